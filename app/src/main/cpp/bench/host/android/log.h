@@ -0,0 +1,39 @@
+/*
+ * SovereignDroid - Host stand-in for <android/log.h>
+ *
+ * Lets the storage sources build for a Linux host (bench/host). Info and
+ * debug messages are dropped so they do not skew timings; warnings and
+ * errors go to stderr.
+ */
+
+#ifndef SOVEREIGNDROID_HOST_ANDROID_LOG_H
+#define SOVEREIGNDROID_HOST_ANDROID_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+static inline int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    if (prio < ANDROID_LOG_WARN) return 0;
+
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return 1;
+}
+
+#endif // SOVEREIGNDROID_HOST_ANDROID_LOG_H
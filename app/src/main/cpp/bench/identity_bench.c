@@ -0,0 +1,189 @@
+/*
+ * SovereignDroid Device Identity - Subkey Derivation Benchmark
+ *
+ * Standalone executable (CMake option SOVEREIGN_IDENTITY_BENCH). Creates
+ * a device identity, then derives SLIP-10 subkeys three ways and reports
+ * derivations per second and HMAC-SHA512 calls per derivation:
+ *   cold    every path has a new first index: only the master node is cached
+ *   shared  leaves below one cached parent (one HMAC each)
+ *   public  as shared, plus each leaf's public key
+ * then times ephemeral keypair takes: generated inline, from the pool
+ * with idle time between sessions, and from the pool in one burst. The
+ * refill columns start at the first take out of a full pool, so they
+ * include the drain to half and follow the take rate of each run.
+ *
+ * Usage (device, as the shell user):
+ *   adb push identity_bench /data/local/tmp/
+ *   adb shell /data/local/tmp/identity_bench /data/local/tmp/idbench [derivations]
+ *
+ * The directory must not hold a real store: the benchmark writes its own
+ * master key and identity there.
+ */
+
+#include "device_identity.h"
+#include "secure_storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_DERIVATIONS 20000
+#define BENCH_DEPTH 3
+#define BENCH_EPHEMERAL_TAKES 2000
+#define BENCH_EPHEMERAL_POOL 32
+#define BENCH_SESSION_GAP_US 2000
+
+typedef enum {
+    PHASE_COLD,
+    PHASE_SHARED,
+    PHASE_PUBLIC,
+    PHASE_COUNT
+} bench_phase_t;
+
+static const char* g_phase_names[PHASE_COUNT] = { "cold", "shared", "public" };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Run one phase; returns derivations per second, 0 on error
+ */
+static double run_phase(bench_phase_t phase, int derivations, double* hmacs_per_derivation) {
+    identity_derive_stats_t before, after;
+    uint8_t key[32];
+    uint8_t public_key[32];
+    device_identity_get_derive_stats(&before);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < derivations; i++) {
+        uint32_t path[BENCH_DEPTH];
+        if (phase == PHASE_COLD) {
+            path[0] = 1000 + (uint32_t)i;
+            path[1] = 0;
+            path[2] = 0;
+        } else {
+            path[0] = 44;
+            path[1] = 1;
+            path[2] = (uint32_t)i;
+        }
+        if (device_identity_derive_keypair(path, BENCH_DEPTH,
+                                           phase == PHASE_PUBLIC ? public_key : NULL,
+                                           key) != IDENTITY_OK) {
+            return 0.0;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    device_identity_get_derive_stats(&after);
+    *hmacs_per_derivation = (double)(after.hmacs - before.hmacs) / derivations;
+    return elapsed > 0 ? derivations / (elapsed / 1e9) : 0.0;
+}
+
+/*
+ * Take count ephemeral keypairs, sleeping gap_us between takes
+ * Returns the mean take latency in microseconds, negative on error
+ */
+static double run_ephemeral(int count, unsigned gap_us) {
+    uint8_t public_key[32];
+    uint8_t private_key[32];
+    uint64_t total = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (gap_us) {
+            usleep(gap_us);
+        }
+        uint64_t start = now_ns();
+        if (device_identity_ephemeral_take(public_key, private_key) != IDENTITY_OK) {
+            return -1.0;
+        }
+        total += now_ns() - start;
+    }
+    return total / 1e3 / count;
+}
+
+static void print_ephemeral(const char* name, double take_us) {
+    identity_ephemeral_stats_t stats;
+    device_identity_ephemeral_get_stats(&stats);
+    printf("%-8s %12.2f %9.1f%% %12.0f %12llu\n", name, take_us, stats.hit_rate * 100.0f,
+           stats.refill_avg_us, (unsigned long long)stats.refill_max_us);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir> [derivations]\n", argv[0]);
+        return 2;
+    }
+
+    const char* dir = argv[1];
+    int derivations = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_DERIVATIONS;
+    if (derivations < 1) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    if (!secure_storage_set_root(dir) || !secure_storage_initialize()) {
+        fprintf(stderr, "failed to open store in %s\n", dir);
+        return 1;
+    }
+    device_identity_init();
+    if (device_identity_generate() != IDENTITY_OK) {
+        fprintf(stderr, "failed to create identity\n");
+        secure_storage_shutdown();
+        return 1;
+    }
+
+    printf("%d derivations per phase, depth %d\n", derivations, BENCH_DEPTH);
+    printf("%-8s %16s %14s\n", "phase", "derivations/s", "HMACs/deriv");
+
+    int failed = 0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        double hmacs = 0.0;
+        double rate = run_phase((bench_phase_t)phase, derivations, &hmacs);
+        if (rate <= 0.0) {
+            fprintf(stderr, "%s phase failed\n", g_phase_names[phase]);
+            failed = 1;
+            continue;
+        }
+        printf("%-8s %16.0f %14.2f\n", g_phase_names[phase], rate, hmacs);
+    }
+
+    identity_derive_stats_t stats;
+    device_identity_get_derive_stats(&stats);
+    printf("cached nodes: %zu, derivations below a cached node: %llu of %llu\n",
+           stats.cached_nodes, (unsigned long long)stats.node_hits,
+           (unsigned long long)stats.derivations);
+
+    // Ephemeral keypairs: inline baseline, then the pool (fresh stats each run)
+    printf("\n%d ephemeral takes, pool of %d\n", BENCH_EPHEMERAL_TAKES, BENCH_EPHEMERAL_POOL);
+    printf("%-8s %12s %10s %12s %12s\n", "takes", "take us", "hit rate", "refill us", "refill max");
+    double inline_us = run_ephemeral(BENCH_EPHEMERAL_TAKES, 0);
+    print_ephemeral("inline", inline_us);
+
+    const char* pooled_names[2] = { "idle", "burst" };
+    const unsigned gaps[2] = { BENCH_SESSION_GAP_US, 0 };
+    for (int i = 0; i < 2 && inline_us >= 0.0; i++) {
+        device_identity_ephemeral_stop();
+        if (device_identity_ephemeral_start(BENCH_EPHEMERAL_POOL) != IDENTITY_OK) {
+            inline_us = -1.0;
+            break;
+        }
+        // Let the pool fill before the sessions start
+        identity_ephemeral_stats_t stats;
+        do {
+            usleep(10000);
+            device_identity_ephemeral_get_stats(&stats);
+        } while (stats.available < stats.capacity);
+        print_ephemeral(pooled_names[i], run_ephemeral(BENCH_EPHEMERAL_TAKES, gaps[i]));
+    }
+    device_identity_ephemeral_stop();
+    if (inline_us < 0.0) {
+        fprintf(stderr, "ephemeral takes failed\n");
+        failed = 1;
+    }
+
+    secure_storage_shutdown();
+    return failed;
+}
@@ -0,0 +1,326 @@
+/*
+ * SovereignDroid Secure Storage - JNI Binding Overhead Benchmark
+ *
+ * Standalone executable (CMake option SOVEREIGN_STORAGE_JNI_BENCH). Calls
+ * the SecureStorage JNI entry points for small values and compares each
+ * against the plain C API, so the difference is what the binding itself
+ * costs: string conversions, VM allocations and extra copies.
+ *
+ * There is no VM in a shell executable, so the entry points get a minimal
+ * JNIEnv that behaves like ART for the calls they make: strings are held
+ * as UTF-16 and converted on every Get/NewStringUTF, byte[] data is not
+ * moved (critical access returns it directly), and every VM-side
+ * allocation is counted. The fixed Java->native transition is not
+ * included; it is the same for every binding.
+ *
+ * fsync is off for the run so disk latency does not hide the binding cost.
+ *
+ * Usage (device, as the shell user):
+ *   adb push jni_bench /data/local/tmp/
+ *   adb shell /data/local/tmp/jni_bench /data/local/tmp/jnibench [iterations]
+ *
+ * The directory must not hold a real store.
+ */
+
+#include "secure_storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_ITERATIONS 20000
+#define BENCH_KEYS 64
+
+static const size_t g_value_sizes[] = { 16, 64, 256, 1024 };
+
+/*
+ * ========================================================================
+ * Host-side JNIEnv
+ * ========================================================================
+ */
+
+typedef struct {
+    jsize length;               // UTF-16 units (ASCII only here)
+    jchar chars[];
+} bench_string_t;
+
+typedef struct {
+    jsize length;
+    jbyte data[];
+} bench_array_t;
+
+typedef struct {
+    void* address;
+    jlong capacity;
+} bench_direct_buffer_t;
+
+static uint64_t g_vm_allocs;
+
+static void* vm_alloc(size_t len) {
+    g_vm_allocs++;
+    return malloc(len);
+}
+
+static jstring bench_new_string(const char* utf) {
+    size_t len = strlen(utf);
+    bench_string_t* s = vm_alloc(sizeof(*s) + len * sizeof(jchar));
+    s->length = (jsize)len;
+    for (size_t i = 0; i < len; i++) s->chars[i] = (jchar)(unsigned char)utf[i];
+    return s;
+}
+
+static jsize env_get_string_length(JNIEnv* env, jstring str) {
+    return ((bench_string_t*)str)->length;
+}
+
+static jsize env_get_string_utf_length(JNIEnv* env, jstring str) {
+    return ((bench_string_t*)str)->length;
+}
+
+static const char* env_get_string_utf_chars(JNIEnv* env, jstring str, jboolean* is_copy) {
+    bench_string_t* s = str;
+    char* utf = vm_alloc((size_t)s->length + 1);
+    for (jsize i = 0; i < s->length; i++) utf[i] = (char)s->chars[i];
+    utf[s->length] = '\0';
+    if (is_copy) *is_copy = JNI_TRUE;
+    return utf;
+}
+
+static void env_release_string_utf_chars(JNIEnv* env, jstring str, const char* utf) {
+    free((void*)utf);
+}
+
+static void env_get_string_utf_region(JNIEnv* env, jstring str, jsize start, jsize len, char* buf) {
+    bench_string_t* s = str;
+    for (jsize i = 0; i < len; i++) buf[i] = (char)s->chars[start + i];
+    buf[len] = '\0';
+}
+
+static jstring env_new_string_utf(JNIEnv* env, const char* utf) {
+    return bench_new_string(utf);
+}
+
+static jbyteArray env_new_byte_array(JNIEnv* env, jsize len) {
+    bench_array_t* a = vm_alloc(sizeof(*a) + (size_t)len);
+    a->length = len;
+    memset(a->data, 0, (size_t)len);
+    return a;
+}
+
+static jsize env_get_array_length(JNIEnv* env, jarray array) {
+    return ((bench_array_t*)array)->length;
+}
+
+static void env_get_byte_array_region(JNIEnv* env, jbyteArray array, jsize start, jsize len,
+                                      jbyte* buf) {
+    memcpy(buf, ((bench_array_t*)array)->data + start, (size_t)len);
+}
+
+static void env_set_byte_array_region(JNIEnv* env, jbyteArray array, jsize start, jsize len,
+                                      const jbyte* buf) {
+    memcpy(((bench_array_t*)array)->data + start, buf, (size_t)len);
+}
+
+static void* env_get_primitive_array_critical(JNIEnv* env, jarray array, jboolean* is_copy) {
+    if (is_copy) *is_copy = JNI_FALSE;
+    return ((bench_array_t*)array)->data;
+}
+
+static void env_release_primitive_array_critical(JNIEnv* env, jarray array, void* data, jint mode) {
+}
+
+static void* env_get_direct_buffer_address(JNIEnv* env, jobject buffer) {
+    return ((bench_direct_buffer_t*)buffer)->address;
+}
+
+static jlong env_get_direct_buffer_capacity(JNIEnv* env, jobject buffer) {
+    return ((bench_direct_buffer_t*)buffer)->capacity;
+}
+
+static void env_delete_local_ref(JNIEnv* env, jobject obj) {
+    free(obj);
+}
+
+static const struct JNINativeInterface g_bench_functions = {
+    .GetStringLength = env_get_string_length,
+    .GetStringUTFLength = env_get_string_utf_length,
+    .GetStringUTFChars = env_get_string_utf_chars,
+    .ReleaseStringUTFChars = env_release_string_utf_chars,
+    .GetStringUTFRegion = env_get_string_utf_region,
+    .NewStringUTF = env_new_string_utf,
+    .NewByteArray = env_new_byte_array,
+    .GetArrayLength = env_get_array_length,
+    .GetByteArrayRegion = env_get_byte_array_region,
+    .SetByteArrayRegion = env_set_byte_array_region,
+    .GetPrimitiveArrayCritical = env_get_primitive_array_critical,
+    .ReleasePrimitiveArrayCritical = env_release_primitive_array_critical,
+    .GetDirectBufferAddress = env_get_direct_buffer_address,
+    .GetDirectBufferCapacity = env_get_direct_buffer_capacity,
+    .DeleteLocalRef = env_delete_local_ref,
+};
+
+static JNIEnv g_env = &g_bench_functions;
+
+/*
+ * ========================================================================
+ * Benchmark
+ * ========================================================================
+ */
+
+enum {
+    PATH_NATIVE,                // secure_storage_store / retrieve
+    PATH_STRING,                // storeSecure / retrieveSecure
+    PATH_BYTES,                 // storeBytes / retrieveBytes
+    PATH_BUFFER,                // storeBuffer / retrieveBuffer
+    PATH_COUNT
+};
+
+static const char* g_path_names[PATH_COUNT] = { "C API", "String", "byte[]", "ByteBuffer" };
+
+typedef struct {
+    jstring keys[BENCH_KEYS];   // Java-side key strings
+    char names[BENCH_KEYS][32];
+    jstring string_value;
+    jbyteArray bytes_value;
+    bench_direct_buffer_t buffer;
+    uint8_t* native_value;
+    size_t value_size;
+} bench_data_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int run_store(int path, bench_data_t* d, int i) {
+    int k = i % BENCH_KEYS;
+    switch (path) {
+    case PATH_NATIVE:
+        return secure_storage_store(d->names[k], d->native_value, d->value_size) == 0;
+    case PATH_STRING:
+        return Java_com_sovereigndroid_core_SecureStorage_storeSecure(&g_env, NULL, d->keys[k],
+                                                                      d->string_value);
+    case PATH_BYTES:
+        return Java_com_sovereigndroid_core_SecureStorage_storeBytes(&g_env, NULL, d->keys[k],
+                                                                     d->bytes_value);
+    default:
+        return Java_com_sovereigndroid_core_SecureStorage_storeBuffer(&g_env, NULL, d->keys[k],
+                                                                      &d->buffer,
+                                                                      (jint)d->value_size);
+    }
+}
+
+static int run_retrieve(int path, bench_data_t* d, int i) {
+    int k = i % BENCH_KEYS;
+    void* result;
+    switch (path) {
+    case PATH_NATIVE:
+        return secure_storage_retrieve(d->names[k], d->native_value, d->value_size) == 0;
+    case PATH_STRING:
+        result = Java_com_sovereigndroid_core_SecureStorage_retrieveSecure(&g_env, NULL, d->keys[k]);
+        break;
+    case PATH_BYTES:
+        result = Java_com_sovereigndroid_core_SecureStorage_retrieveBytes(&g_env, NULL, d->keys[k]);
+        break;
+    default:
+        return Java_com_sovereigndroid_core_SecureStorage_retrieveBuffer(&g_env, NULL, d->keys[k],
+                                                                         &d->buffer) ==
+               (jint)d->value_size;
+    }
+    // The caller drops its reference; the VM would collect it
+    free(result);
+    return result != NULL;
+}
+
+/*
+ * Time one path; returns ns per call and sets allocs to VM allocations per call
+ */
+static double time_path(int (*op)(int, bench_data_t*, int), int path, bench_data_t* d,
+                        int iterations, double* allocs, int* failed) {
+    uint64_t allocs_before = g_vm_allocs;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        if (!op(path, d, i)) (*failed)++;
+    }
+    uint64_t elapsed = now_ns() - start;
+    *allocs = (double)(g_vm_allocs - allocs_before) / iterations;
+    return (double)elapsed / iterations;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir> [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    int iterations = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < BENCH_KEYS) {
+        fprintf(stderr, "iterations must be at least %d\n", BENCH_KEYS);
+        return 2;
+    }
+
+    if (!secure_storage_set_root(argv[1]) || !secure_storage_initialize()) {
+        fprintf(stderr, "failed to open store in %s\n", argv[1]);
+        return 1;
+    }
+    secure_storage_set_durability(SECURE_STORAGE_DURABILITY_LAZY);
+
+    bench_data_t d;
+    for (int k = 0; k < BENCH_KEYS; k++) {
+        snprintf(d.names[k], sizeof(d.names[k]), "jni/key/%04d", k);
+        d.keys[k] = bench_new_string(d.names[k]);
+    }
+
+    printf("%-6s %-10s %12s %12s %12s %12s\n", "size", "binding", "store ns", "retrieve ns",
+           "overhead ns", "vm allocs");
+
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(g_value_sizes) / sizeof(g_value_sizes[0]); s++) {
+        d.value_size = g_value_sizes[s];
+
+        // Printable values so the String binding round-trips them too
+        char* text = malloc(d.value_size + 1);
+        for (size_t i = 0; i < d.value_size; i++) text[i] = (char)('a' + i % 26);
+        text[d.value_size] = '\0';
+        d.string_value = bench_new_string(text);
+        d.bytes_value = env_new_byte_array(&g_env, (jsize)d.value_size);
+        memcpy(((bench_array_t*)d.bytes_value)->data, text, d.value_size);
+        d.native_value = malloc(d.value_size);
+        memcpy(d.native_value, text, d.value_size);
+        d.buffer.address = malloc(d.value_size);
+        d.buffer.capacity = (jlong)d.value_size;
+        memcpy(d.buffer.address, text, d.value_size);
+
+        double native_ns = 0;
+        for (int path = 0; path < PATH_COUNT; path++) {
+            // Warm up: populate keys and fault in the segment
+            double allocs, retrieve_allocs;
+            time_path(run_store, path, &d, BENCH_KEYS, &allocs, &failed);
+
+            double store_ns = time_path(run_store, path, &d, iterations, &allocs, &failed);
+            double retrieve_ns = time_path(run_retrieve, path, &d, iterations, &retrieve_allocs,
+                                           &failed);
+            if (path == PATH_NATIVE) native_ns = store_ns + retrieve_ns;
+
+            printf("%-6zu %-10s %12.0f %12.0f %12.0f %12.1f\n", d.value_size, g_path_names[path],
+                   store_ns, retrieve_ns, store_ns + retrieve_ns - native_ns,
+                   allocs + retrieve_allocs);
+        }
+
+        free(text);
+        free(d.string_value);
+        free(d.bytes_value);
+        free(d.native_value);
+        free(d.buffer.address);
+    }
+
+    for (int k = 0; k < BENCH_KEYS; k++) free(d.keys[k]);
+    secure_storage_shutdown();
+
+    if (failed) {
+        fprintf(stderr, "%d calls failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * SovereignDroid Secure Storage - Multi-threaded Scaling Benchmark
+ *
+ * Standalone executable (CMake option SOVEREIGN_STORAGE_BENCH). Preloads a
+ * key set, then runs get-only and mixed get/put phases at 1, 2, 4, ...
+ * threads and reports throughput relative to one thread.
+ *
+ * Usage (device, as the shell user):
+ *   adb push storage_bench /data/local/tmp/
+ *   adb shell /data/local/tmp/storage_bench /data/local/tmp/bench [threads] [keys] [value_size] [seconds]
+ *
+ * The directory must not hold a real store: the benchmark writes its own
+ * master key there.
+ */
+
+#include "secure_storage.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_THREADS 8
+#define BENCH_DEFAULT_KEYS 1024
+#define BENCH_DEFAULT_VALUE_SIZE 256
+#define BENCH_DEFAULT_SECONDS 2
+#define BENCH_MIXED_PUT_PERCENT 10
+
+typedef struct {
+    int keys;
+    size_t value_size;
+    int put_percent;
+    int* stop;
+    uint32_t seed;
+    uint64_t ops;
+    uint64_t errors;
+} bench_worker_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t next_random(uint32_t* state) {
+    // xorshift32: cheap enough not to show up in the profile
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void key_name(int index, char* out, size_t out_len) {
+    snprintf(out, out_len, "bench/key/%06d", index);
+}
+
+static void* bench_thread(void* arg) {
+    bench_worker_t* w = (bench_worker_t*)arg;
+    uint8_t* value = malloc(w->value_size);
+    if (!value) {
+        w->errors++;
+        return NULL;
+    }
+    memset(value, 0xA5, w->value_size);
+
+    char key[32];
+    while (!__atomic_load_n(w->stop, __ATOMIC_RELAXED)) {
+        uint32_t r = next_random(&w->seed);
+        key_name((int)(r % (uint32_t)w->keys), key, sizeof(key));
+
+        int result;
+        if ((int)((r >> 16) % 100) < w->put_percent) {
+            result = secure_storage_store(key, value, w->value_size);
+        } else {
+            result = secure_storage_retrieve(key, value, w->value_size);
+        }
+
+        if (result == 0) w->ops++;
+        else w->errors++;
+    }
+
+    free(value);
+    return NULL;
+}
+
+/*
+ * Run one phase at the given thread count
+ * Returns ops per second
+ */
+static double run_phase(int threads, int keys, size_t value_size, int put_percent,
+                        int seconds, uint64_t* errors) {
+    pthread_t tids[64];
+    bench_worker_t workers[64];
+    int stop = 0;
+
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (bench_worker_t){
+            .keys = keys,
+            .value_size = value_size,
+            .put_percent = put_percent,
+            .stop = &stop,
+            .seed = 0x9E3779B9u * (uint32_t)(i + 1),
+        };
+    }
+
+    uint64_t start = now_ns();
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, bench_thread, &workers[i]) != 0) break;
+        started++;
+    }
+
+    struct timespec duration = { .tv_sec = seconds, .tv_nsec = 0 };
+    nanosleep(&duration, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+
+    uint64_t ops = 0;
+    *errors = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        ops += workers[i].ops;
+        *errors += workers[i].errors;
+    }
+
+    double elapsed = (double)(now_ns() - start) / 1e9;
+    return (double)ops / elapsed;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir> [threads] [keys] [value_size] [seconds]\n", argv[0]);
+        return 2;
+    }
+
+    const char* dir = argv[1];
+    int max_threads = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_THREADS;
+    int keys = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_KEYS;
+    size_t value_size = argc > 4 ? (size_t)atol(argv[4]) : BENCH_DEFAULT_VALUE_SIZE;
+    int seconds = argc > 5 ? atoi(argv[5]) : BENCH_DEFAULT_SECONDS;
+
+    if (max_threads < 1 || max_threads > 64 || keys < 1 || value_size == 0 || seconds < 1) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    if (!secure_storage_set_root(dir) || !secure_storage_initialize()) {
+        fprintf(stderr, "failed to open store in %s\n", dir);
+        return 1;
+    }
+
+    // Preload every key so gets never miss
+    uint8_t* value = calloc(1, value_size);
+    char key[32];
+    for (int i = 0; value && i < keys; i++) {
+        key_name(i, key, sizeof(key));
+        if (secure_storage_store(key, value, value_size) != 0) {
+            fprintf(stderr, "preload failed at key %d\n", i);
+            free(value);
+            secure_storage_shutdown();
+            return 1;
+        }
+    }
+    free(value);
+
+    printf("keys=%d value=%zu bytes, %d s per run, mixed = %d%% put\n",
+           keys, value_size, seconds, BENCH_MIXED_PUT_PERCENT);
+    printf("%-8s %14s %8s %14s %8s\n", "threads", "get ops/s", "scale", "mixed ops/s", "scale");
+
+    double get_base = 0.0, mixed_base = 0.0;
+    int failed = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        uint64_t get_errors, mixed_errors;
+        double get_rate = run_phase(threads, keys, value_size, 0, seconds, &get_errors);
+        double mixed_rate = run_phase(threads, keys, value_size, BENCH_MIXED_PUT_PERCENT,
+                                      seconds, &mixed_errors);
+
+        if (threads == 1) {
+            get_base = get_rate;
+            mixed_base = mixed_rate;
+        }
+        printf("%-8d %14.0f %7.2fx %14.0f %7.2fx\n", threads,
+               get_rate, get_base > 0 ? get_rate / get_base : 0.0,
+               mixed_rate, mixed_base > 0 ? mixed_rate / mixed_base : 0.0);
+
+        if (get_errors || mixed_errors) {
+            fprintf(stderr, "  %llu get / %llu mixed errors\n",
+                    (unsigned long long)get_errors, (unsigned long long)mixed_errors);
+            failed = 1;
+        }
+    }
+
+    secure_storage_shutdown();
+    return failed;
+}
@@ -0,0 +1,343 @@
+/*
+ * SovereignDroid Secure Storage - Crash Injection Harness
+ *
+ * Standalone executable (CMake option SOVEREIGN_STORAGE_CRASH_TEST).
+ * Every round forks a writer that stores and deletes keys, reporting each
+ * operation to the parent before and after it runs. The parent SIGKILLs
+ * the writer at a random moment, optionally damages the tail of the newest
+ * segment the way a power cut would (garbage, or a complete-looking record
+ * whose checksum does not match), then reopens the store and checks:
+ *
+ * - every acknowledged operation survived
+ * - the one operation in flight either fully happened or not at all
+ * - no value fails authentication
+ *
+ * SIGKILL keeps the page cache, so the torn tails are injected explicitly.
+ *
+ * Usage (device, as the shell user):
+ *   adb push storage_crash_test /data/local/tmp/
+ *   adb shell /data/local/tmp/storage_crash_test /data/local/tmp/crash [rounds] [keys]
+ *
+ * The directory must not hold a real store.
+ */
+
+#include "secure_storage.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CRASH_DEFAULT_ROUNDS 40
+#define CRASH_DEFAULT_KEYS 64
+#define CRASH_MAX_KEYS 4096
+#define CRASH_MAX_VALUE 6000
+#define CRASH_DELETE_PERCENT 15
+
+// Damage applied to the newest segment after the kill
+enum { DAMAGE_NONE, DAMAGE_GARBAGE, DAMAGE_BAD_CHECKSUM, DAMAGE_KINDS };
+
+enum { OP_PUT = 1, OP_DELETE = 2 };
+
+// Writer -> parent message; small enough for an atomic pipe write
+typedef struct {
+    uint32_t key;
+    uint32_t version;
+    uint8_t op;
+    uint8_t done;           // 0 = about to run, 1 = returned
+    uint8_t ok;             // Returned success (deleting an absent key fails)
+} crash_msg_t;
+
+typedef struct {
+    uint32_t version;       // 0 = never written
+    uint8_t op;
+} key_state_t;
+
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void key_name(uint32_t key, char* out, size_t out_len) {
+    snprintf(out, out_len, "crash/key/%04u", key);
+}
+
+// Deterministic value for (key, version); returns its length
+static size_t make_value(uint32_t key, uint32_t version, uint8_t* out) {
+    uint32_t state = (key * 2654435761u) ^ (version * 40503u) ^ 0xA5A5A5A5u;
+    if (!state) state = 1;
+    size_t len = 1 + next_random(&state) % CRASH_MAX_VALUE;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)next_random(&state);
+    }
+    return len;
+}
+
+static void write_msg(int fd, const crash_msg_t* msg) {
+    while (write(fd, msg, sizeof(*msg)) < 0) {
+    }
+}
+
+/*
+ * Child: run operations until killed
+ */
+static void run_writer(int fd, const key_state_t* state, int keys, uint32_t seed) {
+    if (!secure_storage_initialize()) {
+        _exit(3);
+    }
+
+    uint32_t* versions = malloc((size_t)keys * sizeof(uint32_t));
+    for (int i = 0; i < keys; i++) versions[i] = state[i].version;
+
+    uint8_t value[CRASH_MAX_VALUE];
+    char name[32];
+    for (;;) {
+        uint32_t r = next_random(&seed);
+        crash_msg_t msg = {
+            .key = r % (uint32_t)keys,
+            .op = ((r >> 16) % 100 < CRASH_DELETE_PERCENT) ? OP_DELETE : OP_PUT,
+        };
+        msg.version = ++versions[msg.key];
+        key_name(msg.key, name, sizeof(name));
+
+        write_msg(fd, &msg);
+        int result;
+        if (msg.op == OP_PUT) {
+            size_t len = make_value(msg.key, msg.version, value);
+            result = secure_storage_store(name, value, len);
+        } else {
+            result = secure_storage_delete(name);
+        }
+
+        msg.done = 1;
+        msg.ok = (result == 0);
+        write_msg(fd, &msg);
+    }
+}
+
+static int newest_segment(const char* dir, char* path, size_t path_len) {
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+
+    unsigned int best = 0;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        unsigned int id;
+        if (sscanf(ent->d_name, "seg-%8x.log", &id) == 1 && id > best) best = id;
+    }
+    closedir(d);
+
+    if (!best) return 0;
+    snprintf(path, path_len, "%s/seg-%08x.log", dir, best);
+    return 1;
+}
+
+/*
+ * Append a torn tail to the newest segment
+ * Returns the number of bytes appended
+ */
+static size_t damage_tail(const char* dir, int kind, uint32_t* seed) {
+    char path[512];
+    if (kind == DAMAGE_NONE || !newest_segment(dir, path, sizeof(path))) return 0;
+
+    uint8_t tail[512];
+    size_t len = 1 + next_random(seed) % sizeof(tail);
+    for (size_t i = 0; i < len; i++) tail[i] = (uint8_t)next_random(seed);
+
+    if (kind == DAMAGE_BAD_CHECKSUM) {
+        // Well-formed v3 PUT header whose payload is all there but random
+        static const uint8_t magic[4] = { 'S', 'D', 'R', 'L' };
+        len = 48 + 64;
+        memcpy(tail, magic, 4);
+        tail[4] = 3;
+        tail[5] = 1;
+        tail[6] = tail[7] = 0;
+        tail[8] = 64;
+        tail[9] = tail[10] = tail[11] = 0;
+    }
+
+    int fd = open(path, O_WRONLY | O_APPEND);
+    if (fd < 0) return 0;
+    ssize_t n = write(fd, tail, len);
+    close(fd);
+    return n > 0 ? (size_t)n : 0;
+}
+
+/*
+ * Check one key against the acknowledged state and the operation that
+ * was in flight when the writer died
+ */
+static int verify_key(uint32_t key, const key_state_t* acked, const crash_msg_t* pending) {
+    static uint8_t expected[CRASH_MAX_VALUE], actual[CRASH_MAX_VALUE];
+    char name[32];
+    key_name(key, name, sizeof(name));
+
+    size_t size = 0;
+    int present = (secure_storage_get_size(name, &size) == 0);
+    if (present && (size > CRASH_MAX_VALUE || secure_storage_retrieve(name, actual, size) != 0)) {
+        fprintf(stderr, "  %s: present but unreadable\n", name);
+        return 0;
+    }
+
+    // Candidate states: the acknowledged one, and the in-flight one
+    key_state_t candidates[2] = { *acked, { 0, 0 } };
+    int count = 1;
+    if (pending && pending->key == key) {
+        candidates[1].version = pending->version;
+        candidates[1].op = pending->op;
+        count = 2;
+    }
+
+    for (int i = 0; i < count; i++) {
+        // Deleting an absent key leaves it absent, so a delete (or nothing) means absent
+        if (candidates[i].op != OP_PUT) {
+            if (!present) return 1;
+            continue;
+        }
+        size_t len = make_value(key, candidates[i].version, expected);
+        if (present && size == len && memcmp(actual, expected, len) == 0) return 1;
+    }
+
+    fprintf(stderr, "  %s: %s, expected version %u%s\n", name, present ? "wrong value" : "missing",
+            acked->version, count > 1 ? " or the in-flight one" : "");
+    return 0;
+}
+
+/*
+ * Adopt the in-flight operation if recovery kept it
+ */
+static void settle_pending(const crash_msg_t* pending, key_state_t* state) {
+    static uint8_t expected[CRASH_MAX_VALUE], actual[CRASH_MAX_VALUE];
+    char name[32];
+    key_name(pending->key, name, sizeof(name));
+
+    size_t size = 0;
+    int present = (secure_storage_get_size(name, &size) == 0);
+    int applied;
+    if (pending->op == OP_DELETE) {
+        applied = !present;
+    } else {
+        size_t len = make_value(pending->key, pending->version, expected);
+        applied = present && size == len && secure_storage_retrieve(name, actual, size) == 0 &&
+                  memcmp(actual, expected, len) == 0;
+    }
+
+    if (applied) {
+        state->version = pending->version;
+        state->op = pending->op;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir> [rounds] [keys]\n", argv[0]);
+        return 2;
+    }
+
+    const char* dir = argv[1];
+    int rounds = argc > 2 ? atoi(argv[2]) : CRASH_DEFAULT_ROUNDS;
+    int keys = argc > 3 ? atoi(argv[3]) : CRASH_DEFAULT_KEYS;
+    if (rounds < 1 || keys < 1 || keys > CRASH_MAX_KEYS) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    if (!secure_storage_set_root(dir)) {
+        fprintf(stderr, "failed to use %s\n", dir);
+        return 1;
+    }
+
+    key_state_t* state = calloc((size_t)keys, sizeof(key_state_t));
+    uint32_t seed = (uint32_t)time(NULL) | 1u;
+    uint64_t total_acked = 0, max_recovery_us = 0;
+    int failures = 0;
+
+    printf("%-6s %8s %8s %10s %12s %10s\n", "round", "acked", "damage", "recovery", "scanned", "checkpoint");
+
+    for (int round = 0; round < rounds; round++) {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) return 1;
+
+        uint32_t child_seed = next_random(&seed) | 1u;
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(pipe_fds[0]);
+            run_writer(pipe_fds[1], state, keys, child_seed);
+            _exit(0);
+        }
+        close(pipe_fds[1]);
+
+        // Let it get going (includes its own recovery), then kill it
+        struct timespec delay = { 0, (long)(20 + next_random(&seed) % 200) * 1000000L };
+        nanosleep(&delay, NULL);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+
+        crash_msg_t msg, pending;
+        int has_pending = 0;
+        uint64_t acked = 0;
+        while (read(pipe_fds[0], &msg, sizeof(msg)) == (ssize_t)sizeof(msg)) {
+            if (!msg.done) {
+                pending = msg;
+                has_pending = 1;
+                continue;
+            }
+            has_pending = 0;
+            if (msg.ok) {
+                state[msg.key].version = msg.version;
+                state[msg.key].op = msg.op;
+                acked++;
+            }
+        }
+        close(pipe_fds[0]);
+        total_acked += acked;
+
+        int kind = round % DAMAGE_KINDS;
+        size_t damaged = damage_tail(dir, kind, &seed);
+
+        if (!secure_storage_initialize()) {
+            fprintf(stderr, "round %d: store failed to open\n", round);
+            failures++;
+            break;
+        }
+
+        storage_log_metrics_t metrics;
+        secure_storage_get_metrics(&metrics);
+        if (metrics.recovery_us > max_recovery_us) max_recovery_us = metrics.recovery_us;
+
+        int bad = 0;
+        for (int k = 0; k < keys; k++) {
+            if (!verify_key((uint32_t)k, &state[k], has_pending ? &pending : NULL)) bad++;
+        }
+
+        if (has_pending) {
+            settle_pending(&pending, &state[pending.key]);
+        }
+
+        printf("%-6d %8llu %8zu %8llu us %12llu %10s\n", round, (unsigned long long)acked, damaged,
+               (unsigned long long)metrics.recovery_us,
+               (unsigned long long)metrics.recovery_bytes_scanned,
+               metrics.recovered_from_checkpoint ? "yes" : "no");
+        if (bad) {
+            fprintf(stderr, "round %d: %d keys wrong\n", round, bad);
+            failures++;
+        }
+
+        // Clean close: the next writer starts from a fresh checkpoint
+        secure_storage_shutdown();
+    }
+
+    printf("%d rounds, %llu acknowledged operations, max recovery %llu us: %s\n", rounds,
+           (unsigned long long)total_acked, (unsigned long long)max_recovery_us,
+           failures ? "FAILED" : "ok");
+    free(state);
+    return failures ? 1 : 0;
+}
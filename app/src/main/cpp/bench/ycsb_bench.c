@@ -0,0 +1,597 @@
+/*
+ * SovereignDroid Secure Storage - YCSB-style Workload Benchmark
+ *
+ * Standalone executable: CMake option SOVEREIGN_STORAGE_YCSB_BENCH on the
+ * device, or bench/host/CMakeLists.txt on a Linux host (Android logging
+ * stubbed). For every value size and backend it loads a fresh key set,
+ * then runs each workload and reports ops/sec and p50/p99/p999 latency
+ * per operation type.
+ *
+ * Workloads (YCSB core workloads in brackets):
+ *   read-only    100% read                       [C]
+ *   read-heavy   95% read, 5% update             [B]
+ *   balanced     50% read, 50% update            [A]
+ *   write-heavy  5% read, 95% update
+ *   scan         95% scan of 1-100 keys, 5% insert [E]
+ *
+ * Backends:
+ *   log      secure_storage_store / retrieve, value cache off
+ *   cache    the same with the value cache on (-c budget)
+ *   stream   chunked writer / reader API
+ *
+ * Keys are picked Zipfian (theta 0.99, scrambled so hot keys are spread
+ * over the key space, as YCSB does) or uniform over the loaded keys.
+ *
+ * Usage:
+ *   ycsb_bench <dir> [-w workloads] [-b backends] [-v sizes] [-n keys]
+ *              [-o ops] [-t threads] [-d zipfian|uniform] [-c cache_mb] [-s 0|1]
+ *   e.g. ycsb_bench /tmp/ycsb -w read-heavy,scan -v 16,4096,1048576 -n 1000000
+ *
+ * Lists are comma separated. The directory must not hold a real store: it
+ * is cleared before every load.
+ */
+
+#include "secure_storage.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define YCSB_DEFAULT_KEYS 10000
+#define YCSB_DEFAULT_OPS 20000
+#define YCSB_DEFAULT_CACHE_MB 64
+#define YCSB_MAX_THREADS 64
+#define YCSB_MAX_LIST 16
+#define YCSB_ZIPF_THETA 0.99
+#define YCSB_MAX_SCAN 100
+#define YCSB_LOAD_BATCH_BYTES (4 * 1024 * 1024)
+
+/*
+ * ========================================================================
+ * Latency histogram
+ * ========================================================================
+ */
+
+/*
+ * Log-linear buckets: exact below 128 ns, then 64 buckets per power of two
+ * (under 1.6% error) up to 2^40 ns. Recording is one array increment.
+ */
+#define HIST_LINEAR 128
+#define HIST_SUB_BITS 6
+#define HIST_MAX_EXP 40
+#define HIST_BUCKETS (HIST_LINEAR + (HIST_MAX_EXP - 7) * (1 << HIST_SUB_BITS))
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+} histogram_t;
+
+static int hist_bucket(uint64_t ns) {
+    if (ns < HIST_LINEAR) return (int)ns;
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp >= HIST_MAX_EXP) return HIST_BUCKETS - 1;
+    int sub = (int)((ns >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+    return HIST_LINEAR + (exp - 7) * (1 << HIST_SUB_BITS) + sub;
+}
+
+// Lowest value that lands in a bucket
+static uint64_t hist_value(int bucket) {
+    if (bucket < HIST_LINEAR) return (uint64_t)bucket;
+    int exp = (bucket - HIST_LINEAR) / (1 << HIST_SUB_BITS) + 7;
+    uint64_t sub = (uint64_t)((bucket - HIST_LINEAR) % (1 << HIST_SUB_BITS));
+    return ((uint64_t)1 << exp) | (sub << (exp - HIST_SUB_BITS));
+}
+
+static void hist_record(histogram_t* h, uint64_t ns) {
+    h->counts[hist_bucket(ns)]++;
+    h->total++;
+}
+
+static void hist_merge(histogram_t* into, const histogram_t* from) {
+    for (int i = 0; i < HIST_BUCKETS; i++) into->counts[i] += from->counts[i];
+    into->total += from->total;
+}
+
+static uint64_t hist_percentile(const histogram_t* h, double pct) {
+    uint64_t rank = (uint64_t)ceil(pct / 100.0 * (double)h->total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) return hist_value(i);
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+/*
+ * ========================================================================
+ * Key choice
+ * ========================================================================
+ */
+
+static uint64_t next_random(uint64_t* state) {
+    // xorshift64*: cheap enough not to show up in the profile
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double next_unit(uint64_t* state) {
+    return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Zipfian generator over [0, n) from Gray et al., as in YCSB
+typedef struct {
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+    int uniform;
+} key_chooser_t;
+
+static void chooser_init(key_chooser_t* c, uint64_t n, int uniform) {
+    c->n = n;
+    c->uniform = uniform;
+    c->theta = YCSB_ZIPF_THETA;
+    c->alpha = 1.0 / (1.0 - c->theta);
+
+    c->zetan = 0.0;
+    for (uint64_t i = 1; i <= n; i++) c->zetan += 1.0 / pow((double)i, c->theta);
+    double zeta2 = 1.0 + pow(0.5, c->theta);
+    c->eta = (1.0 - pow(2.0 / (double)n, 1.0 - c->theta)) / (1.0 - zeta2 / c->zetan);
+}
+
+static uint64_t fnv1a64(uint64_t value) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ (value & 0xff)) * 0x100000001B3ULL;
+        value >>= 8;
+    }
+    return h;
+}
+
+static uint64_t chooser_next(const key_chooser_t* c, uint64_t* rng) {
+    if (c->uniform) return next_random(rng) % c->n;
+
+    double u = next_unit(rng);
+    double uz = u * c->zetan;
+    uint64_t rank;
+    if (uz < 1.0) rank = 0;
+    else if (uz < 1.0 + pow(0.5, c->theta)) rank = 1;
+    else rank = (uint64_t)((double)c->n * pow(c->eta * u - c->eta + 1.0, c->alpha));
+    if (rank >= c->n) rank = c->n - 1;
+
+    // Scramble so the popular keys are not all neighbours
+    return fnv1a64(rank) % c->n;
+}
+
+static void key_name(uint64_t index, char* out, size_t out_len) {
+    snprintf(out, out_len, "ycsb/%010llu", (unsigned long long)index);
+}
+
+/*
+ * ========================================================================
+ * Backends and workloads
+ * ========================================================================
+ */
+
+enum { BACKEND_LOG, BACKEND_CACHE, BACKEND_STREAM, BACKEND_COUNT };
+
+static const char* g_backend_names[BACKEND_COUNT] = { "log", "cache", "stream" };
+
+enum { OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, OP_COUNT };
+
+static const char* g_op_names[OP_COUNT] = { "read", "update", "insert", "scan" };
+
+typedef struct {
+    const char* name;
+    int percent[OP_COUNT];      // Must add up to 100
+} workload_t;
+
+static const workload_t g_workloads[] = {
+    { "read-only",   { 100, 0, 0, 0 } },
+    { "read-heavy",  { 95, 5, 0, 0 } },
+    { "balanced",    { 50, 50, 0, 0 } },
+    { "write-heavy", { 5, 95, 0, 0 } },
+    { "scan",        { 0, 0, 5, 95 } },
+};
+
+#define WORKLOAD_COUNT ((int)(sizeof(g_workloads) / sizeof(g_workloads[0])))
+
+static int backend_write(int backend, const char* key, const uint8_t* value, size_t len) {
+    if (backend != BACKEND_STREAM) {
+        return secure_storage_store(key, value, len);
+    }
+    secure_storage_writer_t* writer = secure_storage_open_writer(key, 0);
+    if (!writer) return -1;
+    if (secure_storage_write(writer, value, len) != 0) {
+        secure_storage_abort_writer(writer);
+        return -1;
+    }
+    return secure_storage_close_writer(writer);
+}
+
+static int backend_read(int backend, const char* key, uint8_t* buffer, size_t len) {
+    if (backend != BACKEND_STREAM) {
+        return secure_storage_retrieve(key, buffer, len);
+    }
+    secure_storage_reader_t* reader = secure_storage_open_reader(key);
+    if (!reader) return -1;
+    size_t total = 0, got;
+    int result;
+    while ((result = secure_storage_read(reader, buffer + total, len - total, &got)) == 0 && got > 0) {
+        total += got;
+        if (total == len) break;
+    }
+    secure_storage_close_reader(reader);
+    return (result == 0 && total == len) ? 0 : -1;
+}
+
+/*
+ * ========================================================================
+ * Runner
+ * ========================================================================
+ */
+
+typedef struct {
+    const workload_t* workload;
+    const key_chooser_t* chooser;
+    int backend;
+    size_t value_size;
+    uint64_t ops;
+    uint64_t* next_insert;      // Shared: next key index for inserts
+    uint64_t rng;
+    histogram_t* hist;          // OP_COUNT histograms
+    uint64_t errors;
+} ycsb_worker_t;
+
+typedef struct {
+    int backend;
+    uint8_t* buffer;
+    size_t value_size;
+    int remaining;
+    int failed;
+} scan_ctx_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int scan_visit(const char* key, void* ctx) {
+    scan_ctx_t* scan = (scan_ctx_t*)ctx;
+    if (backend_read(scan->backend, key, scan->buffer, scan->value_size) != 0) scan->failed = 1;
+    return --scan->remaining > 0;
+}
+
+static void* ycsb_thread(void* arg) {
+    ycsb_worker_t* w = (ycsb_worker_t*)arg;
+    uint8_t* value = malloc(w->value_size);
+    uint8_t* buffer = malloc(w->value_size);
+    if (!value || !buffer) {
+        free(value);
+        free(buffer);
+        w->errors = w->ops;
+        return NULL;
+    }
+    for (size_t i = 0; i < w->value_size; i++) value[i] = (uint8_t)next_random(&w->rng);
+
+    char key[32], end_key[32];
+    for (uint64_t i = 0; i < w->ops; i++) {
+        int pick = (int)(next_random(&w->rng) % 100);
+        int op = 0;
+        while (op < OP_COUNT - 1 && pick >= w->workload->percent[op]) {
+            pick -= w->workload->percent[op];
+            op++;
+        }
+
+        int result;
+        uint64_t start = now_ns();
+        switch (op) {
+            case OP_READ:
+                key_name(chooser_next(w->chooser, &w->rng), key, sizeof(key));
+                result = backend_read(w->backend, key, buffer, w->value_size);
+                break;
+            case OP_UPDATE:
+                key_name(chooser_next(w->chooser, &w->rng), key, sizeof(key));
+                result = backend_write(w->backend, key, value, w->value_size);
+                break;
+            case OP_INSERT:
+                key_name(__atomic_fetch_add(w->next_insert, 1, __ATOMIC_RELAXED), key, sizeof(key));
+                result = backend_write(w->backend, key, value, w->value_size);
+                break;
+            default: {
+                // Keys are dense and ordered by index, so [first, first + len) holds len keys
+                uint64_t first = chooser_next(w->chooser, &w->rng);
+                int len = 1 + (int)(next_random(&w->rng) % YCSB_MAX_SCAN);
+                key_name(first, key, sizeof(key));
+                key_name(first + (uint64_t)len, end_key, sizeof(end_key));
+                scan_ctx_t scan = { w->backend, buffer, w->value_size, len, 0 };
+                result = (secure_storage_scan(key, end_key, scan_visit, &scan) >= 0 && !scan.failed)
+                         ? 0 : -1;
+                break;
+            }
+        }
+        hist_record(&w->hist[op], now_ns() - start);
+        if (result != 0) w->errors++;
+    }
+
+    free(value);
+    free(buffer);
+    return NULL;
+}
+
+/*
+ * Clear the store and load keys values of value_size through the backend
+ * Returns keys per second, 0 on failure
+ */
+static double load_keys(int backend, uint64_t keys, size_t value_size, uint64_t seed) {
+    if (secure_storage_clear() < 0) return 0.0;
+
+    uint8_t* value = malloc(value_size);
+    size_t batch = YCSB_LOAD_BATCH_BYTES / value_size;
+    if (batch == 0) batch = 1;
+    secure_storage_item_t* items = calloc(batch, sizeof(*items));
+    char (*names)[32] = calloc(batch, sizeof(*names));
+    if (!value || !items || !names) {
+        free(value);
+        free(items);
+        free(names);
+        return 0.0;
+    }
+    for (size_t i = 0; i < value_size; i++) value[i] = (uint8_t)next_random(&seed);
+
+    int failed = 0;
+    uint64_t start = now_ns();
+    for (uint64_t base = 0; !failed && base < keys; base += batch) {
+        size_t count = (keys - base < batch) ? (size_t)(keys - base) : batch;
+        if (backend == BACKEND_STREAM) {
+            for (size_t i = 0; !failed && i < count; i++) {
+                key_name(base + i, names[i], sizeof(names[i]));
+                failed = backend_write(backend, names[i], value, value_size) != 0;
+            }
+        } else {
+            // One log batch per few MB keeps loading 1M keys practical with sync on
+            for (size_t i = 0; i < count; i++) {
+                key_name(base + i, names[i], sizeof(names[i]));
+                items[i] = (secure_storage_item_t){ names[i], value, value_size };
+            }
+            failed = secure_storage_store_many(items, count, NULL) != 0;
+        }
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    free(value);
+    free(items);
+    free(names);
+    return failed ? 0.0 : (double)keys / (elapsed > 0 ? elapsed : 1e-9);
+}
+
+typedef struct {
+    int workloads[WORKLOAD_COUNT];
+    int workload_count;
+    int backends[BACKEND_COUNT];
+    int backend_count;
+    size_t sizes[YCSB_MAX_LIST];
+    int size_count;
+    uint64_t keys;
+    uint64_t ops;
+    int threads;
+    int uniform;
+    size_t cache_bytes;
+    int sync;
+} ycsb_config_t;
+
+/*
+ * Run one workload and print a line per operation type it issued
+ * Returns the number of failed operations
+ */
+static uint64_t run_workload(const ycsb_config_t* cfg, const workload_t* workload, int backend,
+                             size_t value_size, const key_chooser_t* chooser,
+                             uint64_t* next_insert) {
+    pthread_t tids[YCSB_MAX_THREADS];
+    ycsb_worker_t workers[YCSB_MAX_THREADS];
+    histogram_t* hists = calloc((size_t)cfg->threads * OP_COUNT, sizeof(histogram_t));
+    if (!hists) return cfg->ops;
+
+    for (int i = 0; i < cfg->threads; i++) {
+        workers[i] = (ycsb_worker_t){
+            .workload = workload,
+            .chooser = chooser,
+            .backend = backend,
+            .value_size = value_size,
+            .ops = cfg->ops / (uint64_t)cfg->threads + ((uint64_t)i < cfg->ops % (uint64_t)cfg->threads),
+            .next_insert = next_insert,
+            .rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1),
+            .hist = &hists[(size_t)i * OP_COUNT],
+        };
+    }
+
+    uint64_t start = now_ns();
+    int started = 0;
+    for (int i = 0; i < cfg->threads; i++) {
+        if (pthread_create(&tids[i], NULL, ycsb_thread, &workers[i]) != 0) break;
+        started++;
+    }
+    uint64_t errors = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        errors += workers[i].errors;
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    // Fold every thread into the first one's histograms
+    uint64_t done = 0;
+    for (int i = 1; i < started; i++) {
+        for (int op = 0; op < OP_COUNT; op++) hist_merge(&hists[op], &workers[i].hist[op]);
+    }
+    for (int op = 0; op < OP_COUNT; op++) done += hists[op].total;
+    double rate = (double)done / (elapsed > 0 ? elapsed : 1e-9);
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (hists[op].total == 0) continue;
+        printf("%-7s %8zu %-12s %10.0f %-7s %9.1f %9.1f %9.1f\n", g_backend_names[backend],
+               value_size, workload->name, rate, g_op_names[op],
+               hist_percentile(&hists[op], 50.0) / 1e3, hist_percentile(&hists[op], 99.0) / 1e3,
+               hist_percentile(&hists[op], 99.9) / 1e3);
+    }
+    if (started < cfg->threads) errors += cfg->ops - done;
+
+    free(hists);
+    return errors;
+}
+
+/*
+ * ========================================================================
+ * Command line
+ * ========================================================================
+ */
+
+static int lookup(const char* name, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// Split a comma separated list of names into indexes; returns the count, -1 on unknown names
+static int parse_names(char* list, const char* const* names, int count, int* out) {
+    int n = 0;
+    for (char* tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int index = lookup(tok, names, count);
+        if (index < 0 || n == count) {
+            fprintf(stderr, "unknown or repeated name: %s\n", tok);
+            return -1;
+        }
+        out[n++] = index;
+    }
+    return n;
+}
+
+static int parse_sizes(char* list, size_t* out) {
+    int n = 0;
+    for (char* tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        long size = atol(tok);
+        if (size <= 0 || n == YCSB_MAX_LIST) return -1;
+        out[n++] = (size_t)size;
+    }
+    return n;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s <dir> [-w workloads] [-b backends] [-v sizes] [-n keys] [-o ops]\n"
+            "          [-t threads] [-d zipfian|uniform] [-c cache_mb] [-s 0|1]\n"
+            "workloads: read-only read-heavy balanced write-heavy scan\n"
+            "backends:  log cache stream\n", prog);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return 2;
+    }
+    const char* dir = argv[1];
+
+    const char* workload_names[WORKLOAD_COUNT];
+    for (int i = 0; i < WORKLOAD_COUNT; i++) workload_names[i] = g_workloads[i].name;
+
+    char default_workloads[] = "read-heavy,write-heavy,scan";
+    char default_backends[] = "log,cache,stream";
+    char default_sizes[] = "16,1024,65536";
+    char* workloads = default_workloads;
+    char* backends = default_backends;
+    char* sizes = default_sizes;
+
+    ycsb_config_t cfg = {
+        .keys = YCSB_DEFAULT_KEYS,
+        .ops = YCSB_DEFAULT_OPS,
+        .threads = 1,
+        .cache_bytes = (size_t)YCSB_DEFAULT_CACHE_MB << 20,
+        .sync = 1,
+    };
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "w:b:v:n:o:t:d:c:s:")) != -1) {
+        switch (opt) {
+            case 'w': workloads = optarg; break;
+            case 'b': backends = optarg; break;
+            case 'v': sizes = optarg; break;
+            case 'n': cfg.keys = strtoull(optarg, NULL, 10); break;
+            case 'o': cfg.ops = strtoull(optarg, NULL, 10); break;
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'd': cfg.uniform = strcmp(optarg, "uniform") == 0; break;
+            case 'c': cfg.cache_bytes = (size_t)atol(optarg) << 20; break;
+            case 's': cfg.sync = atoi(optarg) != 0; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+
+    cfg.workload_count = parse_names(workloads, workload_names, WORKLOAD_COUNT, cfg.workloads);
+    cfg.backend_count = parse_names(backends, g_backend_names, BACKEND_COUNT, cfg.backends);
+    cfg.size_count = parse_sizes(sizes, cfg.sizes);
+    if (cfg.workload_count <= 0 || cfg.backend_count <= 0 || cfg.size_count <= 0 ||
+        cfg.keys < 2 || cfg.ops == 0 || cfg.threads < 1 || cfg.threads > YCSB_MAX_THREADS) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (!secure_storage_set_root(dir) || !secure_storage_initialize()) {
+        fprintf(stderr, "failed to open store in %s\n", dir);
+        return 1;
+    }
+    secure_storage_set_durability(cfg.sync ? SECURE_STORAGE_DURABILITY_SYNC
+                                           : SECURE_STORAGE_DURABILITY_LAZY);
+
+    key_chooser_t chooser;
+    chooser_init(&chooser, cfg.keys, cfg.uniform);
+
+    printf("keys=%llu ops=%llu threads=%d %s fsync=%s\n", (unsigned long long)cfg.keys,
+           (unsigned long long)cfg.ops, cfg.threads, cfg.uniform ? "uniform" : "zipfian",
+           cfg.sync ? "on" : "off");
+    printf("%-7s %8s %-12s %10s %-7s %9s %9s %9s\n", "backend", "size", "workload", "ops/s",
+           "op", "p50 us", "p99 us", "p999 us");
+
+    uint64_t errors = 0;
+    for (int s = 0; s < cfg.size_count; s++) {
+        for (int b = 0; b < cfg.backend_count; b++) {
+            int backend = cfg.backends[b];
+            secure_storage_cache_configure(backend == BACKEND_CACHE ? cfg.cache_bytes : 0);
+
+            double load_rate = load_keys(backend, cfg.keys, cfg.sizes[s], 0x5EED0000ULL + (uint64_t)s);
+            if (load_rate <= 0) {
+                fprintf(stderr, "load failed: %s, %zu byte values\n", g_backend_names[backend],
+                        cfg.sizes[s]);
+                errors++;
+                continue;
+            }
+            printf("%-7s %8zu %-12s %10.0f\n", g_backend_names[backend], cfg.sizes[s], "load",
+                   load_rate);
+
+            // Inserts append after the loaded keys; requests only draw from those
+            uint64_t next_insert = cfg.keys;
+            for (int w = 0; w < cfg.workload_count; w++) {
+                errors += run_workload(&cfg, &g_workloads[cfg.workloads[w]], backend, cfg.sizes[s],
+                                       &chooser, &next_insert);
+            }
+        }
+    }
+
+    secure_storage_cache_configure(0);
+    secure_storage_shutdown();
+
+    if (errors) {
+        fprintf(stderr, "%llu operations failed\n", (unsigned long long)errors);
+        return 1;
+    }
+    return 0;
+}
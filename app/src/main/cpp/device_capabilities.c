@@ -105,7 +105,7 @@ void device_capabilities_get_security(char* buffer, size_t buffer_size) {
  * Get CPU architecture
  * Returns the primary ABI of the device
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getCpuArchitecture(JNIEnv* env, jobject thiz) {
     char arch[PROP_VALUE_MAX];
     
@@ -125,7 +125,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getCpuArchitecture(JNIEnv* env,
  * Get CPU core count
  * Returns number of available processor cores
  */
-JNIEXPORT jint JNICALL
+SOVEREIGN_JNI_EXPORT jint JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getCpuCoreCount(JNIEnv* env, jobject thiz) {
     long cores = sysconf(_SC_NPROCESSORS_CONF);
     
@@ -143,7 +143,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getCpuCoreCount(JNIEnv* env, job
  * Returns comma-separated list of available sensors
  * Note: This is simplified - full sensor enumeration requires SensorManager JNI calls
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getSensorList(JNIEnv* env, jobject thiz) {
     // For Phase 2, we return a placeholder
     // Full implementation would require calling back into Java SensorManager
@@ -161,7 +161,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getSensorList(JNIEnv* env, jobje
  * Get security status
  * Checks SELinux, encryption, and debug status
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getSecurityStatus(JNIEnv* env, jobject thiz) {
     char selinux[PROP_VALUE_MAX];
     char debuggable[PROP_VALUE_MAX];
@@ -200,7 +200,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getSecurityStatus(JNIEnv* env, j
  * Get build information
  * Returns manufacturer, model, Android version, SDK level
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getBuildInfo(JNIEnv* env, jobject thiz) {
     char manufacturer[PROP_VALUE_MAX];
     char model[PROP_VALUE_MAX];
@@ -245,7 +245,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getBuildInfo(JNIEnv* env, jobjec
  * Get full capability report
  * Returns JSON-formatted complete device capability report
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getFullReport(JNIEnv* env, jobject thiz) {
     char arch[PROP_VALUE_MAX];
     char manufacturer[PROP_VALUE_MAX];
@@ -312,3 +312,24 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getFullReport(JNIEnv* env, jobje
     LOGI("Generated full capability report");
     return (*env)->NewStringUTF(env, report);
 }
+
+static const JNINativeMethod g_capability_methods[] = {
+    { "getCpuArchitecture", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getCpuArchitecture },
+    { "getCpuCoreCount", "()I", (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getCpuCoreCount },
+    { "getSensorList", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getSensorList },
+    { "getSecurityStatus", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getSecurityStatus },
+    { "getBuildInfo", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getBuildInfo },
+    { "getFullReport", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_DeviceCapabilities_getFullReport },
+};
+
+int device_capabilities_register_natives(JNIEnv* env) {
+    int registered = sovereign_jni_register(env, SOVEREIGN_JNI_CLASS("DeviceCapabilities"),
+                                            g_capability_methods,
+                                            SOVEREIGN_JNI_COUNT(g_capability_methods));
+    return registered > 0 ? registered : 0;
+}
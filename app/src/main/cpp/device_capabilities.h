@@ -8,7 +8,7 @@
 #ifndef SOVEREIGNDROID_DEVICE_CAPABILITIES_H
 #define SOVEREIGNDROID_DEVICE_CAPABILITIES_H
 
-#include <jni.h>
+#include "sovereign_jni.h"
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -43,7 +43,7 @@ void device_capabilities_get_security(char* buffer, size_t buffer_size);
  * Method:    getCpuArchitecture
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getCpuArchitecture(JNIEnv* env, jobject thiz);
 
 /*
@@ -51,7 +51,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getCpuArchitecture(JNIEnv* env,
  * Method:    getCpuCoreCount
  * Signature: ()I
  */
-JNIEXPORT jint JNICALL
+SOVEREIGN_JNI_EXPORT jint JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getCpuCoreCount(JNIEnv* env, jobject thiz);
 
 /*
@@ -59,7 +59,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getCpuCoreCount(JNIEnv* env, job
  * Method:    getSensorList
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getSensorList(JNIEnv* env, jobject thiz);
 
 /*
@@ -67,7 +67,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getSensorList(JNIEnv* env, jobje
  * Method:    getSecurityStatus
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getSecurityStatus(JNIEnv* env, jobject thiz);
 
 /*
@@ -75,7 +75,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getSecurityStatus(JNIEnv* env, j
  * Method:    getBuildInfo
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getBuildInfo(JNIEnv* env, jobject thiz);
 
 /*
@@ -83,7 +83,7 @@ Java_com_sovereigndroid_core_DeviceCapabilities_getBuildInfo(JNIEnv* env, jobjec
  * Method:    getFullReport
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_DeviceCapabilities_getFullReport(JNIEnv* env, jobject thiz);
 
 #ifdef __cplusplus
@@ -7,8 +7,15 @@
 #include "sovereign_sha512.h"
 #include "sovereign_crypto.h"
 #include "secure_storage.h"
+#include "secure_buffer.h"
 #include <android/log.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 #define LOG_TAG "DeviceIdentity"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -18,31 +25,86 @@
 #define IDENTITY_KEY_PRIVATE "device_identity_private"
 #define IDENTITY_KEY_PUBLIC "device_identity_public"
 
-// Current identity (loaded in memory)
+// Current identity (loaded in memory); the private key sits in a
+// secure_buffer, allocated on first generate or load and kept after that
 static struct {
-    uint8_t private_key[ED25519_PRIVATE_KEY_SIZE];
+    uint8_t* private_key;
     uint8_t public_key[ED25519_PUBLIC_KEY_SIZE];
     int loaded;
 } g_identity = {0};
 
+static int reserve_private_key(void) {
+    if (!g_identity.private_key) {
+        g_identity.private_key = secure_buffer_alloc(ED25519_PRIVATE_KEY_SIZE);
+    }
+    return g_identity.private_key != NULL;
+}
+
+/*
+ * Subkeys: SLIP-10 for Ed25519 (hardened derivation only) from the
+ * identity seed
+ *   master:  I = HMAC-SHA512("ed25519 seed", seed)
+ *   child i: I = HMAC-SHA512(chain code, 0x00 || key || ser32(i | 2^31))
+ * with key = I[0..31] (an Ed25519 seed) and chain code = I[32..63].
+ * Interior nodes are cached, their chain code already expanded into an
+ * HMAC context, so deriving below a cached parent costs one HMAC
+ * (two SHA-512 blocks) per new level. The cache is direct-mapped on the
+ * path and lives in secure_buffer memory.
+ */
+#define SLIP10_CURVE_KEY "ed25519 seed"
+#define CHAIN_CACHE_SLOTS 64
+
+typedef struct {
+    uint32_t path[IDENTITY_PATH_MAX_DEPTH];
+    uint32_t depth;
+    int valid;
+    uint8_t key[ED25519_SEED_SIZE];
+    hmac_sha512_ctx chain;      // Keyed with the node's chain code
+} chain_node_t;
+
+static pthread_mutex_t g_chain_lock = PTHREAD_MUTEX_INITIALIZER;
+static chain_node_t* g_chain_cache = NULL;
+static identity_derive_stats_t g_derive_stats;
+
+static void chain_cache_clear(void) {
+    pthread_mutex_lock(&g_chain_lock);
+    secure_buffer_wipe((uint8_t*)g_chain_cache, CHAIN_CACHE_SLOTS * sizeof(chain_node_t));
+    g_derive_stats.cached_nodes = 0;
+    pthread_mutex_unlock(&g_chain_lock);
+}
+
+static void forget_identity(void) {
+    chain_cache_clear();
+    secure_buffer_wipe(g_identity.private_key, ED25519_PRIVATE_KEY_SIZE);
+    memset(g_identity.public_key, 0, sizeof(g_identity.public_key));
+    g_identity.loaded = 0;
+}
+
 int device_identity_init(void) {
     LOGI("Initializing device identity subsystem");
     LOGI("Identity algorithm: Ed25519 (RFC 8032)");
     LOGI("Key size: %d bytes private, %d bytes public", 
          ED25519_PRIVATE_KEY_SIZE, ED25519_PUBLIC_KEY_SIZE);
     
+    // The private key never sits in the plaintext cache; the public key may
+    secure_storage_cache_exclude(IDENTITY_KEY_PRIVATE);
+    
     g_identity.loaded = 0;
     return IDENTITY_OK;
 }
 
 int device_identity_exists(void) {
-    uint8_t temp[ED25519_PUBLIC_KEY_SIZE];
-    return (secure_storage_retrieve(IDENTITY_KEY_PUBLIC, temp, sizeof(temp)) == 0) ? 1 : 0;
+    return secure_storage_exists(IDENTITY_KEY_PUBLIC);
 }
 
 int device_identity_generate(void) {
     LOGI("Generating new device identity...");
     
+    if (!reserve_private_key()) {
+        LOGE("Failed to allocate private key buffer");
+        return IDENTITY_ERROR;
+    }
+    
     // Generate random seed
     uint8_t seed[ED25519_SEED_SIZE];
     if (!sovereign_random_bytes(seed, sizeof(seed))) {
@@ -52,12 +114,14 @@ int device_identity_generate(void) {
     
     // Create Ed25519 keypair
     ed25519_create_keypair(g_identity.public_key, g_identity.private_key, seed);
+    secure_buffer_wipe(seed, sizeof(seed));
+    chain_cache_clear();
     
     // Store private key securely (encrypted)
     if (secure_storage_store(IDENTITY_KEY_PRIVATE, g_identity.private_key, 
                             ED25519_PRIVATE_KEY_SIZE) != 0) {
         LOGE("Failed to store private key");
-        memset(&g_identity, 0, sizeof(g_identity));
+        forget_identity();
         return IDENTITY_ERROR;
     }
     
@@ -65,14 +129,14 @@ int device_identity_generate(void) {
     if (secure_storage_store(IDENTITY_KEY_PUBLIC, g_identity.public_key, 
                             ED25519_PUBLIC_KEY_SIZE) != 0) {
         LOGE("Failed to store public key");
-        memset(&g_identity, 0, sizeof(g_identity));
+        forget_identity();
         return IDENTITY_ERROR;
     }
     
     g_identity.loaded = 1;
     
     // Log fingerprint
-    uint8_t fingerprint[32];
+    uint8_t fingerprint[64];
     sha512(g_identity.public_key, ED25519_PUBLIC_KEY_SIZE, fingerprint);
     
     LOGI("Device identity generated successfully");
@@ -91,10 +155,17 @@ int device_identity_generate(void) {
 int device_identity_load(void) {
     LOGI("Loading device identity...");
     
+    if (!reserve_private_key()) {
+        LOGE("Failed to allocate private key buffer");
+        return IDENTITY_ERROR;
+    }
+    
     // Load private key
+    chain_cache_clear();
     if (secure_storage_retrieve(IDENTITY_KEY_PRIVATE, g_identity.private_key,
                                ED25519_PRIVATE_KEY_SIZE) != 0) {
         LOGE("Failed to load private key");
+        forget_identity();
         return IDENTITY_NOT_FOUND;
     }
     
@@ -102,7 +173,7 @@ int device_identity_load(void) {
     if (secure_storage_retrieve(IDENTITY_KEY_PUBLIC, g_identity.public_key,
                                ED25519_PUBLIC_KEY_SIZE) != 0) {
         LOGE("Failed to load public key");
-        memset(&g_identity, 0, sizeof(g_identity));
+        forget_identity();
         return IDENTITY_NOT_FOUND;
     }
     
@@ -168,6 +239,37 @@ int device_identity_verify(const uint8_t* data, size_t data_len, const uint8_t s
     return result;
 }
 
+int device_identity_sign_many(const uint8_t* const* messages, const size_t* message_lens,
+                              size_t count, uint8_t* signatures) {
+    if (!g_identity.loaded) {
+        LOGE("Identity not loaded");
+        return IDENTITY_ERROR;
+    }
+    
+    ed25519_sign_batch(signatures, messages, message_lens, count,
+                       g_identity.private_key, g_identity.public_key);
+    
+    LOGI("Signed %zu messages", count);
+    return IDENTITY_OK;
+}
+
+int device_identity_verify_many(const uint8_t* const* messages, const size_t* message_lens,
+                                size_t count, const uint8_t* signatures, uint8_t* results) {
+    if (!g_identity.loaded) {
+        LOGE("Identity not loaded");
+        return IDENTITY_ERROR;
+    }
+    
+    // ed25519_verify rejects every signature (see sovereign_ed25519.h); report
+    // an error rather than a batch of results that look like real failures
+    (void)messages;
+    (void)message_lens;
+    (void)signatures;
+    memset(results, 0, count);
+    LOGE("Batch verification unavailable: %zu signatures not checked", count);
+    return IDENTITY_ERROR;
+}
+
 int device_identity_create_attestation(uint8_t* attestation, size_t max_len) {
     if (!g_identity.loaded) {
         LOGE("Identity not loaded");
@@ -203,3 +305,432 @@ int device_identity_create_attestation(uint8_t* attestation, size_t max_len) {
     
     return (int)required_len;
 }
+
+/*
+ * ========================================================================
+ * Subkey derivation
+ * ========================================================================
+ */
+
+static uint32_t chain_slot(const uint32_t* path, size_t depth) {
+    uint32_t h = (uint32_t)depth * 0x9E3779B1u;
+    for (size_t i = 0; i < depth; i++) {
+        h = (h ^ path[i]) * 0x9E3779B1u;
+    }
+    return h >> 26;     // log2(CHAIN_CACHE_SLOTS) bits
+}
+
+static chain_node_t* chain_find(const uint32_t* path, size_t depth) {
+    chain_node_t* node = &g_chain_cache[chain_slot(path, depth)];
+    if (node->valid && node->depth == depth &&
+        memcmp(node->path, path, depth * sizeof(uint32_t)) == 0) {
+        return node;
+    }
+    return NULL;
+}
+
+static void chain_insert(const uint32_t* path, size_t depth, const uint8_t key[32],
+                         const hmac_sha512_ctx* chain) {
+    chain_node_t* node = &g_chain_cache[chain_slot(path, depth)];
+    if (!node->valid) {
+        g_derive_stats.cached_nodes++;
+    }
+    memcpy(node->path, path, depth * sizeof(uint32_t));
+    node->depth = (uint32_t)depth;
+    node->valid = 1;
+    memcpy(node->key, key, ED25519_SEED_SIZE);
+    node->chain = *chain;
+}
+
+/*
+ * Key (Ed25519 seed) at a normalized path below seed
+ * Called with g_chain_lock held and the cache allocated
+ */
+static void derive_path(const uint8_t* seed, size_t seed_len,
+                        const uint32_t* path, size_t depth, uint8_t key[32]) {
+    uint8_t node_key[ED25519_SEED_SIZE];
+    hmac_sha512_ctx chain;
+    uint8_t i_out[64];
+    
+    // Start from the deepest cached ancestor, or the master node
+    size_t level = depth;
+    chain_node_t* hit = NULL;
+    while (level > 0 && !hit) {
+        level--;
+        hit = chain_find(path, level);
+    }
+    if (hit) {
+        memcpy(node_key, hit->key, ED25519_SEED_SIZE);
+        chain = hit->chain;
+        if (level > 0) {
+            g_derive_stats.node_hits++;
+        }
+    } else {
+        hmac_sha512((const uint8_t*)SLIP10_CURVE_KEY, strlen(SLIP10_CURVE_KEY),
+                    seed, seed_len, i_out);
+        g_derive_stats.hmacs++;
+        memcpy(node_key, i_out, ED25519_SEED_SIZE);
+        hmac_sha512_init(&chain, i_out + 32, 32);
+        chain_insert(path, 0, node_key, &chain);
+    }
+    
+    uint8_t data[1 + ED25519_SEED_SIZE + 4];
+    for (; level < depth; level++) {
+        uint32_t index = path[level];
+        data[0] = 0;
+        memcpy(data + 1, node_key, ED25519_SEED_SIZE);
+        data[33] = (uint8_t)(index >> 24);
+        data[34] = (uint8_t)(index >> 16);
+        data[35] = (uint8_t)(index >> 8);
+        data[36] = (uint8_t)index;
+        
+        hmac_sha512_update(&chain, data, sizeof(data));
+        hmac_sha512_final(&chain, i_out);
+        g_derive_stats.hmacs++;
+        memcpy(node_key, i_out, ED25519_SEED_SIZE);
+        
+        // Leaves are not cached: they are what callers ask for by the thousand
+        if (level + 1 < depth) {
+            hmac_sha512_init(&chain, i_out + 32, 32);
+            chain_insert(path, level + 1, node_key, &chain);
+        }
+    }
+    memcpy(key, node_key, ED25519_SEED_SIZE);
+    g_derive_stats.derivations++;
+    
+    secure_buffer_wipe(node_key, sizeof(node_key));
+    secure_buffer_wipe(i_out, sizeof(i_out));
+    secure_buffer_wipe(data, sizeof(data));
+    secure_buffer_wipe(&chain, sizeof(chain));
+}
+
+/*
+ * Subkey seed at path (indices hardened) below the identity seed
+ */
+static int derive_key(const uint32_t* path, size_t depth, uint8_t key[32]) {
+    if (!g_identity.loaded) {
+        LOGE("Identity not loaded");
+        return IDENTITY_ERROR;
+    }
+    if (depth < 1 || depth > IDENTITY_PATH_MAX_DEPTH) {
+        LOGE("Invalid derivation path depth %zu", depth);
+        return IDENTITY_INVALID;
+    }
+    
+    uint32_t hardened[IDENTITY_PATH_MAX_DEPTH];
+    for (size_t i = 0; i < depth; i++) {
+        hardened[i] = path[i] | IDENTITY_HARDENED;
+    }
+    
+    pthread_mutex_lock(&g_chain_lock);
+    if (!g_chain_cache) {
+        g_chain_cache = (chain_node_t*)secure_buffer_alloc(CHAIN_CACHE_SLOTS * sizeof(chain_node_t));
+    }
+    int ok = g_chain_cache != NULL;
+    if (ok) {
+        derive_path(g_identity.private_key, ED25519_PRIVATE_KEY_SIZE, hardened, depth, key);
+    }
+    pthread_mutex_unlock(&g_chain_lock);
+    
+    if (!ok) {
+        LOGE("Failed to allocate derivation cache");
+        return IDENTITY_ERROR;
+    }
+    return IDENTITY_OK;
+}
+
+int device_identity_derive_keypair(const uint32_t* path, size_t depth,
+                                   uint8_t public_key[32], uint8_t private_key[32]) {
+    uint8_t key[ED25519_SEED_SIZE];
+    int result = derive_key(path, depth, key);
+    if (result != IDENTITY_OK) {
+        return result;
+    }
+    
+    if (public_key) {
+        uint8_t unused[ED25519_PRIVATE_KEY_SIZE];
+        ed25519_create_keypair(public_key, unused, key);
+        secure_buffer_wipe(unused, sizeof(unused));
+    }
+    if (private_key) {
+        memcpy(private_key, key, ED25519_SEED_SIZE);
+    }
+    secure_buffer_wipe(key, sizeof(key));
+    return IDENTITY_OK;
+}
+
+int device_identity_sign_derived(const uint32_t* path, size_t depth,
+                                 const uint8_t* data, size_t data_len, uint8_t signature[64]) {
+    uint8_t seed[ED25519_SEED_SIZE];
+    uint8_t private_key[ED25519_PRIVATE_KEY_SIZE];
+    uint8_t public_key[ED25519_PUBLIC_KEY_SIZE];
+    int result = derive_key(path, depth, seed);
+    if (result != IDENTITY_OK) {
+        return result;
+    }
+    
+    ed25519_create_keypair(public_key, private_key, seed);
+    ed25519_sign(signature, data, data_len, private_key, public_key);
+    secure_buffer_wipe(seed, sizeof(seed));
+    secure_buffer_wipe(private_key, sizeof(private_key));
+    return IDENTITY_OK;
+}
+
+void device_identity_get_derive_stats(identity_derive_stats_t* stats) {
+    pthread_mutex_lock(&g_chain_lock);
+    *stats = g_derive_stats;
+    pthread_mutex_unlock(&g_chain_lock);
+}
+
+/*
+ * ========================================================================
+ * Ephemeral keypairs
+ * ========================================================================
+ */
+
+/*
+ * A producer thread keeps up to capacity keypairs ready in one
+ * secure_buffer allocation (a stack of [private 32][public 32] entries),
+ * so session setup only pays for a copy. It runs under SCHED_IDLE where
+ * available (background nice otherwise) and is woken once takes drain
+ * the pool to half, then fills it up again; waking it on every take
+ * would let it preempt the taker on a busy core. Takes from an empty
+ * pool generate inline. Refill latency runs from the first take out of
+ * a full pool until the pool is full again. The producer sleeps until
+ * takes reach the half watermark, so that span includes the drain and
+ * follows the rate of takes; keygen_avg_us is the producer's own speed.
+ */
+#define EPHEMERAL_ENTRY_SIZE (ED25519_PRIVATE_KEY_SIZE + ED25519_PUBLIC_KEY_SIZE)
+#define EPHEMERAL_PRODUCER_NICE 10      // Android THREAD_PRIORITY_BACKGROUND
+
+static struct {
+    pthread_mutex_t lock;       // Guards everything below
+    pthread_cond_t cond;        // Signalled at the low watermark and on stop
+    pthread_t thread;
+    int running;
+    int stop;
+    int filling;                // Producer is topping the pool up
+    uint8_t* entries;           // capacity entries, available filled
+    size_t capacity;
+    size_t available;
+    uint64_t refill_start_us;   // 0 while the pool is full
+    
+    uint64_t takes;
+    uint64_t hits;
+    uint64_t generated;
+    uint64_t keygen_us;
+    uint64_t refills;
+    uint64_t refill_us;
+    uint64_t refill_max_us;
+} g_ephemeral = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int generate_ephemeral(uint8_t public_key[32], uint8_t private_key[32]) {
+    uint8_t seed[ED25519_SEED_SIZE];
+    if (!sovereign_random_bytes(seed, sizeof(seed))) {
+        LOGE("Failed to generate random seed");
+        return 0;
+    }
+    ed25519_create_keypair(public_key, private_key, seed);
+    secure_buffer_wipe(seed, sizeof(seed));
+    return 1;
+}
+
+// Refills only take CPU the app is not using
+static void lower_priority(void) {
+#ifdef SCHED_IDLE
+    struct sched_param param = { 0 };
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0) {
+        return;
+    }
+#endif
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), EPHEMERAL_PRODUCER_NICE) != 0) {
+        LOGI("Ephemeral key producer runs at normal priority");
+    }
+}
+
+static void* ephemeral_producer(void* arg) {
+    (void)arg;
+    lower_priority();
+    
+    uint8_t entry[EPHEMERAL_ENTRY_SIZE];
+    pthread_mutex_lock(&g_ephemeral.lock);
+    while (!g_ephemeral.stop) {
+        if (g_ephemeral.available == g_ephemeral.capacity) {
+            g_ephemeral.filling = 0;
+        } else if (g_ephemeral.available <= g_ephemeral.capacity / 2) {
+            g_ephemeral.filling = 1;
+        }
+        if (!g_ephemeral.filling) {
+            pthread_cond_wait(&g_ephemeral.cond, &g_ephemeral.lock);
+            continue;
+        }
+        pthread_mutex_unlock(&g_ephemeral.lock);
+        
+        uint64_t start = now_us();
+        int ok = generate_ephemeral(entry + ED25519_PRIVATE_KEY_SIZE, entry);
+        uint64_t end = now_us();
+        
+        pthread_mutex_lock(&g_ephemeral.lock);
+        if (!ok) {
+            // RNG failure: back off rather than spin; takes still work inline
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += 1;
+            if (!g_ephemeral.stop) {
+                pthread_cond_timedwait(&g_ephemeral.cond, &g_ephemeral.lock, &until);
+            }
+            continue;
+        }
+        g_ephemeral.generated++;
+        g_ephemeral.keygen_us += end - start;
+        if (g_ephemeral.available < g_ephemeral.capacity) {
+            memcpy(g_ephemeral.entries + g_ephemeral.available * EPHEMERAL_ENTRY_SIZE,
+                   entry, EPHEMERAL_ENTRY_SIZE);
+            g_ephemeral.available++;
+        }
+        if (g_ephemeral.available == g_ephemeral.capacity && g_ephemeral.refill_start_us) {
+            uint64_t refill = end - g_ephemeral.refill_start_us;
+            g_ephemeral.refills++;
+            g_ephemeral.refill_us += refill;
+            if (refill > g_ephemeral.refill_max_us) {
+                g_ephemeral.refill_max_us = refill;
+            }
+            g_ephemeral.refill_start_us = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_ephemeral.lock);
+    
+    secure_buffer_wipe(entry, sizeof(entry));
+    return NULL;
+}
+
+int device_identity_ephemeral_start(size_t capacity) {
+    if (capacity == 0) {
+        capacity = IDENTITY_EPHEMERAL_POOL_DEFAULT;
+    }
+    if (capacity > IDENTITY_EPHEMERAL_POOL_MAX) {
+        LOGE("Ephemeral key pool of %zu exceeds %d", capacity, IDENTITY_EPHEMERAL_POOL_MAX);
+        return IDENTITY_INVALID;
+    }
+    
+    pthread_mutex_lock(&g_ephemeral.lock);
+    if (g_ephemeral.running) {
+        pthread_mutex_unlock(&g_ephemeral.lock);
+        return IDENTITY_OK;
+    }
+    
+    g_ephemeral.entries = secure_buffer_alloc(capacity * EPHEMERAL_ENTRY_SIZE);
+    if (!g_ephemeral.entries) {
+        pthread_mutex_unlock(&g_ephemeral.lock);
+        LOGE("Failed to allocate ephemeral key pool");
+        return IDENTITY_ERROR;
+    }
+    g_ephemeral.capacity = capacity;
+    g_ephemeral.available = 0;
+    g_ephemeral.refill_start_us = 0;
+    g_ephemeral.stop = 0;
+    g_ephemeral.filling = 1;
+    g_ephemeral.takes = 0;
+    g_ephemeral.hits = 0;
+    g_ephemeral.generated = 0;
+    g_ephemeral.keygen_us = 0;
+    g_ephemeral.refills = 0;
+    g_ephemeral.refill_us = 0;
+    g_ephemeral.refill_max_us = 0;
+    
+    if (pthread_create(&g_ephemeral.thread, NULL, ephemeral_producer, NULL) != 0) {
+        secure_buffer_free(g_ephemeral.entries);
+        g_ephemeral.entries = NULL;
+        g_ephemeral.capacity = 0;
+        pthread_mutex_unlock(&g_ephemeral.lock);
+        LOGE("Failed to start ephemeral key producer");
+        return IDENTITY_ERROR;
+    }
+    g_ephemeral.running = 1;
+    pthread_mutex_unlock(&g_ephemeral.lock);
+    
+    LOGI("Ephemeral key pool: %zu keypairs", capacity);
+    return IDENTITY_OK;
+}
+
+void device_identity_ephemeral_stop(void) {
+    pthread_mutex_lock(&g_ephemeral.lock);
+    if (!g_ephemeral.running) {
+        pthread_mutex_unlock(&g_ephemeral.lock);
+        return;
+    }
+    g_ephemeral.stop = 1;
+    pthread_cond_signal(&g_ephemeral.cond);
+    pthread_mutex_unlock(&g_ephemeral.lock);
+    
+    pthread_join(g_ephemeral.thread, NULL);
+    
+    // Unused keypairs are never handed out after a stop
+    pthread_mutex_lock(&g_ephemeral.lock);
+    secure_buffer_free(g_ephemeral.entries);
+    g_ephemeral.entries = NULL;
+    g_ephemeral.capacity = 0;
+    g_ephemeral.available = 0;
+    g_ephemeral.refill_start_us = 0;
+    g_ephemeral.filling = 0;
+    g_ephemeral.running = 0;
+    pthread_mutex_unlock(&g_ephemeral.lock);
+}
+
+int device_identity_ephemeral_take(uint8_t public_key[32], uint8_t private_key[32]) {
+    pthread_mutex_lock(&g_ephemeral.lock);
+    g_ephemeral.takes++;
+    int hit = g_ephemeral.available > 0;
+    if (hit) {
+        if (g_ephemeral.available == g_ephemeral.capacity) {
+            g_ephemeral.refill_start_us = now_us();
+        }
+        g_ephemeral.available--;
+        uint8_t* entry = g_ephemeral.entries + g_ephemeral.available * EPHEMERAL_ENTRY_SIZE;
+        memcpy(private_key, entry, ED25519_PRIVATE_KEY_SIZE);
+        memcpy(public_key, entry + ED25519_PRIVATE_KEY_SIZE, ED25519_PUBLIC_KEY_SIZE);
+        secure_buffer_wipe(entry, EPHEMERAL_ENTRY_SIZE);
+        g_ephemeral.hits++;
+        if (!g_ephemeral.filling && g_ephemeral.available <= g_ephemeral.capacity / 2) {
+            pthread_cond_signal(&g_ephemeral.cond);
+        }
+    }
+    pthread_mutex_unlock(&g_ephemeral.lock);
+    
+    if (!hit && !generate_ephemeral(public_key, private_key)) {
+        return IDENTITY_ERROR;
+    }
+    return IDENTITY_OK;
+}
+
+void device_identity_ephemeral_get_stats(identity_ephemeral_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    
+    pthread_mutex_lock(&g_ephemeral.lock);
+    stats->takes = g_ephemeral.takes;
+    stats->hits = g_ephemeral.hits;
+    stats->generated = g_ephemeral.generated;
+    stats->available = g_ephemeral.available;
+    stats->capacity = g_ephemeral.capacity;
+    stats->refills = g_ephemeral.refills;
+    stats->refill_max_us = g_ephemeral.refill_max_us;
+    if (g_ephemeral.takes > 0) {
+        stats->hit_rate = (float)g_ephemeral.hits / (float)g_ephemeral.takes;
+    }
+    if (g_ephemeral.generated > 0) {
+        stats->keygen_avg_us = (float)g_ephemeral.keygen_us / (float)g_ephemeral.generated;
+    }
+    if (g_ephemeral.refills > 0) {
+        stats->refill_avg_us = (float)g_ephemeral.refill_us / (float)g_ephemeral.refills;
+    }
+    pthread_mutex_unlock(&g_ephemeral.lock);
+}
@@ -74,6 +74,26 @@ int device_identity_sign(const uint8_t* data, size_t data_len, uint8_t signature
  */
 int device_identity_verify(const uint8_t* data, size_t data_len, const uint8_t signature[64]);
 
+/*
+ * Sign count messages with device identity
+ * messages/message_lens: the messages to sign
+ * signatures: output buffer (count * 64 bytes)
+ * Returns: IDENTITY_OK on success, error code on failure
+ */
+int device_identity_sign_many(const uint8_t* const* messages, const size_t* message_lens,
+                              size_t count, uint8_t* signatures);
+
+/*
+ * Verify count signatures (count * 64 bytes) with device public key
+ * results: output, 1 per valid signature, 0 per invalid one
+ * Returns: number of valid signatures, negative on error
+ *
+ * Fails with IDENTITY_ERROR (results zeroed) until ed25519_verify can
+ * check signatures
+ */
+int device_identity_verify_many(const uint8_t* const* messages, const size_t* message_lens,
+                                size_t count, const uint8_t* signatures, uint8_t* results);
+
 /*
  * Create device attestation (signed device info)
  * attestation: output buffer (variable size)
@@ -82,4 +102,82 @@ int device_identity_verify(const uint8_t* data, size_t data_len, const uint8_t s
  */
 int device_identity_create_attestation(uint8_t* attestation, size_t max_len);
 
+/*
+ * Subkeys derived from the identity seed (SLIP-10, Ed25519)
+ * path: depth indices (1..IDENTITY_PATH_MAX_DEPTH), one per level; every
+ * level is hardened, so bit 31 is implied. The same path always yields
+ * the same key for a given identity; nothing is stored.
+ */
+#define IDENTITY_PATH_MAX_DEPTH 8
+#define IDENTITY_HARDENED 0x80000000u
+
+/*
+ * Derive the subkey at path
+ * public_key / private_key (Ed25519 seed): outputs (32 bytes), either may
+ * be NULL; skipping the public key skips its point multiplication
+ * Returns: IDENTITY_OK, IDENTITY_INVALID for a bad path, IDENTITY_ERROR
+ */
+int device_identity_derive_keypair(const uint32_t* path, size_t depth,
+                                   uint8_t public_key[32], uint8_t private_key[32]);
+
+/*
+ * Sign data with the subkey at path; the key never leaves this call
+ * Returns: IDENTITY_OK, IDENTITY_INVALID for a bad path, IDENTITY_ERROR
+ */
+int device_identity_sign_derived(const uint32_t* path, size_t depth,
+                                 const uint8_t* data, size_t data_len, uint8_t signature[64]);
+
+typedef struct {
+    uint64_t derivations;
+    uint64_t node_hits;         // Derivations that started below the master node
+    uint64_t hmacs;             // HMAC-SHA512 computations
+    size_t cached_nodes;        // Interior nodes held (master included)
+} identity_derive_stats_t;
+
+void device_identity_get_derive_stats(identity_derive_stats_t* stats);
+
+/*
+ * Ephemeral keypairs (handshakes, per-session signing): fresh Ed25519
+ * keypairs, never stored, served from a pool in secure memory that a
+ * background-priority thread refills
+ */
+#define IDENTITY_EPHEMERAL_POOL_DEFAULT 16
+#define IDENTITY_EPHEMERAL_POOL_MAX 256
+
+/*
+ * Start the producer with room for capacity keypairs (0 = default)
+ * Statistics restart from zero
+ * Returns: IDENTITY_OK (also if already running), IDENTITY_INVALID, IDENTITY_ERROR
+ */
+int device_identity_ephemeral_start(size_t capacity);
+
+/*
+ * Stop the producer and wipe the keypairs still pooled
+ */
+void device_identity_ephemeral_stop(void);
+
+/*
+ * Take a keypair: from the pool, or generated inline when it is empty
+ * or not started. private_key is the Ed25519 seed-form private key
+ * Returns: IDENTITY_OK, IDENTITY_ERROR if the RNG fails
+ */
+int device_identity_ephemeral_take(uint8_t public_key[32], uint8_t private_key[32]);
+
+typedef struct {
+    uint64_t takes;
+    uint64_t hits;              // Takes served from the pool
+    uint64_t generated;         // Keypairs made by the producer
+    size_t available;
+    size_t capacity;
+    float hit_rate;             // hits / takes
+    float keygen_avg_us;        // Producer time per keypair
+    uint64_t refills;           // Pool full -> taken from -> full again
+    // From the first take out of a full pool to full again: includes the
+    // drain to half before the producer wakes, so it tracks the take rate
+    float refill_avg_us;
+    uint64_t refill_max_us;
+} identity_ephemeral_stats_t;
+
+void device_identity_ephemeral_get_stats(identity_ephemeral_stats_t* stats);
+
 #endif // DEVICE_IDENTITY_H
@@ -23,6 +23,7 @@
 #include "sovereign_core.h"
 #include "device_capabilities.h"
 #include "secure_storage.h"
+#include "secure_storage_async.h"
 #include "device_identity.h"
 #include "renderer.h"
 #include "input.h"
@@ -92,6 +93,45 @@ static void set_phase_color(struct app_state* state, float r, float g, float b,
     draw_frame(state, fallback);
 }
 
+// Phase 3 storage round trip
+#define PHASE3_TEST_KEY "native_test_key"
+#define PHASE3_TEST_VALUE "SovereignDroid_Native_Encrypted_2026"
+
+/**
+ * Storage completions - called by the looper when the async eventfd fires
+ */
+static int on_storage_completions(int fd, int events, void* data) {
+    struct app_state* state = (struct app_state*)data;
+    secure_storage_completion_t done[8];
+    size_t count;
+    
+    while ((count = secure_storage_poll_completions(done, 8)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            secure_storage_completion_t* c = &done[i];
+            
+            if (c->op == SECURE_STORAGE_OP_PUT && c->status == 0) {
+                LOGI("✅ Data encrypted and stored");
+            } else if (c->op == SECURE_STORAGE_OP_GET && c->status == 0) {
+                // Decrypted into locked, guard-paged memory sized by the library
+                LOGI("✅ Data decrypted: %zu bytes", c->data_len);
+                
+                if (c->data_len == strlen(PHASE3_TEST_VALUE) &&
+                    memcmp(c->data, PHASE3_TEST_VALUE, c->data_len) == 0) {
+                    LOGI("✅ Data integrity verified");
+                    LOGI("=== Phase 3: SUCCESS ===");
+                    state->phase3_complete = 1;
+                }
+                secure_storage_free(c->data);
+            } else if (c->status != 0) {
+                LOGW("Storage operation %d failed (ticket %llu)", c->op,
+                     (unsigned long long)c->ticket);
+            }
+        }
+    }
+    
+    return 1;  // Keep receiving callbacks
+}
+
 /**
  * Run sovereignty tests - Phase 1 through 4
  */
@@ -146,29 +186,21 @@ static void run_sovereignty_tests(struct app_state* state) {
     if (secure_storage_initialize()) {
         LOGI("Secure storage initialized");
         
-        // Test encryption/decryption
-        const char* test_key = "native_test_key";
-        const char* test_value = "SovereignDroid_Native_Encrypted_2026";
+        // Small plaintext cache for hot keys (identity public key)
+        secure_storage_cache_configure(64 * 1024);
         
-        if (secure_storage_store(test_key, (const uint8_t*)test_value, strlen(test_value))) {
-            LOGI("✅ Data encrypted and stored");
+        // Test encryption/decryption off the render thread: put, get and
+        // delete of one key run in order on a storage worker, results come
+        // back through the looper (on_storage_completions)
+        if (secure_storage_async_start(0) == 0) {
+            ALooper_addFd(ALooper_forThread(), secure_storage_async_fd(), ALOOPER_POLL_CALLBACK,
+                          ALOOPER_EVENT_INPUT, on_storage_completions, state);
             
-            uint8_t retrieved[256] = {0};
-            size_t retrieved_len = 0;
-            
-            if (secure_storage_retrieve(test_key, retrieved, sizeof(retrieved)) == 0) {
-                retrieved_len = strlen((char*)retrieved);
-                LOGI("✅ Data decrypted: %zu bytes", retrieved_len);
-                
-                if (strcmp((char*)retrieved, test_value) == 0) {
-                    LOGI("✅ Data integrity verified");
-                    LOGI("=== Phase 3: SUCCESS ===");
-                    state->phase3_complete = 1;
-                }
+            if (secure_storage_submit_put(PHASE3_TEST_KEY, (const uint8_t*)PHASE3_TEST_VALUE,
+                                          strlen(PHASE3_TEST_VALUE), NULL) &&
+                secure_storage_submit_get(PHASE3_TEST_KEY, NULL)) {
+                secure_storage_submit_delete(PHASE3_TEST_KEY, NULL);
             }
-            
-            // Cleanup
-            secure_storage_delete(test_key);
         }
     }
     
@@ -178,6 +210,8 @@ static void run_sovereignty_tests(struct app_state* state) {
     // Phase 4: Device Identity
     LOGI("=== Phase 4: Key Management & Identity ===");
     
+    device_identity_init();
+    
     if (device_identity_exists()) {
         LOGI("Loading existing identity...");
         if (device_identity_load() == IDENTITY_OK) {
@@ -463,6 +497,11 @@ void android_main(struct android_app* app) {
     // Cleanup
     renderer_cleanup(&state.renderer);
     input_cleanup(&state.input);
+    if (secure_storage_async_fd() >= 0) {
+        ALooper_removeFd(looper, secure_storage_async_fd());
+    }
+    secure_storage_async_stop();
+    secure_storage_shutdown();
     
     LOGI("=== SovereignDroid Native Activity Shutdown ===");
 }
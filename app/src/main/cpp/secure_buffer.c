@@ -0,0 +1,450 @@
+/*
+ * SovereignDroid Secure Buffers - Implementation
+ *
+ * Mapping layout (page granular):
+ *   [guard page][data pages ......... value][guard page]
+ * The value is right-aligned to 16 bytes inside the data pages.
+ *
+ * Slabs use the same layout with SLAB_DATA_PAGES data pages cut into
+ * slots of one size class. A free bitmap per slab finds a slot with one
+ * scan; each class keeps at most one empty slab mapped, so a class that
+ * hovers around a slab boundary does not map and unmap on every call.
+ *
+ * Slot and slab metadata live in separate tables, never next to the secret.
+ */
+
+#include "secure_buffer.h"
+#include <android/log.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define LOG_TAG "SecureBuffer"
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// Wiped mappings kept for reuse
+#define POOL_MAX 16
+
+// Value alignment inside the data pages
+#define VALUE_ALIGN 16
+
+// Slab size classes: 32, 64, ... SECURE_BUFFER_SLAB_MAX bytes
+#define SLAB_MIN_SHIFT 5
+#define SLAB_CLASSES 7
+#define SLAB_DATA_PAGES 4
+
+typedef struct buffer_slot {
+    uint8_t* base;              // Start of the leading guard page
+    size_t data_pages;
+    uint8_t* value;             // Handed to the caller
+    size_t len;
+    int locked;
+    struct buffer_slot* next;
+} buffer_slot_t;
+
+typedef struct buffer_slab {
+    uint8_t* base;              // Start of the leading guard page
+    uint8_t* data;
+    size_t slot_size;
+    size_t slot_count;
+    size_t used;
+    uint64_t* free_map;         // Bit set: slot free
+    uint32_t* lens;             // Requested length of each slot in use
+    int locked;
+    struct buffer_slab* next;
+} buffer_slab_t;
+
+static struct {
+    pthread_mutex_t lock;
+    size_t page_size;
+    buffer_slot_t* in_use;      // Handed out
+    buffer_slot_t* pool;        // Wiped, mapped, ready for reuse
+    size_t in_use_count;
+    size_t pool_count;
+    buffer_slab_t* slabs[SLAB_CLASSES];
+    size_t slab_count;
+    secure_buffer_stats_t stats;
+} g_buffers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+void secure_buffer_wipe(void* p, size_t len) {
+    if (!p || !len) {
+        return;
+    }
+    memset(p, 0, len);
+    // The buffer escapes into an empty asm block, so the stores stay even
+    // when p is freed or goes out of scope right after
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+static size_t page_size(void) {
+    if (!g_buffers.page_size) {
+        long size = sysconf(_SC_PAGESIZE);
+        g_buffers.page_size = size > 0 ? (size_t)size : 4096;
+    }
+    return g_buffers.page_size;
+}
+
+/*
+ * Map guard + data + guard and lock the data pages (caller holds lock)
+ * Returns the start of the leading guard page, NULL on failure
+ */
+static uint8_t* map_pages(size_t data_pages, int* locked) {
+    size_t page = page_size();
+    size_t map_len = (data_pages + 2) * page;
+
+    uint8_t* base = mmap(NULL, map_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        LOGE("Failed to map %zu bytes", map_len);
+        return NULL;
+    }
+
+    uint8_t* data = base + page;
+    size_t data_len = data_pages * page;
+
+    if (mprotect(data, data_len, PROT_READ | PROT_WRITE) != 0) {
+        LOGE("Failed to set up secure buffer");
+        munmap(base, map_len);
+        return NULL;
+    }
+
+#ifdef MADV_DONTDUMP
+    madvise(data, data_len, MADV_DONTDUMP);
+#endif
+
+    *locked = (mlock(data, data_len) == 0);
+    if (!*locked) {
+        g_buffers.stats.lock_failures++;
+        LOGW("mlock failed for %zu bytes (RLIMIT_MEMLOCK?), buffer may be swapped", data_len);
+    }
+    return base;
+}
+
+static void unmap_pages(uint8_t* base, size_t data_pages, int locked) {
+    size_t page = page_size();
+    uint8_t* data = base + page;
+    size_t data_len = data_pages * page;
+
+    secure_buffer_wipe(data, data_len);
+    if (locked) {
+        munlock(data, data_len);
+    }
+    munmap(base, data_len + 2 * page);
+}
+
+static buffer_slot_t* map_slot(size_t data_pages) {
+    buffer_slot_t* slot = calloc(1, sizeof(buffer_slot_t));
+    if (!slot) {
+        LOGE("Failed to set up secure buffer");
+        return NULL;
+    }
+
+    slot->base = map_pages(data_pages, &slot->locked);
+    if (!slot->base) {
+        free(slot);
+        return NULL;
+    }
+    slot->data_pages = data_pages;
+    return slot;
+}
+
+static void unmap_slot(buffer_slot_t* slot) {
+    unmap_pages(slot->base, slot->data_pages, slot->locked);
+    free(slot);
+}
+
+// ============================================================================
+// Slabs
+// ============================================================================
+
+// Size class for len, -1 if it takes a mapping of its own
+static int slab_class(size_t len) {
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        if (len <= ((size_t)1 << (SLAB_MIN_SHIFT + c))) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+static buffer_slab_t* map_slab(int c) {
+    size_t slot_size = (size_t)1 << (SLAB_MIN_SHIFT + c);
+    size_t slot_count = SLAB_DATA_PAGES * page_size() / slot_size;
+    size_t words = (slot_count + 63) / 64;
+
+    buffer_slab_t* slab = calloc(1, sizeof(buffer_slab_t));
+    uint64_t* free_map = malloc(words * sizeof(uint64_t));
+    uint32_t* lens = calloc(slot_count, sizeof(uint32_t));
+    uint8_t* base = (slab && free_map && lens) ? map_pages(SLAB_DATA_PAGES, &slab->locked) : NULL;
+    if (!base) {
+        LOGE("Failed to set up a %zu-byte slab", slot_size);
+        free(lens);
+        free(free_map);
+        free(slab);
+        return NULL;
+    }
+
+    memset(free_map, 0xff, words * sizeof(uint64_t));
+    if (slot_count % 64) {
+        free_map[words - 1] = ((uint64_t)1 << (slot_count % 64)) - 1;
+    }
+
+    slab->base = base;
+    slab->data = base + page_size();
+    slab->slot_size = slot_size;
+    slab->slot_count = slot_count;
+    slab->free_map = free_map;
+    slab->lens = lens;
+    g_buffers.slab_count++;
+    return slab;
+}
+
+static void unmap_slab(buffer_slab_t* slab) {
+    unmap_pages(slab->base, SLAB_DATA_PAGES, slab->locked);
+    free(slab->lens);
+    free(slab->free_map);
+    free(slab);
+    g_buffers.slab_count--;
+}
+
+static uint8_t* slab_alloc(int c, size_t len) {
+    buffer_slab_t* slab = g_buffers.slabs[c];
+    while (slab && slab->used == slab->slot_count) {
+        slab = slab->next;
+    }
+    if (!slab) {
+        slab = map_slab(c);
+        if (!slab) {
+            return NULL;
+        }
+        slab->next = g_buffers.slabs[c];
+        g_buffers.slabs[c] = slab;
+    }
+
+    size_t w = 0;
+    while (!slab->free_map[w]) w++;
+    size_t i = w * 64 + (size_t)__builtin_ctzll(slab->free_map[w]);
+    slab->free_map[w] &= slab->free_map[w] - 1;
+    slab->used++;
+    slab->lens[i] = (uint32_t)len;
+    return slab->data + i * slab->slot_size;
+}
+
+// Slab and slot index holding buf, NULL if buf is not a slab slot
+static buffer_slab_t* slab_of(const uint8_t* buf, size_t* index) {
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        for (buffer_slab_t* slab = g_buffers.slabs[c]; slab; slab = slab->next) {
+            size_t span = slab->slot_count * slab->slot_size;
+            if (buf >= slab->data && buf < slab->data + span) {
+                size_t offset = (size_t)(buf - slab->data);
+                if (offset % slab->slot_size ||
+                    (slab->free_map[offset / slab->slot_size / 64] >>
+                     (offset / slab->slot_size % 64) & 1)) {
+                    return NULL;
+                }
+                *index = offset / slab->slot_size;
+                return slab;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void slab_free(buffer_slab_t* slab, size_t i) {
+    secure_buffer_wipe(slab->data + i * slab->slot_size, slab->slot_size);
+    slab->free_map[i / 64] |= (uint64_t)1 << (i % 64);
+    slab->lens[i] = 0;
+    if (--slab->used > 0) {
+        return;
+    }
+
+    // Keep one empty slab per class; unmap this one if another is spare
+    int c = slab_class(slab->slot_size);
+    buffer_slab_t** self = NULL;
+    int spare = 0;
+    for (buffer_slab_t** link = &g_buffers.slabs[c]; *link; link = &(*link)->next) {
+        if (*link == slab) {
+            self = link;
+        } else if ((*link)->used == 0) {
+            spare = 1;
+        }
+    }
+    if (spare) {
+        *self = slab->next;
+        unmap_slab(slab);
+    }
+}
+
+// ============================================================================
+// Buffers
+// ============================================================================
+
+static buffer_slot_t* unlink_slot(buffer_slot_t** list, const uint8_t* value) {
+    for (buffer_slot_t** link = list; *link; link = &(*link)->next) {
+        buffer_slot_t* slot = *link;
+        if (slot->value == value) {
+            *link = slot->next;
+            slot->next = NULL;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+uint8_t* secure_buffer_alloc(size_t len) {
+    size_t page = page_size();
+    size_t rounded = (len + VALUE_ALIGN - 1) & ~(size_t)(VALUE_ALIGN - 1);
+    size_t data_pages = rounded ? (rounded + page - 1) / page : 1;
+
+    pthread_mutex_lock(&g_buffers.lock);
+
+    // Small secrets share a slab: no system call once the slab is mapped
+    int c = slab_class(len);
+    if (c >= 0) {
+        uint8_t* value = slab_alloc(c, len);
+        if (value) {
+            g_buffers.in_use_count++;
+            g_buffers.stats.allocations++;
+            g_buffers.stats.slab_allocations++;
+        }
+        pthread_mutex_unlock(&g_buffers.lock);
+        return value;
+    }
+
+    // Reuse the smallest pooled mapping that fits, within 2x
+    buffer_slot_t** best = NULL;
+    for (buffer_slot_t** link = &g_buffers.pool; *link; link = &(*link)->next) {
+        size_t pages = (*link)->data_pages;
+        if (pages >= data_pages && pages <= data_pages * 2 &&
+            (!best || pages < (*best)->data_pages)) {
+            best = link;
+        }
+    }
+
+    buffer_slot_t* slot;
+    if (best) {
+        slot = *best;
+        *best = slot->next;
+        g_buffers.pool_count--;
+        g_buffers.stats.pool_hits++;
+    } else {
+        slot = map_slot(data_pages);
+        if (!slot) {
+            pthread_mutex_unlock(&g_buffers.lock);
+            return NULL;
+        }
+    }
+
+    // Right-align so the value ends at the trailing guard page
+    uint8_t* data_end = slot->base + (slot->data_pages + 1) * page;
+    slot->value = data_end - rounded;
+    slot->len = len;
+    slot->next = g_buffers.in_use;
+    g_buffers.in_use = slot;
+    g_buffers.in_use_count++;
+    g_buffers.stats.allocations++;
+
+    pthread_mutex_unlock(&g_buffers.lock);
+    return slot->value;
+}
+
+void secure_buffer_free(uint8_t* buf) {
+    if (!buf) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_buffers.lock);
+    size_t index;
+    buffer_slab_t* slab = slab_of(buf, &index);
+    if (slab) {
+        slab_free(slab, index);
+        g_buffers.in_use_count--;
+        pthread_mutex_unlock(&g_buffers.lock);
+        return;
+    }
+
+    buffer_slot_t* slot = unlink_slot(&g_buffers.in_use, buf);
+    if (!slot) {
+        pthread_mutex_unlock(&g_buffers.lock);
+        LOGE("secure_buffer_free: unknown buffer %p", (void*)buf);
+        return;
+    }
+    g_buffers.in_use_count--;
+
+    // Wipe the whole data area, not just len: callers may have written past it
+    secure_buffer_wipe(slot->base + page_size(), slot->data_pages * page_size());
+    slot->value = NULL;
+    slot->len = 0;
+
+    if (g_buffers.pool_count < POOL_MAX) {
+        slot->next = g_buffers.pool;
+        g_buffers.pool = slot;
+        g_buffers.pool_count++;
+        slot = NULL;
+    }
+    pthread_mutex_unlock(&g_buffers.lock);
+
+    if (slot) {
+        unmap_slot(slot);
+    }
+}
+
+size_t secure_buffer_size(const uint8_t* buf) {
+    size_t len = 0;
+
+    pthread_mutex_lock(&g_buffers.lock);
+    size_t index;
+    buffer_slab_t* slab = slab_of(buf, &index);
+    if (slab) {
+        len = slab->lens[index];
+    } else {
+        for (buffer_slot_t* slot = g_buffers.in_use; slot; slot = slot->next) {
+            if (slot->value == buf) {
+                len = slot->len;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_buffers.lock);
+    return len;
+}
+
+void secure_buffer_trim(void) {
+    pthread_mutex_lock(&g_buffers.lock);
+    buffer_slot_t* pool = g_buffers.pool;
+    g_buffers.pool = NULL;
+    g_buffers.pool_count = 0;
+
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        buffer_slab_t** link = &g_buffers.slabs[c];
+        while (*link) {
+            buffer_slab_t* slab = *link;
+            if (slab->used == 0) {
+                *link = slab->next;
+                unmap_slab(slab);
+            } else {
+                link = &slab->next;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_buffers.lock);
+
+    while (pool) {
+        buffer_slot_t* next = pool->next;
+        unmap_slot(pool);
+        pool = next;
+    }
+}
+
+void secure_buffer_get_stats(secure_buffer_stats_t* stats) {
+    pthread_mutex_lock(&g_buffers.lock);
+    *stats = g_buffers.stats;
+    stats->in_use = g_buffers.in_use_count;
+    stats->pooled = g_buffers.pool_count;
+    stats->slabs = g_buffers.slab_count;
+    pthread_mutex_unlock(&g_buffers.lock);
+}
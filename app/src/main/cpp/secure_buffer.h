@@ -0,0 +1,77 @@
+/*
+ * SovereignDroid Secure Buffers
+ *
+ * Library-owned memory for decrypted secrets:
+ * - Page-granular mappings locked into RAM (mlock), never swapped
+ * - PROT_NONE guard pages on both sides; the value ends right at the
+ *   trailing guard, so overruns fault instead of reading neighbours
+ * - Excluded from core dumps where supported
+ * - Wiped on free, then kept in a small pool so hot paths skip the
+ *   mmap/mlock/mprotect system calls
+ * - Up to SECURE_BUFFER_SLAB_MAX bytes (keys, hashes, short values) come
+ *   from shared slabs of fixed size classes instead: one locked,
+ *   guard-paged mapping serves many secrets, so an allocation is a
+ *   bitmap scan under a mutex rather than a system call or page fault.
+ *   Slots of a slab are adjacent; the guard pages bound the slab
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_BUFFER_H
+#define SOVEREIGNDROID_SECURE_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Largest allocation served from a slab
+#define SECURE_BUFFER_SLAB_MAX 2048
+
+typedef struct {
+    uint64_t allocations;       // secure_buffer_alloc calls that succeeded
+    uint64_t pool_hits;         // Served from the pool without a new mapping
+    uint64_t slab_allocations;  // Served from a slab slot
+    uint64_t lock_failures;     // mlock refused (RLIMIT_MEMLOCK); buffer still usable
+    size_t in_use;              // Buffers currently handed out
+    size_t pooled;              // Wiped mappings waiting for reuse
+    size_t slabs;               // Slab mappings, in use or spare
+} secure_buffer_stats_t;
+
+/*
+ * Allocate len bytes of locked, guard-paged memory
+ * Returns NULL on failure
+ */
+uint8_t* secure_buffer_alloc(size_t len);
+
+/*
+ * Wipe and release a buffer from secure_buffer_alloc (NULL is ignored)
+ */
+void secure_buffer_free(uint8_t* buf);
+
+/*
+ * Usable length of a buffer from secure_buffer_alloc
+ */
+size_t secure_buffer_size(const uint8_t* buf);
+
+/*
+ * Zero len bytes of secret data in a way the compiler cannot drop, for
+ * memory that is about to be freed or go out of scope
+ */
+void secure_buffer_wipe(void* p, size_t len);
+
+/*
+ * Unmap every pooled buffer and empty slab (buffers in use are not touched)
+ */
+void secure_buffer_trim(void);
+
+/*
+ * Snapshot pool counters
+ */
+void secure_buffer_get_stats(secure_buffer_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_BUFFER_H
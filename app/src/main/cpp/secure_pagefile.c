@@ -0,0 +1,489 @@
+/*
+ * SovereignDroid Encrypted Page Files - Implementation
+ *
+ * Physical page 0 is a header: magic, version, page size and a sealed
+ * check block that tells a wrong key apart from a damaged file. Logical
+ * page n lives in physical page n + 1 as [ciphertext][nonce][tag].
+ *
+ * The cache is one secure_buffer of frames, a chained page -> frame
+ * table and a CLOCK hand. Misses, write-backs and allocation do their
+ * I/O under the file mutex.
+ */
+
+#include "secure_pagefile.h"
+#include "secure_buffer.h"
+#include "sovereign_crypto.h"
+#include <android/log.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "SecurePagefile"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define PAGEFILE_MAGIC 0x46504453u      // "SDPF"
+#define PAGEFILE_VERSION 1
+#define PAGEFILE_DEFAULT_CACHE 64
+#define PAGEFILE_CHECK_SIZE 32
+
+// Page trailer: [nonce 12][tag 16] after the ciphertext
+#define PAGE_NONCE_OFFSET SECURE_PAGEFILE_DATA_SIZE
+#define PAGE_TAG_OFFSET (PAGE_NONCE_OFFSET + CHACHA20_NONCE_SIZE)
+
+// Header page: [magic u32][version u32][page size u32][reserved u32]
+//              [check nonce 12][check tag 16][check ciphertext 32]
+#define HEADER_NONCE_OFFSET 16
+#define HEADER_TAG_OFFSET (HEADER_NONCE_OFFSET + CHACHA20_NONCE_SIZE)
+#define HEADER_CHECK_OFFSET (HEADER_TAG_OFFSET + POLY1305_TAG_SIZE)
+
+#define NO_FRAME (-1)
+
+typedef struct {
+    uint64_t page_no;
+    int32_t bucket_next;
+    uint32_t pins;
+    uint8_t used;
+    uint8_t referenced;     // CLOCK bit, set on every pin
+    uint8_t dirty;
+} page_frame_t;
+
+struct secure_pagefile {
+    pthread_mutex_t lock;
+    int fd;
+    uint8_t* key;           // SECURE_PAGEFILE_KEY_SIZE, secure_buffer
+    uint64_t page_count;
+
+    uint8_t* data;          // frame_count * SECURE_PAGEFILE_DATA_SIZE, secure_buffer
+    page_frame_t* frames;
+    size_t frame_count;
+    int32_t* buckets;
+    size_t bucket_mask;
+    size_t hand;
+
+    uint8_t io[SECURE_PAGEFILE_PAGE_SIZE];  // Sealed page being read or written
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+    uint64_t auth_failures;
+};
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static off_t page_offset(uint64_t page_no) {
+    return (off_t)((page_no + 1) * SECURE_PAGEFILE_PAGE_SIZE);
+}
+
+/*
+ * Nonce actually used for a page: the stored random nonce with the page
+ * number XORed into its first 8 bytes. Moving a sealed page to another
+ * slot changes the nonce, so its tag no longer verifies.
+ */
+static void page_nonce(const uint8_t* stored, uint64_t page_no,
+                       uint8_t nonce[CHACHA20_NONCE_SIZE]) {
+    memcpy(nonce, stored, CHACHA20_NONCE_SIZE);
+    for (int i = 0; i < 8; i++) {
+        nonce[i] ^= (uint8_t)(page_no >> (8 * i));
+    }
+}
+
+static int write_full(int fd, const uint8_t* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, uint8_t* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Sealing
+// ============================================================================
+
+static int seal_page(secure_pagefile_t* pf, uint64_t page_no, const uint8_t* plaintext) {
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+
+    if (!sovereign_random_bytes(pf->io + PAGE_NONCE_OFFSET, CHACHA20_NONCE_SIZE)) {
+        return -1;
+    }
+    page_nonce(pf->io + PAGE_NONCE_OFFSET, page_no, nonce);
+
+    if (!chacha20_poly1305_encrypt(pf->key, nonce, plaintext, SECURE_PAGEFILE_DATA_SIZE,
+                                   pf->io, pf->io + PAGE_TAG_OFFSET)) {
+        return -1;
+    }
+
+    if (write_full(pf->fd, pf->io, SECURE_PAGEFILE_PAGE_SIZE, page_offset(page_no)) != 0) {
+        LOGE("Failed to write page %llu: %s", (unsigned long long)page_no, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int open_page(secure_pagefile_t* pf, uint64_t page_no, uint8_t* plaintext) {
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+
+    if (read_full(pf->fd, pf->io, SECURE_PAGEFILE_PAGE_SIZE, page_offset(page_no)) != 0) {
+        LOGE("Failed to read page %llu", (unsigned long long)page_no);
+        return -1;
+    }
+    page_nonce(pf->io + PAGE_NONCE_OFFSET, page_no, nonce);
+
+    if (!chacha20_poly1305_decrypt(pf->key, nonce, pf->io, SECURE_PAGEFILE_DATA_SIZE,
+                                   pf->io + PAGE_TAG_OFFSET, plaintext)) {
+        pf->auth_failures++;
+        LOGE("Page %llu failed authentication", (unsigned long long)page_no);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_header(secure_pagefile_t* pf) {
+    uint8_t check[PAGEFILE_CHECK_SIZE] = {0};
+
+    memset(pf->io, 0, sizeof(pf->io));
+    put_u32(pf->io, PAGEFILE_MAGIC);
+    put_u32(pf->io + 4, PAGEFILE_VERSION);
+    put_u32(pf->io + 8, SECURE_PAGEFILE_PAGE_SIZE);
+
+    if (!sovereign_random_bytes(pf->io + HEADER_NONCE_OFFSET, CHACHA20_NONCE_SIZE) ||
+        !chacha20_poly1305_encrypt(pf->key, pf->io + HEADER_NONCE_OFFSET, check, sizeof(check),
+                                   pf->io + HEADER_CHECK_OFFSET, pf->io + HEADER_TAG_OFFSET)) {
+        return -1;
+    }
+
+    if (write_full(pf->fd, pf->io, SECURE_PAGEFILE_PAGE_SIZE, 0) != 0 || fsync(pf->fd) != 0) {
+        LOGE("Failed to write page file header: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int check_header(secure_pagefile_t* pf) {
+    if (read_full(pf->fd, pf->io, SECURE_PAGEFILE_PAGE_SIZE, 0) != 0) {
+        LOGE("Failed to read page file header");
+        return -1;
+    }
+
+    if (get_u32(pf->io) != PAGEFILE_MAGIC ||
+        get_u32(pf->io + 4) != PAGEFILE_VERSION ||
+        get_u32(pf->io + 8) != SECURE_PAGEFILE_PAGE_SIZE) {
+        LOGE("Not a page file (or unsupported version)");
+        return -1;
+    }
+
+    if (!chacha20_poly1305_verify(pf->key, pf->io + HEADER_NONCE_OFFSET,
+                                  pf->io + HEADER_CHECK_OFFSET, PAGEFILE_CHECK_SIZE,
+                                  pf->io + HEADER_TAG_OFFSET)) {
+        LOGE("Page file key does not match");
+        return -1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Frame table
+// ============================================================================
+
+static size_t bucket_of(const secure_pagefile_t* pf, uint64_t page_no) {
+    return (size_t)((page_no * 0x9E3779B97F4A7C15ull) >> 32) & pf->bucket_mask;
+}
+
+static uint8_t* frame_data(secure_pagefile_t* pf, int32_t f) {
+    return pf->data + (size_t)f * SECURE_PAGEFILE_DATA_SIZE;
+}
+
+static int32_t find_frame(secure_pagefile_t* pf, uint64_t page_no) {
+    int32_t f = pf->buckets[bucket_of(pf, page_no)];
+    while (f != NO_FRAME && pf->frames[f].page_no != page_no) {
+        f = pf->frames[f].bucket_next;
+    }
+    return f;
+}
+
+static void insert_frame(secure_pagefile_t* pf, int32_t f) {
+    size_t b = bucket_of(pf, pf->frames[f].page_no);
+    pf->frames[f].bucket_next = pf->buckets[b];
+    pf->buckets[b] = f;
+}
+
+static void remove_frame(secure_pagefile_t* pf, int32_t f) {
+    int32_t* link = &pf->buckets[bucket_of(pf, pf->frames[f].page_no)];
+    while (*link != f) {
+        link = &pf->frames[*link].bucket_next;
+    }
+    *link = pf->frames[f].bucket_next;
+}
+
+static int write_back(secure_pagefile_t* pf, int32_t f) {
+    if (seal_page(pf, pf->frames[f].page_no, frame_data(pf, f)) != 0) {
+        return -1;
+    }
+    pf->frames[f].dirty = 0;
+    pf->writebacks++;
+    return 0;
+}
+
+/*
+ * Pick a free frame with the CLOCK hand, evicting (and writing back) an
+ * unpinned page whose reference bit is clear. Two sweeps clear every
+ * bit, so failing after them means every frame is pinned.
+ */
+static int32_t claim_frame(secure_pagefile_t* pf) {
+    for (size_t step = 0; step < 2 * pf->frame_count + 1; step++) {
+        int32_t f = (int32_t)pf->hand;
+        page_frame_t* frame = &pf->frames[f];
+        pf->hand = (pf->hand + 1) % pf->frame_count;
+
+        if (!frame->used) return f;
+        if (frame->pins > 0) continue;
+        if (frame->referenced) {
+            frame->referenced = 0;
+            continue;
+        }
+
+        if (frame->dirty && write_back(pf, f) != 0) {
+            return NO_FRAME;
+        }
+        remove_frame(pf, f);
+        frame->used = 0;
+        pf->evictions++;
+        return f;
+    }
+
+    LOGW("All %zu cache frames are pinned", pf->frame_count);
+    return NO_FRAME;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+secure_pagefile_t* secure_pagefile_open(const char* path,
+                                        const uint8_t key[SECURE_PAGEFILE_KEY_SIZE],
+                                        size_t cache_pages) {
+    if (!path || !key) return NULL;
+    if (cache_pages == 0) cache_pages = PAGEFILE_DEFAULT_CACHE;
+
+    secure_pagefile_t* pf = calloc(1, sizeof(*pf));
+    if (!pf) return NULL;
+    pthread_mutex_init(&pf->lock, NULL);
+    pf->fd = -1;
+    pf->frame_count = cache_pages;
+
+    size_t buckets = 1;
+    while (buckets < cache_pages * 2) buckets <<= 1;
+    pf->bucket_mask = buckets - 1;
+
+    pf->key = secure_buffer_alloc(SECURE_PAGEFILE_KEY_SIZE);
+    if (!pf->key) {
+        LOGE("Failed to allocate page file key");
+        goto fail;
+    }
+    memcpy(pf->key, key, SECURE_PAGEFILE_KEY_SIZE);
+
+    pf->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    pf->data = secure_buffer_alloc(cache_pages * SECURE_PAGEFILE_DATA_SIZE);
+    pf->frames = calloc(cache_pages, sizeof(page_frame_t));
+    pf->buckets = malloc(buckets * sizeof(int32_t));
+    if (pf->fd < 0 || !pf->data || !pf->frames || !pf->buckets) {
+        LOGE("Failed to open page file %s", path);
+        goto fail;
+    }
+    for (size_t i = 0; i < buckets; i++) {
+        pf->buckets[i] = NO_FRAME;
+    }
+
+    struct stat st;
+    if (fstat(pf->fd, &st) != 0) goto fail;
+
+    if (st.st_size == 0) {
+        if (write_header(pf) != 0) goto fail;
+    } else {
+        if (check_header(pf) != 0) goto fail;
+        // A torn append leaves a partial tail page; the next allocate overwrites it
+        pf->page_count = (uint64_t)st.st_size / SECURE_PAGEFILE_PAGE_SIZE - 1;
+    }
+
+    LOGI("Opened page file (%llu pages, %zu cached)",
+         (unsigned long long)pf->page_count, cache_pages);
+    return pf;
+
+fail:
+    if (pf->fd >= 0) close(pf->fd);
+    secure_buffer_free(pf->data);
+    free(pf->frames);
+    free(pf->buckets);
+    secure_buffer_free(pf->key);
+    pthread_mutex_destroy(&pf->lock);
+    free(pf);
+    return NULL;
+}
+
+int secure_pagefile_close(secure_pagefile_t* pf) {
+    if (!pf) return 0;
+
+    int result = secure_pagefile_flush(pf);
+
+    close(pf->fd);
+    secure_buffer_free(pf->data);
+    free(pf->frames);
+    free(pf->buckets);
+    secure_buffer_free(pf->key);
+    secure_buffer_wipe(pf->io, sizeof(pf->io));
+    pthread_mutex_destroy(&pf->lock);
+    free(pf);
+    return result;
+}
+
+uint64_t secure_pagefile_page_count(secure_pagefile_t* pf) {
+    if (!pf) return 0;
+
+    pthread_mutex_lock(&pf->lock);
+    uint64_t count = pf->page_count;
+    pthread_mutex_unlock(&pf->lock);
+    return count;
+}
+
+int64_t secure_pagefile_allocate(secure_pagefile_t* pf) {
+    if (!pf) return -1;
+
+    static const uint8_t zero[SECURE_PAGEFILE_DATA_SIZE];
+
+    // Sealed and written straight away, so the file never has holes
+    pthread_mutex_lock(&pf->lock);
+    uint64_t page_no = pf->page_count;
+    int result = seal_page(pf, page_no, zero);
+    if (result == 0) {
+        pf->page_count++;
+    }
+    pthread_mutex_unlock(&pf->lock);
+
+    return result == 0 ? (int64_t)page_no : -1;
+}
+
+uint8_t* secure_pagefile_pin(secure_pagefile_t* pf, uint64_t page_no) {
+    if (!pf) return NULL;
+
+    pthread_mutex_lock(&pf->lock);
+
+    if (page_no >= pf->page_count) {
+        pthread_mutex_unlock(&pf->lock);
+        return NULL;
+    }
+
+    int32_t f = find_frame(pf, page_no);
+    if (f != NO_FRAME) {
+        pf->hits++;
+    } else {
+        pf->misses++;
+        f = claim_frame(pf);
+        if (f == NO_FRAME || open_page(pf, page_no, frame_data(pf, f)) != 0) {
+            if (f != NO_FRAME) {
+                secure_buffer_wipe(frame_data(pf, f), SECURE_PAGEFILE_DATA_SIZE);
+            }
+            pthread_mutex_unlock(&pf->lock);
+            return NULL;
+        }
+
+        page_frame_t* frame = &pf->frames[f];
+        frame->page_no = page_no;
+        frame->used = 1;
+        frame->dirty = 0;
+        frame->pins = 0;
+        insert_frame(pf, f);
+    }
+
+    pf->frames[f].pins++;
+    pf->frames[f].referenced = 1;
+    uint8_t* data = frame_data(pf, f);
+
+    pthread_mutex_unlock(&pf->lock);
+    return data;
+}
+
+void secure_pagefile_unpin(secure_pagefile_t* pf, uint64_t page_no, int dirty) {
+    if (!pf) return;
+
+    pthread_mutex_lock(&pf->lock);
+    int32_t f = find_frame(pf, page_no);
+    if (f != NO_FRAME && pf->frames[f].pins > 0) {
+        pf->frames[f].pins--;
+        if (dirty) pf->frames[f].dirty = 1;
+    } else {
+        LOGW("Unpin of page %llu that is not pinned", (unsigned long long)page_no);
+    }
+    pthread_mutex_unlock(&pf->lock);
+}
+
+int secure_pagefile_flush(secure_pagefile_t* pf) {
+    if (!pf) return -1;
+
+    int result = 0;
+
+    pthread_mutex_lock(&pf->lock);
+    for (size_t f = 0; f < pf->frame_count; f++) {
+        if (pf->frames[f].used && pf->frames[f].dirty &&
+            write_back(pf, (int32_t)f) != 0) {
+            result = -1;
+        }
+    }
+    if (fdatasync(pf->fd) != 0) {
+        LOGE("Failed to sync page file: %s", strerror(errno));
+        result = -1;
+    }
+    pthread_mutex_unlock(&pf->lock);
+
+    return result;
+}
+
+void secure_pagefile_get_stats(secure_pagefile_t* pf, secure_pagefile_stats_t* stats) {
+    if (!pf || !stats) return;
+
+    pthread_mutex_lock(&pf->lock);
+    stats->hits = pf->hits;
+    stats->misses = pf->misses;
+    stats->evictions = pf->evictions;
+    stats->writebacks = pf->writebacks;
+    stats->auth_failures = pf->auth_failures;
+    stats->page_count = pf->page_count;
+    stats->cache_pages = pf->frame_count;
+    pthread_mutex_unlock(&pf->lock);
+}
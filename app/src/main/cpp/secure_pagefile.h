@@ -0,0 +1,111 @@
+/*
+ * SovereignDroid Encrypted Page Files
+ *
+ * Random-access encrypted files for structured data (world state,
+ * indexes) that is too large to seal as one value. Other native modules
+ * build B-trees and similar structures on top, touching only the pages
+ * they need instead of decrypting whole files.
+ *
+ * - Fixed 4 KiB pages on disk, each sealed on its own with
+ *   ChaCha20-Poly1305: [ciphertext][nonce][tag], so a page carries
+ *   SECURE_PAGEFILE_DATA_SIZE bytes of data (as in SQLCipher)
+ * - Fresh random nonce on every write; the page number is folded into
+ *   the nonce, so a page copied to another slot fails authentication
+ * - Bounded cache of decrypted pages in locked, guard-paged memory
+ *   (secure_buffer), evicted by CLOCK; dirty pages are sealed and
+ *   written back on eviction and on flush
+ * - Caller-supplied 256-bit key, never the storage master key, so a
+ *   file survives master key rotation. Keep the key itself in secure
+ *   storage.
+ *
+ * No journal: flush is the durability point and pages are rewritten in
+ * place, so callers needing atomic multi-page updates keep their own
+ * log. A page torn by a crash fails authentication instead of reading
+ * as garbage. Replaying an old version of a whole page is not detected.
+ *
+ * Thread safety: every call may come from any thread (one mutex per
+ * file). Coordinating writers to the same page is up to the caller.
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_PAGEFILE_H
+#define SOVEREIGNDROID_SECURE_PAGEFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SECURE_PAGEFILE_KEY_SIZE 32
+#define SECURE_PAGEFILE_PAGE_SIZE 4096          // On disk
+#define SECURE_PAGEFILE_DATA_SIZE (SECURE_PAGEFILE_PAGE_SIZE - 28)  // Usable per page
+
+typedef struct secure_pagefile secure_pagefile_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;        // Dirty pages sealed and written
+    uint64_t auth_failures;     // Pages that failed their tag (tampered or torn)
+    uint64_t page_count;
+    size_t cache_pages;
+} secure_pagefile_stats_t;
+
+/*
+ * Open an encrypted page file, creating it if missing
+ * cache_pages: decrypted pages held in memory (0 picks 64, 256 KiB)
+ * Returns NULL on failure, including a key that does not match the file
+ */
+secure_pagefile_t* secure_pagefile_open(const char* path,
+                                        const uint8_t key[SECURE_PAGEFILE_KEY_SIZE],
+                                        size_t cache_pages);
+
+/*
+ * Flush dirty pages, then wipe the cache and close
+ * Returns 0 on success, -1 if the final flush failed
+ */
+int secure_pagefile_close(secure_pagefile_t* pf);
+
+/*
+ * Number of pages in the file (page numbers run from 0)
+ */
+uint64_t secure_pagefile_page_count(secure_pagefile_t* pf);
+
+/*
+ * Append a zero-filled page
+ * Returns its page number, -1 on failure
+ */
+int64_t secure_pagefile_allocate(secure_pagefile_t* pf);
+
+/*
+ * Pin a page in the cache and return its SECURE_PAGEFILE_DATA_SIZE bytes
+ * of plaintext, decrypting it on a miss. The pointer stays valid until
+ * the matching unpin; pins nest.
+ * Returns NULL if the page does not exist, fails authentication or
+ * every cache frame is pinned
+ */
+uint8_t* secure_pagefile_pin(secure_pagefile_t* pf, uint64_t page_no);
+
+/*
+ * Release a pin; dirty marks the page for write-back
+ */
+void secure_pagefile_unpin(secure_pagefile_t* pf, uint64_t page_no, int dirty);
+
+/*
+ * Seal and write every dirty page, then fdatasync
+ * Returns 0 on success, -1 on failure
+ */
+int secure_pagefile_flush(secure_pagefile_t* pf);
+
+/*
+ * Snapshot cache counters
+ */
+void secure_pagefile_get_stats(secure_pagefile_t* pf, secure_pagefile_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_PAGEFILE_H
@@ -5,7 +5,24 @@
  * 
  * Encryption: ChaCha20-Poly1305 (sovereign implementation)
  * Key Management: Ephemeral 256-bit keys (per-session for Phase 3)
- * Storage: App private storage, encrypted files
+ * Storage: App private storage, append-only segment log
+ *          (see secure_storage_log.c)
+ * Key ids: SipHash-2-4-128 of the key name under a key derived from
+ *          the master key; stored in each record as the key tag
+ * Rotation: each record names the epoch of the master key that sealed
+ *          it; a background job re-keys old records in small batches
+ *          (see Master key rotation)
+ * Namespaces: named stores with their own log and cache under ns/
+ *          (see Namespaces)
+ * Passphrase: optionally the key file is sealed under a key derived
+ *          from a user passphrase with Argon2id (see Key file)
+ * Secrets: master keys and decrypted values handed out whole sit in
+ *          secure_buffer memory (locked, guard-paged, wiped on free);
+ *          other scratch copies are wiped with secure_buffer_wipe
+ * Threads: every entry point (C and JNI) may be called from any thread.
+ *          Key material lives behind g_state_lock: calls hold it shared,
+ *          initialize and shutdown exclusive. Concurrency below that is
+ *          handled by the segment log's sharded index.
  * 
  * Purpose:
  * - Prove native cryptographic operations work
@@ -21,11 +38,25 @@
  */
 
 #include "secure_storage.h"
+#include "secure_storage_log.h"
+#include "secure_storage_cache.h"
+#include "secure_storage_names.h"
+#include "secure_storage_backup.h"
+#include "secure_storage_dedup.h"
+#include "secure_buffer.h"
+#include "sovereign_argon2.h"
 #include "sovereign_crypto.h"
+#include "sovereign_sha512.h"
+#include "sovereign_siphash.h"
+#include "sovereign_lz.h"
 #include <android/log.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -36,33 +67,306 @@
 
 // Storage constants
 #define STORAGE_DIR "/data/data/com.sovereigndroid.core/files/secure"
-#define KEY_FILE "/data/data/com.sovereigndroid.core/files/secure/.master_key"
+#define KEY_FILE_NAME ".master_key"
 #define MAX_PATH 512
 
-// Global encryption key (persistent across app restarts)
-static unsigned char g_encryption_key[CHACHA20_KEY_SIZE];
+// Record payload: [nonce][tag][ciphertext]
+#define PAYLOAD_OVERHEAD (CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE)
+
+// Guards everything below; see Threads in the file header
+static pthread_rwlock_t g_state_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Storage root (secure_storage_set_root, before initialize)
+static char g_storage_dir[MAX_PATH] = STORAGE_DIR;
+
+// Segment log of the main store, open while initialized, and whether
+// its appends are synced (secure_storage_set_durability)
+static storage_log_t* g_log = NULL;
+static secure_storage_durability_t g_durability = SECURE_STORAGE_DURABILITY_SYNC;
+
+// Key material, in one secure_buffer slot while initialized
+typedef struct {
+    // Global encryption key (persistent across app restarts)
+    uint8_t encryption_key[CHACHA20_KEY_SIZE];
+
+    // Key being rotated away from: records sealed under it stay readable
+    // until the rotation job has rewritten all of them
+    uint8_t previous_key[CHACHA20_KEY_SIZE];
+
+    // SipHash key for key ids, derived from the first master key and
+    // kept through rotations
+    uint8_t key_id_key[SIPHASH_KEY_SIZE];
+
+    // Key the key file is sealed under, when passphrase protected
+    uint8_t wrap_key[CHACHA20_KEY_SIZE];
+} storage_keys_t;
+
+static storage_keys_t* g_keys = NULL;
+
+// Passphrase for the next initialize (secure_storage_set_passphrase),
+// in secure_buffer memory until initialize has used it
+static uint8_t* g_passphrase = NULL;
+static size_t g_passphrase_len = 0;
+
+// Whether the key file is wrapped, and the Argon2id parameters and salt
+// its wrapping key was derived with
+#define KEY_WRAP_SALT_SIZE 16
+static int g_key_wrapped = 0;
+static argon2_params_t g_wrap_params;
+static uint8_t g_wrap_salt[KEY_WRAP_SALT_SIZE];
+static uint32_t g_key_epoch = 0;
 static int g_initialized = 0;
+static uint32_t g_previous_epoch = 0;
+static int g_has_previous = 0;
+
+// Per-key .enc files from before the segment log: their names (a hash
+// in hex) as found at open, sorted. Files migrated or deleted since stay
+// listed and just fail the access() check
+static uint32_t* g_legacy_ids = NULL;
+static size_t g_legacy_files = 0;
+
+/*
+ * Streamed values: fixed-size chunks, each its own record and AEAD message,
+ * plus a small encrypted manifest stored under the key itself.
+ * Chunk i lives under SipHash(key_id || stream_id || i) and is encrypted
+ * with nonce [nonce_prefix][i], so chunks cannot be reordered or spliced
+ * in from another stream.
+ * Deduplicated values (STREAM_MANIFEST_DEDUP, see Deduplicated values)
+ * reuse the manifest but keep their chunks in a shared pool.
+ */
+#define STREAM_MANIFEST_VERSION 1
+#define STREAM_MANIFEST_DEDUP 2
+#define STREAM_MANIFEST_SIZE 48
+#define STREAM_ID_SIZE 16
+#define STREAM_NONCE_PREFIX_SIZE 8
+#define STREAM_CHUNK_MAX (1024 * 1024)
+
+typedef struct {
+    uint8_t version;            // STREAM_MANIFEST_VERSION or _DEDUP
+    uint32_t chunk_size;        // Largest chunk for _DEDUP
+    uint32_t chunk_count;
+    uint64_t total_len;
+    uint8_t stream_id[STREAM_ID_SIZE];
+    uint8_t nonce_prefix[STREAM_NONCE_PREFIX_SIZE];
+} stream_manifest_t;
+
+struct secure_storage_writer {
+    char* key;                  // Recorded in the name index on close
+    storage_key_id_t key_id;
+    stream_manifest_t manifest;
+    unsigned char* chunk;       // Plaintext being filled
+    size_t chunk_fill;
+    unsigned char* payload;     // [nonce][tag][ciphertext] of one chunk
+    unsigned char* packed;      // Compressed chunk, allocated on first use
+};
+
+struct secure_storage_reader {
+    storage_key_id_t key_id;
+    stream_manifest_t manifest;
+    int plain;                  // Regular value, held as a single chunk
+    unsigned char* chunk;       // Decrypted current chunk
+    uint32_t chunk_index;       // UINT32_MAX when nothing is loaded
+    size_t chunk_len;
+    uint64_t position;
+    uint8_t* recipe;            // Deduplicated values: chunk digests and lengths
+    uint64_t* offsets;          // and where each chunk starts
+};
+
+// Stream internals, also used by the whole-value paths
+// (caller holds the state lock)
+static secure_storage_reader_t* reader_open(const char* key);
+static int reader_read(secure_storage_reader_t* reader, uint8_t* data, size_t data_len,
+                       size_t* read_len);
+static void writer_abort(secure_storage_writer_t* writer);
+
+// Name records for the ordered index (caller holds the state lock)
+static int record_name(const char* key, const storage_key_id_t* key_id);
+
+// Shared chunks of a deduplicated value (caller holds the state lock)
+static void dedup_release(const storage_key_id_t* key_id, const stream_manifest_t* m);
+
+/*
+ * Enter a storage call: hold the state lock shared so shutdown cannot
+ * wipe the key underneath us. Returns 0 (lock released) if not initialized
+ */
+static int state_enter(void) {
+    pthread_rwlock_rdlock(&g_state_lock);
+    if (!g_initialized) {
+        pthread_rwlock_unlock(&g_state_lock);
+        LOGE("Storage not initialized");
+        return 0;
+    }
+    return 1;
+}
+
+static void state_leave(void) {
+    pthread_rwlock_unlock(&g_state_lock);
+}
+
+/*
+ * Derive the key id key: SHA-512 over a domain label and the master key
+ */
+static void derive_key_id_key(void) {
+    static const char label[] = "sovereigndroid/storage/key-id/v1";
+    uint8_t digest[64];
+    sha512_ctx ctx;
+    
+    sha512_init(&ctx);
+    sha512_update(&ctx, (const uint8_t*)label, sizeof(label) - 1);
+    sha512_update(&ctx, g_keys->encryption_key, CHACHA20_KEY_SIZE);
+    sha512_final(&ctx, digest);
+    
+    memcpy(g_keys->key_id_key, digest, SIPHASH_KEY_SIZE);
+    secure_buffer_wipe(digest, sizeof(digest));
+    secure_buffer_wipe(&ctx, sizeof(ctx));
+}
+
+/*
+ * Keyed 128-bit id of a key name, used by both the C and JNI paths
+ */
+static void key_id_for(const char* key, storage_key_id_t* key_id) {
+    siphash_128(g_keys->key_id_key, (const uint8_t*)key, strlen(key), key_id->bytes);
+}
+
+/*
+ * Master key that sealed records of an epoch, NULL if it is no longer held
+ */
+static const unsigned char* key_for_epoch(uint32_t epoch) {
+    if (epoch == g_key_epoch) {
+        return g_keys->encryption_key;
+    }
+    if (g_has_previous && epoch == g_previous_epoch) {
+        return g_keys->previous_key;
+    }
+    LOGE("No master key for epoch %u", epoch);
+    return NULL;
+}
 
 /*
- * Simple SHA-256 implementation for filename hashing
- * Using a basic hash for filenames (not security-critical)
+ * Hash that named legacy per-key files (32-bit, collision-prone).
+ * Only used to find files left over from before the segment log.
  */
-static void simple_hash(const char* input, unsigned char* output) {
-    // Simple hash for filename generation (not cryptographic strength needed here)
+static uint32_t legacy_hash(const char* input) {
     unsigned int hash = 0;
-    for (size_t i = 0; i < strlen(input); i++) {
-        hash = (hash * 31 + input[i]) & 0xFFFFFFFF;
+    for (const char* p = input; *p; p++) {
+        hash = (hash * 31 + *p) & 0xFFFFFFFF;
+    }
+    return hash;
+}
+
+/*
+ * Find the legacy per-key file for a key.
+ * The JNI path named files after the hash; the native path after the
+ * first four characters of the hash's hex string.
+ * Returns 1 and fills path if a file exists
+ */
+static int compare_legacy_ids(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int legacy_listed(uint32_t id) {
+    return g_legacy_files &&
+           bsearch(&id, g_legacy_ids, g_legacy_files, sizeof(uint32_t), compare_legacy_ids);
+}
+
+static int find_legacy_file(const char* key, char* path) {
+    char hex[9];
+    uint32_t hash = legacy_hash(key);
+    uint32_t prefix;
+
+    // Keys with no file on the list never touch the filesystem
+    snprintf(hex, sizeof(hex), "%08x", hash);
+    snprintf(path, MAX_PATH, "%s/%s.enc", g_storage_dir, hex);
+    if (legacy_listed(hash) && access(path, F_OK) == 0) {
+        return 1;
+    }
+
+    memcpy(&prefix, hex, sizeof(prefix));
+    snprintf(path, MAX_PATH, "%s/%08x.enc", g_storage_dir, prefix);
+    return legacy_listed(prefix) && access(path, F_OK) == 0;
+}
+
+/*
+ * Move a legacy per-key file into the segment log.
+ * The file layout [nonce][tag][ciphertext] already is a record payload,
+ * so nothing is decrypted or re-encrypted.
+ * Returns 1 if the key was migrated
+ */
+static int migrate_legacy_file(const char* key, const storage_key_id_t* key_id) {
+    char path[MAX_PATH];
+    if (!g_legacy_files || !find_legacy_file(key, path)) {
+        return 0;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (file_size < PAYLOAD_OVERHEAD) {
+        fclose(file);
+        return 0;
+    }
+
+    unsigned char* payload = malloc(file_size);
+    size_t read = payload ? fread(payload, 1, file_size, file) : 0;
+    fclose(file);
+
+    int migrated = (read == (size_t)file_size &&
+                    storage_log_put(g_log, key_id, payload, read) == STORAGE_LOG_OK);
+    free(payload);
+
+    if (migrated) {
+        record_name(key, key_id);
+        unlink(path);
+        LOGI("Migrated legacy file into segment log: %s", path);
     }
-    snprintf((char*)output, 33, "%08x", hash);
+    return migrated;
 }
 
 /*
- * Get file path for a given key
+ * List the legacy per-key files in the storage directory
+ * Returns the number found; g_legacy_ids holds their names
  */
-static void get_file_path(const char* key, char* path) {
-    unsigned char hash[33];
-    simple_hash(key, hash);
-    snprintf(path, MAX_PATH, "%s/%s.enc", STORAGE_DIR, hash);
+static size_t load_legacy_files(void) {
+    free(g_legacy_ids);
+    g_legacy_ids = NULL;
+    
+    DIR* dir = opendir(g_storage_dir);
+    if (!dir) {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t capacity = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        char* end;
+        unsigned long id = strtoul(ent->d_name, &end, 16);
+        if (end != ent->d_name + 8 || strcmp(end, ".enc") != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            size_t grown = capacity ? capacity * 2 : 16;
+            uint32_t* ids = realloc(g_legacy_ids, grown * sizeof(uint32_t));
+            if (!ids) break;
+            g_legacy_ids = ids;
+            capacity = grown;
+        }
+        g_legacy_ids[count++] = (uint32_t)id;
+    }
+    closedir(dir);
+    
+    if (count > 1) {
+        qsort(g_legacy_ids, count, sizeof(uint32_t), compare_legacy_ids);
+    }
+    return count;
 }
 
 /*
@@ -79,7 +383,7 @@ static int encrypt_data(const unsigned char* plaintext, size_t plaintext_len,
     }
     
     // Encrypt with ChaCha20-Poly1305
-    if (!chacha20_poly1305_encrypt(g_encryption_key, nonce,
+    if (!chacha20_poly1305_encrypt(g_keys->encryption_key, nonce,
                                    plaintext, plaintext_len,
                                    ciphertext, tag)) {
         LOGE("Failed to encrypt data");
@@ -95,14 +399,15 @@ static int encrypt_data(const unsigned char* plaintext, size_t plaintext_len,
 }
 
 /*
- * Decrypt data using ChaCha20-Poly1305
+ * Decrypt data using ChaCha20-Poly1305 under the key of its record's epoch
  */
-static int decrypt_data(const unsigned char* ciphertext, size_t ciphertext_len,
+static int decrypt_data(const unsigned char* key,
+                       const unsigned char* ciphertext, size_t ciphertext_len,
                        const unsigned char* nonce, const unsigned char* tag,
                        unsigned char* plaintext, size_t* plaintext_len) {
     
     // Decrypt and verify with ChaCha20-Poly1305
-    if (!chacha20_poly1305_decrypt(g_encryption_key, nonce,
+    if (!key || !chacha20_poly1305_decrypt(key, nonce,
                                    ciphertext, ciphertext_len,
                                    tag, plaintext)) {
         LOGE("Poly1305 authentication FAILED - data tampered or corrupted");
@@ -117,427 +422,4673 @@ static int decrypt_data(const unsigned char* ciphertext, size_t ciphertext_len,
     return 1;
 }
 
+/*
+ * Encrypt a value into a malloc'd record payload
+ */
+static int seal_value(const unsigned char* data, size_t data_len,
+                      unsigned char** payload, size_t* payload_len) {
+    unsigned char* buf = malloc(PAYLOAD_OVERHEAD + data_len);
+    if (!buf) {
+        LOGE("Failed to allocate payload (%zu bytes)", data_len);
+        return 0;
+    }
+    
+    size_t ciphertext_len;
+    if (!encrypt_data(data, data_len, buf + PAYLOAD_OVERHEAD, &ciphertext_len,
+                      buf, buf + CHACHA20_NONCE_SIZE)) {
+        free(buf);
+        return 0;
+    }
+    
+    *payload = buf;
+    *payload_len = PAYLOAD_OVERHEAD + ciphertext_len;
+    return 1;
+}
+
+/*
+ * Map the payload for a key in place, migrating a legacy file on first access
+ */
+static int map_payload(const char* key, const storage_key_id_t* key_id, storage_log_view_t* view) {
+    int result = storage_log_map(g_log, key_id, view);
+    
+    if (result == STORAGE_LOG_NOT_FOUND && migrate_legacy_file(key, key_id)) {
+        result = storage_log_map(g_log, key_id, view);
+    }
+    
+    if (result == STORAGE_LOG_OK && view->payload_len < PAYLOAD_OVERHEAD) {
+        LOGE("Record too small to be valid encrypted data");
+        storage_log_unmap(view);
+        return STORAGE_LOG_ERROR;
+    }
+    
+    return result;
+}
+
 /*
  * ========================================================================
- * Native C API for internal use (other native modules can call these)
+ * Stream chunk helpers
  * ========================================================================
  */
 
+static void put_le32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_le64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_le64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
 /*
- * Initialize secure storage (native C API)
- * Returns 1 on success, 0 on failure
+ * Manifest: [version u8][reserved 3][chunk_size u32][chunk_count u32]
+ *           [reserved u32][total_len u64][stream_id 16][nonce_prefix 8]
  */
-int secure_storage_initialize(void) {
-    if (g_initialized) {
-        LOGI("Secure storage already initialized");
-        return 1;
+static void encode_manifest(const stream_manifest_t* m, uint8_t out[STREAM_MANIFEST_SIZE]) {
+    memset(out, 0, STREAM_MANIFEST_SIZE);
+    out[0] = m->version;
+    put_le32(out + 4, m->chunk_size);
+    put_le32(out + 8, m->chunk_count);
+    put_le64(out + 16, m->total_len);
+    memcpy(out + 24, m->stream_id, STREAM_ID_SIZE);
+    memcpy(out + 40, m->nonce_prefix, STREAM_NONCE_PREFIX_SIZE);
+}
+
+static int decode_manifest(const uint8_t in[STREAM_MANIFEST_SIZE], stream_manifest_t* m) {
+    if (in[0] != STREAM_MANIFEST_VERSION && in[0] != STREAM_MANIFEST_DEDUP) {
+        return 0;
     }
     
-    LOGI("Initializing secure storage subsystem");
-    LOGI("Sovereign crypto: ChaCha20-Poly1305 (RFC 8439)");
+    m->version = in[0];
+    m->chunk_size = get_le32(in + 4);
+    m->chunk_count = get_le32(in + 8);
+    m->total_len = get_le64(in + 16);
+    memcpy(m->stream_id, in + 24, STREAM_ID_SIZE);
+    memcpy(m->nonce_prefix, in + 40, STREAM_NONCE_PREFIX_SIZE);
     
-    // Create storage directory
-    mkdir(STORAGE_DIR, 0700);
-    LOGI("Storage directory: %s", STORAGE_DIR);
+    if (m->chunk_size == 0 || m->chunk_size > STREAM_CHUNK_MAX) return 0;
     
-    // Load or create persistent encryption key
-    FILE* key_file = fopen(KEY_FILE, "rb");
+    // Content-defined chunks vary in length, up to chunk_size each
+    if (m->version == STREAM_MANIFEST_DEDUP) {
+        return m->chunk_count <= m->total_len &&
+               (uint64_t)m->chunk_count * m->chunk_size >= m->total_len;
+    }
     
-    if (key_file) {
-        // Load existing key
-        size_t read = fread(g_encryption_key, 1, CHACHA20_KEY_SIZE, key_file);
-        fclose(key_file);
-        
-        if (read == CHACHA20_KEY_SIZE) {
-            LOGI("Loaded persistent master key");
-            g_initialized = 1;
-            return 1;
-        }
-        
-        LOGW("Corrupted key file, regenerating");
+    // Chunk count must match the length exactly
+    return m->chunk_count == (m->total_len + m->chunk_size - 1) / m->chunk_size;
+}
+
+static void chunk_id_for(const storage_key_id_t* key_id, const stream_manifest_t* m,
+                         uint32_t index, storage_key_id_t* chunk_id) {
+    uint8_t input[STORAGE_KEY_ID_SIZE + STREAM_ID_SIZE + 4];
+    memcpy(input, key_id->bytes, STORAGE_KEY_ID_SIZE);
+    memcpy(input + STORAGE_KEY_ID_SIZE, m->stream_id, STREAM_ID_SIZE);
+    put_le32(input + STORAGE_KEY_ID_SIZE + STREAM_ID_SIZE, index);
+    siphash_128(g_keys->key_id_key, input, sizeof(input), chunk_id->bytes);
+}
+
+static void chunk_nonce(const stream_manifest_t* m, uint32_t index,
+                        uint8_t nonce[CHACHA20_NONCE_SIZE]) {
+    memcpy(nonce, m->nonce_prefix, STREAM_NONCE_PREFIX_SIZE);
+    put_le32(nonce + STREAM_NONCE_PREFIX_SIZE, index);
+}
+
+// Plaintext length of chunk index
+static size_t chunk_length(const stream_manifest_t* m, uint32_t index) {
+    uint64_t start = (uint64_t)index * m->chunk_size;
+    uint64_t remaining = m->total_len - start;
+    return remaining < m->chunk_size ? (size_t)remaining : m->chunk_size;
+}
+
+/*
+ * Read and decrypt the manifest of a streamed value
+ * Returns 1 if key_id currently holds a valid stream
+ */
+static int load_manifest(const storage_key_id_t* key_id, stream_manifest_t* m) {
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, key_id, &flags) != STORAGE_LOG_OK ||
+        !(flags & STORAGE_LOG_FLAG_STREAM)) {
+        return 0;
     }
     
-    // Generate new key
-    if (!sovereign_random_bytes(g_encryption_key, CHACHA20_KEY_SIZE)) {
-        LOGE("Failed to generate encryption key");
+    storage_log_view_t view;
+    if (storage_log_map(g_log, key_id, &view) != STORAGE_LOG_OK) {
         return 0;
     }
     
-    // Save key to file
-    key_file = fopen(KEY_FILE, "wb");
-    if (!key_file) {
-        LOGE("Failed to create key file");
+    uint8_t raw[STREAM_MANIFEST_SIZE];
+    size_t raw_len;
+    int ok = view.payload_len == PAYLOAD_OVERHEAD + STREAM_MANIFEST_SIZE &&
+             decrypt_data(key_for_epoch(view.key_epoch),
+                          view.payload + PAYLOAD_OVERHEAD, STREAM_MANIFEST_SIZE,
+                          view.payload, view.payload + CHACHA20_NONCE_SIZE, raw, &raw_len) &&
+             decode_manifest(raw, m);
+    storage_log_unmap(&view);
+    
+    if (!ok) {
+        LOGE("Invalid stream manifest");
+    }
+    return ok;
+}
+
+/*
+ * Delete the chunks of a stream that is no longer referenced
+ */
+static void release_chunks(const storage_key_id_t* key_id, const stream_manifest_t* m,
+                           uint32_t chunk_count) {
+    if (m->version == STREAM_MANIFEST_DEDUP) {
+        dedup_release(key_id, m);
+        return;
+    }
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        storage_key_id_t chunk_id;
+        chunk_id_for(key_id, m, i, &chunk_id);
+        storage_log_delete(g_log, &chunk_id);
+    }
+}
+
+/*
+ * ========================================================================
+ * Compression and value records
+ * ========================================================================
+ */
+
+/*
+ * Values (and stream chunks) of at least min_size bytes are LZ-compressed
+ * before encryption when that saves an eighth or more. Such a record
+ * carries STORAGE_LOG_FLAG_COMPRESSED and the payload
+ *   [nonce][tag][value length u32][ciphertext of the compressed block]
+ * The length sits outside the AEAD message so sizes are known without
+ * decrypting; decompression must produce exactly that many bytes, which
+ * ties the length to the authenticated block.
+ *
+ * Adaptive bypass: after COMPRESS_MISS_LIMIT values in a row that did not
+ * shrink enough, the next COMPRESS_SKIP values are stored without trying,
+ * so incompressible data (media, archives) pays almost nothing.
+ */
+#define COMPRESS_DEFAULT_MIN 512
+#define COMPRESS_HEADER_SIZE 4
+#define COMPRESS_MISS_LIMIT 4
+#define COMPRESS_SKIP 64
+
+// All fields are accessed with relaxed atomics; the bypass is a heuristic
+static struct {
+    size_t min_size;            // 0 disables compression
+    uint32_t misses;            // Consecutive values that did not shrink enough
+    uint32_t skip;              // Values left to store raw before trying again
+    secure_storage_compression_stats_t stats;
+} g_compress = {
+    .min_size = COMPRESS_DEFAULT_MIN,
+};
+
+// Output budget for a value of len bytes: it must save an eighth
+static size_t compress_budget(size_t len) {
+    return len - len / 8;
+}
+
+// Whether a value of len bytes should be offered to compress_value
+static int compress_wanted(size_t len) {
+    size_t min_size = __atomic_load_n(&g_compress.min_size, __ATOMIC_RELAXED);
+    return min_size && len >= min_size && len <= SOVEREIGN_LZ_MAX_INPUT;
+}
+
+/*
+ * Compress data into out (compress_budget(len) bytes)
+ * Returns the compressed length, 0 to store the value as is
+ */
+static size_t compress_value(const uint8_t* data, size_t len, uint8_t* out) {
+    uint32_t skip = __atomic_load_n(&g_compress.skip, __ATOMIC_RELAXED);
+    if (skip > 0) {
+        __atomic_store_n(&g_compress.skip, skip - 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_compress.stats.values_bypassed, 1, __ATOMIC_RELAXED);
         return 0;
     }
     
-    fwrite(g_encryption_key, 1, CHACHA20_KEY_SIZE, key_file);
-    fclose(key_file);
-    chmod(KEY_FILE, 0600);  // Restrict to owner only
+    size_t packed = sovereign_lz_compress(data, len, out, compress_budget(len));
+    if (packed == 0) {
+        if (__atomic_add_fetch(&g_compress.misses, 1, __ATOMIC_RELAXED) >= COMPRESS_MISS_LIMIT) {
+            __atomic_store_n(&g_compress.misses, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&g_compress.skip, COMPRESS_SKIP, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&g_compress.stats.values_bypassed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
     
-    LOGI("Generated and saved new master key");
-    LOGI("Master key initialized (persistent across restarts)");
-    LOGI("Key source: /dev/urandom (Android secure RNG)");
+    __atomic_store_n(&g_compress.misses, 0, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_compress.stats.values_compressed, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_compress.stats.bytes_in, len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_compress.stats.bytes_out, packed, __ATOMIC_RELAXED);
+    return packed;
+}
+
+/*
+ * Seal a value into a malloc'd record payload, compressed when that pays
+ * off; *flags gets the record flags to append it with
+ */
+static int seal_record(const unsigned char* data, size_t data_len,
+                       unsigned char** payload, size_t* payload_len, uint16_t* flags) {
+    *flags = 0;
+    if (!compress_wanted(data_len)) {
+        return seal_value(data, data_len, payload, payload_len);
+    }
     
-    g_initialized = 1;
+    size_t budget = compress_budget(data_len);
+    unsigned char* packed = malloc(budget);
+    size_t packed_len = packed ? compress_value(data, data_len, packed) : 0;
+    if (packed_len == 0) {
+        free(packed);
+        return seal_value(data, data_len, payload, payload_len);
+    }
+    
+    unsigned char* buf = malloc(PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE + packed_len);
+    size_t ciphertext_len;
+    int sealed = buf && encrypt_data(packed, packed_len,
+                                     buf + PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE,
+                                     &ciphertext_len, buf, buf + CHACHA20_NONCE_SIZE);
+    secure_buffer_wipe(packed, packed_len);
+    free(packed);
+    if (!sealed) {
+        LOGE("Failed to seal compressed value (%zu bytes)", data_len);
+        free(buf);
+        return 0;
+    }
+    
+    put_le32(buf + PAYLOAD_OVERHEAD, (uint32_t)data_len);
+    *payload = buf;
+    *payload_len = PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE + ciphertext_len;
+    *flags = STORAGE_LOG_FLAG_COMPRESSED;
     return 1;
 }
 
-int secure_storage_store(const char* key, const uint8_t* data, size_t data_len) {
-    if (!g_initialized) {
-        LOGE("Storage not initialized");
-        return -1;
+/*
+ * Offset of the AEAD message in a record payload: compressed records
+ * keep their value length in the clear ahead of it
+ */
+static size_t sealed_offset(uint16_t flags) {
+    return PAYLOAD_OVERHEAD + ((flags & STORAGE_LOG_FLAG_COMPRESSED) ? COMPRESS_HEADER_SIZE : 0);
+}
+
+/*
+ * Plaintext length of a mapped value record
+ */
+static int view_value_len(const storage_log_view_t* view, size_t* len) {
+    if (!(view->flags & STORAGE_LOG_FLAG_COMPRESSED)) {
+        *len = view->payload_len - PAYLOAD_OVERHEAD;
+        return 1;
+    }
+    if (view->payload_len < PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE) {
+        LOGE("Compressed record too small");
+        return 0;
+    }
+    // An LZ block expands at most 255-fold; anything longer is corrupt
+    size_t packed_len = view->payload_len - PAYLOAD_OVERHEAD - COMPRESS_HEADER_SIZE;
+    *len = get_le32(view->payload + PAYLOAD_OVERHEAD);
+    if (*len / 255 > packed_len) {
+        LOGE("Compressed record length %zu out of range", *len);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Decrypt a payload under key and nonce into out, which takes exactly
+ * value_len bytes; decompresses when compressed is set
+ */
+static int open_payload(const unsigned char* key, const unsigned char* payload,
+                        size_t payload_len, int compressed,
+                        const unsigned char* nonce, uint8_t* out, size_t value_len) {
+    const unsigned char* tag = payload + CHACHA20_NONCE_SIZE;
+    if (!key) {
+        return 0;
+    }
+    if (!compressed) {
+        return payload_len - PAYLOAD_OVERHEAD == value_len &&
+               chacha20_poly1305_decrypt(key, nonce, payload + PAYLOAD_OVERHEAD,
+                                         value_len, tag, out);
     }
     
-    // Create encrypted filename
-    unsigned char hash[32];
-    simple_hash(key, hash);
-    char filename[256];
-    snprintf(filename, sizeof(filename), "%s/%08x.enc", STORAGE_DIR, *(uint32_t*)hash);
+    size_t packed_len = payload_len - PAYLOAD_OVERHEAD - COMPRESS_HEADER_SIZE;
+    unsigned char* packed = malloc(packed_len ? packed_len : 1);
+    int ok = packed &&
+             chacha20_poly1305_decrypt(key, nonce,
+                                       payload + PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE,
+                                       packed_len, tag, packed) &&
+             sovereign_lz_decompress(packed, packed_len, out, value_len);
+    if (packed) {
+        secure_buffer_wipe(packed, packed_len);
+        free(packed);
+    }
+    return ok;
+}
+
+/*
+ * Decrypt (and decompress) a mapped value record into out, which holds
+ * the view_value_len bytes
+ */
+static int open_view(const storage_log_view_t* view, uint8_t* out, size_t value_len) {
+    if (!open_payload(key_for_epoch(view->key_epoch), view->payload, view->payload_len,
+                      (view->flags & STORAGE_LOG_FLAG_COMPRESSED) != 0, view->payload,
+                      out, value_len)) {
+        LOGE("Poly1305 authentication or decompression FAILED - data tampered or corrupted");
+        return 0;
+    }
+    return 1;
+}
+
+void secure_storage_compression_configure(size_t min_size) {
+    __atomic_store_n(&g_compress.min_size, min_size, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_compress.skip, 0, __ATOMIC_RELAXED);
+}
+
+void secure_storage_get_compression_stats(secure_storage_compression_stats_t* stats) {
+    stats->values_compressed = __atomic_load_n(&g_compress.stats.values_compressed, __ATOMIC_RELAXED);
+    stats->values_bypassed = __atomic_load_n(&g_compress.stats.values_bypassed, __ATOMIC_RELAXED);
+    stats->bytes_in = __atomic_load_n(&g_compress.stats.bytes_in, __ATOMIC_RELAXED);
+    stats->bytes_out = __atomic_load_n(&g_compress.stats.bytes_out, __ATOMIC_RELAXED);
+}
+
+/*
+ * ========================================================================
+ * Deduplicated values (see secure_storage_dedup.h)
+ * ========================================================================
+ */
+
+/*
+ * Values of at least g_dedup.min_size bytes are stored as streams of
+ * content-defined chunks. Each chunk is sealed like a value (random
+ * nonce, compressed when that pays off) under the keyed digest of its
+ * plaintext, flag STORAGE_LOG_FLAG_SHARED, and every value containing
+ * it points at that one record. A manifest with version
+ * STREAM_MANIFEST_DEDUP goes under the key; the recipe it stands for,
+ * [digest 16][length u32] per chunk, is sealed under the stream's chunk
+ * id RECIPE_INDEX. Storing a value again after a small edit only seals
+ * and appends the chunks around the edit.
+ *
+ * A shared chunk cannot be bound to one stream through its nonce, so
+ * readers check its length and digest against the recipe instead.
+ *
+ * Reference counts are rebuilt from the recipes on first use after
+ * open. Each counted recipe holds a reference on its own id too, so a
+ * release can tell whether its recipe was counted and a value released
+ * twice is only uncounted once. Recipes carry STORAGE_LOG_FLAG_SHARED
+ * like chunks, so shared records nothing references (a store or release
+ * cut short by a crash, recipes included) are deleted then.
+ *
+ * g_dedup.lock only covers the counts; chunks are sealed and appended
+ * outside it. Whoever drops a count to zero deletes the chunk, and the
+ * ids of a delete batch stay on g_dedup.deleting until it has landed: a
+ * store that references one of them waits for that first, so a delete
+ * never lands after the chunk was written again. A store that finds a
+ * chunk already referenced still writes it if it is not on disk yet
+ * (its first writer is behind or failed). Commits of the same key wait
+ * for each other the same way, so each replaced manifest is released
+ * exactly once.
+ */
+#define DEDUP_DEFAULT_MIN (256 * 1024)
+#define DEDUP_RECIPE_ENTRY (STORAGE_KEY_ID_SIZE + 4)
+#define DEDUP_BATCH 64
+#define RECIPE_INDEX UINT32_MAX
+
+// Shared records being deleted outside g_dedup.lock
+typedef struct dedup_delete {
+    storage_key_id_t* ids;
+    size_t count;
+    struct dedup_delete* next;
+} dedup_delete_t;
+
+// A key whose recipe and manifest are being appended
+typedef struct dedup_commit {
+    storage_key_id_t key_id;
+    struct dedup_commit* next;
+} dedup_commit_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t settled;     // A delete batch or commit has finished
+    int loaded;                 // Counts rebuilt since open
+    size_t min_size;            // 0 disables dedup (atomic)
+    uint64_t recipes;           // Recipes counted
+    uint64_t chunk_bytes;       // Plaintext of chunks written
+    dedup_delete_t* deleting;   // Delete batches in flight
+    dedup_commit_t* committing; // Commits in flight
+    secure_storage_dedup_stats_t stats;
+} g_dedup = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .settled = PTHREAD_COND_INITIALIZER,
+    .min_size = DEDUP_DEFAULT_MIN,
+};
+
+static int dedup_wanted(size_t len) {
+    size_t min_size = __atomic_load_n(&g_dedup.min_size, __ATOMIC_RELAXED);
+    return min_size && len >= min_size;
+}
+
+/*
+ * Derive the dedup key (gear table and chunk digests) from the key id
+ * key, which stays the same through master key rotations
+ */
+static void derive_dedup_key(void) {
+    static const char label[] = "sovereigndroid/storage/dedup/v1";
+    uint8_t digest[64];
+    sha512_ctx ctx;
     
-    // Encrypt data
-    unsigned char encrypted_data[data_len + 128];  // Extra space for nonce/tag
-    unsigned char nonce[CHACHA20_NONCE_SIZE];
-    unsigned char tag[POLY1305_TAG_SIZE];
-    size_t encrypted_len = data_len;
+    sha512_init(&ctx);
+    sha512_update(&ctx, (const uint8_t*)label, sizeof(label) - 1);
+    sha512_update(&ctx, g_keys->key_id_key, SIPHASH_KEY_SIZE);
+    sha512_final(&ctx, digest);
     
-    if (!encrypt_data(data, data_len, encrypted_data, &encrypted_len, nonce, tag)) {
-        LOGE("Encryption failed");
-        return -1;
+    storage_dedup_set_key(digest);
+    secure_buffer_wipe(digest, sizeof(digest));
+    secure_buffer_wipe(&ctx, sizeof(ctx));
+}
+
+static void recipe_entry(const uint8_t* recipe, uint32_t index,
+                         storage_key_id_t* id, size_t* len) {
+    const uint8_t* entry = recipe + (size_t)index * DEDUP_RECIPE_ENTRY;
+    memcpy(id->bytes, entry, STORAGE_KEY_ID_SIZE);
+    *len = get_le32(entry + STORAGE_KEY_ID_SIZE);
+}
+
+/*
+ * Read and decrypt the recipe of a deduplicated stream
+ * Returns m->chunk_count entries (caller frees), NULL on failure
+ */
+static uint8_t* load_recipe(const storage_key_id_t* key_id, const stream_manifest_t* m) {
+    storage_key_id_t recipe_id;
+    chunk_id_for(key_id, m, RECIPE_INDEX, &recipe_id);
+    
+    storage_log_view_t view;
+    if (storage_log_map(g_log, &recipe_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Dedup recipe missing");
+        return NULL;
+    }
+    
+    size_t len = (size_t)m->chunk_count * DEDUP_RECIPE_ENTRY;
+    size_t value_len;
+    uint8_t* recipe = malloc(len ? len : 1);
+    int ok = recipe && view_value_len(&view, &value_len) && value_len == len &&
+             open_view(&view, recipe, len);
+    storage_log_unmap(&view);
+    
+    // Lengths must add up to the manifest's
+    uint64_t total = 0;
+    for (uint32_t i = 0; ok && i < m->chunk_count; i++) {
+        storage_key_id_t id;
+        size_t chunk_len;
+        recipe_entry(recipe, i, &id, &chunk_len);
+        ok = chunk_len > 0 && chunk_len <= m->chunk_size;
+        total += chunk_len;
+    }
+    
+    if (!ok || total != m->total_len) {
+        LOGE("Invalid dedup recipe");
+        free(recipe);
+        return NULL;
+    }
+    return recipe;
+}
+
+/*
+ * Append a batch of ops and free their payloads
+ * Returns 1 if every op succeeded
+ */
+static int dedup_write(storage_log_op_t* ops, size_t* count) {
+    int ok = *count == 0 || storage_log_write_batch(g_log, ops, *count) == STORAGE_LOG_OK;
+    for (size_t i = 0; i < *count; i++) {
+        free((void*)ops[i].payload);
+    }
+    *count = 0;
+    return ok;
+}
+
+/*
+ * Drop the references of a recipe (its own included) and register the
+ * recipe and the chunks left unreferenced as being deleted, for
+ * dedup_delete_finish to append (caller holds g_dedup.lock). If that
+ * list cannot be allocated the records stay until the next open
+ * collects them.
+ */
+static void dedup_unref_recipe(const storage_key_id_t* recipe_id,
+                               const uint8_t* recipe, uint32_t count, int counted,
+                               dedup_delete_t* del) {
+    del->ids = malloc(((size_t)count + 1) * sizeof(storage_key_id_t));
+    del->count = 0;
+    
+    if (counted && storage_dedup_unref(recipe_id) == 0) {
+        g_dedup.recipes--;
+    }
+    if (del->ids) {
+        del->ids[del->count++] = *recipe_id;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        storage_key_id_t id;
+        size_t len;
+        recipe_entry(recipe, i, &id, &len);
+        uint32_t refs = counted ? storage_dedup_unref(&id) : storage_dedup_refs(&id);
+        if (refs == 0 && del->ids) {
+            del->ids[del->count++] = id;
+        }
+    }
+    
+    if (del->ids) {
+        del->next = g_dedup.deleting;
+        g_dedup.deleting = del;
+    }
+}
+
+/*
+ * Append the deletes registered by dedup_unref_recipe, then wake stores
+ * waiting on them (caller does not hold g_dedup.lock)
+ */
+static void dedup_delete_finish(dedup_delete_t* del) {
+    if (!del->ids) {
+        return;
+    }
+    
+    storage_log_op_t ops[DEDUP_BATCH];
+    size_t op_count = 0;
+    for (size_t i = 0; i < del->count; i++) {
+        memset(&ops[op_count], 0, sizeof(ops[0]));
+        ops[op_count].key_id = del->ids[i];
+        ops[op_count].is_delete = 1;
+        if (++op_count == DEDUP_BATCH) {
+            dedup_write(ops, &op_count);
+        }
+    }
+    dedup_write(ops, &op_count);
+    
+    pthread_mutex_lock(&g_dedup.lock);
+    dedup_delete_t** link = &g_dedup.deleting;
+    while (*link != del) {
+        link = &(*link)->next;
+    }
+    *link = del->next;
+    pthread_cond_broadcast(&g_dedup.settled);
+    pthread_mutex_unlock(&g_dedup.lock);
+    free(del->ids);
+}
+
+/*
+ * Register a commit of key_id, first waiting for one already running
+ * (caller holds g_dedup.lock)
+ */
+static void dedup_commit_begin(dedup_commit_t* commit, const storage_key_id_t* key_id) {
+    for (;;) {
+        const dedup_commit_t* c = g_dedup.committing;
+        while (c && memcmp(c->key_id.bytes, key_id->bytes, STORAGE_KEY_ID_SIZE) != 0) {
+            c = c->next;
+        }
+        if (!c) {
+            break;
+        }
+        pthread_cond_wait(&g_dedup.settled, &g_dedup.lock);
+    }
+    commit->key_id = *key_id;
+    commit->next = g_dedup.committing;
+    g_dedup.committing = commit;
+}
+
+// Unregister a commit and wake waiters (caller holds g_dedup.lock)
+static void dedup_commit_end(dedup_commit_t* commit) {
+    dedup_commit_t** link = &g_dedup.committing;
+    while (*link != commit) {
+        link = &(*link)->next;
+    }
+    *link = commit->next;
+    pthread_cond_broadcast(&g_dedup.settled);
+}
+
+/*
+ * Whether any of the first count chunks of a recipe has a delete in
+ * flight (caller holds g_dedup.lock)
+ */
+static int dedup_deleting_any(const uint8_t* recipe, uint32_t count) {
+    for (const dedup_delete_t* del = g_dedup.deleting; del; del = del->next) {
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t* id = recipe + (size_t)i * DEDUP_RECIPE_ENTRY;
+            for (size_t k = 0; k < del->count; k++) {
+                if (memcmp(del->ids[k].bytes, id, STORAGE_KEY_ID_SIZE) == 0) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Rebuild reference counts from every recipe, then delete shared chunks
+ * nothing references (caller holds g_dedup.lock)
+ * Returns 1 if the counts are loaded
+ */
+static int dedup_load_refs(void) {
+    if (g_dedup.loaded) {
+        return 1;
+    }
+    
+    storage_key_id_t* ids;
+    size_t count;
+    if (storage_log_list(g_log, STORAGE_LOG_FLAG_STREAM, &ids, &count) != STORAGE_LOG_OK) {
+        return 0;
+    }
+    
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++) {
+        stream_manifest_t m;
+        if (!load_manifest(&ids[i], &m) || m.version != STREAM_MANIFEST_DEDUP) {
+            continue;
+        }
+        uint8_t* recipe = load_recipe(&ids[i], &m);
+        if (!recipe) {
+            continue;
+        }
+        
+        storage_key_id_t recipe_id;
+        chunk_id_for(&ids[i], &m, RECIPE_INDEX, &recipe_id);
+        ok = storage_dedup_ref(&recipe_id) > 0;
+        g_dedup.recipes++;
+        for (uint32_t c = 0; ok && c < m.chunk_count; c++) {
+            storage_key_id_t id;
+            size_t len;
+            recipe_entry(recipe, c, &id, &len);
+            ok = storage_dedup_ref(&id) > 0;
+        }
+        free(recipe);
+    }
+    free(ids);
+    
+    if (!ok || storage_log_list(g_log, STORAGE_LOG_FLAG_SHARED, &ids, &count) != STORAGE_LOG_OK) {
+        LOGE("Failed to load chunk reference counts");
+        storage_dedup_reset_refs();
+        g_dedup.recipes = 0;
+        return 0;
+    }
+    
+    // Orphans from a store or release cut short by a crash
+    storage_log_op_t ops[DEDUP_BATCH];
+    size_t op_count = 0;
+    size_t orphans = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (storage_dedup_refs(&ids[i]) > 0) {
+            continue;
+        }
+        memset(&ops[op_count], 0, sizeof(ops[0]));
+        ops[op_count].key_id = ids[i];
+        ops[op_count].is_delete = 1;
+        orphans++;
+        if (++op_count == DEDUP_BATCH) {
+            dedup_write(ops, &op_count);
+        }
+    }
+    dedup_write(ops, &op_count);
+    free(ids);
+    
+    g_dedup.loaded = 1;
+    LOGI("Loaded %llu dedup recipes, %zu shared chunks (%zu orphans deleted)",
+         (unsigned long long)g_dedup.recipes, storage_dedup_live() - (size_t)g_dedup.recipes,
+         orphans);
+    return 1;
+}
+
+/*
+ * Release the shared chunks of a deduplicated value whose manifest is
+ * gone: drop its references if they were counted, delete chunks left
+ * unreferenced and the recipe itself
+ */
+static void dedup_release(const storage_key_id_t* key_id, const stream_manifest_t* m) {
+    storage_key_id_t recipe_id;
+    chunk_id_for(key_id, m, RECIPE_INDEX, &recipe_id);
+    uint8_t* recipe = load_recipe(key_id, m);
+    dedup_delete_t del = { 0 };
+    
+    pthread_mutex_lock(&g_dedup.lock);
+    if (recipe && dedup_load_refs()) {
+        dedup_unref_recipe(&recipe_id, recipe, m->chunk_count,
+                           storage_dedup_refs(&recipe_id) > 0, &del);
+    }
+    pthread_mutex_unlock(&g_dedup.lock);
+    
+    if (del.ids) {
+        dedup_delete_finish(&del);
+    } else {
+        storage_log_delete(g_log, &recipe_id);
+    }
+    free(recipe);
+}
+
+/*
+ * Store a value as content-defined chunks, sealing and appending only
+ * those not already stored. Every chunk is cut and referenced first, in
+ * one short hold of g_dedup.lock; new chunks then go out in batches of
+ * DEDUP_BATCH with one sync each, the recipe and then the manifest
+ * follow, and the manifest append is the commit point. On failure the
+ * references are dropped again.
+ */
+static int store_dedup(const char* key, const uint8_t* data, size_t data_len) {
+    storage_key_id_t key_id, recipe_id;
+    key_id_for(key, &key_id);
+    
+    stream_manifest_t m = { .version = STREAM_MANIFEST_DEDUP, .total_len = data_len };
+    size_t max_chunks = data_len / STORAGE_DEDUP_CHUNK_MIN + 1;
+    uint8_t* recipe = malloc(max_chunks * DEDUP_RECIPE_ENTRY);
+    uint8_t* fresh = calloc(max_chunks, 1);
+    storage_log_op_t* ops = calloc(DEDUP_BATCH, sizeof(storage_log_op_t));
+    if (!recipe || !fresh || !ops ||
+        !sovereign_random_bytes(m.stream_id, STREAM_ID_SIZE) ||
+        !sovereign_random_bytes(m.nonce_prefix, STREAM_NONCE_PREFIX_SIZE)) {
+        LOGE("Failed to start dedup store for %s", key);
+        free(recipe);
+        free(fresh);
+        free(ops);
+        return -1;
+    }
+    chunk_id_for(&key_id, &m, RECIPE_INDEX, &recipe_id);
+    
+    for (size_t pos = 0; pos < data_len; ) {
+        size_t len = storage_dedup_cut(data + pos, data_len - pos);
+        uint8_t* entry = recipe + (size_t)m.chunk_count * DEDUP_RECIPE_ENTRY;
+        storage_key_id_t id;
+        storage_dedup_digest(data + pos, len, &id);
+        memcpy(entry, id.bytes, STORAGE_KEY_ID_SIZE);
+        put_le32(entry + STORAGE_KEY_ID_SIZE, (uint32_t)len);
+        m.chunk_count++;
+        if (len > m.chunk_size) m.chunk_size = (uint32_t)len;
+        pos += len;
+    }
+    
+    // Reference every chunk; a count of 1 means this store writes it
+    pthread_mutex_lock(&g_dedup.lock);
+    int ok = dedup_load_refs() && storage_dedup_ref(&recipe_id) > 0;
+    int counted = ok;
+    if (counted) {
+        g_dedup.recipes++;
+    }
+    uint32_t referenced = 0;
+    while (ok && referenced < m.chunk_count) {
+        storage_key_id_t id;
+        size_t len;
+        recipe_entry(recipe, referenced, &id, &len);
+        uint32_t refs = storage_dedup_ref(&id);
+        ok = refs > 0;
+        if (ok) {
+            fresh[referenced++] = (refs == 1);
+        }
+    }
+    while (ok && dedup_deleting_any(recipe, referenced)) {
+        pthread_cond_wait(&g_dedup.settled, &g_dedup.lock);
+    }
+    pthread_mutex_unlock(&g_dedup.lock);
+    
+    // Seal and append outside the lock. A chunk referenced before is on
+    // disk unless its first writer has not got to it yet or failed
+    size_t op_count = 0;
+    uint64_t written = 0, chunk_bytes = 0, reused = 0, fresh_count = 0;
+    size_t pos = 0;
+    for (uint32_t c = 0; ok && c < m.chunk_count; c++) {
+        storage_key_id_t id;
+        size_t len;
+        recipe_entry(recipe, c, &id, &len);
+        
+        if (!fresh[c] && storage_log_contains(g_log, &id)) {
+            reused++;
+        } else {
+            storage_log_op_t* op = &ops[op_count];
+            unsigned char* payload;
+            memset(op, 0, sizeof(*op));
+            op->key_id = id;
+            ok = seal_record(data + pos, len, &payload, &op->payload_len, &op->flags);
+            if (ok) {
+                op->payload = payload;
+                op->flags |= STORAGE_LOG_FLAG_SHARED;
+                written += op->payload_len;
+                chunk_bytes += len;
+                fresh_count++;
+                if (++op_count == DEDUP_BATCH) {
+                    ok = dedup_write(ops, &op_count);
+                }
+            }
+        }
+        pos += len;
+    }
+    ok = dedup_write(ops, &op_count) && ok;
+    
+    // Recipe, then the manifest that commits it
+    stream_manifest_t previous;
+    int replaces_stream = 0;
+    if (ok) {
+        uint8_t raw[STREAM_MANIFEST_SIZE];
+        unsigned char* recipe_payload = NULL;
+        unsigned char* manifest_payload = NULL;
+        encode_manifest(&m, raw);
+        ok = seal_value(recipe, (size_t)m.chunk_count * DEDUP_RECIPE_ENTRY,
+                        &recipe_payload, &ops[0].payload_len) &&
+             seal_value(raw, sizeof(raw), &manifest_payload, &ops[1].payload_len);
+        ops[0].key_id = recipe_id;
+        ops[0].payload = recipe_payload;
+        ops[0].flags = STORAGE_LOG_FLAG_CHUNK | STORAGE_LOG_FLAG_SHARED;
+        ops[1].key_id = key_id;
+        ops[1].payload = manifest_payload;
+        ops[1].flags = STORAGE_LOG_FLAG_STREAM;
+        op_count = 2;
+        
+        if (ok && record_name(key, &key_id)) {
+            dedup_commit_t commit;
+            pthread_mutex_lock(&g_dedup.lock);
+            dedup_commit_begin(&commit, &key_id);
+            pthread_mutex_unlock(&g_dedup.lock);
+            
+            written += ops[0].payload_len + ops[1].payload_len;
+            replaces_stream = load_manifest(&key_id, &previous);
+            ok = dedup_write(ops, &op_count);
+            storage_cache_invalidate(storage_cache_default(), &key_id);
+            
+            pthread_mutex_lock(&g_dedup.lock);
+            dedup_commit_end(&commit);
+            pthread_mutex_unlock(&g_dedup.lock);
+        } else {
+            free(recipe_payload);
+            free(manifest_payload);
+            ok = 0;
+        }
+    }
+    
+    dedup_delete_t del = { 0 };
+    pthread_mutex_lock(&g_dedup.lock);
+    if (ok) {
+        g_dedup.chunk_bytes += chunk_bytes;
+        g_dedup.stats.values_stored++;
+        g_dedup.stats.bytes_in += data_len;
+        g_dedup.stats.bytes_written += written;
+        g_dedup.stats.chunks_written += fresh_count;
+        g_dedup.stats.chunks_reused += reused;
+    } else if (counted) {
+        dedup_unref_recipe(&recipe_id, recipe, referenced, 1, &del);
+    }
+    pthread_mutex_unlock(&g_dedup.lock);
+    
+    if (ok) {
+        if (replaces_stream) {
+            release_chunks(&key_id, &previous, previous.chunk_count);
+        }
+        LOGI("Stored deduplicated value: %s (%zu bytes, %llu of %u chunks new)", key, data_len,
+             (unsigned long long)fresh_count, m.chunk_count);
+    } else {
+        LOGE("Failed to store deduplicated value: %s", key);
+        if (del.ids) {
+            dedup_delete_finish(&del);
+        } else if (counted) {
+            storage_log_delete(g_log, &recipe_id);
+        }
+    }
+    secure_buffer_wipe(recipe, max_chunks * DEDUP_RECIPE_ENTRY);
+    free(recipe);
+    free(fresh);
+    free(ops);
+    return ok ? 0 : -1;
+}
+
+void secure_storage_dedup_configure(size_t min_size) {
+    __atomic_store_n(&g_dedup.min_size, min_size, __ATOMIC_RELAXED);
+}
+
+void secure_storage_get_dedup_stats(secure_storage_dedup_stats_t* stats) {
+    pthread_mutex_lock(&g_dedup.lock);
+    *stats = g_dedup.stats;
+    stats->chunks_live = g_dedup.loaded ? storage_dedup_live() - g_dedup.recipes : 0;
+    stats->dedup_ratio = g_dedup.chunk_bytes ?
+                         (float)((double)stats->bytes_in / (double)g_dedup.chunk_bytes) : 0.0f;
+    stats->write_amplification = stats->bytes_in ?
+                                 (float)((double)stats->bytes_written / (double)stats->bytes_in) : 0.0f;
+    pthread_mutex_unlock(&g_dedup.lock);
+}
+
+/*
+ * Forget the counts (storage cleared or shut down); the next dedup
+ * store or release rebuilds them
+ */
+static void dedup_reset(void) {
+    pthread_mutex_lock(&g_dedup.lock);
+    storage_dedup_reset_refs();
+    g_dedup.loaded = 0;
+    g_dedup.recipes = 0;
+    pthread_mutex_unlock(&g_dedup.lock);
+}
+
+/*
+ * ========================================================================
+ * Key name records (ordered index, see secure_storage_names.h)
+ * ========================================================================
+ */
+
+/*
+ * Id of the name record for a key: SipHash(key_id || "name").
+ * The 20-byte input cannot collide with chunk id inputs (36 bytes).
+ */
+static void name_id_for(const storage_key_id_t* key_id, storage_key_id_t* name_id) {
+    uint8_t input[STORAGE_KEY_ID_SIZE + 4];
+    memcpy(input, key_id->bytes, STORAGE_KEY_ID_SIZE);
+    memcpy(input + STORAGE_KEY_ID_SIZE, "name", 4);
+    siphash_128(g_keys->key_id_key, input, sizeof(input), name_id->bytes);
+}
+
+/*
+ * Make sure a key's name is on disk and in the ordered index.
+ * Written before the value, so an enumerable value always has a name;
+ * a name whose value never landed is skipped when the index loads.
+ * Returns 1 on success
+ */
+static int record_name(const char* key, const storage_key_id_t* key_id) {
+    storage_key_id_t name_id;
+    name_id_for(key_id, &name_id);
+    
+    if (!storage_log_contains(g_log, &name_id)) {
+        unsigned char* payload;
+        size_t payload_len;
+        if (!seal_value((const unsigned char*)key, strlen(key), &payload, &payload_len)) {
+            return 0;
+        }
+        
+        int result = storage_log_put_flags(g_log, &name_id, STORAGE_LOG_FLAG_NAME, payload, payload_len);
+        free(payload);
+        if (result != STORAGE_LOG_OK) {
+            LOGE("Failed to record name for key: %s", key);
+            return 0;
+        }
+    }
+    
+    return storage_names_insert(key, key_id);
+}
+
+/*
+ * Drop a key's name record and index entry (after its value is gone)
+ */
+static void forget_name(const char* key, const storage_key_id_t* key_id) {
+    storage_key_id_t name_id;
+    name_id_for(key_id, &name_id);
+    storage_log_delete(g_log, &name_id);
+    storage_names_remove(key);
+}
+
+/*
+ * Decrypt one name record; the name must hash back to the record's id
+ * Returns a malloc'd name, NULL if the record is invalid
+ */
+static char* load_name(const storage_key_id_t* name_id, storage_key_id_t* key_id) {
+    storage_log_view_t view;
+    if (storage_log_map(g_log, name_id, &view) != STORAGE_LOG_OK) {
+        return NULL;
+    }
+    
+    char* name = NULL;
+    size_t payload_len = view.payload_len;
+    if (payload_len > PAYLOAD_OVERHEAD) {
+        size_t name_len = payload_len - PAYLOAD_OVERHEAD;
+        name = malloc(name_len + 1);
+        if (name && decrypt_data(key_for_epoch(view.key_epoch),
+                                 view.payload + PAYLOAD_OVERHEAD, name_len, view.payload,
+                                 view.payload + CHACHA20_NONCE_SIZE,
+                                 (unsigned char*)name, &name_len)) {
+            name[name_len] = '\0';
+        } else {
+            free(name);
+            name = NULL;
+        }
+    }
+    storage_log_unmap(&view);
+    
+    // Reject names bound to another id (spliced or stale records)
+    storage_key_id_t expected;
+    if (name) {
+        key_id_for(name, key_id);
+        name_id_for(key_id, &expected);
+        if (strlen(name) != payload_len - PAYLOAD_OVERHEAD ||
+            memcmp(expected.bytes, name_id->bytes, STORAGE_KEY_ID_SIZE) != 0) {
+            LOGW("Discarding name record that does not match its id");
+            free(name);
+            name = NULL;
+        }
+    }
+    return name;
+}
+
+/*
+ * storage_names_source_t: decrypt every name record whose value exists
+ */
+static int load_names(storage_name_entry_t** entries, size_t* count) {
+    storage_key_id_t* ids;
+    size_t id_count;
+    if (storage_log_list(g_log, STORAGE_LOG_FLAG_NAME, &ids, &id_count) != STORAGE_LOG_OK) {
+        return 0;
+    }
+    
+    storage_name_entry_t* list = malloc((id_count + 1) * sizeof(storage_name_entry_t));
+    if (!list) {
+        free(ids);
+        return 0;
+    }
+    
+    size_t n = 0;
+    for (size_t i = 0; i < id_count; i++) {
+        storage_key_id_t key_id;
+        char* name = load_name(&ids[i], &key_id);
+        if (!name) continue;
+        
+        if (!storage_log_contains(g_log, &key_id)) {
+            // Crash between name and value, or value deleted since
+            free(name);
+            continue;
+        }
+        list[n].name = name;
+        list[n].key_id = key_id;
+        n++;
+    }
+    free(ids);
+    
+    *entries = list;
+    *count = n;
+    return 1;
+}
+
+/*
+ * Key file: either the 32 raw bytes of the master key (epoch 0, as
+ * written before rotation existed), or a key ring
+ *   [magic u32][version u32][current epoch u32][count u32][key id key 16]
+ *   count x [epoch u32][key 32]
+ *   [first 16 bytes of SHA-512 over everything before]
+ * A ring holds the current key and, while a rotation runs, the previous
+ * one. The key id key is stored so ids stay put when the key changes.
+ */
+#define KEY_RING_MAGIC 0x524B4453u     // "SDKR"
+#define KEY_RING_VERSION 1
+#define KEY_RING_HEADER_SIZE 32
+#define KEY_RING_ENTRY_SIZE (4 + CHACHA20_KEY_SIZE)
+#define KEY_RING_CHECK_SIZE 16
+#define KEY_RING_MAX_SIZE (KEY_RING_HEADER_SIZE + 2 * KEY_RING_ENTRY_SIZE + KEY_RING_CHECK_SIZE)
+
+/*
+ * Replace the key file: temp file, fsync, rename, fsync the directory,
+ * so a crash leaves either the old file or the complete new one
+ */
+static int write_key_file(const uint8_t* data, size_t len) {
+    char key_path[MAX_PATH];
+    char tmp_path[MAX_PATH];
+    snprintf(key_path, sizeof(key_path), "%s/%s", g_storage_dir, KEY_FILE_NAME);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", key_path);
+    
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);  // Owner only
+    if (fd < 0) {
+        LOGE("Failed to create key file");
+        return 0;
+    }
+    
+    int saved = write(fd, data, len) == (ssize_t)len && fsync(fd) == 0;
+    close(fd);
+    saved = saved && rename(tmp_path, key_path) == 0;
+    if (!saved) {
+        LOGE("Failed to save key file");
+        unlink(tmp_path);
+        return 0;
+    }
+    
+    int dir_fd = open(g_storage_dir, O_RDONLY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 1;
+}
+
+/*
+ * Passphrase-protected key file: the raw key or key ring above, sealed
+ * under a wrapping key that Argon2id derives from the passphrase
+ *   [magic u32][version u32][t_cost u32][m_cost_kib u32][lanes u32][0 u32]
+ *   [salt 16][nonce 12][tag 16][ciphertext]
+ * Header and salt are outside the AEAD, but altering them changes the
+ * derived key and so fails the tag all the same. The wrapping key stays
+ * in g_keys while initialized: rotations rewrite the file under a fresh
+ * nonce without running Argon2id again.
+ */
+#define KEY_WRAP_MAGIC 0x574B4453u     // "SDKW"
+#define KEY_WRAP_VERSION 1
+#define KEY_WRAP_HEADER_SIZE (24 + KEY_WRAP_SALT_SIZE)
+#define KEY_WRAP_OVERHEAD (KEY_WRAP_HEADER_SIZE + CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE)
+#define KEY_FILE_MAX_SIZE (KEY_WRAP_OVERHEAD + KEY_RING_MAX_SIZE)
+
+// Calibration goal when the caller names no parameters
+#define KEY_WRAP_TARGET_MS 500
+#define KEY_WRAP_MAX_KIB (64 * 1024)
+
+// Largest parameters accepted from a caller or a key file
+#define KEY_WRAP_LIMIT_KIB (1024 * 1024)
+#define KEY_WRAP_LIMIT_T 64
+
+/*
+ * Write key file contents, sealed when the store is passphrase protected
+ */
+static int save_key_file(const uint8_t* data, size_t len) {
+    if (!g_key_wrapped) {
+        return write_key_file(data, len);
+    }
+    
+    uint8_t buf[KEY_FILE_MAX_SIZE];
+    put_le32(buf, KEY_WRAP_MAGIC);
+    put_le32(buf + 4, KEY_WRAP_VERSION);
+    put_le32(buf + 8, g_wrap_params.t_cost);
+    put_le32(buf + 12, g_wrap_params.m_cost_kib);
+    put_le32(buf + 16, g_wrap_params.lanes);
+    put_le32(buf + 20, 0);
+    memcpy(buf + 24, g_wrap_salt, KEY_WRAP_SALT_SIZE);
+    
+    uint8_t* nonce = buf + KEY_WRAP_HEADER_SIZE;
+    uint8_t* tag = nonce + CHACHA20_NONCE_SIZE;
+    if (!sovereign_random_bytes(nonce, CHACHA20_NONCE_SIZE) ||
+        !chacha20_poly1305_encrypt(g_keys->wrap_key, nonce, data, len,
+                                   tag + POLY1305_TAG_SIZE, tag)) {
+        LOGE("Failed to seal key file");
+        return 0;
+    }
+    return write_key_file(buf, KEY_WRAP_OVERHEAD + len);
+}
+
+/*
+ * Write the current key (and the previous one, mid-rotation) as a key ring
+ */
+static int save_key_ring(void) {
+    uint8_t buf[KEY_RING_MAX_SIZE];
+    uint32_t count = g_has_previous ? 2 : 1;
+    
+    put_le32(buf, KEY_RING_MAGIC);
+    put_le32(buf + 4, KEY_RING_VERSION);
+    put_le32(buf + 8, g_key_epoch);
+    put_le32(buf + 12, count);
+    memcpy(buf + 16, g_keys->key_id_key, SIPHASH_KEY_SIZE);
+    
+    uint8_t* p = buf + KEY_RING_HEADER_SIZE;
+    put_le32(p, g_key_epoch);
+    memcpy(p + 4, g_keys->encryption_key, CHACHA20_KEY_SIZE);
+    if (g_has_previous) {
+        p += KEY_RING_ENTRY_SIZE;
+        put_le32(p, g_previous_epoch);
+        memcpy(p + 4, g_keys->previous_key, CHACHA20_KEY_SIZE);
+    }
+    
+    size_t len = KEY_RING_HEADER_SIZE + count * KEY_RING_ENTRY_SIZE;
+    uint8_t digest[64];
+    sha512(buf, len, digest);
+    memcpy(buf + len, digest, KEY_RING_CHECK_SIZE);
+    len += KEY_RING_CHECK_SIZE;
+    
+    int saved = save_key_file(buf, len);
+    secure_buffer_wipe(buf, sizeof(buf));
+    return saved;
+}
+
+/*
+ * Parse a key ring into the key globals
+ * Returns 1 if it is well formed and holds its current epoch
+ */
+static int load_key_ring(const uint8_t* buf, size_t len) {
+    if (len < KEY_RING_HEADER_SIZE + KEY_RING_ENTRY_SIZE + KEY_RING_CHECK_SIZE ||
+        get_le32(buf) != KEY_RING_MAGIC || get_le32(buf + 4) != KEY_RING_VERSION) {
+        return 0;
+    }
+    
+    uint32_t epoch = get_le32(buf + 8);
+    uint32_t count = get_le32(buf + 12);
+    if ((count != 1 && count != 2) ||
+        len != KEY_RING_HEADER_SIZE + count * KEY_RING_ENTRY_SIZE + KEY_RING_CHECK_SIZE) {
+        return 0;
+    }
+    
+    uint8_t digest[64];
+    sha512(buf, len - KEY_RING_CHECK_SIZE, digest);
+    if (memcmp(digest, buf + len - KEY_RING_CHECK_SIZE, KEY_RING_CHECK_SIZE) != 0) {
+        return 0;
+    }
+    
+    int have_current = 0;
+    g_has_previous = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* p = buf + KEY_RING_HEADER_SIZE + i * KEY_RING_ENTRY_SIZE;
+        uint32_t entry_epoch = get_le32(p);
+        if (entry_epoch == epoch && !have_current) {
+            memcpy(g_keys->encryption_key, p + 4, CHACHA20_KEY_SIZE);
+            have_current = 1;
+        } else if (entry_epoch != epoch && !g_has_previous) {
+            memcpy(g_keys->previous_key, p + 4, CHACHA20_KEY_SIZE);
+            g_previous_epoch = entry_epoch;
+            g_has_previous = 1;
+        } else {
+            have_current = 0;
+            break;
+        }
+    }
+    
+    if (!have_current) {
+        secure_buffer_wipe(g_keys->encryption_key, sizeof(g_keys->encryption_key));
+        secure_buffer_wipe(g_keys->previous_key, sizeof(g_keys->previous_key));
+        g_has_previous = 0;
+        return 0;
+    }
+    
+    g_key_epoch = epoch;
+    memcpy(g_keys->key_id_key, buf + 16, SIPHASH_KEY_SIZE);
+    return 1;
+}
+
+static int wrap_params_valid(const argon2_params_t* params) {
+    return params->lanes >= 1 && params->lanes <= ARGON2_LANES_MAX &&
+           params->t_cost >= 1 && params->t_cost <= KEY_WRAP_LIMIT_T &&
+           params->m_cost_kib >= 8 * params->lanes && params->m_cost_kib <= KEY_WRAP_LIMIT_KIB;
+}
+
+/*
+ * Fresh salt and wrapping key for a passphrase; NULL params calibrates
+ * for KEY_WRAP_TARGET_MS on this device. Leaves the globals alone
+ */
+static int new_wrap_key(const uint8_t* passphrase, size_t passphrase_len,
+                        const argon2_params_t* params, uint8_t key[CHACHA20_KEY_SIZE],
+                        uint8_t salt[KEY_WRAP_SALT_SIZE], argon2_params_t* chosen) {
+    if (params) {
+        if (!wrap_params_valid(params)) {
+            LOGE("Invalid passphrase KDF parameters");
+            return 0;
+        }
+        *chosen = *params;
+    } else {
+        uint32_t ms = argon2id_calibrate(KEY_WRAP_TARGET_MS, KEY_WRAP_MAX_KIB, chosen);
+        if (!ms) {
+            LOGE("Passphrase KDF calibration failed");
+            return 0;
+        }
+        if (chosen->t_cost > KEY_WRAP_LIMIT_T) {
+            chosen->t_cost = KEY_WRAP_LIMIT_T;
+        }
+        LOGI("Passphrase KDF: t=%u m=%u KiB lanes=%u (%u ms)",
+             chosen->t_cost, chosen->m_cost_kib, chosen->lanes, ms);
+    }
+    
+    if (!sovereign_random_bytes(salt, KEY_WRAP_SALT_SIZE) ||
+        !argon2id(chosen, passphrase, passphrase_len, salt, KEY_WRAP_SALT_SIZE,
+                  key, CHACHA20_KEY_SIZE)) {
+        LOGE("Failed to derive passphrase key");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Open a wrapped key file with the passphrase given for this initialize
+ * On success plain holds the raw key or ring and later saves are sealed
+ * under the same wrapping key. Returns 1 on success
+ */
+static int unwrap_key_file(const uint8_t* buf, size_t len, uint8_t* plain, size_t* plain_len) {
+    argon2_params_t params;
+    int well_formed = len > KEY_WRAP_OVERHEAD && len <= KEY_FILE_MAX_SIZE &&
+                      get_le32(buf + 4) == KEY_WRAP_VERSION;
+    if (well_formed) {
+        params.t_cost = get_le32(buf + 8);
+        params.m_cost_kib = get_le32(buf + 12);
+        params.lanes = get_le32(buf + 16);
+        well_formed = wrap_params_valid(&params);
+    }
+    if (!well_formed) {
+        LOGE("Malformed passphrase-protected key file");
+        return 0;
+    }
+    if (!g_passphrase) {
+        LOGE("Key file is passphrase protected and no passphrase was set");
+        return 0;
+    }
+    
+    const uint8_t* salt = buf + 24;
+    const uint8_t* nonce = buf + KEY_WRAP_HEADER_SIZE;
+    const uint8_t* tag = nonce + CHACHA20_NONCE_SIZE;
+    *plain_len = len - KEY_WRAP_OVERHEAD;
+    if (!argon2id(&params, g_passphrase, g_passphrase_len, salt, KEY_WRAP_SALT_SIZE,
+                  g_keys->wrap_key, CHACHA20_KEY_SIZE) ||
+        !chacha20_poly1305_decrypt(g_keys->wrap_key, nonce, tag + POLY1305_TAG_SIZE,
+                                   *plain_len, tag, plain)) {
+        LOGE("Wrong passphrase or damaged key file");
+        secure_buffer_wipe(g_keys->wrap_key, sizeof(g_keys->wrap_key));
+        return 0;
+    }
+    
+    g_wrap_params = params;
+    memcpy(g_wrap_salt, salt, KEY_WRAP_SALT_SIZE);
+    g_key_wrapped = 1;
+    return 1;
+}
+
+/*
+ * Seal the loaded key file under the passphrase set for initialize
+ */
+static int wrap_loaded_key(void) {
+    if (!new_wrap_key(g_passphrase, g_passphrase_len, NULL, g_keys->wrap_key,
+                      g_wrap_salt, &g_wrap_params)) {
+        return 0;
+    }
+    g_key_wrapped = 1;
+    if (!save_key_ring()) {
+        g_key_wrapped = 0;
+        secure_buffer_wipe(g_keys->wrap_key, sizeof(g_keys->wrap_key));
+        return 0;
+    }
+    LOGI("Key file is now passphrase protected");
+    return 1;
+}
+
+/*
+ * Load or generate persistent master key
+ */
+static int load_or_create_master_key(void) {
+    char key_path[MAX_PATH];
+    snprintf(key_path, sizeof(key_path), "%s/%s", g_storage_dir, KEY_FILE_NAME);
+    
+    FILE* key_file = fopen(key_path, "rb");
+    
+    if (key_file) {
+        // Load existing key, or key ring, possibly passphrase protected
+        uint8_t buf[KEY_FILE_MAX_SIZE + 1];
+        size_t read = fread(buf, 1, sizeof(buf), key_file);
+        fclose(key_file);
+        
+        uint8_t plain[KEY_RING_MAX_SIZE];
+        const uint8_t* contents = buf;
+        size_t contents_len = read;
+        if (read >= 4 && get_le32(buf) == KEY_WRAP_MAGIC) {
+            // Never regenerate over a wrapped key: that would lose every record
+            if (!unwrap_key_file(buf, read, plain, &contents_len)) {
+                return 0;
+            }
+            contents = plain;
+        }
+        
+        int loaded = 0;
+        if (contents_len == CHACHA20_KEY_SIZE) {
+            memcpy(g_keys->encryption_key, contents, CHACHA20_KEY_SIZE);
+            g_key_epoch = 0;
+            g_has_previous = 0;
+            derive_key_id_key();
+            loaded = 1;
+        } else {
+            loaded = load_key_ring(contents, contents_len);
+        }
+        secure_buffer_wipe(buf, sizeof(buf));
+        secure_buffer_wipe(plain, sizeof(plain));
+        
+        if (loaded) {
+            LOGI("Loaded persistent master key (epoch %u%s%s)", g_key_epoch,
+                 g_has_previous ? ", rotation in progress" : "",
+                 g_key_wrapped ? ", passphrase protected" : "");
+            return g_passphrase && !g_key_wrapped ? wrap_loaded_key() : 1;
+        }
+        if (g_key_wrapped) {
+            LOGE("Passphrase-protected key file holds no valid key");
+            return 0;
+        }
+        
+        LOGW("Corrupted key file, regenerating");
+    }
+    
+    // Generate new key
+    if (!sovereign_random_bytes(g_keys->encryption_key, CHACHA20_KEY_SIZE)) {
+        LOGE("Failed to generate encryption key");
+        return 0;
+    }
+    g_key_epoch = 0;
+    g_has_previous = 0;
+    derive_key_id_key();
+    
+    // With a passphrase set the key never reaches disk unwrapped
+    if (g_passphrase) {
+        if (!new_wrap_key(g_passphrase, g_passphrase_len, NULL, g_keys->wrap_key,
+                          g_wrap_salt, &g_wrap_params)) {
+            return 0;
+        }
+        g_key_wrapped = 1;
+    }
+    if (!save_key_file(g_keys->encryption_key, CHACHA20_KEY_SIZE)) {
+        return 0;
+    }
+    
+    LOGI("Generated and saved new master key");
+    return 1;
+}
+
+/*
+ * ========================================================================
+ * Namespaces
+ * ========================================================================
+ */
+
+/*
+ * Each namespace is a store of its own under g_storage_dir/ns/<name>:
+ * segment log, plaintext cache, compaction thread and sync setting, so a
+ * bulk namespace neither evicts a hot one from cache nor queues behind
+ * it for the writer lock and fdatasync. Values are sealed exactly like
+ * main store values (same master key, compression and key ids); streams,
+ * dedup and name records stay in the main store.
+ *
+ * The table only grows while initialized, and only under the state lock
+ * exclusive, so an entry found under the shared lock stays valid until
+ * the lock is released.
+ */
+#define NAMESPACE_DIR "ns"
+#define NAMESPACE_MAX SECURE_STORAGE_NAMESPACE_MAX
+#define NAMESPACE_NAME_MAX SECURE_STORAGE_NAMESPACE_NAME_MAX
+
+typedef struct {
+    char name[NAMESPACE_NAME_MAX + 1];
+    storage_log_t* log;
+    storage_cache_t* cache;
+    secure_storage_namespace_config_t config;
+} storage_namespace_t;
+
+static storage_namespace_t g_namespaces[NAMESPACE_MAX];
+static size_t g_namespace_count = 0;
+
+void secure_storage_namespace_default_config(secure_storage_namespace_config_t* config) {
+    config->cache_bytes = 0;
+    config->durability = SECURE_STORAGE_DURABILITY_SYNC;
+    storage_log_default_policy(&config->compaction);
+}
+
+// Names double as directory names: 1-32 of [a-z0-9_-]
+static int namespace_name_valid(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len > NAMESPACE_NAME_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Log of store s: the main store first, then each namespace
+ * Returns NULL past the last one (caller holds the state lock)
+ */
+static storage_log_t* store_log(size_t s) {
+    if (s == 0) {
+        return g_log;
+    }
+    return (s - 1 < g_namespace_count) ? g_namespaces[s - 1].log : NULL;
+}
+
+/*
+ * Apply a configuration to an open namespace; every setting can change
+ * at any time (caller holds the state lock)
+ */
+static void namespace_apply(storage_namespace_t* n, const secure_storage_namespace_config_t* config) {
+    n->config = *config;
+    storage_cache_configure(n->cache, config->cache_bytes);
+    storage_log_set_sync(n->log, config->durability == SECURE_STORAGE_DURABILITY_SYNC);
+    storage_log_compaction_start(n->log, &config->compaction);
+}
+
+/*
+ * Open the log and cache of a namespace and add it to the table
+ * (caller holds the state lock exclusive)
+ */
+static storage_namespace_t* namespace_add(const char* name,
+                                          const secure_storage_namespace_config_t* config) {
+    if (g_namespace_count == NAMESPACE_MAX) {
+        LOGE("Too many namespaces (max %d), not opening %s", NAMESPACE_MAX, name);
+        return NULL;
+    }
+    
+    char dir[MAX_PATH];
+    snprintf(dir, sizeof(dir), "%s/%s", g_storage_dir, NAMESPACE_DIR);
+    mkdir(dir, 0700);
+    // The log keeps its directory in MAX_PATH - 32 bytes
+    if (snprintf(dir, sizeof(dir), "%s/%s/%s", g_storage_dir, NAMESPACE_DIR, name) >= MAX_PATH - 32) {
+        LOGE("Namespace path too long: %s", name);
+        return NULL;
+    }
+    mkdir(dir, 0700);
+    
+    storage_namespace_t* n = &g_namespaces[g_namespace_count];
+    memset(n, 0, sizeof(*n));
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    n->log = storage_log_open(dir);
+    n->cache = n->log ? storage_cache_create(0) : NULL;
+    if (!n->cache) {
+        LOGE("Failed to open namespace %s", name);
+        if (n->log) storage_log_close(n->log);
+        memset(n, 0, sizeof(*n));
+        return NULL;
+    }
+    
+    storage_log_set_key_epoch(n->log, g_key_epoch);
+    namespace_apply(n, config);
+    g_namespace_count++;
+    LOGI("Namespace %s open (cache %zu bytes, %s writes)", name, config->cache_bytes,
+         config->durability == SECURE_STORAGE_DURABILITY_SYNC ? "synced" : "lazy");
+    return n;
+}
+
+static storage_namespace_t* namespace_find(const char* name) {
+    for (size_t i = 0; i < g_namespace_count; i++) {
+        if (strcmp(g_namespaces[i].name, name) == 0) {
+            return &g_namespaces[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Reopen every namespace found on disk with the default configuration
+ * (at initialize, state lock exclusive); the app reapplies its own
+ */
+static void namespaces_open(void) {
+    char dir[MAX_PATH];
+    snprintf(dir, sizeof(dir), "%s/%s", g_storage_dir, NAMESPACE_DIR);
+    DIR* d = opendir(dir);
+    if (!d) {
+        return;
+    }
+    
+    secure_storage_namespace_config_t config;
+    secure_storage_namespace_default_config(&config);
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (namespace_name_valid(ent->d_name) && !namespace_find(ent->d_name)) {
+            namespace_add(ent->d_name, &config);
+        }
+    }
+    closedir(d);
+}
+
+// Close every namespace (at shutdown, state lock exclusive)
+static void namespaces_close(void) {
+    for (size_t i = 0; i < g_namespace_count; i++) {
+        storage_log_close(g_namespaces[i].log);
+        storage_cache_destroy(g_namespaces[i].cache);
+    }
+    memset(g_namespaces, 0, sizeof(g_namespaces));
+    g_namespace_count = 0;
+}
+
+int secure_storage_namespace_open(const char* ns, const secure_storage_namespace_config_t* config) {
+    if (!namespace_name_valid(ns)) {
+        LOGE("Invalid namespace name: %s", ns);
+        return -1;
+    }
+    
+    pthread_rwlock_wrlock(&g_state_lock);
+    if (!g_initialized) {
+        pthread_rwlock_unlock(&g_state_lock);
+        LOGE("Storage not initialized");
+        return -1;
+    }
+    
+    secure_storage_namespace_config_t defaults;
+    secure_storage_namespace_default_config(&defaults);
+    storage_namespace_t* n = namespace_find(ns);
+    if (n) {
+        if (config) namespace_apply(n, config);
+    } else {
+        n = namespace_add(ns, config ? config : &defaults);
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+    return n ? 0 : -1;
+}
+
+/*
+ * Enter a namespace call: state_enter plus the lookup
+ * Returns NULL (lock released) if not initialized or the namespace is not open
+ */
+static storage_namespace_t* namespace_enter(const char* ns) {
+    if (!state_enter()) {
+        return NULL;
+    }
+    storage_namespace_t* n = namespace_find(ns);
+    if (!n) {
+        state_leave();
+        LOGE("Namespace not open: %s", ns);
+    }
+    return n;
+}
+
+int secure_storage_ns_store(const char* ns, const char* key, const uint8_t* data, size_t data_len) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    unsigned char* payload;
+    size_t payload_len;
+    uint16_t flags;
+    int result = -1;
+    if (seal_record(data, data_len, &payload, &payload_len, &flags)) {
+        if (storage_log_put_flags(n->log, &key_id, flags, payload, payload_len) == STORAGE_LOG_OK) {
+            result = 0;
+        }
+        storage_cache_invalidate(n->cache, &key_id);
+        free(payload);
+    }
+    state_leave();
+    
+    if (result != 0) {
+        LOGE("Failed to store %s in namespace %s", key, ns);
+    }
+    return result;
+}
+
+/*
+ * Decrypt the value of key_id in a namespace into data
+ * *value_len gets its length, also when data is too small
+ */
+static int namespace_retrieve(storage_namespace_t* n, const storage_key_id_t* key_id,
+                              uint8_t* data, size_t data_len, size_t* value_len) {
+    int cached = storage_cache_get(n->cache, key_id, data, data_len, value_len);
+    if (cached == STORAGE_CACHE_HIT) {
+        return 0;
+    }
+    if (cached == STORAGE_CACHE_TOO_SMALL) {
+        return -1;
+    }
+    
+    uint64_t fill_token = storage_cache_fill_token(n->cache);
+    storage_log_view_t view;
+    if (storage_log_map(n->log, key_id, &view) != STORAGE_LOG_OK) {
+        return -1;
+    }
+    
+    int ok = view.payload_len >= PAYLOAD_OVERHEAD && view_value_len(&view, value_len) &&
+             *value_len <= data_len && open_view(&view, data, *value_len);
+    storage_log_unmap(&view);
+    
+    if (ok) {
+        storage_cache_put(n->cache, key_id, data, *value_len, fill_token);
+    }
+    return ok ? 0 : -1;
+}
+
+int secure_storage_ns_retrieve(const char* ns, const char* key, uint8_t* data, size_t data_len) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    size_t value_len = 0;
+    int result = namespace_retrieve(n, &key_id, data, data_len, &value_len);
+    state_leave();
+    
+    if (result != 0) {
+        LOGE("Failed to retrieve %s from namespace %s (%zu bytes, buffer %zu)", key, ns,
+             value_len, data_len);
+    }
+    return result;
+}
+
+int secure_storage_ns_get_size(const char* ns, const char* key, size_t* size) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    size_t payload_len;
+    uint16_t flags;
+    int result = -1;
+    if (storage_log_get_flags(n->log, &key_id, &flags) == STORAGE_LOG_OK &&
+        storage_log_get_length(n->log, &key_id, &payload_len) == STORAGE_LOG_OK &&
+        payload_len >= PAYLOAD_OVERHEAD) {
+        if (!(flags & STORAGE_LOG_FLAG_COMPRESSED)) {
+            *size = payload_len - PAYLOAD_OVERHEAD;
+            result = 0;
+        } else {
+            // Compressed records keep the value length in front of the ciphertext
+            storage_log_view_t view;
+            if (storage_log_map(n->log, &key_id, &view) == STORAGE_LOG_OK) {
+                result = view_value_len(&view, size) ? 0 : -1;
+                storage_log_unmap(&view);
+            }
+        }
+    }
+    state_leave();
+    return result;
+}
+
+int secure_storage_ns_exists(const char* ns, const char* key) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return 0;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    int exists = storage_log_contains(n->log, &key_id);
+    state_leave();
+    return exists;
+}
+
+int secure_storage_ns_delete(const char* ns, const char* key) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    int result = storage_log_delete(n->log, &key_id) == STORAGE_LOG_OK ? 0 : -1;
+    storage_cache_invalidate(n->cache, &key_id);
+    state_leave();
+    return result;
+}
+
+int secure_storage_ns_store_many(const char* ns, const secure_storage_item_t* items, size_t count,
+                                 int* results) {
+    for (size_t i = 0; results && i < count; i++) results[i] = -1;
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    
+    // Seal everything first so the batch holds the writer queue only for I/O
+    storage_log_op_t* ops = calloc(count ? count : 1, sizeof(storage_log_op_t));
+    size_t* item_of = malloc((count ? count : 1) * sizeof(size_t));
+    size_t op_count = 0;
+    for (size_t i = 0; ops && item_of && i < count; i++) {
+        storage_log_op_t* op = &ops[op_count];
+        unsigned char* payload;
+        key_id_for(items[i].key, &op->key_id);
+        if (seal_record(items[i].data, items[i].data_len, &payload, &op->payload_len, &op->flags)) {
+            op->payload = payload;
+            item_of[op_count++] = i;
+        }
+    }
+    if (op_count > 0) {
+        storage_log_write_batch(n->log, ops, op_count);
+    }
+    
+    size_t stored = 0;
+    for (size_t k = 0; k < op_count; k++) {
+        int ok = (ops[k].result == STORAGE_LOG_OK);
+        storage_cache_invalidate(n->cache, &ops[k].key_id);
+        free((void*)ops[k].payload);
+        if (results) results[item_of[k]] = ok ? 0 : -1;
+        stored += ok;
+    }
+    free(item_of);
+    free(ops);
+    state_leave();
+    
+    LOGI("Stored %zu of %zu records in namespace %s", stored, count, ns);
+    return stored == count ? 0 : -1;
+}
+
+int secure_storage_ns_get_metrics(const char* ns, storage_log_metrics_t* metrics,
+                                  storage_cache_stats_t* cache_stats) {
+    storage_namespace_t* n = namespace_enter(ns);
+    if (!n) {
+        return -1;
+    }
+    if (metrics) storage_log_get_metrics(n->log, metrics);
+    if (cache_stats) storage_cache_get_stats(n->cache, cache_stats);
+    state_leave();
+    return 0;
+}
+
+/*
+ * ========================================================================
+ * Master key rotation
+ * ========================================================================
+ */
+
+/*
+ * secure_storage_rotate_key switches to a fresh master key at once: every
+ * record written from then on is sealed under it and stamped with its
+ * epoch. A background job then rewrites the live records still stamped
+ * with the previous epoch, ROTATION_BATCH at a time. Each batch holds
+ * the state lock shared only while it runs, so reads and writes go on
+ * throughout, and records of both epochs stay readable. A rewrite keeps
+ * the record's nonce (under a different key) and is a conditional batch
+ * op, so a value stored meanwhile always wins over the rewrite.
+ *
+ * The key file keeps the previous key until the job finds no record left
+ * that needs it; a restart before then resumes the job.
+ */
+#define ROTATION_BATCH 64
+#define ROTATION_DEFAULT_BUDGET (1024 * 1024)   // Bytes rewritten per second
+
+static struct {
+    pthread_mutex_t control;    // Serializes starting and joining the job
+    pthread_t thread;
+    int joinable;               // Started and not joined yet (control)
+    int stop;                   // thread_lock
+    pthread_mutex_t thread_lock;
+    pthread_cond_t thread_cond;
+    uint64_t io_budget;         // Bytes rewritten per second, 0 = unthrottled (control)
+    
+    // Metrics of the current (or last) job, relaxed atomics
+    uint64_t records_total;
+    uint64_t records_rewritten;
+    uint64_t records_skipped;
+    uint64_t records_failed;
+    uint64_t bytes_rewritten;
+    uint64_t time_us;
+} g_rotation = {
+    .control = PTHREAD_MUTEX_INITIALIZER,
+    .thread_lock = PTHREAD_MUTEX_INITIALIZER,
+    .thread_cond = PTHREAD_COND_INITIALIZER,
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/*
+ * Re-seal one record under the current key into a conditional batch op
+ * with a malloc'd payload (caller holds the state lock shared)
+ * Returns 1 if op was filled, 0 if the record needs no rewrite, -1 on failure
+ */
+static int rewrap_record(storage_log_t* log, const storage_key_id_t* id, storage_log_op_t* op) {
+    storage_log_view_t view;
+    int result = storage_log_map(log, id, &view);
+    if (result == STORAGE_LOG_NOT_FOUND) {
+        return 0;
+    }
+    if (result != STORAGE_LOG_OK) {
+        return -1;
+    }
+    if (view.key_epoch == g_key_epoch) {
+        storage_log_unmap(&view);
+        return 0;
+    }
+    
+    // Compressed records keep their clear length header as it is
+    size_t header_len = sealed_offset(view.flags);
+    const unsigned char* old_key = key_for_epoch(view.key_epoch);
+    size_t body_len = view.payload_len >= header_len ? view.payload_len - header_len : 0;
+    unsigned char* payload = malloc(view.payload_len);
+    unsigned char* plain = secure_buffer_alloc(body_len);
+    
+    int ok = old_key && payload && plain && view.payload_len >= header_len;
+    if (ok) {
+        const unsigned char* nonce = view.payload;
+        memcpy(payload, view.payload, header_len);
+        ok = chacha20_poly1305_decrypt(old_key, nonce, view.payload + header_len, body_len,
+                                       view.payload + CHACHA20_NONCE_SIZE, plain) &&
+             chacha20_poly1305_encrypt(g_keys->encryption_key, nonce, plain, body_len,
+                                       payload + header_len, payload + CHACHA20_NONCE_SIZE);
+    }
+    
+    uint32_t epoch = view.key_epoch;
+    memset(op, 0, sizeof(*op));
+    op->key_id = *id;
+    op->payload = payload;
+    op->payload_len = view.payload_len;
+    op->flags = view.flags;
+    op->if_seq = view.seq;
+    storage_log_unmap(&view);
+    
+    secure_buffer_free(plain);
+    if (!ok) {
+        LOGE("Failed to re-key record (epoch %u)", epoch);
+        free(payload);
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Rewrite one batch of records of a log (caller holds the state lock shared)
+ * Returns the payload bytes written
+ */
+static uint64_t rotation_batch(storage_log_t* log, const storage_key_id_t* ids, size_t count) {
+    storage_log_op_t ops[ROTATION_BATCH];
+    size_t op_count = 0;
+    uint64_t skipped = 0, failed = 0, rewritten = 0, bytes = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        int result = rewrap_record(log, &ids[i], &ops[op_count]);
+        if (result > 0) {
+            op_count++;
+        } else if (result == 0) {
+            skipped++;
+        } else {
+            failed++;
+        }
+    }
+    
+    storage_log_write_batch(log, ops, op_count);
+    for (size_t i = 0; i < op_count; i++) {
+        if (ops[i].result == STORAGE_LOG_OK) {
+            rewritten++;
+            bytes += ops[i].payload_len;
+        } else if (ops[i].result == STORAGE_LOG_CONFLICT) {
+            skipped++;
+        } else {
+            failed++;
+        }
+        free((void*)ops[i].payload);
+    }
+    
+    __atomic_fetch_add(&g_rotation.records_rewritten, rewritten, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_rotation.records_skipped, skipped, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_rotation.records_failed, failed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_rotation.bytes_rewritten, bytes, __ATOMIC_RELAXED);
+    return bytes;
+}
+
+/*
+ * Find the first store, from s on, holding records sealed under an old
+ * key and snapshot their ids (caller holds the state lock)
+ * Returns 1 with *s, *ids and *count set (count 0 once every store is
+ * clean), 0 on failure
+ */
+static int rotation_list(size_t* s, storage_key_id_t** ids, size_t* count) {
+    *ids = NULL;
+    *count = 0;
+    storage_log_t* log;
+    for (; (log = store_log(*s)) != NULL; (*s)++) {
+        if (storage_log_list_stale(log, g_key_epoch, ids, count) != STORAGE_LOG_OK) {
+            return 0;
+        }
+        if (*count > 0) {
+            return 1;
+        }
+        free(*ids);
+        *ids = NULL;
+    }
+    return 1;
+}
+
+/*
+ * Drop the previous key once no live record in any store needs it
+ * Returns 1 if the rotation is complete
+ */
+static int rotation_finish(void) {
+    pthread_rwlock_wrlock(&g_state_lock);
+    
+    // With the lock exclusive no writer is in flight, so the count is final
+    storage_key_id_t* ids = NULL;
+    size_t count = 0;
+    size_t s = 0;
+    int complete = g_initialized && g_has_previous && rotation_list(&s, &ids, &count) &&
+                   count == 0;
+    free(ids);
+    
+    if (complete) {
+        g_has_previous = 0;
+        if (save_key_ring()) {
+            secure_buffer_wipe(g_keys->previous_key, sizeof(g_keys->previous_key));
+            LOGI("Key rotation to epoch %u complete, epoch %u key wiped",
+                 g_key_epoch, g_previous_epoch);
+        } else {
+            g_has_previous = 1;
+            complete = 0;
+        }
+    }
+    
+    pthread_rwlock_unlock(&g_state_lock);
+    return complete;
+}
+
+/*
+ * Sleep for us microseconds unless asked to stop
+ * Returns 0 if the job should stop
+ */
+static int rotation_wait(uint64_t us) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += (time_t)(us / 1000000);
+    until.tv_nsec += (long)(us % 1000000) * 1000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&g_rotation.thread_lock);
+    if (!g_rotation.stop && us > 0) {
+        pthread_cond_timedwait(&g_rotation.thread_cond, &g_rotation.thread_lock, &until);
+    }
+    int go_on = !g_rotation.stop;
+    pthread_mutex_unlock(&g_rotation.thread_lock);
+    return go_on;
+}
+
+static void* rotation_thread(void* arg) {
+    (void)arg;
+    uint64_t io_budget = g_rotation.io_budget;   // Fixed for the life of the thread
+    size_t store = 0;           // Main store, then each namespace in turn
+    size_t counted = 0;         // Stores whose first pass is in records_total
+    LOGI("Key rotation job started");
+    
+    while (rotation_wait(0)) {
+        pthread_rwlock_rdlock(&g_state_lock);
+        storage_key_id_t* ids = NULL;
+        size_t count = 0;
+        int listed = g_initialized && g_has_previous && rotation_list(&store, &ids, &count);
+        pthread_rwlock_unlock(&g_state_lock);
+        
+        if (!listed) {
+            break;
+        }
+        if (count == 0) {
+            free(ids);
+            if (rotation_finish()) {
+                break;
+            }
+            // Lost a race with a rotation or shutdown, or the ring did not save
+            if (!rotation_wait(1000000)) break;
+            store = 0;
+            continue;
+        }
+        if (store >= counted) {
+            __atomic_fetch_add(&g_rotation.records_total, count, __ATOMIC_RELAXED);
+            counted = store + 1;
+        }
+        
+        uint64_t rewritten_before = __atomic_load_n(&g_rotation.records_rewritten, __ATOMIC_RELAXED);
+        uint64_t failed_before = __atomic_load_n(&g_rotation.records_failed, __ATOMIC_RELAXED);
+        int go_on = 1;
+        for (size_t i = 0; go_on && i < count; i += ROTATION_BATCH) {
+            size_t n = count - i < ROTATION_BATCH ? count - i : ROTATION_BATCH;
+            uint64_t start = now_us();
+            
+            uint64_t bytes = 0;
+            pthread_rwlock_rdlock(&g_state_lock);
+            storage_log_t* log = g_initialized ? store_log(store) : NULL;
+            if (log) {
+                bytes = rotation_batch(log, ids + i, n);
+            }
+            pthread_rwlock_unlock(&g_state_lock);
+            
+            uint64_t spent = now_us() - start;
+            __atomic_fetch_add(&g_rotation.time_us, spent, __ATOMIC_RELAXED);
+            
+            // Throttle: a batch of b bytes earns b / budget seconds
+            uint64_t due = io_budget ? bytes * 1000000ULL / io_budget : 0;
+            go_on = rotation_wait(due > spent ? due - spent : 0);
+        }
+        free(ids);
+        
+        // Records that keep failing would otherwise be retried forever
+        if (go_on &&
+            __atomic_load_n(&g_rotation.records_rewritten, __ATOMIC_RELAXED) == rewritten_before &&
+            __atomic_load_n(&g_rotation.records_failed, __ATOMIC_RELAXED) > failed_before) {
+            LOGE("Key rotation stalled on unreadable records, resuming on next start");
+            break;
+        }
+    }
+    
+    LOGI("Key rotation job stopped");
+    return NULL;
+}
+
+/*
+ * Start the job thread (caller holds g_rotation.control)
+ */
+static int rotation_start_locked(void) {
+    // A previous job has already finished or is about to
+    if (g_rotation.joinable) {
+        pthread_join(g_rotation.thread, NULL);
+        g_rotation.joinable = 0;
+    }
+    
+    __atomic_store_n(&g_rotation.records_total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_rotation.records_rewritten, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_rotation.records_skipped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_rotation.records_failed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_rotation.bytes_rewritten, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_rotation.time_us, 0, __ATOMIC_RELAXED);
+    
+    pthread_mutex_lock(&g_rotation.thread_lock);
+    g_rotation.stop = 0;
+    pthread_mutex_unlock(&g_rotation.thread_lock);
+    
+    if (pthread_create(&g_rotation.thread, NULL, rotation_thread, NULL) != 0) {
+        LOGE("Failed to start key rotation job");
+        return 0;
+    }
+    g_rotation.joinable = 1;
+    return 1;
+}
+
+/*
+ * Resume an interrupted rotation (after initialize, state lock not held)
+ */
+static void rotation_resume(void) {
+    pthread_mutex_lock(&g_rotation.control);
+    g_rotation.io_budget = ROTATION_DEFAULT_BUDGET;
+    rotation_start_locked();
+    pthread_mutex_unlock(&g_rotation.control);
+}
+
+/*
+ * Stop the job between batches and wait for it (state lock not held)
+ */
+static void rotation_stop(void) {
+    pthread_mutex_lock(&g_rotation.control);
+    if (g_rotation.joinable) {
+        pthread_mutex_lock(&g_rotation.thread_lock);
+        g_rotation.stop = 1;
+        pthread_cond_signal(&g_rotation.thread_cond);
+        pthread_mutex_unlock(&g_rotation.thread_lock);
+        
+        pthread_join(g_rotation.thread, NULL);
+        g_rotation.joinable = 0;
+    }
+    pthread_mutex_unlock(&g_rotation.control);
+}
+
+/*
+ * Whether a legacy per-key file is still waiting to be migrated.
+ * Those are sealed under the epoch 0 key outside the log, where the
+ * rotation job cannot see them.
+ */
+static int legacy_files_remain(void) {
+    char path[MAX_PATH];
+    for (size_t i = 0; i < g_legacy_files; i++) {
+        snprintf(path, sizeof(path), "%s/%08x.enc", g_storage_dir, g_legacy_ids[i]);
+        if (access(path, F_OK) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int secure_storage_rotate_key(uint64_t io_budget_bytes) {
+    pthread_mutex_lock(&g_rotation.control);
+    pthread_rwlock_wrlock(&g_state_lock);
+    
+    int ok = 0;
+    if (!g_initialized) {
+        LOGE("Storage not initialized");
+    } else if (g_has_previous) {
+        LOGW("Key rotation to epoch %u still in progress", g_key_epoch);
+    } else if (legacy_files_remain()) {
+        LOGW("Legacy per-key files must be migrated before the key can rotate");
+    } else if (g_key_epoch == UINT32_MAX) {
+        LOGE("Key epochs exhausted");
+    } else {
+        unsigned char next[CHACHA20_KEY_SIZE];
+        ok = sovereign_random_bytes(next, CHACHA20_KEY_SIZE);
+        if (ok) {
+            memcpy(g_keys->previous_key, g_keys->encryption_key, CHACHA20_KEY_SIZE);
+            g_previous_epoch = g_key_epoch;
+            g_has_previous = 1;
+            memcpy(g_keys->encryption_key, next, CHACHA20_KEY_SIZE);
+            g_key_epoch++;
+            
+            // The ring must be durable before any record uses the new key
+            ok = save_key_ring();
+            if (ok) {
+                storage_log_t* log;
+                for (size_t s = 0; (log = store_log(s)) != NULL; s++) {
+                    storage_log_set_key_epoch(log, g_key_epoch);
+                }
+            } else {
+                memcpy(g_keys->encryption_key, g_keys->previous_key, CHACHA20_KEY_SIZE);
+                g_key_epoch = g_previous_epoch;
+                secure_buffer_wipe(g_keys->previous_key, sizeof(g_keys->previous_key));
+                g_has_previous = 0;
+            }
+        } else {
+            LOGE("Failed to generate encryption key");
+        }
+        secure_buffer_wipe(next, sizeof(next));
+    }
+    
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    if (ok) {
+        LOGI("Master key rotated to epoch %u, re-keying records in the background", g_key_epoch);
+        g_rotation.io_budget = io_budget_bytes;
+        ok = rotation_start_locked();
+    }
+    pthread_mutex_unlock(&g_rotation.control);
+    return ok;
+}
+
+void secure_storage_get_rotation_metrics(secure_storage_rotation_metrics_t* metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+    
+    pthread_rwlock_rdlock(&g_state_lock);
+    metrics->key_epoch = g_key_epoch;
+    metrics->in_progress = g_initialized && g_has_previous;
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    metrics->records_total = __atomic_load_n(&g_rotation.records_total, __ATOMIC_RELAXED);
+    metrics->records_rewritten = __atomic_load_n(&g_rotation.records_rewritten, __ATOMIC_RELAXED);
+    metrics->records_skipped = __atomic_load_n(&g_rotation.records_skipped, __ATOMIC_RELAXED);
+    metrics->records_failed = __atomic_load_n(&g_rotation.records_failed, __ATOMIC_RELAXED);
+    metrics->bytes_rewritten = __atomic_load_n(&g_rotation.bytes_rewritten, __ATOMIC_RELAXED);
+    metrics->time_us = __atomic_load_n(&g_rotation.time_us, __ATOMIC_RELAXED);
+    if (metrics->time_us > 0) {
+        metrics->throughput_mb_s =
+            (float)((double)metrics->bytes_rewritten /
+                    ((double)metrics->time_us / 1e6) / (1024.0 * 1024.0));
+    }
+}
+
+/*
+ * Re-seal the key file under a new passphrase, or store it unwrapped
+ * when passphrase is NULL. Argon2id runs before the state lock is taken,
+ * so other calls only wait for the file write.
+ */
+int secure_storage_change_passphrase(const uint8_t* passphrase, size_t passphrase_len,
+                                     const argon2_params_t* params) {
+    int wrap = passphrase && passphrase_len > 0;
+    
+    // New wrapping key, then the old one to restore if the write fails
+    uint8_t* keys = secure_buffer_alloc(2 * CHACHA20_KEY_SIZE);
+    if (!keys) {
+        LOGE("Failed to allocate key buffer");
+        return 0;
+    }
+    uint8_t salt[KEY_WRAP_SALT_SIZE];
+    argon2_params_t chosen;
+    if (wrap && !new_wrap_key(passphrase, passphrase_len, params, keys, salt, &chosen)) {
+        secure_buffer_free(keys);
+        return 0;
+    }
+    
+    pthread_rwlock_wrlock(&g_state_lock);
+    int ok = 0;
+    if (!g_initialized) {
+        LOGE("Storage not initialized");
+    } else {
+        int was_wrapped = g_key_wrapped;
+        argon2_params_t old_params = g_wrap_params;
+        uint8_t old_salt[KEY_WRAP_SALT_SIZE];
+        memcpy(old_salt, g_wrap_salt, KEY_WRAP_SALT_SIZE);
+        memcpy(keys + CHACHA20_KEY_SIZE, g_keys->wrap_key, CHACHA20_KEY_SIZE);
+        
+        g_key_wrapped = wrap;
+        if (wrap) {
+            memcpy(g_keys->wrap_key, keys, CHACHA20_KEY_SIZE);
+            memcpy(g_wrap_salt, salt, KEY_WRAP_SALT_SIZE);
+            g_wrap_params = chosen;
+        } else {
+            secure_buffer_wipe(g_keys->wrap_key, sizeof(g_keys->wrap_key));
+        }
+        
+        ok = save_key_ring();
+        if (ok) {
+            LOGI(wrap ? "Key file passphrase changed" : "Key file passphrase removed");
+        } else {
+            g_key_wrapped = was_wrapped;
+            g_wrap_params = old_params;
+            memcpy(g_wrap_salt, old_salt, KEY_WRAP_SALT_SIZE);
+            memcpy(g_keys->wrap_key, keys + CHACHA20_KEY_SIZE, CHACHA20_KEY_SIZE);
+        }
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    secure_buffer_free(keys);
+    return ok;
+}
+
+int secure_storage_is_passphrase_protected(void) {
+    pthread_rwlock_rdlock(&g_state_lock);
+    int wrapped = g_initialized && g_key_wrapped;
+    pthread_rwlock_unlock(&g_state_lock);
+    return wrapped;
+}
+
+/*
+ * Open the segment log and start background compaction
+ */
+static int open_store(void) {
+    g_log = storage_log_open(g_storage_dir);
+    if (!g_log) {
+        LOGE("Failed to open segment log");
+        return 0;
+    }
+    storage_log_set_sync(g_log, g_durability == SECURE_STORAGE_DURABILITY_SYNC);
+    storage_log_set_key_epoch(g_log, g_key_epoch);
+    derive_dedup_key();
+    
+    g_legacy_files = load_legacy_files();
+    if (g_legacy_files) {
+        LOGI("%zu legacy per-key files present, migrating on access", g_legacy_files);
+    }
+    
+    storage_log_compaction_start(g_log, NULL);
+    namespaces_open();
+    return 1;
+}
+
+/*
+ * ========================================================================
+ * Native C API for internal use (other native modules can call these)
+ * ========================================================================
+ */
+
+/*
+ * Choose the storage directory (default: app private files/secure)
+ * Only takes effect before initialize; returns 0 if already initialized
+ */
+int secure_storage_set_root(const char* dir) {
+    pthread_rwlock_wrlock(&g_state_lock);
+    int ok = !g_initialized && strlen(dir) < sizeof(g_storage_dir) - 32;
+    if (ok) {
+        snprintf(g_storage_dir, sizeof(g_storage_dir), "%s", dir);
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    if (!ok) {
+        LOGE("Cannot set storage root to %s", dir);
+    }
+    return ok;
+}
+
+/*
+ * Passphrase for the next initialize: opens a protected key file, and
+ * wraps an unprotected or new one. Kept in secure_buffer memory and
+ * dropped by initialize. NULL clears it
+ */
+int secure_storage_set_passphrase(const uint8_t* passphrase, size_t passphrase_len) {
+    uint8_t* copy = NULL;
+    if (passphrase && passphrase_len > 0) {
+        copy = secure_buffer_alloc(passphrase_len);
+        if (!copy) {
+            LOGE("Failed to allocate passphrase buffer");
+            return 0;
+        }
+        memcpy(copy, passphrase, passphrase_len);
+    }
+    
+    pthread_rwlock_wrlock(&g_state_lock);
+    int ok = !g_initialized;
+    if (ok) {
+        secure_buffer_free(g_passphrase);
+        g_passphrase = copy;
+        g_passphrase_len = copy ? passphrase_len : 0;
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    if (!ok) {
+        LOGE("Passphrase must be set before initialize");
+        secure_buffer_free(copy);
+    }
+    return ok;
+}
+
+/*
+ * Initialize secure storage (native C API and JNI)
+ * Safe to call from several threads at once: the first caller does the
+ * work under the exclusive state lock, the rest see it done.
+ * Returns 1 on success, 0 on failure
+ */
+int secure_storage_initialize(void) {
+    pthread_rwlock_wrlock(&g_state_lock);
+    if (g_initialized) {
+        pthread_rwlock_unlock(&g_state_lock);
+        LOGI("Secure storage already initialized");
+        return 1;
+    }
+    
+    LOGI("Initializing secure storage subsystem");
+    LOGI("Sovereign crypto: ChaCha20-Poly1305 (RFC 8439)");
+    
+    // Create storage directory
+    mkdir(g_storage_dir, 0700);
+    LOGI("Storage directory: %s", g_storage_dir);
+    
+    // Load or create persistent encryption key
+    g_keys = (storage_keys_t*)secure_buffer_alloc(sizeof(storage_keys_t));
+    int have_key = g_keys && load_or_create_master_key();
+    
+    // The passphrase serves one initialize, successful or not
+    secure_buffer_free(g_passphrase);
+    g_passphrase = NULL;
+    g_passphrase_len = 0;
+    
+    if (!have_key) {
+        LOGE("Failed to initialize encryption key");
+        secure_buffer_free((uint8_t*)g_keys);
+        g_keys = NULL;
+        g_key_wrapped = 0;
+        pthread_rwlock_unlock(&g_state_lock);
+        return 0;
+    }
+    
+    LOGI("Master key initialized (persistent across restarts)");
+    LOGI("Key source: /dev/urandom (Android secure RNG)");
+    
+    if (!open_store()) {
+        secure_buffer_free((uint8_t*)g_keys);
+        g_keys = NULL;
+        g_has_previous = 0;
+        g_key_wrapped = 0;
+        pthread_rwlock_unlock(&g_state_lock);
+        return 0;
+    }
+    
+    g_initialized = 1;
+    int resume = g_has_previous;
+    pthread_rwlock_unlock(&g_state_lock);
+    
+    if (resume) {
+        LOGI("Resuming key rotation to epoch %u", g_key_epoch);
+        rotation_resume();
+    }
+    return 1;
+}
+
+/*
+ * Append a sealed payload under key and free it
+ * Split from store_value so the JNI byte[] path can seal while it holds
+ * the array and append (which may fsync) after releasing it
+ */
+static int store_payload(const char* key, unsigned char* payload, size_t payload_len,
+                         uint16_t flags) {
+    // Append to the segment log, then drop any cached plaintext
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    stream_manifest_t previous;
+    int replaces_stream = load_manifest(&key_id, &previous);
+    
+    if (!record_name(key, &key_id)) {
+        free(payload);
+        return -1;
+    }
+    int result = storage_log_put_flags(g_log, &key_id, flags, payload, payload_len);
+    storage_cache_invalidate(storage_cache_default(), &key_id);
+    free(payload);
+    
+    if (result != STORAGE_LOG_OK) {
+        LOGE("Failed to append record for key: %s", key);
+        return -1;
+    }
+    
+    if (replaces_stream) {
+        release_chunks(&key_id, &previous, previous.chunk_count);
+    }
+    
+    LOGI("Stored encrypted record: %s (%zu bytes)", key, payload_len);
+    return 0;
+}
+
+static int store_value(const char* key, const uint8_t* data, size_t data_len) {
+    // Large values share unchanged chunks with what is already stored
+    if (dedup_wanted(data_len)) {
+        return store_dedup(key, data, data_len);
+    }
+    
+    // Encrypt data into a record payload: [nonce][tag][ciphertext]
+    unsigned char* payload;
+    size_t payload_len;
+    uint16_t flags;
+    
+    if (!seal_record(data, data_len, &payload, &payload_len, &flags)) {
+        LOGE("Encryption failed");
+        return -1;
+    }
+    
+    return store_payload(key, payload, payload_len, flags);
+}
+
+int secure_storage_store(const char* key, const uint8_t* data, size_t data_len) {
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = store_value(key, data, data_len);
+    state_leave();
+    return result;
+}
+
+/*
+ * Decrypt a value into data. *value_len gets the plaintext length, or the
+ * length needed when data_len is too small (returns -1 either way then).
+ */
+static int retrieve_value(const char* key, uint8_t* data, size_t data_len, size_t* value_len) {
+    *value_len = 0;
+    
+    // Hot keys are served from the plaintext cache when enabled
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    size_t cached_len;
+    int cached = storage_cache_get(storage_cache_default(), &key_id, data, data_len, &cached_len);
+    
+    if (cached == STORAGE_CACHE_HIT) {
+        *value_len = cached_len;
+        return 0;
+    }
+    if (cached == STORAGE_CACHE_TOO_SMALL) {
+        LOGE("Buffer too small for %s (need %zu, got %zu)", key, cached_len, data_len);
+        *value_len = cached_len;
+        return -1;
+    }
+    
+    // Streamed values are reassembled chunk by chunk and never cached
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_STREAM)) {
+        secure_storage_reader_t* reader = reader_open(key);
+        if (!reader) {
+            return -1;
+        }
+        
+        uint64_t size = secure_storage_reader_size(reader);
+        size_t read_len = 0;
+        int result = (size <= data_len) ? reader_read(reader, data, data_len, &read_len) : -1;
+        if (size > data_len) {
+            LOGE("Buffer too small for %s (need %llu, got %zu)", key,
+                 (unsigned long long)size, data_len);
+            read_len = (size > SIZE_MAX) ? SIZE_MAX : (size_t)size;
+        }
+        secure_storage_close_reader(reader);
+        *value_len = read_len;
+        return result;
+    }
+    
+    // Decrypt straight out of the mapped segment, no ciphertext copy
+    uint64_t fill_token = storage_cache_fill_token(storage_cache_default());
+    storage_log_view_t view;
+    
+    if (map_payload(key, &key_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Record not found: %s", key);
+        return -1;
+    }
+    
+    size_t decrypted_len;
+    if (!view_value_len(&view, &decrypted_len)) {
+        storage_log_unmap(&view);
+        return -1;
+    }
+    if (decrypted_len > data_len) {
+        LOGE("Buffer too small for %s (need %zu, got %zu)", key, decrypted_len, data_len);
+        storage_log_unmap(&view);
+        *value_len = decrypted_len;
+        return -1;
+    }
+    
+    // Decrypt
+    int result = open_view(&view, data, decrypted_len);
+    
+    storage_log_unmap(&view);
+    
+    if (!result) {
+        LOGE("Decryption failed");
+        return -1;
+    }
+    
+    storage_cache_put(storage_cache_default(), &key_id, data, decrypted_len, fill_token);
+    *value_len = decrypted_len;
+    return 0;
+}
+
+int secure_storage_retrieve(const char* key, uint8_t* data, size_t data_len) {
+    if (!state_enter()) {
+        return -1;
+    }
+    size_t value_len;
+    int result = retrieve_value(key, data, data_len, &value_len);
+    state_leave();
+    return result;
+}
+
+static int value_size(const char* key, size_t* size) {
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    
+    stream_manifest_t manifest;
+    if (load_manifest(&key_id, &manifest)) {
+        if (manifest.total_len > SIZE_MAX) {
+            LOGE("Value for %s does not fit in memory, use the streaming API", key);
+            return -1;
+        }
+        *size = (size_t)manifest.total_len;
+        return 0;
+    }
+    
+    size_t payload_len;
+    int result = storage_log_get_length(g_log, &key_id, &payload_len);
+    if (result == STORAGE_LOG_NOT_FOUND && migrate_legacy_file(key, &key_id)) {
+        result = storage_log_get_length(g_log, &key_id, &payload_len);
+    }
+    
+    if (result != STORAGE_LOG_OK || payload_len < PAYLOAD_OVERHEAD) {
+        return -1;
+    }
+    
+    // Compressed records keep the value length in front of the ciphertext
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_COMPRESSED)) {
+        storage_log_view_t view;
+        if (map_payload(key, &key_id, &view) != STORAGE_LOG_OK) {
+            return -1;
+        }
+        int ok = view_value_len(&view, size);
+        storage_log_unmap(&view);
+        return ok ? 0 : -1;
+    }
+    
+    *size = payload_len - PAYLOAD_OVERHEAD;
+    return 0;
+}
+
+int secure_storage_get_size(const char* key, size_t* size) {
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = value_size(key, size);
+    state_leave();
+    return result;
+}
+
+static int value_exists(const char* key) {
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    
+    char legacy_path[MAX_PATH];
+    return storage_log_contains(g_log, &key_id) ||
+           (g_legacy_files && find_legacy_file(key, legacy_path));
+}
+
+int secure_storage_exists(const char* key) {
+    if (!state_enter()) {
+        return 0;
+    }
+    int exists = value_exists(key);
+    state_leave();
+    return exists;
+}
+
+static int retrieve_value_secure(const char* key, uint8_t** data, size_t* data_len) {
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    
+    // Streamed values: chunks are decrypted one at a time into the buffer
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_STREAM)) {
+        size_t size;
+        secure_storage_reader_t* reader = reader_open(key);
+        if (!reader || value_size(key, &size) != 0) {
+            if (reader) secure_storage_close_reader(reader);
+            return -1;
+        }
+        
+        uint8_t* buf = secure_buffer_alloc(size);
+        size_t read_len;
+        int result = (buf && reader_read(reader, buf, size, &read_len) == 0 &&
+                      read_len == size) ? 0 : -1;
+        secure_storage_close_reader(reader);
+        
+        if (result != 0) {
+            secure_buffer_free(buf);
+            return -1;
+        }
+        *data = buf;
+        *data_len = size;
+        return 0;
+    }
+    
+    // Regular values: decrypt from the mapped segment into locked memory
+    storage_log_view_t view;
+    if (map_payload(key, &key_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Record not found: %s", key);
+        return -1;
+    }
+    
+    size_t decrypted_len = 0;
+    uint8_t* buf = view_value_len(&view, &decrypted_len) ?
+                   secure_buffer_alloc(decrypted_len) : NULL;
+    
+    int result = buf && open_view(&view, buf, decrypted_len);
+    storage_log_unmap(&view);
+    
+    if (!result) {
+        LOGE("Decryption failed");
+        secure_buffer_free(buf);
+        return -1;
+    }
+    
+    *data = buf;
+    *data_len = decrypted_len;
+    return 0;
+}
+
+int secure_storage_retrieve_secure(const char* key, uint8_t** data, size_t* data_len) {
+    *data = NULL;
+    *data_len = 0;
+    
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = retrieve_value_secure(key, data, data_len);
+    state_leave();
+    return result;
+}
+
+void secure_storage_free(uint8_t* data) {
+    secure_buffer_free(data);
+}
+
+static int delete_value(const char* key) {
+    char legacy_path[MAX_PATH];
+    int removed = 0;
+    
+    if (g_legacy_files && find_legacy_file(key, legacy_path) && remove(legacy_path) == 0) {
+        removed = 1;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    stream_manifest_t previous;
+    int replaces_stream = load_manifest(&key_id, &previous);
+    
+    if (storage_log_delete(g_log, &key_id) == STORAGE_LOG_OK) {
+        removed = 1;
+        if (replaces_stream) {
+            release_chunks(&key_id, &previous, previous.chunk_count);
+        }
+    }
+    storage_cache_invalidate(storage_cache_default(), &key_id);
+    forget_name(key, &key_id);
+    
+    if (!removed) {
+        LOGE("Failed to delete record: %s", key);
+        return -1;
+    }
+    
+    LOGI("Deleted record: %s", key);
+    return 0;
+}
+
+int secure_storage_delete(const char* key) {
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = delete_value(key);
+    state_leave();
+    return result;
+}
+
+/*
+ * ========================================================================
+ * Batches: one log write batch, so one writer-queue turn and one sync
+ * ========================================================================
+ */
+
+// One value of a batch store, sealed before the batch is written
+typedef struct {
+    const char* key;
+    storage_key_id_t key_id;
+    unsigned char* payload;         // [nonce][tag][ciphertext]
+    size_t payload_len;
+    uint16_t flags;                 // STORAGE_LOG_FLAG_COMPRESSED or 0
+    unsigned char* name_payload;    // Sealed name record, NULL if already on disk
+    size_t name_payload_len;
+    int replaces_stream;
+    stream_manifest_t previous;
+    int result;
+} batch_value_t;
+
+/*
+ * Seal one value (and its name record if new) for store_batch
+ * Returns 1 on success; on failure v->result is -1
+ */
+static int batch_seal(batch_value_t* v, const char* key, const uint8_t* data, size_t data_len) {
+    memset(v, 0, sizeof(*v));
+    v->key = key;
+    v->result = -1;
+    key_id_for(key, &v->key_id);
+    v->replaces_stream = load_manifest(&v->key_id, &v->previous);
+    
+    storage_key_id_t name_id;
+    name_id_for(&v->key_id, &name_id);
+    if (!storage_log_contains(g_log, &name_id) &&
+        !seal_value((const unsigned char*)key, strlen(key), &v->name_payload, &v->name_payload_len)) {
+        return 0;
+    }
+    if (!seal_record(data, data_len, &v->payload, &v->payload_len, &v->flags)) {
+        free(v->name_payload);
+        v->name_payload = NULL;
+        return 0;
+    }
+    v->result = 0;
+    return 1;
+}
+
+/*
+ * Write sealed values as one batch, each name record just before its
+ * value, and free the payloads. Sets each value's result.
+ * Returns the number stored
+ */
+static size_t store_batch(batch_value_t* values, size_t count) {
+    storage_log_op_t* ops = calloc(2 * count + 1, sizeof(storage_log_op_t));
+    if (!ops) {
+        for (size_t i = 0; i < count; i++) values[i].result = -1;
+    }
+    
+    size_t op_count = 0;
+    for (size_t i = 0; ops && i < count; i++) {
+        batch_value_t* v = &values[i];
+        if (v->result != 0) continue;
+        if (v->name_payload) {
+            name_id_for(&v->key_id, &ops[op_count].key_id);
+            ops[op_count].flags = STORAGE_LOG_FLAG_NAME;
+            ops[op_count].payload = v->name_payload;
+            ops[op_count].payload_len = v->name_payload_len;
+            op_count++;
+        }
+        ops[op_count].key_id = v->key_id;
+        ops[op_count].flags = v->flags;
+        ops[op_count].payload = v->payload;
+        ops[op_count].payload_len = v->payload_len;
+        op_count++;
+    }
+    
+    if (ops) {
+        storage_log_write_batch(g_log, ops, op_count);
+    }
+    
+    size_t stored = 0;
+    size_t op = 0;
+    for (size_t i = 0; i < count; i++) {
+        batch_value_t* v = &values[i];
+        if (ops && v->result == 0) {
+            int ok = 1;
+            if (v->name_payload) {
+                ok = (ops[op++].result == STORAGE_LOG_OK);
+            }
+            ok = (ops[op++].result == STORAGE_LOG_OK) && ok;
+            
+            storage_cache_invalidate(storage_cache_default(), &v->key_id);
+            if (ok && storage_names_insert(v->key, &v->key_id)) {
+                if (v->replaces_stream) {
+                    release_chunks(&v->key_id, &v->previous, v->previous.chunk_count);
+                }
+                stored++;
+            } else {
+                LOGE("Failed to append record for key: %s", v->key);
+                v->result = -1;
+            }
+        }
+        free(v->payload);
+        free(v->name_payload);
+        v->payload = v->name_payload = NULL;
+    }
+    
+    free(ops);
+    LOGI("Stored %zu of %zu records in one batch", stored, count);
+    return stored;
+}
+
+int secure_storage_store_many(const secure_storage_item_t* items, size_t count, int* results) {
+    if (!state_enter()) {
+        for (size_t i = 0; results && i < count; i++) results[i] = -1;
+        return -1;
+    }
+    
+    batch_value_t* values = malloc((count ? count : 1) * sizeof(batch_value_t));
+    size_t stored = 0;
+    if (values) {
+        for (size_t i = 0; i < count; i++) {
+            batch_seal(&values[i], items[i].key, items[i].data, items[i].data_len);
+        }
+        stored = store_batch(values, count);
+        for (size_t i = 0; results && i < count; i++) {
+            results[i] = values[i].result;
+        }
+        free(values);
+    } else {
+        for (size_t i = 0; results && i < count; i++) results[i] = -1;
+    }
+    
+    state_leave();
+    return (stored == count) ? 0 : -1;
+}
+
+/*
+ * Delete keys as one batch: each value, then its name record.
+ * results (may be NULL) gets 0 per key removed, -1 otherwise.
+ * Returns the number removed
+ */
+static size_t delete_batch(const char* const* keys, size_t count, int* results) {
+    storage_log_op_t* ops = calloc(2 * count + 1, sizeof(storage_log_op_t));
+    stream_manifest_t* previous = malloc((count ? count : 1) * sizeof(stream_manifest_t));
+    uint8_t* streams = calloc(count ? count : 1, 1);
+    uint8_t* legacy = calloc(count ? count : 1, 1);
+    if (!ops || !previous || !streams || !legacy) {
+        free(ops);
+        free(previous);
+        free(streams);
+        free(legacy);
+        for (size_t i = 0; results && i < count; i++) results[i] = -1;
+        return 0;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        char legacy_path[MAX_PATH];
+        if (g_legacy_files && find_legacy_file(keys[i], legacy_path) && remove(legacy_path) == 0) {
+            legacy[i] = 1;
+        }
+        
+        storage_log_op_t* value_op = &ops[2 * i];
+        key_id_for(keys[i], &value_op->key_id);
+        value_op->is_delete = 1;
+        streams[i] = (uint8_t)load_manifest(&value_op->key_id, &previous[i]);
+        
+        name_id_for(&value_op->key_id, &ops[2 * i + 1].key_id);
+        ops[2 * i + 1].is_delete = 1;
+    }
+    
+    storage_log_write_batch(g_log, ops, 2 * count);
+    
+    size_t removed = 0;
+    for (size_t i = 0; i < count; i++) {
+        const storage_key_id_t* key_id = &ops[2 * i].key_id;
+        int deleted = (ops[2 * i].result == STORAGE_LOG_OK);
+        if (deleted && streams[i]) {
+            release_chunks(key_id, &previous[i], previous[i].chunk_count);
+        }
+        storage_cache_invalidate(storage_cache_default(), key_id);
+        storage_names_remove(keys[i]);
+        
+        if (deleted || legacy[i]) {
+            removed++;
+        }
+        if (results) {
+            results[i] = (deleted || legacy[i]) ? 0 : -1;
+        }
+    }
+    
+    free(ops);
+    free(previous);
+    free(streams);
+    free(legacy);
+    LOGI("Deleted %zu of %zu records in one batch", removed, count);
+    return removed;
+}
+
+int secure_storage_delete_many(const char* const* keys, size_t count, int* results) {
+    if (!state_enter()) {
+        for (size_t i = 0; results && i < count; i++) results[i] = -1;
+        return -1;
+    }
+    size_t removed = delete_batch(keys, count, results);
+    state_leave();
+    return (removed == count) ? 0 : -1;
+}
+
+/*
+ * Snapshot the names matching a range or prefix (state lock held)
+ */
+static char** list_names(const char* start, const char* end, const char* prefix, size_t* count) {
+    *count = 0;
+    if (!storage_names_ensure_loaded(load_names)) {
+        LOGE("Failed to load name index");
+        return NULL;
+    }
+    return prefix ? storage_names_prefix(prefix, count) : storage_names_range(start, end, count);
+}
+
+/*
+ * Visit a snapshot of names with the state lock released, so the
+ * visitor may call back into storage
+ */
+static int visit_names(char** names, size_t count, secure_storage_key_visitor_t visit, void* ctx) {
+    if (!names) {
+        return -1;
+    }
+    
+    size_t visited = 0;
+    while (visited < count && visit(names[visited], ctx)) {
+        visited++;
+    }
+    if (visited < count) {
+        visited++;  // The key the visitor stopped on was still visited
+    }
+    storage_names_free_list(names, count);
+    return (int)visited;
+}
+
+int secure_storage_scan(const char* start, const char* end,
+                        secure_storage_key_visitor_t visit, void* ctx) {
+    if (!state_enter()) {
+        return -1;
+    }
+    size_t count;
+    char** names = list_names(start, end, NULL, &count);
+    state_leave();
+    
+    return visit_names(names, count, visit, ctx);
+}
+
+int secure_storage_scan_prefix(const char* prefix, secure_storage_key_visitor_t visit, void* ctx) {
+    if (!state_enter()) {
+        return -1;
+    }
+    size_t count;
+    char** names = list_names(NULL, NULL, prefix, &count);
+    state_leave();
+    
+    return visit_names(names, count, visit, ctx);
+}
+
+int secure_storage_delete_prefix(const char* prefix) {
+    if (!state_enter()) {
+        return -1;
+    }
+    
+    size_t count;
+    char** names = list_names(NULL, NULL, prefix, &count);
+    int deleted = names ? 0 : -1;
+    for (size_t i = 0; i < count; i++) {
+        if (delete_value(names[i]) == 0) deleted++;
+    }
+    state_leave();
+    
+    storage_names_free_list(names, count);
+    LOGI("Deleted %d keys with prefix %s", deleted, prefix);
+    return deleted;
+}
+
+/*
+ * Delete every record: one delete per live index entry (values, stream
+ * chunks and name records alike), so the cost follows the record count
+ * and nothing is decrypted. Compaction reclaims the space later.
+ */
+int secure_storage_clear(void) {
+    if (!state_enter()) {
+        return -1;
+    }
+    
+    storage_key_id_t* ids;
+    size_t count;
+    if (storage_log_list(g_log, 0, &ids, &count) != STORAGE_LOG_OK) {
+        state_leave();
+        return -1;
+    }
+    
+    int deleted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (storage_log_delete(g_log, &ids[i]) == STORAGE_LOG_OK) deleted++;
+        storage_cache_invalidate(storage_cache_default(), &ids[i]);
+    }
+    free(ids);
+    
+    // The log is the source of truth; reload names and chunk counts on next use
+    storage_names_reset();
+    dedup_reset();
+    
+    // Unmigrated legacy files hold values too
+    if (g_legacy_files) {
+        DIR* dir = opendir(g_storage_dir);
+        struct dirent* ent;
+        while (dir && (ent = readdir(dir)) != NULL) {
+            size_t len = strlen(ent->d_name);
+            if (len > 4 && strcmp(ent->d_name + len - 4, ".enc") == 0) {
+                char path[MAX_PATH];
+                snprintf(path, sizeof(path), "%s/%s", g_storage_dir, ent->d_name);
+                if (unlink(path) == 0) deleted++;
+            }
+        }
+        if (dir) closedir(dir);
+    }
+    state_leave();
+    
+    LOGI("Cleared %d records", deleted);
+    return deleted;
+}
+
+/*
+ * Stop background compaction and close the segment log
+ * Waits for calls in flight on other threads to finish
+ */
+void secure_storage_shutdown(void) {
+    // The job takes the state lock itself, so it stops before we wait on it
+    rotation_stop();
+    
+    pthread_rwlock_wrlock(&g_state_lock);
+    if (!g_initialized) {
+        pthread_rwlock_unlock(&g_state_lock);
+        return;
+    }
+    
+    namespaces_close();
+    storage_log_close(g_log);
+    g_log = NULL;
+    storage_cache_configure(storage_cache_default(), 0);
+    storage_names_reset();
+    dedup_reset();
+    storage_dedup_reset();
+    free(g_legacy_ids);
+    g_legacy_ids = NULL;
+    g_legacy_files = 0;
+    secure_buffer_free((uint8_t*)g_keys);
+    g_keys = NULL;
+    secure_buffer_trim();
+    g_has_previous = 0;
+    g_key_wrapped = 0;
+    g_key_epoch = 0;
+    g_initialized = 0;
+    pthread_rwlock_unlock(&g_state_lock);
+    LOGI("Secure storage shut down");
+}
+
+/*
+ * Live/dead byte accounting and compaction throughput
+ */
+void secure_storage_get_metrics(storage_log_metrics_t* metrics) {
+    pthread_rwlock_rdlock(&g_state_lock);
+    if (g_initialized) {
+        storage_log_get_metrics(g_log, metrics);
+    } else {
+        memset(metrics, 0, sizeof(*metrics));
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+}
+
+/*
+ * Sync every append of the main store (default) or leave it to the kernel
+ */
+void secure_storage_set_durability(secure_storage_durability_t durability) {
+    pthread_rwlock_rdlock(&g_state_lock);
+    __atomic_store_n(&g_durability, durability, __ATOMIC_RELAXED);
+    if (g_initialized) {
+        storage_log_set_sync(g_log, durability == SECURE_STORAGE_DURABILITY_SYNC);
+    }
+    pthread_rwlock_unlock(&g_state_lock);
+}
+
+/*
+ * Opt-in plaintext cache; a budget of 0 disables it and wipes all entries
+ */
+void secure_storage_cache_configure(size_t byte_budget) {
+    storage_cache_configure(storage_cache_default(), byte_budget);
+}
+
+/*
+ * Keep a key's plaintext out of the cache (private keys, secrets)
+ * Key ids depend on the master key, so storage must be initialized
+ */
+void secure_storage_cache_exclude(const char* key) {
+    if (!state_enter()) {
+        LOGE("Cannot exclude %s from cache", key);
+        return;
+    }
+    
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    storage_cache_exclude(storage_cache_default(), &key_id);
+    state_leave();
+}
+
+/*
+ * Cache hit/miss counters and occupancy
+ */
+void secure_storage_get_cache_stats(storage_cache_stats_t* stats) {
+    storage_cache_get_stats(storage_cache_default(), stats);
+}
+
+/*
+ * ========================================================================
+ * Scrub
+ * ========================================================================
+ */
+
+/*
+ * A scrub checks the Poly1305 tag of every live record (values, stream
+ * manifests and chunks, name records) on a pool of worker threads.
+ * Records are mapped and their tags recomputed, never decrypted, so no
+ * plaintext exists at any point and memory stays at the id list plus
+ * one mapping per worker. Workers claim SCRUB_BATCH ids at a time and
+ * hold the state lock shared for one batch only, so stores, shutdown
+ * and key rotation are never held up for long; all workers share one
+ * byte budget per second.
+ */
+#define SCRUB_BATCH 32
+#define SCRUB_MAX_WORKERS 8
+
+typedef struct {
+    storage_key_id_t* ids;
+    size_t count;
+    size_t next;                // Next id to claim (atomic)
+    uint8_t* corrupt;           // Per id, written by the worker that claimed it
+    uint64_t io_budget;         // Bytes per second, 0 = unthrottled
+    uint64_t start_us;
+    uint64_t bytes;             // Checked so far (atomic)
+    uint64_t records;           // Checked so far (atomic)
+    int stop;                   // Storage shut down under the scrub (atomic)
+} scrub_ctx_t;
+
+// One corrupt record and the key that owns it
+typedef struct {
+    storage_key_id_t id;
+    const char* key;            // Points into the name list, NULL if unowned
+} scrub_finding_t;
+
+/*
+ * Check one record's tag (caller holds the state lock shared)
+ * Returns 1 if it is intact or gone, 0 if corrupt; *bytes gets its size
+ */
+static int scrub_record(const storage_key_id_t* id, uint64_t* bytes) {
+    storage_log_view_t view;
+    int result = storage_log_map(g_log, id, &view);
+    *bytes = 0;
+    if (result == STORAGE_LOG_NOT_FOUND) {
+        return 1;
+    }
+    if (result != STORAGE_LOG_OK) {
+        return 0;
+    }
+    
+    size_t offset = sealed_offset(view.flags);
+    const unsigned char* key = key_for_epoch(view.key_epoch);
+    int ok = key && view.payload_len >= offset &&
+             chacha20_poly1305_verify(key, view.payload, view.payload + offset,
+                                      view.payload_len - offset,
+                                      view.payload + CHACHA20_NONCE_SIZE);
+    *bytes = view.payload_len;
+    storage_log_unmap(&view);
+    return ok;
+}
+
+static void* scrub_worker(void* arg) {
+    scrub_ctx_t* ctx = arg;
+    
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED)) {
+        size_t first = __atomic_fetch_add(&ctx->next, SCRUB_BATCH, __ATOMIC_RELAXED);
+        if (first >= ctx->count) {
+            break;
+        }
+        size_t last = ctx->count - first < SCRUB_BATCH ? ctx->count : first + SCRUB_BATCH;
+        
+        uint64_t bytes = 0;
+        pthread_rwlock_rdlock(&g_state_lock);
+        int live = g_initialized;
+        for (size_t i = first; live && i < last; i++) {
+            uint64_t record_bytes;
+            if (!scrub_record(&ctx->ids[i], &record_bytes)) {
+                ctx->corrupt[i] = 1;
+            }
+            bytes += record_bytes;
+        }
+        pthread_rwlock_unlock(&g_state_lock);
+        
+        if (!live) {
+            __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        __atomic_fetch_add(&ctx->records, last - first, __ATOMIC_RELAXED);
+        uint64_t total = __atomic_add_fetch(&ctx->bytes, bytes, __ATOMIC_RELAXED);
+        
+        // Shared budget: sleep until the bytes checked so far are due
+        if (ctx->io_budget) {
+            uint64_t due = ctx->start_us + total * 1000000ULL / ctx->io_budget;
+            uint64_t now = now_us();
+            if (due > now) {
+                usleep((useconds_t)(due - now < 1000000 ? due - now : 1000000));
+            }
+        }
+    }
+    return NULL;
+}
+
+static int compare_findings(const void* a, const void* b) {
+    return memcmp(((const scrub_finding_t*)a)->id.bytes, ((const scrub_finding_t*)b)->id.bytes,
+                  STORAGE_KEY_ID_SIZE);
+}
+
+// Attribute a derived record id to key if it is one of the findings
+static void scrub_claim(scrub_finding_t* findings, size_t count,
+                        const storage_key_id_t* id, const char* key) {
+    scrub_finding_t probe = { .id = *id };
+    scrub_finding_t* found = bsearch(&probe, findings, count, sizeof(*findings), compare_findings);
+    if (found) {
+        found->key = key;
+    }
+}
+
+/*
+ * Find the key behind each corrupt record: its value or manifest, its
+ * name record or one of its chunks (caller holds the state lock shared;
+ * findings sorted by id)
+ */
+static void scrub_attribute(scrub_finding_t* findings, size_t count,
+                            char** names, size_t name_count) {
+    for (size_t i = 0; i < name_count; i++) {
+        storage_key_id_t key_id, derived;
+        key_id_for(names[i], &key_id);
+        scrub_claim(findings, count, &key_id, names[i]);
+        name_id_for(&key_id, &derived);
+        scrub_claim(findings, count, &derived, names[i]);
+        
+        stream_manifest_t m;
+        if (!load_manifest(&key_id, &m)) {
+            continue;
+        }
+        if (m.version == STREAM_MANIFEST_DEDUP) {
+            // A shared chunk is reported under one of the keys using it
+            chunk_id_for(&key_id, &m, RECIPE_INDEX, &derived);
+            scrub_claim(findings, count, &derived, names[i]);
+            uint8_t* recipe = load_recipe(&key_id, &m);
+            for (uint32_t c = 0; recipe && c < m.chunk_count; c++) {
+                size_t len;
+                recipe_entry(recipe, c, &derived, &len);
+                scrub_claim(findings, count, &derived, names[i]);
+            }
+            free(recipe);
+        } else {
+            for (uint32_t c = 0; c < m.chunk_count; c++) {
+                chunk_id_for(&key_id, &m, c, &derived);
+                scrub_claim(findings, count, &derived, names[i]);
+            }
+        }
+    }
+}
+
+int secure_storage_scrub(int threads, uint64_t io_budget_bytes,
+                         secure_storage_corrupt_visitor_t on_corrupt, void* visit_ctx,
+                         secure_storage_scrub_stats_t* stats) {
+    secure_storage_scrub_stats_t local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+    
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (int)cpus;
+    }
+    if (threads > SCRUB_MAX_WORKERS) threads = SCRUB_MAX_WORKERS;
+    
+    scrub_ctx_t ctx = { .io_budget = io_budget_bytes, .start_us = now_us() };
+    if (!state_enter()) {
+        return -1;
+    }
+    int listed = storage_log_list(g_log, 0, &ctx.ids, &ctx.count) == STORAGE_LOG_OK;
+    state_leave();
+    
+    ctx.corrupt = listed ? calloc(ctx.count + 1, 1) : NULL;
+    if (!ctx.corrupt) {
+        free(ctx.ids);
+        LOGE("Failed to start scrub");
+        return -1;
+    }
+    
+    pthread_t workers[SCRUB_MAX_WORKERS];
+    int started = 0;
+    while (started < threads &&
+           pthread_create(&workers[started], NULL, scrub_worker, &ctx) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        scrub_worker(&ctx);   // No threads to spare: scrub on the caller
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    
+    size_t corrupt_count = 0;
+    for (size_t i = 0; i < ctx.count; i++) {
+        corrupt_count += ctx.corrupt[i];
+    }
+    
+    // Name the keys hit, then report with no lock held (like scan visitors)
+    scrub_finding_t* findings = NULL;
+    char** names = NULL;
+    size_t name_count = 0;
+    int ok = !ctx.stop;
+    if (ok && corrupt_count > 0) {
+        findings = malloc(corrupt_count * sizeof(*findings));
+        ok = findings != NULL;
+        for (size_t i = 0, n = 0; ok && i < ctx.count; i++) {
+            if (ctx.corrupt[i]) {
+                findings[n].id = ctx.ids[i];
+                findings[n].key = NULL;
+                n++;
+            }
+        }
+        if (ok) {
+            qsort(findings, corrupt_count, sizeof(*findings), compare_findings);
+            ok = state_enter();
+        }
+        if (ok) {
+            names = list_names(NULL, NULL, NULL, &name_count);
+            if (names) {
+                scrub_attribute(findings, corrupt_count, names, name_count);
+            }
+            state_leave();
+        }
+        for (size_t i = 0; ok && on_corrupt && i < corrupt_count; i++) {
+            on_corrupt(findings[i].key, &findings[i].id, visit_ctx);
+        }
+    }
+    
+    stats->records_checked = ctx.records;
+    stats->records_corrupt = corrupt_count;
+    stats->bytes_checked = ctx.bytes;
+    stats->elapsed_us = now_us() - ctx.start_us;
+    if (stats->elapsed_us > 0) {
+        stats->throughput_mb_s = (float)((double)stats->bytes_checked /
+                                         ((double)stats->elapsed_us / 1e6) / (1024.0 * 1024.0));
+    }
+    
+    if (names) {
+        storage_names_free_list(names, name_count);
+    }
+    free(findings);
+    free(ctx.corrupt);
+    free(ctx.ids);
+    
+    if (!ok) {
+        LOGE("Scrub did not complete");
+        return -1;
+    }
+    if (corrupt_count > 0) {
+        LOGW("Scrub found %zu corrupt records out of %llu", corrupt_count,
+             (unsigned long long)stats->records_checked);
+    }
+    LOGI("Scrubbed %llu records (%llu bytes) in %.1f ms, %.1f MB/s on %d threads",
+         (unsigned long long)stats->records_checked, (unsigned long long)stats->bytes_checked,
+         (double)stats->elapsed_us / 1000.0, (double)stats->throughput_mb_s, started ? started : 1);
+    return (int)corrupt_count;
+}
+
+/*
+ * ========================================================================
+ * Streaming API for large values
+ * ========================================================================
+ */
+
+/*
+ * Encrypt and append the buffered chunk
+ */
+static int flush_chunk(secure_storage_writer_t* writer) {
+    stream_manifest_t* m = &writer->manifest;
+    if (m->chunk_count == UINT32_MAX) {
+        LOGE("Stream too long");
+        return 0;
+    }
+    
+    uint32_t index = m->chunk_count;
+    unsigned char* nonce = writer->payload;
+    unsigned char* tag = writer->payload + CHACHA20_NONCE_SIZE;
+    chunk_nonce(m, index, nonce);
+    
+    // Compressed chunks carry the chunk length like compressed values
+    uint16_t flags = STORAGE_LOG_FLAG_CHUNK;
+    const unsigned char* plaintext = writer->chunk;
+    size_t plaintext_len = writer->chunk_fill;
+    size_t header_len = 0;
+    if (compress_wanted(writer->chunk_fill)) {
+        if (!writer->packed) {
+            writer->packed = malloc(compress_budget(writer->manifest.chunk_size));
+        }
+        size_t packed_len = writer->packed ?
+                            compress_value(writer->chunk, writer->chunk_fill, writer->packed) : 0;
+        if (packed_len > 0) {
+            put_le32(writer->payload + PAYLOAD_OVERHEAD, (uint32_t)writer->chunk_fill);
+            flags |= STORAGE_LOG_FLAG_COMPRESSED;
+            plaintext = writer->packed;
+            plaintext_len = packed_len;
+            header_len = COMPRESS_HEADER_SIZE;
+        }
+    }
+    
+    if (!chacha20_poly1305_encrypt(g_keys->encryption_key, nonce, plaintext, plaintext_len,
+                                   writer->payload + PAYLOAD_OVERHEAD + header_len, tag)) {
+        LOGE("Failed to encrypt chunk %u", index);
+        return 0;
+    }
+    
+    storage_key_id_t chunk_id;
+    chunk_id_for(&writer->key_id, m, index, &chunk_id);
+    if (storage_log_put_flags(g_log, &chunk_id, flags, writer->payload,
+                              PAYLOAD_OVERHEAD + header_len + plaintext_len) != STORAGE_LOG_OK) {
+        LOGE("Failed to append chunk %u", index);
+        return 0;
+    }
+    
+    m->chunk_count++;
+    m->total_len += writer->chunk_fill;
+    writer->chunk_fill = 0;
+    return 1;
+}
+
+static void free_writer(secure_storage_writer_t* writer) {
+    if (writer->chunk) {
+        secure_buffer_wipe(writer->chunk, writer->manifest.chunk_size);
+        free(writer->chunk);
+    }
+    if (writer->packed) {
+        secure_buffer_wipe(writer->packed, compress_budget(writer->manifest.chunk_size));
+        free(writer->packed);
+    }
+    free(writer->payload);
+    free(writer->key);
+    memset(writer, 0, sizeof(*writer));
+    free(writer);
+}
+
+static secure_storage_writer_t* writer_open(const char* key, size_t chunk_size) {
+    if (chunk_size == 0) {
+        chunk_size = SECURE_STORAGE_CHUNK_DEFAULT;
+    }
+    if (chunk_size > STREAM_CHUNK_MAX) {
+        LOGE("Chunk size too large: %zu (max %d)", chunk_size, STREAM_CHUNK_MAX);
+        return NULL;
+    }
+    
+    secure_storage_writer_t* writer = calloc(1, sizeof(secure_storage_writer_t));
+    if (!writer) {
+        return NULL;
+    }
+    
+    key_id_for(key, &writer->key_id);
+    writer->key = strdup(key);
+    writer->manifest.version = STREAM_MANIFEST_VERSION;
+    writer->manifest.chunk_size = (uint32_t)chunk_size;
+    writer->chunk = malloc(chunk_size);
+    writer->payload = malloc(PAYLOAD_OVERHEAD + COMPRESS_HEADER_SIZE + chunk_size);
+    
+    // A fresh stream id keeps the old value readable until close commits
+    if (!writer->key || !writer->chunk || !writer->payload ||
+        !sovereign_random_bytes(writer->manifest.stream_id, STREAM_ID_SIZE) ||
+        !sovereign_random_bytes(writer->manifest.nonce_prefix, STREAM_NONCE_PREFIX_SIZE)) {
+        LOGE("Failed to open writer for %s", key);
+        free_writer(writer);
+        return NULL;
+    }
+    
+    return writer;
+}
+
+secure_storage_writer_t* secure_storage_open_writer(const char* key, size_t chunk_size) {
+    if (!state_enter()) {
+        return NULL;
+    }
+    secure_storage_writer_t* writer = writer_open(key, chunk_size);
+    state_leave();
+    return writer;
+}
+
+static int writer_write(secure_storage_writer_t* writer, const uint8_t* data, size_t data_len) {
+    size_t chunk_size = writer->manifest.chunk_size;
+    
+    while (data_len > 0) {
+        size_t n = chunk_size - writer->chunk_fill;
+        if (n > data_len) n = data_len;
+        
+        memcpy(writer->chunk + writer->chunk_fill, data, n);
+        writer->chunk_fill += n;
+        data += n;
+        data_len -= n;
+        
+        if (writer->chunk_fill == chunk_size && !flush_chunk(writer)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int secure_storage_write(secure_storage_writer_t* writer, const uint8_t* data, size_t data_len) {
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = writer_write(writer, data, data_len);
+    state_leave();
+    return result;
+}
+
+static int writer_close(secure_storage_writer_t* writer) {
+    stream_manifest_t* m = &writer->manifest;
+    
+    if (writer->chunk_fill > 0 && !flush_chunk(writer)) {
+        writer_abort(writer);
+        return -1;
+    }
+    
+    uint8_t raw[STREAM_MANIFEST_SIZE];
+    unsigned char* payload;
+    size_t payload_len;
+    encode_manifest(m, raw);
+    
+    if (!seal_value(raw, sizeof(raw), &payload, &payload_len)) {
+        writer_abort(writer);
+        return -1;
+    }
+    
+    // The manifest append is the commit point
+    stream_manifest_t previous;
+    int replaces_stream = load_manifest(&writer->key_id, &previous);
+    if (!record_name(writer->key, &writer->key_id)) {
+        free(payload);
+        writer_abort(writer);
+        return -1;
+    }
+    int result = storage_log_put_flags(g_log, &writer->key_id, STORAGE_LOG_FLAG_STREAM,
+                                       payload, payload_len);
+    storage_cache_invalidate(storage_cache_default(), &writer->key_id);
+    free(payload);
+    
+    if (result != STORAGE_LOG_OK) {
+        LOGE("Failed to commit stream manifest");
+        writer_abort(writer);
+        return -1;
+    }
+    
+    if (replaces_stream) {
+        release_chunks(&writer->key_id, &previous, previous.chunk_count);
+    }
+    
+    LOGI("Stored stream: %llu bytes in %u chunks of %u",
+         (unsigned long long)m->total_len, m->chunk_count, m->chunk_size);
+    free_writer(writer);
+    return 0;
+}
+
+int secure_storage_close_writer(secure_storage_writer_t* writer) {
+    if (!state_enter()) {
+        free_writer(writer);
+        return -1;
+    }
+    int result = writer_close(writer);
+    state_leave();
+    return result;
+}
+
+static void writer_abort(secure_storage_writer_t* writer) {
+    release_chunks(&writer->key_id, &writer->manifest, writer->manifest.chunk_count);
+    free_writer(writer);
+}
+
+void secure_storage_abort_writer(secure_storage_writer_t* writer) {
+    if (!state_enter()) {
+        free_writer(writer);
+        return;
+    }
+    writer_abort(writer);
+    state_leave();
+}
+
+/*
+ * Decrypt shared chunk index of a deduplicated value; it must match the
+ * length and digest its recipe lists
+ */
+static int load_shared_chunk(secure_storage_reader_t* reader, uint32_t index) {
+    storage_key_id_t chunk_id, digest;
+    size_t expected;
+    recipe_entry(reader->recipe, index, &chunk_id, &expected);
+    
+    storage_log_view_t view;
+    if (storage_log_map(g_log, &chunk_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Shared chunk %u missing", index);
+        return 0;
+    }
+    
+    size_t value_len;
+    int ok = view.payload_len >= PAYLOAD_OVERHEAD &&
+             view_value_len(&view, &value_len) && value_len == expected &&
+             open_view(&view, reader->chunk, expected);
+    storage_log_unmap(&view);
+    
+    if (ok) {
+        storage_dedup_digest(reader->chunk, expected, &digest);
+        ok = memcmp(digest.bytes, chunk_id.bytes, STORAGE_KEY_ID_SIZE) == 0;
+    }
+    if (!ok) {
+        LOGE("Shared chunk %u failed authentication", index);
+        reader->chunk_index = UINT32_MAX;
+        return 0;
+    }
+    
+    reader->chunk_index = index;
+    reader->chunk_len = expected;
+    return 1;
+}
+
+/*
+ * Decrypt chunk index into the reader's chunk buffer
+ */
+static int load_chunk(secure_storage_reader_t* reader, uint32_t index) {
+    const stream_manifest_t* m = &reader->manifest;
+    if (m->version == STREAM_MANIFEST_DEDUP) {
+        return load_shared_chunk(reader, index);
+    }
+    size_t expected = chunk_length(m, index);
+    
+    storage_key_id_t chunk_id;
+    chunk_id_for(&reader->key_id, m, index, &chunk_id);
+    
+    storage_log_view_t view;
+    if (storage_log_map(g_log, &chunk_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Stream chunk %u missing", index);
+        return 0;
+    }
+    
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+    chunk_nonce(m, index, nonce);
+    
+    size_t value_len;
+    int ok = view.payload_len >= PAYLOAD_OVERHEAD &&
+             view_value_len(&view, &value_len) && value_len == expected &&
+             memcmp(view.payload, nonce, CHACHA20_NONCE_SIZE) == 0 &&
+             open_payload(key_for_epoch(view.key_epoch), view.payload, view.payload_len,
+                          (view.flags & STORAGE_LOG_FLAG_COMPRESSED) != 0, nonce,
+                          reader->chunk, expected);
+    storage_log_unmap(&view);
+    
+    if (!ok) {
+        LOGE("Stream chunk %u failed authentication", index);
+        reader->chunk_index = UINT32_MAX;
+        return 0;
+    }
+    
+    reader->chunk_index = index;
+    reader->chunk_len = expected;
+    return 1;
+}
+
+static secure_storage_reader_t* reader_open(const char* key) {
+    secure_storage_reader_t* reader = calloc(1, sizeof(secure_storage_reader_t));
+    if (!reader) {
+        return NULL;
+    }
+    key_id_for(key, &reader->key_id);
+    reader->chunk_index = UINT32_MAX;
+    
+    if (load_manifest(&reader->key_id, &reader->manifest)) {
+        const stream_manifest_t* m = &reader->manifest;
+        if (m->version == STREAM_MANIFEST_DEDUP) {
+            reader->recipe = load_recipe(&reader->key_id, m);
+            reader->offsets = malloc(((size_t)m->chunk_count + 1) * sizeof(uint64_t));
+            if (!reader->recipe || !reader->offsets) {
+                free(reader->recipe);
+                free(reader->offsets);
+                free(reader);
+                return NULL;
+            }
+            
+            uint64_t offset = 0;
+            for (uint32_t i = 0; i < m->chunk_count; i++) {
+                storage_key_id_t id;
+                size_t len;
+                recipe_entry(reader->recipe, i, &id, &len);
+                reader->offsets[i] = offset;
+                offset += len;
+            }
+            reader->offsets[m->chunk_count] = offset;
+        }
+        
+        reader->chunk = malloc(m->chunk_size);
+        if (!reader->chunk) {
+            free(reader->recipe);
+            free(reader->offsets);
+            free(reader);
+            return NULL;
+        }
+        return reader;
+    }
+    
+    // Regular values are decrypted whole and served as one chunk
+    storage_log_view_t view;
+    if (map_payload(key, &reader->key_id, &view) != STORAGE_LOG_OK) {
+        LOGE("Record not found: %s", key);
+        free(reader);
+        return NULL;
+    }
+    
+    size_t value_len = 0;
+    reader->plain = 1;
+    reader->chunk = view_value_len(&view, &value_len) ? malloc(value_len ? value_len : 1) : NULL;
+    
+    int decrypted = reader->chunk && open_view(&view, reader->chunk, value_len);
+    storage_log_unmap(&view);
+    
+    if (!decrypted) {
+        free(reader->chunk);
+        free(reader);
+        return NULL;
+    }
+    
+    reader->manifest.chunk_size = (uint32_t)(value_len ? value_len : 1);
+    reader->manifest.chunk_count = value_len ? 1 : 0;
+    reader->manifest.total_len = value_len;
+    reader->chunk_index = 0;
+    reader->chunk_len = value_len;
+    return reader;
+}
+
+secure_storage_reader_t* secure_storage_open_reader(const char* key) {
+    if (!state_enter()) {
+        return NULL;
+    }
+    secure_storage_reader_t* reader = reader_open(key);
+    state_leave();
+    return reader;
+}
+
+uint64_t secure_storage_reader_size(const secure_storage_reader_t* reader) {
+    return reader->manifest.total_len;
+}
+
+/*
+ * Chunk holding position (< total_len) and where that chunk starts
+ */
+static uint32_t chunk_at(const secure_storage_reader_t* reader, uint64_t position,
+                         uint64_t* start) {
+    const stream_manifest_t* m = &reader->manifest;
+    if (!reader->offsets) {
+        uint32_t index = (uint32_t)(position / m->chunk_size);
+        *start = (uint64_t)index * m->chunk_size;
+        return index;
+    }
+    
+    // Content-defined chunks: last one starting at or before position
+    uint32_t lo = 0, hi = m->chunk_count - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (reader->offsets[mid] <= position) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *start = reader->offsets[lo];
+    return lo;
+}
+
+static int reader_read(secure_storage_reader_t* reader, uint8_t* data, size_t data_len,
+                       size_t* read_len) {
+    const stream_manifest_t* m = &reader->manifest;
+    *read_len = 0;
+    
+    while (data_len > 0 && reader->position < m->total_len) {
+        uint64_t start;
+        uint32_t index = chunk_at(reader, reader->position, &start);
+        if (index != reader->chunk_index && !load_chunk(reader, index)) {
+            return -1;
+        }
+        
+        size_t offset = (size_t)(reader->position - start);
+        size_t n = reader->chunk_len - offset;
+        if (n > data_len) n = data_len;
+        
+        memcpy(data, reader->chunk + offset, n);
+        data += n;
+        data_len -= n;
+        *read_len += n;
+        reader->position += n;
+    }
+    return 0;
+}
+
+int secure_storage_read(secure_storage_reader_t* reader, uint8_t* data, size_t data_len,
+                        size_t* read_len) {
+    *read_len = 0;
+    if (!state_enter()) {
+        return -1;
+    }
+    int result = reader_read(reader, data, data_len, read_len);
+    state_leave();
+    return result;
+}
+
+int secure_storage_seek(secure_storage_reader_t* reader, uint64_t offset) {
+    if (offset > reader->manifest.total_len) {
+        LOGE("Seek past end of stream (%llu > %llu)", (unsigned long long)offset,
+             (unsigned long long)reader->manifest.total_len);
+        return -1;
+    }
+    reader->position = offset;
+    return 0;
+}
+
+void secure_storage_close_reader(secure_storage_reader_t* reader) {
+    if (reader->chunk) {
+        secure_buffer_wipe(reader->chunk, reader->manifest.chunk_size);
+        free(reader->chunk);
+    }
+    free(reader->recipe);
+    free(reader->offsets);
+    memset(reader, 0, sizeof(*reader));
+    free(reader);
+}
+
+/*
+ * ========================================================================
+ * JNI API for Kotlin/Java
+ * ========================================================================
+ */
+
+// java/lang/String global ref for listKeys, set by secure_storage_register_natives
+static jclass g_string_class;
+
+/*
+ * Initialize secure storage subsystem
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_initialize(JNIEnv* env, jobject thiz) {
+    return secure_storage_initialize() ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Store encrypted key-value pair
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeSecure(JNIEnv* env, jobject thiz, jstring key, jstring value) {
+    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char* value_str = (*env)->GetStringUTFChars(env, value, NULL);
+    
+    if (!key_str || !value_str) {
+        LOGE("Failed to get string data");
+        if (key_str) (*env)->ReleaseStringUTFChars(env, key, key_str);
+        if (value_str) (*env)->ReleaseStringUTFChars(env, value, value_str);
+        return JNI_FALSE;
+    }
+    
+    int result = secure_storage_store(key_str, (const uint8_t*)value_str, strlen(value_str));
+    
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    (*env)->ReleaseStringUTFChars(env, value, value_str);
+    
+    return (result == 0) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Decrypt a value into a Java string (caller holds the state lock)
+ */
+static jstring retrieve_string(JNIEnv* env, const char* key_str) {
+    // Serve hot keys from the plaintext cache
+    storage_key_id_t key_id;
+    key_id_for(key_str, &key_id);
+    size_t cached_len;
+    unsigned char* cached = storage_cache_get_copy(storage_cache_default(), &key_id, &cached_len);
+    
+    if (cached) {
+        jstring result = (*env)->NewStringUTF(env, (const char*)cached);
+        
+        secure_buffer_free(cached);
+        return result;
+    }
+    
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_STREAM)) {
+        LOGW("Value for %s is streamed, not returned as a string", key_str);
+        return NULL;
+    }
+    
+    // Map encrypted record in place: NONCE + TAG + CIPHERTEXT
+    uint64_t fill_token = storage_cache_fill_token(storage_cache_default());
+    storage_log_view_t view;
+    
+    if (map_payload(key_str, &key_id, &view) != STORAGE_LOG_OK) {
+        LOGW("Record not found: %s", key_str);
+        return NULL;
+    }
+    
+    size_t plaintext_len = 0;
+    unsigned char* plaintext = view_value_len(&view, &plaintext_len)
+                               ? secure_buffer_alloc(plaintext_len + 1) : NULL; // +1 for null terminator
+    
+    // Decrypt data
+    int decrypted = plaintext && open_view(&view, plaintext, plaintext_len);
+    storage_log_unmap(&view);
+    
+    if (!decrypted) {
+        LOGE("Decryption failed for key: %s", key_str);
+        secure_buffer_free(plaintext);
+        return NULL;
+    }
+    
+    storage_cache_put(storage_cache_default(), &key_id, plaintext, plaintext_len, fill_token);
+    
+    // Null-terminate plaintext
+    plaintext[plaintext_len] = '\0';
+    
+    // Create Java string
+    jstring result = (*env)->NewStringUTF(env, (const char*)plaintext);
+    
+    secure_buffer_free(plaintext);
+    return result;
+}
+
+/*
+ * Retrieve and decrypt value for key
+ */
+SOVEREIGN_JNI_EXPORT jstring JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveSecure(JNIEnv* env, jobject thiz, jstring key) {
+    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    if (!key_str) {
+        LOGE("Failed to get key string");
+        return NULL;
+    }
+    
+    jstring result = NULL;
+    if (state_enter()) {
+        result = retrieve_string(env, key_str);
+        state_leave();
+    }
+    
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    return result;
+}
+
+/*
+ * Binary values: byte[] and direct ByteBuffer, no UTF conversion of the
+ * value and no intermediate plaintext or ciphertext copies. Keys are
+ * still modified UTF-8, converted the same way as GetStringUTFChars.
+ */
+
+// Keys shorter than this are converted into a stack buffer
+#define JNI_KEY_STACK_SIZE 256
+
+typedef struct {
+    char stack[JNI_KEY_STACK_SIZE];
+    const char* chars;
+    jstring string;             // Set when chars came from GetStringUTFChars
+} jni_key_t;
+
+static const char* jni_key_get(JNIEnv* env, jstring key, jni_key_t* k) {
+    k->chars = NULL;
+    k->string = NULL;
+    if (!key) {
+        return NULL;
+    }
+    
+    jsize utf_len = (*env)->GetStringUTFLength(env, key);
+    if (utf_len < JNI_KEY_STACK_SIZE) {
+        (*env)->GetStringUTFRegion(env, key, 0, (*env)->GetStringLength(env, key), k->stack);
+        k->stack[utf_len] = '\0';
+        k->chars = k->stack;
+    } else {
+        k->chars = (*env)->GetStringUTFChars(env, key, NULL);
+        k->string = k->chars ? key : NULL;
+    }
+    return k->chars;
+}
+
+static void jni_key_release(JNIEnv* env, jni_key_t* k) {
+    if (k->string) {
+        (*env)->ReleaseStringUTFChars(env, k->string, k->chars);
+    }
+}
+
+/*
+ * Store a byte[] value
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeBytes(JNIEnv* env, jobject thiz, jstring key, jbyteArray value) {
+    jni_key_t k;
+    if (!value || !jni_key_get(env, key, &k)) {
+        return JNI_FALSE;
     }
     
-    // Write to file: [nonce][tag][ciphertext]
-    FILE* file = fopen(filename, "wb");
-    if (!file) {
-        LOGE("Failed to open file for writing: %s", filename);
-        return -1;
+    if (!state_enter()) {
+        jni_key_release(env, &k);
+        return JNI_FALSE;
     }
     
-    fwrite(nonce, 1, CHACHA20_NONCE_SIZE, file);
-    fwrite(tag, 1, POLY1305_TAG_SIZE, file);
-    size_t written = fwrite(encrypted_data, 1, encrypted_len, file);
-    fclose(file);
-    
-    if (written != encrypted_len) {
-        LOGE("Failed to write all data");
-        return -1;
+    int result = -1;
+    size_t len = (size_t)(*env)->GetArrayLength(env, value);
+    if (dedup_wanted(len)) {
+        // Chunking appends in several batches; work on a copy, not the array
+        uint8_t* copy = malloc(len);
+        if (copy) {
+            (*env)->GetByteArrayRegion(env, value, 0, (jsize)len, (jbyte*)copy);
+            result = store_dedup(k.chars, copy, len);
+            secure_buffer_wipe(copy, len);
+            free(copy);
+        }
+    } else {
+        // Seal straight out of the array; the append (and its fsync) runs
+        // after releasing it so the GC is not held up by disk I/O
+        unsigned char* payload;
+        size_t payload_len;
+        uint16_t flags;
+        void* data = (*env)->GetPrimitiveArrayCritical(env, value, NULL);
+        int sealed = data && seal_record(data, len, &payload, &payload_len, &flags);
+        if (data) {
+            (*env)->ReleasePrimitiveArrayCritical(env, value, data, JNI_ABORT);
+        }
+        
+        if (sealed) {
+            result = store_payload(k.chars, payload, payload_len, flags);
+        }
     }
+    state_leave();
     
-    size_t total_size = CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE + encrypted_len;
-    LOGI("Stored encrypted file: %s (%zu bytes)", filename, total_size);
-    return 0;
+    jni_key_release(env, &k);
+    return (result == 0) ? JNI_TRUE : JNI_FALSE;
 }
 
-int secure_storage_retrieve(const char* key, uint8_t* data, size_t data_len) {
-    if (!g_initialized) {
-        LOGE("Storage not initialized");
-        return -1;
+/*
+ * Read a streamed value into a new byte[] one chunk at a time: each is
+ * decrypted into a native buffer and copied in with SetByteArrayRegion,
+ * so no critical section spans the reads and decryption (caller holds
+ * the state lock)
+ */
+static jbyteArray retrieve_stream_bytes(JNIEnv* env, const char* key) {
+    secure_storage_reader_t* reader = reader_open(key);
+    if (!reader) {
+        return NULL;
     }
     
-    // Create encrypted filename
-    unsigned char hash[32];
-    simple_hash(key, hash);
-    char filename[256];
-    snprintf(filename, sizeof(filename), "%s/%08x.enc", STORAGE_DIR, *(uint32_t*)hash);
+    uint64_t size = secure_storage_reader_size(reader);
+    size_t chunk_size = reader->manifest.chunk_size;
+    jbyteArray array = (size <= INT32_MAX) ? (*env)->NewByteArray(env, (jsize)size) : NULL;
+    uint8_t* chunk = (array && size > 0) ? secure_buffer_alloc(chunk_size) : NULL;
+    int ok = array && (size == 0 || chunk);
     
-    // Read file
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        LOGE("File not found: %s", filename);
-        return -1;
+    for (uint64_t done = 0; ok && done < size; ) {
+        size_t want = (size - done < chunk_size) ? (size_t)(size - done) : chunk_size;
+        size_t read_len = 0;
+        ok = reader_read(reader, chunk, want, &read_len) == 0 && read_len == want;
+        if (ok) {
+            (*env)->SetByteArrayRegion(env, array, (jsize)done, (jsize)want, (const jbyte*)chunk);
+        }
+        done += read_len;
     }
     
-    // Read nonce and tag
-    unsigned char nonce[CHACHA20_NONCE_SIZE];
-    unsigned char tag[POLY1305_TAG_SIZE];
-    fread(nonce, 1, CHACHA20_NONCE_SIZE, file);
-    fread(tag, 1, POLY1305_TAG_SIZE, file);
+    secure_buffer_free(chunk);
+    secure_storage_close_reader(reader);
+    if (!ok && array) {
+        (*env)->DeleteLocalRef(env, array);
+        array = NULL;
+    }
+    return array;
+}
+
+/*
+ * Decrypt a value into a new byte[] (caller holds the state lock)
+ */
+static jbyteArray retrieve_bytes(JNIEnv* env, const char* key) {
+    storage_key_id_t key_id;
+    key_id_for(key, &key_id);
+    size_t cached_len;
+    unsigned char* cached = storage_cache_get_copy(storage_cache_default(), &key_id, &cached_len);
     
-    // Read ciphertext
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file) - CHACHA20_NONCE_SIZE - POLY1305_TAG_SIZE;
-    fseek(file, CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE, SEEK_SET);
+    if (cached) {
+        jbyteArray array = (cached_len <= INT32_MAX)
+                           ? (*env)->NewByteArray(env, (jsize)cached_len) : NULL;
+        if (array) {
+            (*env)->SetByteArrayRegion(env, array, 0, (jsize)cached_len, (const jbyte*)cached);
+        }
+        secure_buffer_free(cached);
+        return array;
+    }
     
-    unsigned char* encrypted_data = (unsigned char*)malloc(file_size);
-    if (!encrypted_data) {
-        fclose(file);
-        return -1;
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_STREAM)) {
+        return retrieve_stream_bytes(env, key);
     }
     
-    fread(encrypted_data, 1, file_size, file);
-    fclose(file);
+    uint64_t fill_token = storage_cache_fill_token(storage_cache_default());
+    storage_log_view_t view;
     
-    // Decrypt
-    size_t decrypted_len = data_len;
-    int result = decrypt_data(encrypted_data, file_size, nonce, tag, data, &decrypted_len);
+    if (map_payload(key, &key_id, &view) != STORAGE_LOG_OK) {
+        LOGW("Record not found: %s", key);
+        return NULL;
+    }
     
-    free(encrypted_data);
+    // Size the array from the mapped record, then decrypt into it
+    size_t plaintext_len = 0;
+    jbyteArray array = (view_value_len(&view, &plaintext_len) && plaintext_len <= INT32_MAX)
+                       ? (*env)->NewByteArray(env, (jsize)plaintext_len) : NULL;
+    int decrypted = 0;
     
-    if (!result) {
-        LOGE("Decryption failed");
-        return -1;
+    if (array && storage_cache_cacheable(storage_cache_default(), &key_id)) {
+        // Fill the cache from native plaintext: the cache lock is never
+        // taken inside a critical region
+        uint8_t* plaintext = secure_buffer_alloc(plaintext_len);
+        decrypted = plaintext && open_view(&view, plaintext, plaintext_len);
+        if (decrypted) {
+            storage_cache_put(storage_cache_default(), &key_id, plaintext, plaintext_len,
+                              fill_token);
+            (*env)->SetByteArrayRegion(env, array, 0, (jsize)plaintext_len,
+                                       (const jbyte*)plaintext);
+        }
+        secure_buffer_free(plaintext);
+    } else if (array) {
+        // Not cached: decrypt straight into the Java array
+        uint8_t* out = (*env)->GetPrimitiveArrayCritical(env, array, NULL);
+        decrypted = out && open_view(&view, out, plaintext_len);
+        if (out) {
+            (*env)->ReleasePrimitiveArrayCritical(env, array, out, 0);
+        }
     }
+    storage_log_unmap(&view);
     
-    return 0;
+    if (!decrypted) {
+        LOGE("Decryption failed for key: %s", key);
+        if (array) (*env)->DeleteLocalRef(env, array);
+        return NULL;
+    }
+    return array;
 }
 
-int secure_storage_delete(const char* key) {
-    unsigned char hash[32];
-    simple_hash(key, hash);
-    char filename[256];
-    snprintf(filename, sizeof(filename), "%s/%08x.enc", STORAGE_DIR, *(uint32_t*)hash);
+/*
+ * Retrieve a value as byte[]; NULL if missing or unreadable
+ */
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveBytes(JNIEnv* env, jobject thiz, jstring key) {
+    jni_key_t k;
+    if (!jni_key_get(env, key, &k)) {
+        return NULL;
+    }
     
-    if (remove(filename) != 0) {
-        LOGE("Failed to delete file: %s", filename);
-        return -1;
+    jbyteArray result = NULL;
+    if (state_enter()) {
+        result = retrieve_bytes(env, k.chars);
+        state_leave();
     }
     
-    LOGI("Deleted file: %s", filename);
-    return 0;
+    jni_key_release(env, &k);
+    return result;
 }
 
 /*
- * ========================================================================
- * JNI API for Kotlin/Java
- * ========================================================================
+ * Store the first length bytes of a direct ByteBuffer (position and limit
+ * are ignored; pass a slice to store from elsewhere)
  */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeBuffer(JNIEnv* env, jobject thiz, jstring key,
+                                                      jobject buffer, jint length) {
+    uint8_t* data = buffer ? (*env)->GetDirectBufferAddress(env, buffer) : NULL;
+    jlong capacity = data ? (*env)->GetDirectBufferCapacity(env, buffer) : -1;
+    if (!data || length < 0 || length > capacity) {
+        LOGE("storeBuffer needs a direct ByteBuffer of at least length bytes");
+        return JNI_FALSE;
+    }
+    
+    jni_key_t k;
+    if (!jni_key_get(env, key, &k)) {
+        return JNI_FALSE;
+    }
+    
+    int result = secure_storage_store(k.chars, data, (size_t)length);
+    jni_key_release(env, &k);
+    return (result == 0) ? JNI_TRUE : JNI_FALSE;
+}
 
 /*
- * Load or generate persistent master key
+ * Decrypt a value into the start of a direct ByteBuffer.
+ * Returns the value length; if that exceeds the capacity nothing is
+ * written and the caller retries with a larger buffer. -1 on failure.
  */
-static int load_or_create_master_key() {
-    FILE* key_file = fopen(KEY_FILE, "rb");
-    
-    if (key_file) {
-        // Load existing key
-        size_t read = fread(g_encryption_key, 1, CHACHA20_KEY_SIZE, key_file);
-        fclose(key_file);
-        
-        if (read == CHACHA20_KEY_SIZE) {
-            LOGI("Loaded persistent master key");
-            return 1;
-        }
-        
-        LOGW("Corrupted key file, regenerating");
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveBuffer(JNIEnv* env, jobject thiz, jstring key,
+                                                         jobject buffer) {
+    uint8_t* data = buffer ? (*env)->GetDirectBufferAddress(env, buffer) : NULL;
+    jlong capacity = data ? (*env)->GetDirectBufferCapacity(env, buffer) : -1;
+    if (!data || capacity < 0) {
+        LOGE("retrieveBuffer needs a direct ByteBuffer");
+        return -1;
     }
     
-    // Generate new key
-    if (!sovereign_random_bytes(g_encryption_key, CHACHA20_KEY_SIZE)) {
-        LOGE("Failed to generate encryption key");
-        return 0;
+    jni_key_t k;
+    if (!jni_key_get(env, key, &k)) {
+        return -1;
     }
     
-    // Save key to file
-    key_file = fopen(KEY_FILE, "wb");
-    if (!key_file) {
-        LOGE("Failed to create key file");
-        return 0;
+    size_t value_len = 0;
+    int result = -1;
+    if (state_enter()) {
+        result = retrieve_value(k.chars, data, (size_t)capacity, &value_len);
+        state_leave();
     }
+    jni_key_release(env, &k);
     
-    fwrite(g_encryption_key, 1, CHACHA20_KEY_SIZE, key_file);
-    fclose(key_file);
-    chmod(KEY_FILE, 0600);  // Restrict to owner only
-    
-    LOGI("Generated and saved new master key");
+    if (result != 0 && value_len <= (size_t)capacity) {
+        return -1;
+    }
+    return (value_len <= INT32_MAX) ? (jint)value_len : -1;
+}
+
+/*
+ * Batched bindings: many items in one packed array per call, so bulk
+ * work pays for one JNI transition. Packed layouts, little-endian:
+ *   keys:   [count u32] then per key [length u16][key]
+ *   items:  [count u32] then per item [key length u16][key][value length u32][value]
+ *   values: [count u32] then per key [length i32, -1 if missing][value]
+ * Keys are UTF-8 without NUL; for text inside the BMP that is exactly the
+ * modified UTF-8 the String bindings hash, so both reach the same value.
+ */
+
+typedef struct {
+    const uint8_t* p;
+    size_t left;
+} packed_reader_t;
+
+static int packed_u16(packed_reader_t* r, uint32_t* v) {
+    if (r->left < 2) return 0;
+    *v = (uint32_t)r->p[0] | ((uint32_t)r->p[1] << 8);
+    r->p += 2;
+    r->left -= 2;
+    return 1;
+}
+
+static int packed_u32(packed_reader_t* r, uint32_t* v) {
+    if (r->left < 4) return 0;
+    *v = get_le32(r->p);
+    r->p += 4;
+    r->left -= 4;
     return 1;
 }
 
+static const uint8_t* packed_bytes(packed_reader_t* r, size_t len) {
+    if (r->left < len) return NULL;
+    const uint8_t* p = r->p;
+    r->p += len;
+    r->left -= len;
+    return p;
+}
+
 /*
- * Initialize secure storage subsystem
+ * Copy one key into the arena as a C string
+ * Returns the key, NULL if malformed
  */
-JNIEXPORT jboolean JNICALL
-Java_com_sovereigndroid_core_SecureStorage_initialize(JNIEnv* env, jobject thiz) {
-    if (g_initialized) {
-        LOGI("Secure storage already initialized");
-        return JNI_TRUE;
+static const char* packed_key(packed_reader_t* r, char** arena) {
+    uint32_t len;
+    const uint8_t* bytes;
+    if (!packed_u16(r, &len) || len == 0 || !(bytes = packed_bytes(r, len)) ||
+        memchr(bytes, 0, len)) {
+        return NULL;
     }
+    char* key = *arena;
+    memcpy(key, bytes, len);
+    key[len] = '\0';
+    *arena += len + 1;
+    return key;
+}
+
+/*
+ * Parse a packed key array. *keys points into a single malloc'd block
+ * holding the strings too; free it with free(*keys).
+ * Returns the key count, -1 if malformed
+ */
+static long unpack_keys(JNIEnv* env, jbyteArray packed, const char*** keys) {
+    if (!packed) return -1;
+    size_t len = (size_t)(*env)->GetArrayLength(env, packed);
+    uint8_t* data = (*env)->GetPrimitiveArrayCritical(env, packed, NULL);
+    if (!data) return -1;
     
-    LOGI("Initializing secure storage subsystem");
-    LOGI("Sovereign crypto: ChaCha20-Poly1305 (RFC 8439)");
-    
-    // Create storage directory
-    mkdir(STORAGE_DIR, 0700);
-    LOGI("Storage directory: %s", STORAGE_DIR);
+    packed_reader_t r = { data, len };
+    uint32_t count;
+    long result = -1;
+    *keys = NULL;
     
-    // Load or create persistent encryption key
-    if (!load_or_create_master_key()) {
-        LOGE("Failed to initialize encryption key");
-        return JNI_FALSE;
+    // Every key takes at least 3 packed bytes, which bounds the allocation;
+    // the strings need at most the packed size
+    if (packed_u32(&r, &count) && count <= r.left / 3) {
+        *keys = malloc((count ? count : 1) * sizeof(char*) + len);
     }
+    if (*keys) {
+        char* arena = (char*)(*keys + count);
+        uint32_t i = 0;
+        while (i < count && ((*keys)[i] = packed_key(&r, &arena)) != NULL) i++;
+        result = (i == count && r.left == 0) ? (long)count : -1;
+    }
+    (*env)->ReleasePrimitiveArrayCritical(env, packed, data, JNI_ABORT);
     
-    LOGI("Master key initialized (persistent across restarts)");
-    LOGI("Key source: /dev/urandom (Android secure RNG)");
-    
-    g_initialized = 1;
-    return JNI_TRUE;
+    if (result < 0) {
+        LOGE("Malformed key batch");
+        free(*keys);
+        *keys = NULL;
+    }
+    return result;
+}
+
+static jbooleanArray results_to_java(JNIEnv* env, const int* results, size_t count) {
+    jboolean* flags = malloc(count ? count : 1);
+    jbooleanArray array = flags ? (*env)->NewBooleanArray(env, (jsize)count) : NULL;
+    if (array) {
+        for (size_t i = 0; i < count; i++) {
+            flags[i] = (results[i] == 0) ? JNI_TRUE : JNI_FALSE;
+        }
+        (*env)->SetBooleanArrayRegion(env, array, 0, (jsize)count, flags);
+    }
+    free(flags);
+    return array;
 }
 
 /*
- * Store encrypted key-value pair
+ * Store every item of a packed batch; one result per item
  */
-JNIEXPORT jboolean JNICALL
-Java_com_sovereigndroid_core_SecureStorage_storeSecure(JNIEnv* env, jobject thiz, jstring key, jstring value) {
-    if (!g_initialized) {
-        LOGE("Secure storage not initialized");
-        return JNI_FALSE;
+SOVEREIGN_JNI_EXPORT jbooleanArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeMany(JNIEnv* env, jobject thiz, jbyteArray batch) {
+    if (!batch) {
+        return NULL;
     }
     
-    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
-    const char* value_str = (*env)->GetStringUTFChars(env, value, NULL);
-    
-    if (!key_str || !value_str) {
-        LOGE("Failed to get string data");
-        return JNI_FALSE;
+    // Copy the batch out of the Java heap first: sealing compresses and
+    // encrypts every value, far too long to hold a critical region
+    size_t len = (size_t)(*env)->GetArrayLength(env, batch);
+    uint8_t* data = secure_buffer_alloc(len);
+    if (!data) {
+        LOGE("Failed to allocate store batch");
+        return NULL;
+    }
+    (*env)->GetByteArrayRegion(env, batch, 0, (jsize)len, (jbyte*)data);
+    if (!state_enter()) {
+        secure_buffer_free(data);
+        return NULL;
     }
     
-    size_t value_len = strlen(value_str);
-    unsigned char* ciphertext = malloc(value_len);
-    unsigned char nonce[CHACHA20_NONCE_SIZE];
-    unsigned char tag[POLY1305_TAG_SIZE];
-    size_t ciphertext_len;
+    packed_reader_t r = { data, len };
+    uint32_t count = 0;
+    batch_value_t* values = NULL;
+    char* arena = NULL;
     
-    // Encrypt value
-    if (!encrypt_data((const unsigned char*)value_str, value_len, 
-                     ciphertext, &ciphertext_len, nonce, tag)) {
-        LOGE("Encryption failed for key: %s", key_str);
-        free(ciphertext);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
-        (*env)->ReleaseStringUTFChars(env, value, value_str);
-        return JNI_FALSE;
+    // Every item takes at least 7 packed bytes
+    if (packed_u32(&r, &count) && count <= r.left / 7) {
+        values = malloc((count ? count : 1) * sizeof(batch_value_t));
+        arena = malloc(len);
     }
     
-    // Get file path
-    char file_path[MAX_PATH];
-    get_file_path(key_str, file_path);
+    // Seal every item, then append (and sync) the batch
+    uint32_t sealed = 0;
+    char* next_key = arena;
+    while (values && arena && sealed < count) {
+        uint32_t value_len;
+        const uint8_t* value;
+        const char* key = packed_key(&r, &next_key);
+        if (!key || !packed_u32(&r, &value_len) || !(value = packed_bytes(&r, value_len))) {
+            break;
+        }
+        batch_seal(&values[sealed++], key, value, value_len);
+    }
+    int valid = (values && arena && sealed == count && r.left == 0);
+    secure_buffer_free(data);
     
-    // Write encrypted data to file
-    FILE* file = fopen(file_path, "wb");
-    if (!file) {
-        LOGE("Failed to open file for writing: %s", file_path);
-        free(ciphertext);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
-        (*env)->ReleaseStringUTFChars(env, value, value_str);
-        return JNI_FALSE;
+    jbooleanArray array = NULL;
+    if (valid) {
+        store_batch(values, count);
+        int* results = malloc((count ? count : 1) * sizeof(int));
+        for (uint32_t i = 0; results && i < count; i++) results[i] = values[i].result;
+        array = results ? results_to_java(env, results, count) : NULL;
+        free(results);
+    } else {
+        LOGE("Malformed store batch");
+        for (uint32_t i = 0; i < sealed; i++) {
+            free(values[i].payload);
+            free(values[i].name_payload);
+        }
     }
+    state_leave();
     
-    // Write: NONCE + TAG + CIPHERTEXT
-    fwrite(nonce, 1, CHACHA20_NONCE_SIZE, file);
-    fwrite(tag, 1, POLY1305_TAG_SIZE, file);
-    fwrite(ciphertext, 1, ciphertext_len, file);
-    fclose(file);
+    free(values);
+    if (arena) {
+        secure_buffer_wipe(arena, (size_t)(next_key - arena));
+        free(arena);
+    }
+    return array;
+}
+
+// One value of retrieveMany, gathered before the result array is sized
+typedef struct {
+    storage_key_id_t key_id;
+    storage_log_view_t view;    // Mapped regular value (mapped set)
+    int mapped;
+    uint8_t* plaintext;         // Cached or streamed value (secure buffer)
+    size_t len;
+    int present;
+    uint64_t fill_token;
+} batch_read_t;
+
+static void batch_read_gather(batch_read_t* b, const char* key) {
+    memset(b, 0, sizeof(*b));
+    key_id_for(key, &b->key_id);
     
-    LOGI("Stored encrypted file: %s (%zu bytes)", file_path, ciphertext_len + CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE);
+    b->plaintext = storage_cache_get_copy(storage_cache_default(), &b->key_id, &b->len);
+    if (b->plaintext) {
+        b->present = 1;
+        return;
+    }
     
-    free(ciphertext);
-    (*env)->ReleaseStringUTFChars(env, key, key_str);
-    (*env)->ReleaseStringUTFChars(env, value, value_str);
+    uint16_t flags;
+    if (storage_log_get_flags(g_log, &b->key_id, &flags) == STORAGE_LOG_OK &&
+        (flags & STORAGE_LOG_FLAG_STREAM)) {
+        b->present = (retrieve_value_secure(key, &b->plaintext, &b->len) == 0);
+        return;
+    }
     
-    return JNI_TRUE;
+    b->fill_token = storage_cache_fill_token(storage_cache_default());
+    if (map_payload(key, &b->key_id, &b->view) == STORAGE_LOG_OK) {
+        b->mapped = 1;
+        b->present = view_value_len(&b->view, &b->len);
+    }
+}
+
+static void batch_read_release(batch_read_t* b) {
+    if (b->mapped) {
+        storage_log_unmap(&b->view);
+    }
+    secure_buffer_free(b->plaintext);
 }
 
 /*
- * Retrieve and decrypt value for key
+ * Retrieve every key of a packed key array into one packed values array.
+ * Mapped values are decrypted into native scratch and copied in with
+ * SetByteArrayRegion, so no critical region spans the decryption or the
+ * cache fill. A value that fails to decrypt is reported missing; the
+ * array is then longer than its contents and ends in zeros.
  */
-JNIEXPORT jstring JNICALL
-Java_com_sovereigndroid_core_SecureStorage_retrieveSecure(JNIEnv* env, jobject thiz, jstring key) {
-    if (!g_initialized) {
-        LOGE("Secure storage not initialized");
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveMany(JNIEnv* env, jobject thiz, jbyteArray keys) {
+    const char** names;
+    long count = unpack_keys(env, keys, &names);
+    if (count < 0) {
         return NULL;
     }
-    
-    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
-    if (!key_str) {
-        LOGE("Failed to get key string");
+    if (!state_enter()) {
+        free(names);
         return NULL;
     }
     
-    // Get file path
-    char file_path[MAX_PATH];
-    get_file_path(key_str, file_path);
-    
-    // Check if file exists
-    if (access(file_path, F_OK) != 0) {
-        LOGW("File not found: %s", file_path);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
-        return NULL;
+    batch_read_t* reads = malloc((count ? (size_t)count : 1) * sizeof(batch_read_t));
+    uint64_t total = 4;
+    size_t scratch_len = 0;
+    for (long i = 0; reads && i < count; i++) {
+        batch_read_t* b = &reads[i];
+        batch_read_gather(b, names[i]);
+        total += 4 + (b->present ? b->len : 0);
+        if (b->present && b->mapped && b->len > scratch_len) scratch_len = b->len;
     }
     
-    // Read encrypted file
-    FILE* file = fopen(file_path, "rb");
-    if (!file) {
-        LOGE("Failed to open file for reading: %s", file_path);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
-        return NULL;
+    // One scratch buffer, sized for the largest mapped value, for every decryption
+    uint8_t* scratch = reads ? secure_buffer_alloc(scratch_len) : NULL;
+    jbyteArray array = (scratch && total <= INT32_MAX)
+                       ? (*env)->NewByteArray(env, (jsize)total) : NULL;
+    if (array) {
+        uint8_t prefix[4];
+        put_le32(prefix, (uint32_t)count);
+        (*env)->SetByteArrayRegion(env, array, 0, 4, (const jbyte*)prefix);
+        
+        size_t pos = 4;
+        for (long i = 0; i < count; i++) {
+            batch_read_t* b = &reads[i];
+            const uint8_t* value = b->plaintext;
+            int ok = b->present;
+            if (ok && b->mapped) {
+                ok = open_view(&b->view, scratch, b->len);
+                if (ok) {
+                    storage_cache_put(storage_cache_default(), &b->key_id, scratch, b->len,
+                                      b->fill_token);
+                    value = scratch;
+                } else {
+                    LOGE("Decryption failed for key: %s", names[i]);
+                }
+            }
+            put_le32(prefix, ok ? (uint32_t)b->len : UINT32_MAX);
+            (*env)->SetByteArrayRegion(env, array, (jsize)pos, 4, (const jbyte*)prefix);
+            if (ok) {
+                (*env)->SetByteArrayRegion(env, array, (jsize)(pos + 4), (jsize)b->len,
+                                           (const jbyte*)value);
+            }
+            pos += 4 + (ok ? b->len : 0);
+        }
     }
+    secure_buffer_free(scratch);
     
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size < CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE) {
-        LOGE("File too small to be valid encrypted data");
-        fclose(file);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
-        return NULL;
+    for (long i = 0; reads && i < count; i++) {
+        batch_read_release(&reads[i]);
     }
+    state_leave();
     
-    // Read NONCE, TAG, and ciphertext
-    unsigned char nonce[CHACHA20_NONCE_SIZE];
-    unsigned char tag[POLY1305_TAG_SIZE];
-    size_t ciphertext_len = file_size - CHACHA20_NONCE_SIZE - POLY1305_TAG_SIZE;
-    unsigned char* ciphertext = malloc(ciphertext_len);
-    unsigned char* plaintext = malloc(ciphertext_len + 1); // +1 for null terminator
-    
-    fread(nonce, 1, CHACHA20_NONCE_SIZE, file);
-    fread(tag, 1, POLY1305_TAG_SIZE, file);
-    fread(ciphertext, 1, ciphertext_len, file);
-    fclose(file);
-    
-    LOGI("Reading encrypted file: %s (%ld bytes)", file_path, file_size);
-    
-    // Decrypt data
-    size_t plaintext_len;
-    if (!decrypt_data(ciphertext, ciphertext_len, nonce, tag, plaintext, &plaintext_len)) {
-        LOGE("Decryption failed for key: %s", key_str);
-        free(ciphertext);
-        free(plaintext);
-        (*env)->ReleaseStringUTFChars(env, key, key_str);
+    free(reads);
+    free(names);
+    return array;
+}
+
+/*
+ * Delete every key of a packed key array; one result per key
+ */
+SOVEREIGN_JNI_EXPORT jbooleanArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_deleteMany(JNIEnv* env, jobject thiz, jbyteArray keys) {
+    const char** names;
+    long count = unpack_keys(env, keys, &names);
+    if (count < 0) {
         return NULL;
     }
     
-    // Null-terminate plaintext
-    plaintext[plaintext_len] = '\0';
-    
-    // Create Java string
-    jstring result = (*env)->NewStringUTF(env, (const char*)plaintext);
-    
-    free(ciphertext);
-    free(plaintext);
-    (*env)->ReleaseStringUTFChars(env, key, key_str);
-    
-    return result;
+    int* results = malloc((count ? (size_t)count : 1) * sizeof(int));
+    jbooleanArray array = NULL;
+    if (results) {
+        secure_storage_delete_many(names, (size_t)count, results);
+        array = results_to_java(env, results, (size_t)count);
+        free(results);
+    }
+    free(names);
+    return array;
 }
 
 /*
  * Delete encrypted data for key
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_deleteSecure(JNIEnv* env, jobject thiz, jstring key) {
     const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
     if (!key_str) {
         return JNI_FALSE;
     }
     
-    char file_path[MAX_PATH];
-    get_file_path(key_str, file_path);
-    
-    int result = unlink(file_path);
-    
-    if (result == 0) {
-        LOGI("Deleted encrypted file: %s", file_path);
-    } else {
-        LOGW("Failed to delete file: %s", file_path);
-    }
+    int result = secure_storage_delete(key_str);
     
     (*env)->ReleaseStringUTFChars(env, key, key_str);
     return (result == 0) ? JNI_TRUE : JNI_FALSE;
@@ -546,17 +5097,18 @@ Java_com_sovereigndroid_core_SecureStorage_deleteSecure(JNIEnv* env, jobject thi
 /*
  * Check if key exists
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_exists(JNIEnv* env, jobject thiz, jstring key) {
     const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
     if (!key_str) {
         return JNI_FALSE;
     }
     
-    char file_path[MAX_PATH];
-    get_file_path(key_str, file_path);
-    
-    int exists = (access(file_path, F_OK) == 0);
+    int exists = 0;
+    if (state_enter()) {
+        exists = value_exists(key_str);
+        state_leave();
+    }
     
     (*env)->ReleaseStringUTFChars(env, key, key_str);
     return exists ? JNI_TRUE : JNI_FALSE;
@@ -565,17 +5117,171 @@ Java_com_sovereigndroid_core_SecureStorage_exists(JNIEnv* env, jobject thiz, jst
 /*
  * Clear all encrypted data
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_clear(JNIEnv* env, jobject thiz) {
-    // Simple implementation: would need to iterate directory to delete all files
-    LOGI("Clear operation called (simplified implementation)");
-    return JNI_TRUE;
+    return (secure_storage_clear() >= 0) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * List keys starting with prefix, in order
+ */
+SOVEREIGN_JNI_EXPORT jobjectArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_listKeys(JNIEnv* env, jobject thiz, jstring prefix) {
+    const char* prefix_str = (*env)->GetStringUTFChars(env, prefix, NULL);
+    if (!prefix_str) {
+        return NULL;
+    }
+    
+    size_t count = 0;
+    char** names = NULL;
+    if (state_enter()) {
+        names = list_names(NULL, NULL, prefix_str, &count);
+        state_leave();
+    }
+    (*env)->ReleaseStringUTFChars(env, prefix, prefix_str);
+    if (!names) {
+        return NULL;
+    }
+    
+    // Cached at registration; looked up here only if JNI_OnLoad did not run
+    jclass string_class = g_string_class ? g_string_class
+                                         : (*env)->FindClass(env, "java/lang/String");
+    jobjectArray result = string_class
+        ? (*env)->NewObjectArray(env, (jsize)count, string_class, NULL) : NULL;
+    if (string_class && string_class != g_string_class) {
+        (*env)->DeleteLocalRef(env, string_class);
+    }
+    for (size_t i = 0; result && i < count; i++) {
+        jstring name = (*env)->NewStringUTF(env, names[i]);
+        if (!name) {
+            result = NULL;
+            break;
+        }
+        (*env)->SetObjectArrayElement(env, result, (jsize)i, name);
+        (*env)->DeleteLocalRef(env, name);
+    }
+    
+    storage_names_free_list(names, count);
+    return result;
+}
+
+/*
+ * Delete every key starting with prefix; returns the number deleted
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_deletePrefix(JNIEnv* env, jobject thiz, jstring prefix) {
+    const char* prefix_str = (*env)->GetStringUTFChars(env, prefix, NULL);
+    if (!prefix_str) {
+        return -1;
+    }
+    
+    int deleted = secure_storage_delete_prefix(prefix_str);
+    (*env)->ReleaseStringUTFChars(env, prefix, prefix_str);
+    return deleted;
+}
+
+/*
+ * Copy a backup key out of a Java byte[] (must be exactly 32 bytes)
+ */
+static int backup_key_from_java(JNIEnv* env, jbyteArray key,
+                                uint8_t out[SECURE_STORAGE_BACKUP_KEY_SIZE]) {
+    if (!key || (*env)->GetArrayLength(env, key) != SECURE_STORAGE_BACKUP_KEY_SIZE) {
+        LOGE("Backup key must be %d bytes", SECURE_STORAGE_BACKUP_KEY_SIZE);
+        return 0;
+    }
+    (*env)->GetByteArrayRegion(env, key, 0, SECURE_STORAGE_BACKUP_KEY_SIZE, (jbyte*)out);
+    return 1;
+}
+
+/*
+ * Export every key into an archive sealed with a 32-byte key
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_exportBackup(JNIEnv* env, jobject thiz,
+                                                       jstring path, jbyteArray key) {
+    uint8_t backup_key[SECURE_STORAGE_BACKUP_KEY_SIZE];
+    if (!backup_key_from_java(env, key, backup_key)) {
+        return JNI_FALSE;
+    }
+    const char* path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    if (!path_str) {
+        secure_buffer_wipe(backup_key, sizeof(backup_key));
+        return JNI_FALSE;
+    }
+    
+    int result = secure_storage_export(path_str, backup_key, 0, NULL);
+    secure_buffer_wipe(backup_key, sizeof(backup_key));
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    return (result == 0) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Import an archive; returns the number of keys stored, -1 on failure
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_importBackup(JNIEnv* env, jobject thiz,
+                                                       jstring path, jbyteArray key) {
+    uint8_t backup_key[SECURE_STORAGE_BACKUP_KEY_SIZE];
+    if (!backup_key_from_java(env, key, backup_key)) {
+        return -1;
+    }
+    const char* path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    if (!path_str) {
+        secure_buffer_wipe(backup_key, sizeof(backup_key));
+        return -1;
+    }
+    
+    secure_storage_backup_stats_t stats;
+    int result = secure_storage_import(path_str, backup_key, &stats);
+    secure_buffer_wipe(backup_key, sizeof(backup_key));
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    return (result == 0) ? (jint)stats.keys : -1;
 }
 
 /*
  * Get storage directory path
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_SecureStorage_getStoragePath(JNIEnv* env, jobject thiz) {
-    return (*env)->NewStringUTF(env, STORAGE_DIR);
+    pthread_rwlock_rdlock(&g_state_lock);
+    jstring path = (*env)->NewStringUTF(env, g_storage_dir);
+    pthread_rwlock_unlock(&g_state_lock);
+    return path;
+}
+
+static const JNINativeMethod g_storage_methods[] = {
+    { "initialize", "()Z", (void*)Java_com_sovereigndroid_core_SecureStorage_initialize },
+    { "storeSecure", "(Ljava/lang/String;Ljava/lang/String;)Z",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_storeSecure },
+    { "retrieveSecure", "(Ljava/lang/String;)Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_retrieveSecure },
+    { "storeBytes", "(Ljava/lang/String;[B)Z", (void*)Java_com_sovereigndroid_core_SecureStorage_storeBytes },
+    { "retrieveBytes", "(Ljava/lang/String;)[B",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_retrieveBytes },
+    { "storeBuffer", "(Ljava/lang/String;Ljava/nio/ByteBuffer;I)Z",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_storeBuffer },
+    { "retrieveBuffer", "(Ljava/lang/String;Ljava/nio/ByteBuffer;)I",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_retrieveBuffer },
+    { "storeMany", "([B)[Z", (void*)Java_com_sovereigndroid_core_SecureStorage_storeMany },
+    { "retrieveMany", "([B)[B", (void*)Java_com_sovereigndroid_core_SecureStorage_retrieveMany },
+    { "deleteMany", "([B)[Z", (void*)Java_com_sovereigndroid_core_SecureStorage_deleteMany },
+    { "deleteSecure", "(Ljava/lang/String;)Z", (void*)Java_com_sovereigndroid_core_SecureStorage_deleteSecure },
+    { "exists", "(Ljava/lang/String;)Z", (void*)Java_com_sovereigndroid_core_SecureStorage_exists },
+    { "clear", "()Z", (void*)Java_com_sovereigndroid_core_SecureStorage_clear },
+    { "listKeys", "(Ljava/lang/String;)[Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_listKeys },
+    { "deletePrefix", "(Ljava/lang/String;)I", (void*)Java_com_sovereigndroid_core_SecureStorage_deletePrefix },
+    { "exportBackup", "(Ljava/lang/String;[B)Z", (void*)Java_com_sovereigndroid_core_SecureStorage_exportBackup },
+    { "importBackup", "(Ljava/lang/String;[B)I", (void*)Java_com_sovereigndroid_core_SecureStorage_importBackup },
+    { "getStoragePath", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_getStoragePath },
+};
+
+int secure_storage_register_natives(JNIEnv* env) {
+    if (!g_string_class) {
+        g_string_class = sovereign_jni_find_class(env, "java/lang/String");
+    }
+    int registered = sovereign_jni_register(env, SOVEREIGN_JNI_CLASS("SecureStorage"), g_storage_methods,
+                                            SOVEREIGN_JNI_COUNT(g_storage_methods));
+    return registered > 0 ? registered : 0;
 }
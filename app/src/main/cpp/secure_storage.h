@@ -8,9 +8,12 @@
 #ifndef SOVEREIGNDROID_SECURE_STORAGE_H
 #define SOVEREIGNDROID_SECURE_STORAGE_H
 
-#include <jni.h>
+#include "sovereign_jni.h"
 #include <stdint.h>
 #include <stddef.h>
+#include "secure_storage_log.h"
+#include "secure_storage_cache.h"
+#include "sovereign_argon2.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +21,20 @@ extern "C" {
 
 /*
  * Native C API for internal use
+ * All calls are thread-safe; shutdown waits for calls in flight.
  */
 
-// Initialize secure storage subsystem
+// Storage directory; call before initialize (tools, benchmarks)
+int secure_storage_set_root(const char* dir);
+
+// Passphrase for the next initialize, which then opens a protected key
+// file or protects an unprotected one. Call before initialize; the copy
+// is wiped once initialize has run. NULL clears it
+int secure_storage_set_passphrase(const uint8_t* passphrase, size_t passphrase_len);
+
+// Initialize secure storage subsystem (idempotent, safe from any thread)
+// Fails, leaving the key file alone, if the key file is passphrase
+// protected and the passphrase is missing or wrong
 int secure_storage_initialize(void);
 
 // Store binary data with a key
@@ -29,9 +43,257 @@ int secure_storage_store(const char* key, const uint8_t* data, size_t data_len);
 // Retrieve binary data by key
 int secure_storage_retrieve(const char* key, uint8_t* data, size_t data_len);
 
+// Plaintext size of a value, for sizing the retrieve buffer
+int secure_storage_get_size(const char* key, size_t* size);
+
+// 1 if a value is stored under key; answered from memory, nothing is
+// read or decrypted (misses usually from the key filter alone)
+int secure_storage_exists(const char* key);
+
+// Retrieve into a library-owned, mlock'd, guard-paged buffer
+// (bypasses the plaintext cache); release with secure_storage_free
+int secure_storage_retrieve_secure(const char* key, uint8_t** data, size_t* data_len);
+
+// Wipe and release a buffer from secure_storage_retrieve_secure
+void secure_storage_free(uint8_t* data);
+
 // Delete data by key
 int secure_storage_delete(const char* key);
 
+// Stop background compaction and close the store
+void secure_storage_shutdown(void);
+
+// Live/dead byte ratios and compaction throughput
+void secure_storage_get_metrics(storage_log_metrics_t* metrics);
+
+typedef enum {
+    SECURE_STORAGE_DURABILITY_SYNC = 0,    // fdatasync before a store returns (default)
+    SECURE_STORAGE_DURABILITY_LAZY = 1,    // Left to the kernel: a crash may lose the last stores
+} secure_storage_durability_t;
+
+// Durability of main store writes; may be called before initialize
+void secure_storage_set_durability(secure_storage_durability_t durability);
+
+// Opt-in plaintext LRU cache (0 disables and wipes it)
+void secure_storage_cache_configure(size_t byte_budget);
+
+// Never cache a key's plaintext (secrets); call after initialize
+void secure_storage_cache_exclude(const char* key);
+
+// Cache hit/miss counters
+void secure_storage_get_cache_stats(storage_cache_stats_t* stats);
+
+// Values of at least min_size bytes are compressed before encryption when
+// that saves an eighth or more (default 512; 0 turns compression off)
+void secure_storage_compression_configure(size_t min_size);
+
+typedef struct {
+    uint64_t values_compressed;
+    uint64_t values_bypassed;      // Large enough but stored raw (poor ratio)
+    uint64_t bytes_in;             // Of compressed values, before and after
+    uint64_t bytes_out;
+} secure_storage_compression_stats_t;
+
+void secure_storage_get_compression_stats(secure_storage_compression_stats_t* stats);
+
+// Values of at least min_size bytes are cut into content-defined chunks
+// shared with every other such value, so storing a large value again
+// after a small edit only writes the chunks that changed (default 256 KiB;
+// 0 turns dedup off). Applies to secure_storage_store and storeBytes.
+void secure_storage_dedup_configure(size_t min_size);
+
+typedef struct {
+    uint64_t values_stored;
+    uint64_t bytes_in;             // Value bytes stored with dedup
+    uint64_t bytes_written;        // Record payloads appended for them
+    uint64_t chunks_written;
+    uint64_t chunks_reused;        // Already stored, not sealed or written again
+    uint64_t chunks_live;          // Distinct shared chunks (0 until first use)
+    float dedup_ratio;             // bytes_in / plaintext of the chunks written
+    float write_amplification;     // bytes_written / bytes_in
+} secure_storage_dedup_stats_t;
+
+void secure_storage_get_dedup_stats(secure_storage_dedup_stats_t* stats);
+
+// Switch to a fresh master key now and re-key existing records in the
+// background at up to io_budget_bytes per second (0 = unthrottled).
+// Reads and writes continue meanwhile; an interrupted job resumes on the
+// next initialize. Returns 0 while a rotation is still running
+int secure_storage_rotate_key(uint64_t io_budget_bytes);
+
+typedef struct {
+    uint32_t key_epoch;            // Epoch new records are sealed under
+    int in_progress;               // Records sealed under the previous key remain
+    uint64_t records_total;        // Stale records found when the job started
+    uint64_t records_rewritten;
+    uint64_t records_skipped;      // Overwritten or deleted before the job reached them
+    uint64_t records_failed;
+    uint64_t bytes_rewritten;
+    uint64_t time_us;              // Time spent inside batches
+    float throughput_mb_s;         // Bytes rewritten per second of batch time
+} secure_storage_rotation_metrics_t;
+
+void secure_storage_get_rotation_metrics(secure_storage_rotation_metrics_t* metrics);
+
+// Re-seal the master key file under a new passphrase (NULL: remove the
+// protection). params NULL calibrates Argon2id to about half a second of
+// unlock time on this device. Returns 1 on success
+int secure_storage_change_passphrase(const uint8_t* passphrase, size_t passphrase_len,
+                                     const argon2_params_t* params);
+
+// Whether the open store's key file is passphrase protected
+int secure_storage_is_passphrase_protected(void);
+
+/*
+ * Streaming API for large values
+ * Values are split into fixed-size chunks, each encrypted and authenticated
+ * on its own, so peak memory stays around two chunks. secure_storage_retrieve
+ * and secure_storage_delete also work on streamed values.
+ */
+
+// Default chunk size for writers (chunk_size 0)
+#define SECURE_STORAGE_CHUNK_DEFAULT (64 * 1024)
+
+typedef struct secure_storage_writer secure_storage_writer_t;
+typedef struct secure_storage_reader secure_storage_reader_t;
+
+// Start writing a value; the old value stays readable until close
+secure_storage_writer_t* secure_storage_open_writer(const char* key, size_t chunk_size);
+
+// Append data (encrypts and stores each chunk as it fills)
+int secure_storage_write(secure_storage_writer_t* writer, const uint8_t* data, size_t data_len);
+
+// Flush the last chunk and commit the value; frees the writer
+int secure_storage_close_writer(secure_storage_writer_t* writer);
+
+// Discard everything written so far; frees the writer
+void secure_storage_abort_writer(secure_storage_writer_t* writer);
+
+// Open a streamed or regular value for reading
+secure_storage_reader_t* secure_storage_open_reader(const char* key);
+
+// Total value length in bytes
+uint64_t secure_storage_reader_size(const secure_storage_reader_t* reader);
+
+// Read up to data_len bytes from the current position (*read_len is 0 at end)
+int secure_storage_read(secure_storage_reader_t* reader, uint8_t* data, size_t data_len, size_t* read_len);
+
+// Move to any byte offset; only the chunk holding it is decrypted
+int secure_storage_seek(secure_storage_reader_t* reader, uint64_t offset);
+
+// Wipe and free the reader
+void secure_storage_close_reader(secure_storage_reader_t* reader);
+
+/*
+ * Ordered key enumeration
+ * Key names are kept in encrypted name records and an in-memory sorted
+ * index, loaded on first use. Visitors run on a snapshot without any
+ * storage lock held, so they may read, store or delete keys.
+ */
+
+// Called once per key in order; return 0 to stop early
+typedef int (*secure_storage_key_visitor_t)(const char* key, void* ctx);
+
+// Visit keys in [start, end) (NULL bounds are open); returns keys visited or -1
+int secure_storage_scan(const char* start, const char* end,
+                        secure_storage_key_visitor_t visit, void* ctx);
+
+// Visit keys starting with prefix; returns keys visited or -1
+int secure_storage_scan_prefix(const char* prefix, secure_storage_key_visitor_t visit, void* ctx);
+
+// Delete every key starting with prefix; returns the number deleted or -1
+int secure_storage_delete_prefix(const char* prefix);
+
+// Delete every record in the store; returns the number deleted or -1
+int secure_storage_clear(void);
+
+// One value for secure_storage_store_many
+typedef struct {
+    const char* key;
+    const uint8_t* data;
+    size_t data_len;
+} secure_storage_item_t;
+
+// Store many values as one log batch: one writer turn, one sync.
+// results (may be NULL) gets 0 or -1 per item; returns 0 if all stored
+int secure_storage_store_many(const secure_storage_item_t* items, size_t count, int* results);
+
+// Delete many keys as one log batch; results as above (-1: not found)
+int secure_storage_delete_many(const char* const* keys, size_t count, int* results);
+
+/*
+ * Integrity scrub
+ * Recomputes the authentication tag of every stored record on a worker
+ * pool without decrypting anything, so silent corruption shows up before
+ * a read trips over it. Safe to run while the store is in use.
+ */
+
+// Called once per corrupt record after the scrub, with no lock held.
+// key is the key the record belongs to (its value, a stream chunk or
+// its name record), NULL if no readable key claims it
+typedef void (*secure_storage_corrupt_visitor_t)(const char* key, const storage_key_id_t* record_id,
+                                                 void* ctx);
+
+typedef struct {
+    uint64_t records_checked;
+    uint64_t records_corrupt;
+    uint64_t bytes_checked;
+    uint64_t elapsed_us;
+    float throughput_mb_s;         // Bytes checked per second of wall time
+} secure_storage_scrub_stats_t;
+
+// threads 0 picks one per online CPU (up to 8); io_budget_bytes caps the
+// bytes read per second across all of them (0 = unthrottled).
+// Returns the number of corrupt records, -1 on failure (stats may be NULL)
+int secure_storage_scrub(int threads, uint64_t io_budget_bytes,
+                         secure_storage_corrupt_visitor_t on_corrupt, void* ctx,
+                         secure_storage_scrub_stats_t* stats);
+
+/*
+ * Namespaces
+ * Named stores beside the main one, each with its own segment log
+ * (STORAGE_DIR/ns/<name>), plaintext cache, compaction policy and
+ * durability, so hot small keys and bulk writes do not share a writer
+ * queue, a cache or an fdatasync. Values are sealed under the master key
+ * and re-keyed by rotation like any other. Namespaces hold whole values
+ * only: streams, dedup, key enumeration, scrub, clear and backup cover
+ * the main store alone.
+ */
+
+#define SECURE_STORAGE_NAMESPACE_MAX 16
+#define SECURE_STORAGE_NAMESPACE_NAME_MAX 32
+
+typedef struct {
+    size_t cache_bytes;                      // Plaintext cache budget, 0 = no cache
+    secure_storage_durability_t durability;
+    storage_compaction_policy_t compaction;
+} secure_storage_namespace_config_t;
+
+// No cache, synced writes, the default compaction policy
+void secure_storage_namespace_default_config(secure_storage_namespace_config_t* config);
+
+// Open a namespace, creating it on first use, or change the settings of
+// an open one (config NULL: defaults for a new one, no change otherwise).
+// Names are 1-32 characters of [a-z0-9_-]. Namespaces on disk reopen with
+// the defaults at initialize. Returns 0 on success, -1 on failure
+int secure_storage_namespace_open(const char* ns, const secure_storage_namespace_config_t* config);
+
+// Value calls as for the main store, within namespace ns
+int secure_storage_ns_store(const char* ns, const char* key, const uint8_t* data, size_t data_len);
+int secure_storage_ns_retrieve(const char* ns, const char* key, uint8_t* data, size_t data_len);
+int secure_storage_ns_get_size(const char* ns, const char* key, size_t* size);
+int secure_storage_ns_exists(const char* ns, const char* key);
+int secure_storage_ns_delete(const char* ns, const char* key);
+
+// Store many values as one batch of the namespace log: one writer turn,
+// one sync. results (may be NULL) as for secure_storage_store_many
+int secure_storage_ns_store_many(const char* ns, const secure_storage_item_t* items, size_t count,
+                                 int* results);
+
+// Log, compaction and cache counters of one namespace (either may be NULL)
+int secure_storage_ns_get_metrics(const char* ns, storage_log_metrics_t* metrics,
+                                  storage_cache_stats_t* cache_stats);
+
 /*
  * JNI API for Kotlin/Java
  */
@@ -41,7 +303,7 @@ int secure_storage_delete(const char* key);
  * Method:    initialize
  * Signature: ()Z
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_initialize(JNIEnv* env, jobject thiz);
 
 /*
@@ -49,7 +311,7 @@ Java_com_sovereigndroid_core_SecureStorage_initialize(JNIEnv* env, jobject thiz)
  * Method:    storeSecure
  * Signature: (Ljava/lang/String;Ljava/lang/String;)Z
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_storeSecure(JNIEnv* env, jobject thiz, jstring key, jstring value);
 
 /*
@@ -57,15 +319,73 @@ Java_com_sovereigndroid_core_SecureStorage_storeSecure(JNIEnv* env, jobject thiz
  * Method:    retrieveSecure
  * Signature: (Ljava/lang/String;)Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_SecureStorage_retrieveSecure(JNIEnv* env, jobject thiz, jstring key);
 
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    storeBytes
+ * Signature: (Ljava/lang/String;[B)Z
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeBytes(JNIEnv* env, jobject thiz, jstring key, jbyteArray value);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    retrieveBytes
+ * Signature: (Ljava/lang/String;)[B
+ */
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveBytes(JNIEnv* env, jobject thiz, jstring key);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    storeBuffer
+ * Signature: (Ljava/lang/String;Ljava/nio/ByteBuffer;I)Z
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeBuffer(JNIEnv* env, jobject thiz, jstring key,
+                                                      jobject buffer, jint length);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    retrieveBuffer
+ * Signature: (Ljava/lang/String;Ljava/nio/ByteBuffer;)I
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveBuffer(JNIEnv* env, jobject thiz, jstring key,
+                                                         jobject buffer);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    storeMany
+ * Signature: ([B)[Z
+ */
+SOVEREIGN_JNI_EXPORT jbooleanArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_storeMany(JNIEnv* env, jobject thiz, jbyteArray batch);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    retrieveMany
+ * Signature: ([B)[B
+ */
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_retrieveMany(JNIEnv* env, jobject thiz, jbyteArray keys);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    deleteMany
+ * Signature: ([B)[Z
+ */
+SOVEREIGN_JNI_EXPORT jbooleanArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_deleteMany(JNIEnv* env, jobject thiz, jbyteArray keys);
+
 /*
  * Class:     com_sovereigndroid_core_SecureStorage
  * Method:    deleteSecure
  * Signature: (Ljava/lang/String;)Z
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_deleteSecure(JNIEnv* env, jobject thiz, jstring key);
 
 /*
@@ -73,7 +393,7 @@ Java_com_sovereigndroid_core_SecureStorage_deleteSecure(JNIEnv* env, jobject thi
  * Method:    exists
  * Signature: (Ljava/lang/String;)Z
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_exists(JNIEnv* env, jobject thiz, jstring key);
 
 /*
@@ -81,15 +401,49 @@ Java_com_sovereigndroid_core_SecureStorage_exists(JNIEnv* env, jobject thiz, jst
  * Method:    clear
  * Signature: ()Z
  */
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_SecureStorage_clear(JNIEnv* env, jobject thiz);
 
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    listKeys
+ * Signature: (Ljava/lang/String;)[Ljava/lang/String;
+ */
+SOVEREIGN_JNI_EXPORT jobjectArray JNICALL
+Java_com_sovereigndroid_core_SecureStorage_listKeys(JNIEnv* env, jobject thiz, jstring prefix);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    deletePrefix
+ * Signature: (Ljava/lang/String;)I
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_deletePrefix(JNIEnv* env, jobject thiz, jstring prefix);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    exportBackup
+ * Signature: (Ljava/lang/String;[B)Z
+ */
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
+Java_com_sovereigndroid_core_SecureStorage_exportBackup(JNIEnv* env, jobject thiz,
+                                                       jstring path, jbyteArray key);
+
+/*
+ * Class:     com_sovereigndroid_core_SecureStorage
+ * Method:    importBackup
+ * Signature: (Ljava/lang/String;[B)I
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_importBackup(JNIEnv* env, jobject thiz,
+                                                       jstring path, jbyteArray key);
+
 /*
  * Class:     com_sovereigndroid_core_SecureStorage
  * Method:    getStoragePath
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_SecureStorage_getStoragePath(JNIEnv* env, jobject thiz);
 
 #ifdef __cplusplus
@@ -0,0 +1,473 @@
+/*
+ * SovereignDroid Secure Storage - Asynchronous API Implementation
+ *
+ * Each worker owns a FIFO queue. Submissions are routed by a hash of the
+ * key, which keeps per-key ordering without any cross-worker coordination.
+ * Workers call the blocking API and push results onto one completion
+ * list, then bump the eventfd counter.
+ *
+ * No io_uring backend: untrusted Android apps are denied io_uring by the
+ * platform sandbox, and the work here is dominated by ChaCha20-Poly1305
+ * rather than syscalls, which a thread pool overlaps just as well.
+ */
+
+#include "secure_storage_async.h"
+#include "secure_storage.h"
+#include "secure_buffer.h"
+#include <android/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define LOG_TAG "SecureStorageAsync"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define ASYNC_DEFAULT_WORKERS 2
+#define ASYNC_MAX_WORKERS 8
+
+typedef struct async_op {
+    uint64_t ticket;
+    int op;
+    char* key;
+    uint8_t* data;              // PUT: secure buffer copy of the value
+    size_t data_len;
+    void* user_data;
+    struct async_op* next;
+} async_op_t;
+
+typedef struct async_done {
+    secure_storage_completion_t completion;
+    struct async_done* next;
+} async_done_t;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    async_op_t* head;
+    async_op_t* tail;
+    int stop;
+} async_worker_t;
+
+static struct {
+    pthread_mutex_t lock;       // Guards started, next_ticket and the completion list
+    int started;
+    int event_fd;
+    uint64_t next_ticket;
+
+    async_worker_t workers[ASYNC_MAX_WORKERS];
+    int worker_count;
+
+    async_done_t* done_head;
+    async_done_t* done_tail;
+} g_async = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .event_fd = -1,
+    .next_ticket = 1,
+};
+
+// FNV-1a: only spreads keys over workers
+static uint32_t key_route(const char* key) {
+    uint32_t h = 2166136261u;
+    for (const char* p = key; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h;
+}
+
+static void signal_completions(void) {
+    uint64_t one = 1;
+    while (write(g_async.event_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+static void free_op(async_op_t* op) {
+    free(op->key);
+    secure_buffer_free(op->data);
+    free(op);
+}
+
+static void run_op(async_op_t* op) {
+    async_done_t* done = calloc(1, sizeof(async_done_t));
+    secure_storage_completion_t c = {
+        .ticket = op->ticket,
+        .op = op->op,
+        .status = -1,
+        .user_data = op->user_data,
+    };
+
+    switch (op->op) {
+        case SECURE_STORAGE_OP_PUT:
+            c.status = secure_storage_store(op->key, op->data, op->data_len);
+            break;
+        case SECURE_STORAGE_OP_GET:
+            c.status = secure_storage_retrieve_secure(op->key, &c.data, &c.data_len);
+            break;
+        case SECURE_STORAGE_OP_DELETE:
+            c.status = secure_storage_delete(op->key);
+            break;
+    }
+    free_op(op);
+
+    if (!done) {
+        LOGE("Dropping completion for ticket %llu (out of memory)", (unsigned long long)c.ticket);
+        secure_storage_free(c.data);
+        return;
+    }
+    done->completion = c;
+
+    pthread_mutex_lock(&g_async.lock);
+    if (g_async.done_tail) g_async.done_tail->next = done;
+    else g_async.done_head = done;
+    g_async.done_tail = done;
+    pthread_mutex_unlock(&g_async.lock);
+
+    signal_completions();
+}
+
+static void* worker_main(void* arg) {
+    async_worker_t* w = (async_worker_t*)arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->head && !w->stop) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (!w->head) break;    // Stopping and drained
+
+        async_op_t* op = w->head;
+        w->head = op->next;
+        if (!w->head) w->tail = NULL;
+        pthread_mutex_unlock(&w->lock);
+
+        run_op(op);
+
+        pthread_mutex_lock(&w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+int secure_storage_async_start(int worker_count) {
+    if (worker_count <= 0) worker_count = ASYNC_DEFAULT_WORKERS;
+    if (worker_count > ASYNC_MAX_WORKERS) worker_count = ASYNC_MAX_WORKERS;
+
+    pthread_mutex_lock(&g_async.lock);
+    if (g_async.started) {
+        pthread_mutex_unlock(&g_async.lock);
+        return 0;
+    }
+
+    g_async.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_async.event_fd < 0) {
+        pthread_mutex_unlock(&g_async.lock);
+        LOGE("Failed to create eventfd");
+        return -1;
+    }
+
+    int started = 0;
+    for (; started < worker_count; started++) {
+        async_worker_t* w = &g_async.workers[started];
+        memset(w, 0, sizeof(*w));
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            pthread_mutex_destroy(&w->lock);
+            pthread_cond_destroy(&w->cond);
+            break;
+        }
+    }
+
+    if (started == 0) {
+        close(g_async.event_fd);
+        g_async.event_fd = -1;
+        pthread_mutex_unlock(&g_async.lock);
+        LOGE("Failed to start storage workers");
+        return -1;
+    }
+
+    g_async.worker_count = started;
+    g_async.started = 1;
+    pthread_mutex_unlock(&g_async.lock);
+
+    LOGI("Async storage started: %d workers", started);
+    return 0;
+}
+
+void secure_storage_async_stop(void) {
+    pthread_mutex_lock(&g_async.lock);
+    if (!g_async.started) {
+        pthread_mutex_unlock(&g_async.lock);
+        return;
+    }
+    g_async.started = 0;    // No new submissions
+    pthread_mutex_unlock(&g_async.lock);
+
+    for (int i = 0; i < g_async.worker_count; i++) {
+        async_worker_t* w = &g_async.workers[i];
+        pthread_mutex_lock(&w->lock);
+        w->stop = 1;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+    }
+    for (int i = 0; i < g_async.worker_count; i++) {
+        async_worker_t* w = &g_async.workers[i];
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+    }
+    g_async.worker_count = 0;
+
+    // Nobody will collect these any more
+    pthread_mutex_lock(&g_async.lock);
+    async_done_t* done = g_async.done_head;
+    g_async.done_head = g_async.done_tail = NULL;
+    close(g_async.event_fd);
+    g_async.event_fd = -1;
+    pthread_mutex_unlock(&g_async.lock);
+
+    while (done) {
+        async_done_t* next = done->next;
+        secure_storage_free(done->completion.data);
+        free(done);
+        done = next;
+    }
+
+    LOGI("Async storage stopped");
+}
+
+int secure_storage_async_fd(void) {
+    return g_async.event_fd;
+}
+
+static uint64_t submit(int op_code, const char* key, const uint8_t* data, size_t data_len,
+                       void* user_data) {
+    async_op_t* op = calloc(1, sizeof(async_op_t));
+    if (!op) {
+        return 0;
+    }
+
+    op->op = op_code;
+    op->key = strdup(key);
+    op->data_len = data_len;
+    op->user_data = user_data;
+    if (op_code == SECURE_STORAGE_OP_PUT) {
+        op->data = secure_buffer_alloc(data_len);
+        if (op->data) memcpy(op->data, data, data_len);
+    }
+
+    if (!op->key || (op_code == SECURE_STORAGE_OP_PUT && !op->data)) {
+        LOGE("Failed to queue storage operation");
+        free_op(op);
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_async.lock);
+    if (!g_async.started) {
+        pthread_mutex_unlock(&g_async.lock);
+        LOGE("Async storage not started");
+        free_op(op);
+        return 0;
+    }
+    op->ticket = g_async.next_ticket++;
+    async_worker_t* w = &g_async.workers[key_route(key) % (uint32_t)g_async.worker_count];
+
+    // Take the worker lock before dropping ours so stop cannot slip in between
+    pthread_mutex_lock(&w->lock);
+    pthread_mutex_unlock(&g_async.lock);
+
+    if (w->tail) w->tail->next = op;
+    else w->head = op;
+    w->tail = op;
+    uint64_t ticket = op->ticket;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    return ticket;
+}
+
+uint64_t secure_storage_submit_put(const char* key, const uint8_t* data, size_t data_len, void* user_data) {
+    return submit(SECURE_STORAGE_OP_PUT, key, data, data_len, user_data);
+}
+
+uint64_t secure_storage_submit_get(const char* key, void* user_data) {
+    return submit(SECURE_STORAGE_OP_GET, key, NULL, 0, user_data);
+}
+
+uint64_t secure_storage_submit_delete(const char* key, void* user_data) {
+    return submit(SECURE_STORAGE_OP_DELETE, key, NULL, 0, user_data);
+}
+
+size_t secure_storage_poll_completions(secure_storage_completion_t* out, size_t max) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&g_async.lock);
+    if (g_async.event_fd < 0) {
+        pthread_mutex_unlock(&g_async.lock);
+        return 0;
+    }
+
+    // Reset readiness first; re-arm below if anything is left behind
+    uint64_t pending;
+    while (read(g_async.event_fd, &pending, sizeof(pending)) < 0 && errno == EINTR) {
+    }
+
+    while (count < max && g_async.done_head) {
+        async_done_t* done = g_async.done_head;
+        g_async.done_head = done->next;
+        if (!g_async.done_head) g_async.done_tail = NULL;
+        out[count++] = done->completion;
+        free(done);
+    }
+
+    if (g_async.done_head) {
+        signal_completions();
+    }
+    pthread_mutex_unlock(&g_async.lock);
+    return count;
+}
+
+/*
+ * ========================================================================
+ * JNI API for Kotlin/Java
+ * ========================================================================
+ */
+
+// Completions handed to the callback per poll_completions call
+#define ASYNC_JNI_POLL_BATCH 32
+
+// StorageCallback.onComplete, resolved once in secure_storage_async_register_natives
+static jclass g_callback_class;
+static jmethodID g_on_complete;
+
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_asyncStart(JNIEnv* env, jobject thiz, jint workers) {
+    return secure_storage_async_start(workers) == 0 ? secure_storage_async_fd() : -1;
+}
+
+SOVEREIGN_JNI_EXPORT void JNICALL
+Java_com_sovereigndroid_core_SecureStorage_asyncStop(JNIEnv* env, jobject thiz) {
+    secure_storage_async_stop();
+}
+
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitPut(JNIEnv* env, jobject thiz,
+                                                    jstring key, jbyteArray value) {
+    if (!key || !value) {
+        return 0;
+    }
+    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    if (!key_str) {
+        return 0;
+    }
+
+    // submit copies the value before returning, so the array is only held briefly
+    jsize len = (*env)->GetArrayLength(env, value);
+    jbyte* data = (*env)->GetPrimitiveArrayCritical(env, value, NULL);
+    uint64_t ticket = data
+        ? secure_storage_submit_put(key_str, (const uint8_t*)data, (size_t)len, NULL) : 0;
+    if (data) {
+        (*env)->ReleasePrimitiveArrayCritical(env, value, data, JNI_ABORT);
+    }
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    return (jlong)ticket;
+}
+
+static jlong submit_key_op(JNIEnv* env, jstring key, int op_code) {
+    if (!key) {
+        return 0;
+    }
+    const char* key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    if (!key_str) {
+        return 0;
+    }
+    uint64_t ticket = submit(op_code, key_str, NULL, 0, NULL);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    return (jlong)ticket;
+}
+
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitGet(JNIEnv* env, jobject thiz, jstring key) {
+    return submit_key_op(env, key, SECURE_STORAGE_OP_GET);
+}
+
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitDelete(JNIEnv* env, jobject thiz, jstring key) {
+    return submit_key_op(env, key, SECURE_STORAGE_OP_DELETE);
+}
+
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_pollCompletions(JNIEnv* env, jobject thiz,
+                                                          jobject callback) {
+    if (!g_on_complete || !callback) {
+        LOGE("pollCompletions: StorageCallback not available");
+        return -1;
+    }
+
+    secure_storage_completion_t batch[ASYNC_JNI_POLL_BATCH];
+    jint delivered = 0;
+    int failed = 0;
+    size_t n;
+    while (!failed && (n = secure_storage_poll_completions(batch, ASYNC_JNI_POLL_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            secure_storage_completion_t* c = &batch[i];
+            jbyteArray data = NULL;
+            if (!failed && c->data) {
+                data = (*env)->NewByteArray(env, (jsize)c->data_len);
+                if (data) {
+                    (*env)->SetByteArrayRegion(env, data, 0, (jsize)c->data_len, (const jbyte*)c->data);
+                } else {
+                    failed = 1;     // OutOfMemoryError pending
+                }
+            }
+            secure_storage_free(c->data);
+            if (failed) {
+                // The callback threw or the VM is out of memory: drop the rest of the batch
+                continue;
+            }
+
+            (*env)->CallVoidMethod(env, callback, g_on_complete, (jlong)c->ticket, (jint)c->op,
+                                   (jint)c->status, data);
+            if (data) {
+                (*env)->DeleteLocalRef(env, data);
+            }
+            if ((*env)->ExceptionCheck(env)) {
+                failed = 1;     // Leave the exception pending for the caller
+                continue;
+            }
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+static const JNINativeMethod g_async_methods[] = {
+    { "asyncStart", "(I)I", (void*)Java_com_sovereigndroid_core_SecureStorage_asyncStart },
+    { "asyncStop", "()V", (void*)Java_com_sovereigndroid_core_SecureStorage_asyncStop },
+    { "submitPut", "(Ljava/lang/String;[B)J", (void*)Java_com_sovereigndroid_core_SecureStorage_submitPut },
+    { "submitGet", "(Ljava/lang/String;)J", (void*)Java_com_sovereigndroid_core_SecureStorage_submitGet },
+    { "submitDelete", "(Ljava/lang/String;)J",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_submitDelete },
+    { "pollCompletions", "(L" SOVEREIGN_JNI_CLASS("StorageCallback") ";)I",
+      (void*)Java_com_sovereigndroid_core_SecureStorage_pollCompletions },
+};
+
+int secure_storage_async_register_natives(JNIEnv* env) {
+    if (!g_callback_class) {
+        g_callback_class = sovereign_jni_find_class(env, SOVEREIGN_JNI_CLASS("StorageCallback"));
+        if (g_callback_class) {
+            g_on_complete = (*env)->GetMethodID(env, g_callback_class, "onComplete", "(JII[B)V");
+            if (!g_on_complete) {
+                (*env)->ExceptionClear(env);
+                LOGE("StorageCallback.onComplete(JII[B)V not found");
+            }
+        }
+    }
+    int registered = sovereign_jni_register(env, SOVEREIGN_JNI_CLASS("SecureStorage"), g_async_methods,
+                                            SOVEREIGN_JNI_COUNT(g_async_methods));
+    return registered > 0 ? registered : 0;
+}
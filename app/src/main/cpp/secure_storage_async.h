@@ -0,0 +1,130 @@
+/*
+ * SovereignDroid Secure Storage - Asynchronous API
+ *
+ * Submit put/get/delete without blocking the caller (render thread).
+ * Each submission returns a ticket; results arrive on a completion queue
+ * signalled through an eventfd that can be added to an ALooper.
+ *
+ * - Operations run on a small worker pool, so encryption and disk I/O
+ *   of independent keys overlap
+ * - Operations on the same key run in submission order
+ * - GET results are delivered in secure buffers (secure_storage_free)
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_ASYNC_H
+#define SOVEREIGNDROID_SECURE_STORAGE_ASYNC_H
+
+#include "sovereign_jni.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Operation codes
+#define SECURE_STORAGE_OP_PUT 1
+#define SECURE_STORAGE_OP_GET 2
+#define SECURE_STORAGE_OP_DELETE 3
+
+typedef struct {
+    uint64_t ticket;
+    int op;
+    int status;             // 0 on success, -1 on failure (as the blocking API)
+    void* user_data;
+    uint8_t* data;          // GET only: plaintext, release with secure_storage_free
+    size_t data_len;
+} secure_storage_completion_t;
+
+/*
+ * Start the worker pool (worker_count 0 picks the default)
+ * Storage must be initialized first
+ * Returns 0 on success
+ */
+int secure_storage_async_start(int worker_count);
+
+/*
+ * Finish queued operations, stop the workers and drop undelivered results
+ */
+void secure_storage_async_stop(void);
+
+/*
+ * eventfd that becomes readable when completions are pending
+ * (register with ALooper_addFd, ALOOPER_EVENT_INPUT); -1 if not started
+ */
+int secure_storage_async_fd(void);
+
+/*
+ * Queue an operation; key and data are copied
+ * Returns a ticket, 0 if the operation could not be queued
+ */
+uint64_t secure_storage_submit_put(const char* key, const uint8_t* data, size_t data_len, void* user_data);
+uint64_t secure_storage_submit_get(const char* key, void* user_data);
+uint64_t secure_storage_submit_delete(const char* key, void* user_data);
+
+/*
+ * Move up to max completions into out
+ * Returns the number of completions written
+ */
+size_t secure_storage_poll_completions(secure_storage_completion_t* out, size_t max);
+
+/*
+ * JNI API for Kotlin/Java (methods on SecureStorage)
+ * Completions are delivered to com.sovereigndroid.core.StorageCallback:
+ *   void onComplete(long ticket, int op, int status, byte[] data)
+ * data is null except for a successful GET
+ */
+
+/*
+ * Method:    asyncStart
+ * Signature: (I)I
+ * Returns the eventfd to watch, -1 on failure
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_asyncStart(JNIEnv* env, jobject thiz, jint workers);
+
+/*
+ * Method:    asyncStop
+ * Signature: ()V
+ */
+SOVEREIGN_JNI_EXPORT void JNICALL
+Java_com_sovereigndroid_core_SecureStorage_asyncStop(JNIEnv* env, jobject thiz);
+
+/*
+ * Method:    submitPut
+ * Signature: (Ljava/lang/String;[B)J
+ * Returns a ticket, 0 if not queued (also for submitGet/submitDelete)
+ */
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitPut(JNIEnv* env, jobject thiz,
+                                                    jstring key, jbyteArray value);
+
+/*
+ * Method:    submitGet
+ * Signature: (Ljava/lang/String;)J
+ */
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitGet(JNIEnv* env, jobject thiz, jstring key);
+
+/*
+ * Method:    submitDelete
+ * Signature: (Ljava/lang/String;)J
+ */
+SOVEREIGN_JNI_EXPORT jlong JNICALL
+Java_com_sovereigndroid_core_SecureStorage_submitDelete(JNIEnv* env, jobject thiz, jstring key);
+
+/*
+ * Method:    pollCompletions
+ * Signature: (Lcom/sovereigndroid/core/StorageCallback;)I
+ * Returns the number of completions delivered, -1 if StorageCallback
+ * was not found at load
+ */
+SOVEREIGN_JNI_EXPORT jint JNICALL
+Java_com_sovereigndroid_core_SecureStorage_pollCompletions(JNIEnv* env, jobject thiz,
+                                                          jobject callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_ASYNC_H
@@ -0,0 +1,760 @@
+/*
+ * SovereignDroid Secure Storage - Encrypted Backup Archive Implementation
+ *
+ * Archive layout:
+ *   header  [magic "SDBK"][version u8][reserved 3][segment_size u32][salt 16]
+ *   segment [frame u32: plaintext length | last << 31][ciphertext][tag 16]
+ *
+ * The segments carry one plaintext stream of entries
+ *   [name_len u16 > 0][name][value_len u64][value]
+ * closed by [0 u16][entry count u64].
+ *
+ * The subkey is SHA-512(key || label || header) truncated to 32 bytes, so
+ * every archive gets a fresh key (counter nonces never repeat) and any
+ * change to the header breaks every segment. Segment i is sealed with
+ * nonce [i u64][last u32]: a dropped, moved or relabelled segment fails
+ * its tag, and an archive without a last segment is truncated.
+ */
+
+#include "secure_storage_backup.h"
+#include "secure_storage.h"
+#include "secure_buffer.h"
+#include "sovereign_crypto.h"
+#include "sovereign_sha512.h"
+#include <android/log.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "SecureStorageBackup"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define BACKUP_MAGIC "SDBK"
+#define BACKUP_VERSION 1
+#define BACKUP_HEADER_SIZE 28
+#define BACKUP_SALT_SIZE 16
+#define BACKUP_FRAME_SIZE 4
+#define BACKUP_FRAME_LAST 0x80000000u
+#define BACKUP_SEGMENT_SIZE (64 * 1024)
+#define BACKUP_MAX_WORKERS 4
+#define BACKUP_SLOTS_PER_WORKER 2
+#define BACKUP_MAX_PATH 512
+
+static const char BACKUP_KDF_LABEL[] = "SovereignDroid backup v1";
+
+// Values up to this size are imported with one store; larger ones stream
+#define BACKUP_IMPORT_STREAM_THRESHOLD SECURE_STORAGE_CHUNK_DEFAULT
+
+// Small values are stored in batches of up to this many bytes (names
+// included) or items, one log write batch and one sync each
+#define BACKUP_IMPORT_BATCH_BYTES (1024 * 1024)
+#define BACKUP_IMPORT_BATCH_ITEMS 256
+
+// ============================================================================
+// Shared helpers
+// ============================================================================
+
+static void put_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_le64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_le64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int write_all(int fd, const uint8_t* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Returns bytes read; less than len only at end of file (-1 on error)
+static ssize_t read_all(int fd, uint8_t* p, size_t len) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = read(fd, p + total, len - total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+static void derive_subkey(const uint8_t key[SECURE_STORAGE_BACKUP_KEY_SIZE],
+                          const uint8_t header[BACKUP_HEADER_SIZE],
+                          uint8_t subkey[CHACHA20_KEY_SIZE]) {
+    sha512_ctx ctx;
+    uint8_t digest[64];
+    sha512_init(&ctx);
+    sha512_update(&ctx, key, SECURE_STORAGE_BACKUP_KEY_SIZE);
+    sha512_update(&ctx, (const uint8_t*)BACKUP_KDF_LABEL, sizeof(BACKUP_KDF_LABEL) - 1);
+    sha512_update(&ctx, header, BACKUP_HEADER_SIZE);
+    sha512_final(&ctx, digest);
+    memcpy(subkey, digest, CHACHA20_KEY_SIZE);
+    secure_buffer_wipe(digest, sizeof(digest));
+    secure_buffer_wipe(&ctx, sizeof(ctx));
+}
+
+static void segment_nonce(uint64_t index, int last, uint8_t nonce[CHACHA20_NONCE_SIZE]) {
+    put_le64(nonce, index);
+    put_le32(nonce + 8, last ? 1 : 0);
+}
+
+static void finish_stats(secure_storage_backup_stats_t* stats, uint64_t start_us) {
+    stats->elapsed_us = now_us() - start_us;
+    double seconds = (double)(stats->elapsed_us ? stats->elapsed_us : 1) / 1e6;
+    stats->throughput_mb_s = (float)((double)stats->archive_bytes / (1024.0 * 1024.0) / seconds);
+}
+
+/*
+ * ========================================================================
+ * Export: the calling thread fills segment slots in order, workers seal
+ * them, and the caller writes each slot out before reusing it
+ * ========================================================================
+ */
+
+enum { SLOT_FREE, SLOT_FILLED, SLOT_SEALING, SLOT_SEALED, SLOT_FAILED };
+
+typedef struct {
+    uint8_t* plain;             // Secure buffer, BACKUP_SEGMENT_SIZE
+    uint8_t* sealed;            // Frame + ciphertext + tag
+    size_t plain_len;
+    uint64_t index;
+    int last;
+    int state;
+} backup_slot_t;
+
+typedef struct {
+    int fd;
+    uint8_t subkey[CHACHA20_KEY_SIZE];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // Slot state changes and stop
+    backup_slot_t slots[BACKUP_MAX_WORKERS * BACKUP_SLOTS_PER_WORKER];
+    int slot_count;
+    pthread_t workers[BACKUP_MAX_WORKERS];
+    int worker_count;
+    int stop;
+
+    uint64_t next_index;        // Segment being filled
+    uint64_t next_write;        // Oldest segment not yet written
+    backup_slot_t* current;
+    int failed;
+
+    uint8_t* value_buffer;      // Secure buffer for reading values
+    secure_storage_backup_stats_t* stats;
+} export_ctx_t;
+
+static void seal_slot(export_ctx_t* ctx, backup_slot_t* slot) {
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+    segment_nonce(slot->index, slot->last, nonce);
+
+    put_le32(slot->sealed, (uint32_t)slot->plain_len | (slot->last ? BACKUP_FRAME_LAST : 0));
+    int ok = chacha20_poly1305_encrypt(ctx->subkey, nonce, slot->plain, slot->plain_len,
+                                       slot->sealed + BACKUP_FRAME_SIZE,
+                                       slot->sealed + BACKUP_FRAME_SIZE + slot->plain_len);
+
+    pthread_mutex_lock(&ctx->lock);
+    slot->state = ok ? SLOT_SEALED : SLOT_FAILED;
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void* export_worker(void* arg) {
+    export_ctx_t* ctx = (export_ctx_t*)arg;
+
+    pthread_mutex_lock(&ctx->lock);
+    for (;;) {
+        backup_slot_t* slot = NULL;
+        for (int i = 0; i < ctx->slot_count && !slot; i++) {
+            if (ctx->slots[i].state == SLOT_FILLED) slot = &ctx->slots[i];
+        }
+        if (!slot) {
+            if (ctx->stop) break;
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+            continue;
+        }
+
+        slot->state = SLOT_SEALING;
+        pthread_mutex_unlock(&ctx->lock);
+        seal_slot(ctx, slot);
+        pthread_mutex_lock(&ctx->lock);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+/*
+ * Wait for the oldest unwritten segment, write it and free its slot
+ */
+static int write_oldest(export_ctx_t* ctx) {
+    backup_slot_t* slot = &ctx->slots[ctx->next_write % (uint64_t)ctx->slot_count];
+
+    pthread_mutex_lock(&ctx->lock);
+    while (slot->state != SLOT_SEALED && slot->state != SLOT_FAILED) {
+        pthread_cond_wait(&ctx->cond, &ctx->lock);
+    }
+    int sealed = (slot->state == SLOT_SEALED);
+    pthread_mutex_unlock(&ctx->lock);
+
+    size_t len = BACKUP_FRAME_SIZE + slot->plain_len + POLY1305_TAG_SIZE;
+    if (!sealed || !write_all(ctx->fd, slot->sealed, len)) {
+        LOGE("Failed to %s backup segment %llu", sealed ? "write" : "seal",
+             (unsigned long long)slot->index);
+        ctx->failed = 1;
+    }
+    ctx->stats->archive_bytes += len;
+    ctx->next_write++;
+
+    pthread_mutex_lock(&ctx->lock);
+    slot->state = SLOT_FREE;
+    pthread_mutex_unlock(&ctx->lock);
+    return !ctx->failed;
+}
+
+/*
+ * Hand the current slot to the workers and take the next one
+ */
+static int submit_segment(export_ctx_t* ctx, int last) {
+    backup_slot_t* slot = ctx->current;
+    slot->index = ctx->next_index++;
+    slot->last = last;
+
+    pthread_mutex_lock(&ctx->lock);
+    slot->state = SLOT_FILLED;
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (last) {
+        ctx->current = NULL;
+        return 1;
+    }
+
+    // Every slot in flight: write the oldest to make room
+    if (ctx->next_index - ctx->next_write >= (uint64_t)ctx->slot_count &&
+        !write_oldest(ctx)) {
+        return 0;
+    }
+    ctx->current = &ctx->slots[ctx->next_index % (uint64_t)ctx->slot_count];
+    ctx->current->plain_len = 0;
+    return 1;
+}
+
+static int export_append(export_ctx_t* ctx, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        backup_slot_t* slot = ctx->current;
+        size_t room = BACKUP_SEGMENT_SIZE - slot->plain_len;
+        size_t n = len < room ? len : room;
+
+        memcpy(slot->plain + slot->plain_len, data, n);
+        slot->plain_len += n;
+        data += n;
+        len -= n;
+
+        if (slot->plain_len == BACKUP_SEGMENT_SIZE && !submit_segment(ctx, 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * secure_storage_key_visitor_t: append one entry, reading the value
+ * through a reader so large streamed values never sit in memory whole
+ */
+static int export_key(const char* key, void* arg) {
+    export_ctx_t* ctx = (export_ctx_t*)arg;
+    size_t name_len = strlen(key);
+    if (name_len == 0 || name_len > UINT16_MAX) {
+        LOGW("Skipping key with unsupported name length %zu", name_len);
+        return 1;
+    }
+
+    secure_storage_reader_t* reader = secure_storage_open_reader(key);
+    if (!reader) {
+        // Deleted since the scan snapshot
+        return 1;
+    }
+
+    uint64_t value_len = secure_storage_reader_size(reader);
+    uint8_t prefix[8];
+    put_le16(prefix, (uint16_t)name_len);
+    int ok = export_append(ctx, prefix, 2) &&
+             export_append(ctx, (const uint8_t*)key, name_len);
+    put_le64(prefix, value_len);
+    ok = ok && export_append(ctx, prefix, 8);
+
+    uint64_t remaining = value_len;
+    while (ok && remaining > 0) {
+        size_t read_len;
+        if (secure_storage_read(reader, ctx->value_buffer, BACKUP_SEGMENT_SIZE, &read_len) != 0 ||
+            read_len == 0 || read_len > remaining) {
+            LOGE("Failed to read value for backup: %s", key);
+            ok = 0;
+            break;
+        }
+        ok = export_append(ctx, ctx->value_buffer, read_len);
+        remaining -= read_len;
+    }
+    secure_storage_close_reader(reader);
+
+    if (!ok) {
+        ctx->failed = 1;
+        return 0;
+    }
+    ctx->stats->keys++;
+    ctx->stats->value_bytes += value_len;
+    return 1;
+}
+
+static void export_teardown(export_ctx_t* ctx) {
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stop = 1;
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+    for (int i = 0; i < ctx->worker_count; i++) {
+        pthread_join(ctx->workers[i], NULL);
+    }
+
+    for (int i = 0; i < ctx->slot_count; i++) {
+        secure_buffer_free(ctx->slots[i].plain);
+        free(ctx->slots[i].sealed);
+    }
+    secure_buffer_free(ctx->value_buffer);
+    secure_buffer_wipe(ctx->subkey, sizeof(ctx->subkey));
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->lock);
+}
+
+static int default_workers(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > BACKUP_MAX_WORKERS ? BACKUP_MAX_WORKERS : (int)cpus;
+}
+
+int secure_storage_export(const char* path, const uint8_t key[SECURE_STORAGE_BACKUP_KEY_SIZE],
+                          int threads, secure_storage_backup_stats_t* stats) {
+    secure_storage_backup_stats_t local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+    uint64_t start_us = now_us();
+
+    if (threads <= 0) threads = default_workers();
+    if (threads > BACKUP_MAX_WORKERS) threads = BACKUP_MAX_WORKERS;
+
+    char tmp_path[BACKUP_MAX_PATH];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        LOGE("Backup path too long: %s", path);
+        return -1;
+    }
+
+    uint8_t header[BACKUP_HEADER_SIZE] = {0};
+    memcpy(header, BACKUP_MAGIC, 4);
+    header[4] = BACKUP_VERSION;
+    put_le32(header + 8, BACKUP_SEGMENT_SIZE);
+    if (!sovereign_random_bytes(header + 12, BACKUP_SALT_SIZE)) {
+        return -1;
+    }
+
+    export_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.stats = stats;
+    ctx.slot_count = threads * BACKUP_SLOTS_PER_WORKER;
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+    derive_subkey(key, header, ctx.subkey);
+
+    ctx.value_buffer = secure_buffer_alloc(BACKUP_SEGMENT_SIZE);
+    int ok = ctx.value_buffer != NULL;
+    for (int i = 0; ok && i < ctx.slot_count; i++) {
+        ctx.slots[i].plain = secure_buffer_alloc(BACKUP_SEGMENT_SIZE);
+        ctx.slots[i].sealed = malloc(BACKUP_FRAME_SIZE + BACKUP_SEGMENT_SIZE + POLY1305_TAG_SIZE);
+        ok = ctx.slots[i].plain && ctx.slots[i].sealed;
+    }
+    for (int i = 0; ok && i < threads; i++) {
+        if (pthread_create(&ctx.workers[i], NULL, export_worker, &ctx) != 0) break;
+        ctx.worker_count++;
+    }
+    if (!ok || ctx.worker_count == 0) {
+        LOGE("Failed to set up backup export");
+        export_teardown(&ctx);
+        return -1;
+    }
+
+    ctx.fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (ctx.fd < 0) {
+        LOGE("Failed to create backup file: %s", tmp_path);
+        export_teardown(&ctx);
+        return -1;
+    }
+    ok = write_all(ctx.fd, header, sizeof(header));
+    stats->archive_bytes = sizeof(header);
+
+    ctx.current = &ctx.slots[0];
+    ok = ok && secure_storage_scan(NULL, NULL, export_key, &ctx) >= 0 && !ctx.failed;
+
+    // End marker, then the last segment (possibly short or empty)
+    uint8_t trailer[10];
+    put_le16(trailer, 0);
+    put_le64(trailer + 2, stats->keys);
+    ok = ok && export_append(&ctx, trailer, sizeof(trailer)) && submit_segment(&ctx, 1);
+
+    // Drain: submitted slots must be sealed before their buffers are freed
+    while (ctx.next_write < ctx.next_index) {
+        if (!write_oldest(&ctx)) ok = 0;
+    }
+    ok = ok && !ctx.failed && fsync(ctx.fd) == 0;
+    close(ctx.fd);
+    export_teardown(&ctx);
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        LOGE("Backup export failed: %s", path);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    finish_stats(stats, start_us);
+    LOGI("Exported %llu keys (%llu bytes) in %.1f ms, %.1f MB/s on %d threads",
+         (unsigned long long)stats->keys, (unsigned long long)stats->archive_bytes,
+         (double)stats->elapsed_us / 1000.0, (double)stats->throughput_mb_s, threads);
+    return 0;
+}
+
+/*
+ * ========================================================================
+ * Import: decrypt segments in order and parse entries across them
+ * ========================================================================
+ */
+
+typedef struct {
+    int fd;
+    uint8_t subkey[CHACHA20_KEY_SIZE];
+    uint32_t segment_size;
+    uint8_t* sealed;
+    uint8_t* plain;             // Secure buffer, segment_size
+    size_t plain_len;
+    size_t plain_pos;
+    uint64_t next_index;
+    int saw_last;
+    uint64_t entries;           // Entries parsed, checked against the trailer
+    secure_storage_backup_stats_t* stats;
+} import_ctx_t;
+
+/*
+ * Read and authenticate the next segment; decrypt 0 checks its tag only
+ */
+static int load_segment(import_ctx_t* ctx, int decrypt) {
+    if (ctx->saw_last) {
+        LOGE("Backup archive has data past its last segment");
+        return 0;
+    }
+
+    uint8_t frame[BACKUP_FRAME_SIZE];
+    if (read_all(ctx->fd, frame, sizeof(frame)) != (ssize_t)sizeof(frame)) {
+        LOGE("Backup archive is truncated at segment %llu", (unsigned long long)ctx->next_index);
+        return 0;
+    }
+    uint32_t word = get_le32(frame);
+    int last = (word & BACKUP_FRAME_LAST) != 0;
+    size_t len = word & ~BACKUP_FRAME_LAST;
+    if (len > ctx->segment_size || (!last && len != ctx->segment_size)) {
+        LOGE("Backup segment %llu has invalid length", (unsigned long long)ctx->next_index);
+        return 0;
+    }
+
+    size_t sealed_len = len + POLY1305_TAG_SIZE;
+    if (read_all(ctx->fd, ctx->sealed, sealed_len) != (ssize_t)sealed_len) {
+        LOGE("Backup archive is truncated at segment %llu", (unsigned long long)ctx->next_index);
+        return 0;
+    }
+
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+    segment_nonce(ctx->next_index, last, nonce);
+    int authentic = decrypt
+                  ? chacha20_poly1305_decrypt(ctx->subkey, nonce, ctx->sealed, len,
+                                              ctx->sealed + len, ctx->plain)
+                  : chacha20_poly1305_verify(ctx->subkey, nonce, ctx->sealed, len,
+                                             ctx->sealed + len);
+    if (!authentic) {
+        LOGE("Backup segment %llu failed authentication", (unsigned long long)ctx->next_index);
+        return 0;
+    }
+
+    ctx->next_index++;
+    ctx->saw_last = last;
+    if (decrypt) {
+        ctx->stats->archive_bytes += sizeof(frame) + sealed_len;
+        ctx->plain_len = len;
+        ctx->plain_pos = 0;
+    }
+    return 1;
+}
+
+/*
+ * Check every segment's tag up to the last one and the end of file, then
+ * rewind to the first segment. Tags are checked without decrypting, so
+ * this costs one Poly1305 pass and nothing is stored from an archive that
+ * is truncated, reordered or tampered with.
+ */
+static int verify_segments(import_ctx_t* ctx) {
+    off_t start = lseek(ctx->fd, 0, SEEK_CUR);
+    if (start < 0) return 0;
+
+    while (!ctx->saw_last) {
+        if (!load_segment(ctx, 0)) return 0;
+    }
+    uint8_t probe;
+    if (read_all(ctx->fd, &probe, 1) != 0) {
+        LOGE("Backup archive has data past its last segment");
+        return 0;
+    }
+
+    ctx->next_index = 0;
+    ctx->saw_last = 0;
+    return lseek(ctx->fd, start, SEEK_SET) == start;
+}
+
+static int import_read(import_ctx_t* ctx, uint8_t* out, size_t len) {
+    while (len > 0) {
+        if (ctx->plain_pos == ctx->plain_len && !load_segment(ctx, 1)) {
+            return 0;
+        }
+        size_t n = ctx->plain_len - ctx->plain_pos;
+        if (n > len) n = len;
+        memcpy(out, ctx->plain + ctx->plain_pos, n);
+        ctx->plain_pos += n;
+        out += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Small values decoded but not stored yet
+typedef struct {
+    uint8_t* arena;             // Secure buffer of BACKUP_IMPORT_BATCH_BYTES: names and values
+    size_t used;
+    secure_storage_item_t items[BACKUP_IMPORT_BATCH_ITEMS];
+    size_t count;
+} import_batch_t;
+
+/*
+ * Store the collected small values with one secure_storage_store_many
+ */
+static int import_flush(import_ctx_t* ctx, import_batch_t* batch) {
+    if (batch->count == 0) return 1;
+
+    int results[BACKUP_IMPORT_BATCH_ITEMS];
+    int ok = secure_storage_store_many(batch->items, batch->count, results) == 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        if (results[i] != 0) {
+            LOGE("Failed to import key: %s", batch->items[i].key);
+            continue;
+        }
+        ctx->stats->keys++;
+        ctx->stats->value_bytes += batch->items[i].data_len;
+    }
+
+    secure_buffer_wipe(batch->arena, batch->used);
+    batch->used = 0;
+    batch->count = 0;
+    return ok;
+}
+
+/*
+ * Store one value of value_len bytes read from the archive: small ones
+ * join the batch, larger ones flush it and stream through a writer
+ */
+static int import_value(import_ctx_t* ctx, import_batch_t* batch, const char* name,
+                        size_t name_len, uint64_t value_len, uint8_t* buffer) {
+    if (value_len <= BACKUP_IMPORT_STREAM_THRESHOLD) {
+        size_t need = name_len + 1 + (size_t)value_len;
+        if ((batch->used + need > BACKUP_IMPORT_BATCH_BYTES ||
+             batch->count == BACKUP_IMPORT_BATCH_ITEMS) && !import_flush(ctx, batch)) {
+            return 0;
+        }
+
+        char* key = (char*)batch->arena + batch->used;
+        uint8_t* data = (uint8_t*)key + name_len + 1;
+        memcpy(key, name, name_len + 1);
+        if (!import_read(ctx, data, (size_t)value_len)) return 0;
+
+        batch->items[batch->count].key = key;
+        batch->items[batch->count].data = data;
+        batch->items[batch->count].data_len = (size_t)value_len;
+        batch->count++;
+        batch->used += need;
+        return 1;
+    }
+
+    if (!import_flush(ctx, batch)) return 0;
+    secure_storage_writer_t* writer = secure_storage_open_writer(name, 0);
+    if (!writer) return 0;
+
+    uint64_t remaining = value_len;
+    while (remaining > 0) {
+        size_t n = remaining < BACKUP_SEGMENT_SIZE ? (size_t)remaining : BACKUP_SEGMENT_SIZE;
+        if (!import_read(ctx, buffer, n) || secure_storage_write(writer, buffer, n) != 0) {
+            secure_storage_abort_writer(writer);
+            return 0;
+        }
+        remaining -= n;
+    }
+    if (secure_storage_close_writer(writer) != 0) return 0;
+
+    ctx->stats->keys++;
+    ctx->stats->value_bytes += value_len;
+    return 1;
+}
+
+static int import_entries(import_ctx_t* ctx, uint8_t* buffer) {
+    import_batch_t batch = { .arena = secure_buffer_alloc(BACKUP_IMPORT_BATCH_BYTES) };
+    char* name = malloc(UINT16_MAX + 1);
+    if (!name || !batch.arena) {
+        free(name);
+        secure_buffer_free(batch.arena);
+        return 0;
+    }
+
+    int ok = 1;
+    for (;;) {
+        uint8_t prefix[8];
+        if (!import_read(ctx, prefix, 2)) {
+            ok = 0;
+            break;
+        }
+        uint16_t name_len = get_le16(prefix);
+
+        if (name_len == 0) {
+            // End marker: entry count, then nothing but the end of file
+            uint8_t probe;
+            ok = import_read(ctx, prefix, 8) && get_le64(prefix) == ctx->entries &&
+                 ctx->plain_pos == ctx->plain_len && ctx->saw_last &&
+                 read_all(ctx->fd, &probe, 1) == 0;
+            if (!ok) LOGE("Backup archive trailer does not match its contents");
+            ok = ok && import_flush(ctx, &batch);
+            break;
+        }
+
+        if (!import_read(ctx, (uint8_t*)name, name_len) || !import_read(ctx, prefix, 8)) {
+            ok = 0;
+            break;
+        }
+        name[name_len] = '\0';
+        uint64_t value_len = get_le64(prefix);
+
+        if (strlen(name) != name_len ||
+            !import_value(ctx, &batch, name, name_len, value_len, buffer)) {
+            LOGE("Failed to import key: %s", name);
+            ok = 0;
+            break;
+        }
+        ctx->entries++;
+    }
+
+    secure_buffer_wipe(name, UINT16_MAX + 1);
+    free(name);
+    secure_buffer_free(batch.arena);
+    return ok;
+}
+
+int secure_storage_import(const char* path, const uint8_t key[SECURE_STORAGE_BACKUP_KEY_SIZE],
+                          secure_storage_backup_stats_t* stats) {
+    secure_storage_backup_stats_t local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+    uint64_t start_us = now_us();
+
+    import_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.stats = stats;
+    ctx.fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (ctx.fd < 0) {
+        LOGE("Failed to open backup file: %s", path);
+        return -1;
+    }
+
+    uint8_t header[BACKUP_HEADER_SIZE];
+    if (read_all(ctx.fd, header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        memcmp(header, BACKUP_MAGIC, 4) != 0 || header[4] != BACKUP_VERSION) {
+        LOGE("Not a backup archive: %s", path);
+        close(ctx.fd);
+        return -1;
+    }
+    ctx.segment_size = get_le32(header + 8);
+    if (ctx.segment_size == 0 || ctx.segment_size > 16 * BACKUP_SEGMENT_SIZE) {
+        LOGE("Unsupported backup segment size %u", ctx.segment_size);
+        close(ctx.fd);
+        return -1;
+    }
+    stats->archive_bytes = sizeof(header);
+    derive_subkey(key, header, ctx.subkey);
+
+    size_t buffer_size = ctx.segment_size > BACKUP_IMPORT_STREAM_THRESHOLD
+                       ? ctx.segment_size : BACKUP_IMPORT_STREAM_THRESHOLD;
+    ctx.sealed = malloc(ctx.segment_size + POLY1305_TAG_SIZE);
+    ctx.plain = secure_buffer_alloc(ctx.segment_size);
+    uint8_t* buffer = secure_buffer_alloc(buffer_size);
+
+    int ok = ctx.sealed && ctx.plain && buffer && verify_segments(&ctx) &&
+             import_entries(&ctx, buffer);
+
+    secure_buffer_free(buffer);
+    secure_buffer_free(ctx.plain);
+    free(ctx.sealed);
+    secure_buffer_wipe(ctx.subkey, sizeof(ctx.subkey));
+    close(ctx.fd);
+
+    finish_stats(stats, start_us);
+    if (!ok) {
+        LOGE("Backup import failed after %llu keys: %s", (unsigned long long)stats->keys, path);
+        return -1;
+    }
+    LOGI("Imported %llu keys (%llu bytes) in %.1f ms, %.1f MB/s",
+         (unsigned long long)stats->keys, (unsigned long long)stats->archive_bytes,
+         (double)stats->elapsed_us / 1000.0, (double)stats->throughput_mb_s);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * SovereignDroid Secure Storage - Encrypted Backup Archives
+ *
+ * Export every key into one file and load it back, on this device or
+ * another one. The archive is sealed with a caller-supplied 32-byte key,
+ * not the device master key, so it can move between installs.
+ *
+ * - Segmented AEAD (STREAM construction): the plaintext is cut into
+ *   fixed-size segments, each sealed with ChaCha20-Poly1305 under a
+ *   per-archive subkey and a nonce of (segment index, last flag), so
+ *   reordering, truncation and splicing are all detected
+ * - Export seals segments on a worker pool while the calling thread
+ *   reads values and writes finished segments in order
+ * - Memory stays constant: a few segments in flight, values read and
+ *   written chunk by chunk
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_BACKUP_H
+#define SOVEREIGNDROID_SECURE_STORAGE_BACKUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SECURE_STORAGE_BACKUP_KEY_SIZE 32
+
+typedef struct {
+    uint64_t keys;              // Keys exported or imported
+    uint64_t value_bytes;       // Plaintext value bytes
+    uint64_t archive_bytes;     // Archive file size
+    uint64_t elapsed_us;
+    float throughput_mb_s;      // Archive bytes per second of wall time
+} secure_storage_backup_stats_t;
+
+/*
+ * Write every key to an archive at path (replaced atomically)
+ * threads 0 picks one sealing thread per online CPU, up to 4
+ * Returns 0 on success, -1 on failure (stats may be NULL)
+ */
+int secure_storage_export(const char* path, const uint8_t key[SECURE_STORAGE_BACKUP_KEY_SIZE],
+                          int threads, secure_storage_backup_stats_t* stats);
+
+/*
+ * Store every key from an archive, replacing existing values.
+ * Every segment tag is checked before the first key is stored, so a
+ * truncated or tampered archive stores nothing. Keys are then stored in
+ * archive order, small values in batches of up to 1 MiB with one sync
+ * each. A failure after that point (storage error, trailer mismatch, or
+ * the file changing during the import) leaves the keys stored so far.
+ * Returns 0 on success, -1 on failure (stats count what was stored)
+ */
+int secure_storage_import(const char* path, const uint8_t key[SECURE_STORAGE_BACKUP_KEY_SIZE],
+                          secure_storage_backup_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_BACKUP_H
@@ -0,0 +1,366 @@
+/*
+ * SovereignDroid Secure Storage - Plaintext Cache Implementation
+ *
+ * Chained hash table for lookup plus an intrusive doubly linked list in
+ * recency order. Head is most recently used, tail is evicted first.
+ */
+
+#include "secure_storage_cache.h"
+#include "secure_buffer.h"
+#include <android/log.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "SecureStorageCache"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// Initial bucket count (power of two)
+#define CACHE_INITIAL_BUCKETS 64
+
+// Values larger than budget / CACHE_MAX_VALUE_FRACTION are not cached,
+// so one bulk value cannot flush every hot key
+#define CACHE_MAX_VALUE_FRACTION 8
+
+typedef struct cache_entry {
+    storage_key_id_t key_id;
+    size_t value_len;
+    uint8_t* value;
+    struct cache_entry* bucket_next;
+    struct cache_entry* prev;   // Towards head (more recent)
+    struct cache_entry* next;   // Towards tail (less recent)
+} cache_entry_t;
+
+#define ENTRY_OVERHEAD sizeof(cache_entry_t)
+
+struct storage_cache {
+    pthread_mutex_t lock;
+    size_t byte_budget;
+    size_t bytes;
+    size_t entries;
+
+    cache_entry_t** buckets;
+    size_t bucket_count;
+    cache_entry_t* head;
+    cache_entry_t* tail;
+
+    // Bumped on every invalidation; fills started before it are dropped
+    uint64_t generation;
+
+    storage_key_id_t* excluded;
+    size_t excluded_count;
+    size_t excluded_capacity;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+};
+
+// The main store's cache, configurable before storage is initialized
+static storage_cache_t g_default_cache = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static size_t bucket_of(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    // Key ids are uniformly distributed; the first word picks the bucket
+    uint32_t h;
+    memcpy(&h, key_id->bytes, sizeof(h));
+    return h & (cache->bucket_count - 1);
+}
+
+static int same_key(const storage_key_id_t* a, const storage_key_id_t* b) {
+    return memcmp(a->bytes, b->bytes, STORAGE_KEY_ID_SIZE) == 0;
+}
+
+// ============================================================================
+// Internal helpers (caller holds the cache lock)
+// ============================================================================
+
+static cache_entry_t* find(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    if (!cache->buckets) return NULL;
+
+    for (cache_entry_t* e = cache->buckets[bucket_of(cache, key_id)]; e; e = e->bucket_next) {
+        if (same_key(&e->key_id, key_id)) return e;
+    }
+    return NULL;
+}
+
+static void list_unlink(storage_cache_t* cache, cache_entry_t* e) {
+    if (e->prev) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void list_push_front(storage_cache_t* cache, cache_entry_t* e) {
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e;
+    cache->head = e;
+    if (!cache->tail) cache->tail = e;
+}
+
+static void remove_entry(storage_cache_t* cache, cache_entry_t* e) {
+    cache_entry_t** link = &cache->buckets[bucket_of(cache, &e->key_id)];
+    while (*link != e) link = &(*link)->bucket_next;
+    *link = e->bucket_next;
+
+    list_unlink(cache, e);
+    cache->bytes -= e->value_len + ENTRY_OVERHEAD;
+    cache->entries--;
+
+    secure_buffer_free(e->value);
+    secure_buffer_wipe(e, sizeof(*e));
+    free(e);
+}
+
+static void evict_to(storage_cache_t* cache, size_t target_bytes) {
+    while (cache->tail && cache->bytes > target_bytes) {
+        remove_entry(cache, cache->tail);
+        cache->evictions++;
+    }
+}
+
+static int grow_buckets(storage_cache_t* cache) {
+    size_t count = cache->bucket_count ? cache->bucket_count * 2 : CACHE_INITIAL_BUCKETS;
+    cache_entry_t** buckets = calloc(count, sizeof(cache_entry_t*));
+    if (!buckets) return 0;
+
+    cache_entry_t** old = cache->buckets;
+    size_t old_count = cache->bucket_count;
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+
+    for (size_t i = 0; i < old_count; i++) {
+        cache_entry_t* e = old[i];
+        while (e) {
+            cache_entry_t* next = e->bucket_next;
+            size_t b = bucket_of(cache, &e->key_id);
+            e->bucket_next = buckets[b];
+            buckets[b] = e;
+            e = next;
+        }
+    }
+    free(old);
+    return 1;
+}
+
+static int excluded(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    for (size_t i = 0; i < cache->excluded_count; i++) {
+        if (same_key(&cache->excluded[i], key_id)) return 1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+storage_cache_t* storage_cache_default(void) {
+    return &g_default_cache;
+}
+
+storage_cache_t* storage_cache_create(size_t byte_budget) {
+    storage_cache_t* cache = calloc(1, sizeof(storage_cache_t));
+    if (!cache) {
+        LOGE("Failed to allocate plaintext cache");
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->byte_budget = byte_budget;
+    return cache;
+}
+
+void storage_cache_destroy(storage_cache_t* cache) {
+    if (!cache || cache == &g_default_cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    evict_to(cache, 0);
+    free(cache->buckets);
+    free(cache->excluded);
+    pthread_mutex_unlock(&cache->lock);
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void storage_cache_configure(storage_cache_t* cache, size_t byte_budget) {
+    pthread_mutex_lock(&cache->lock);
+    cache->byte_budget = byte_budget;
+    evict_to(cache, byte_budget);
+
+    if (byte_budget == 0) {
+        free(cache->buckets);
+        cache->buckets = NULL;
+        cache->bucket_count = 0;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    LOGI("Plaintext cache budget: %zu bytes%s", byte_budget, byte_budget ? "" : " (disabled)");
+}
+
+void storage_cache_exclude(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    pthread_mutex_lock(&cache->lock);
+    if (!excluded(cache, key_id)) {
+        if (cache->excluded_count == cache->excluded_capacity) {
+            size_t capacity = cache->excluded_capacity ? cache->excluded_capacity * 2 : 8;
+            storage_key_id_t* grown = realloc(cache->excluded, capacity * sizeof(storage_key_id_t));
+            if (!grown) {
+                pthread_mutex_unlock(&cache->lock);
+                LOGE("Failed to record no-cache key");
+                return;
+            }
+            cache->excluded = grown;
+            cache->excluded_capacity = capacity;
+        }
+        cache->excluded[cache->excluded_count++] = *key_id;
+    }
+
+    // A value cached before the flag was set must not linger
+    cache_entry_t* e = find(cache, key_id);
+    if (e) remove_entry(cache, e);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int storage_cache_cacheable(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    pthread_mutex_lock(&cache->lock);
+    int cacheable = cache->byte_budget > 0 && !excluded(cache, key_id);
+    pthread_mutex_unlock(&cache->lock);
+    return cacheable;
+}
+
+int storage_cache_get(storage_cache_t* cache, const storage_key_id_t* key_id, uint8_t* out,
+                      size_t out_cap, size_t* value_len) {
+    pthread_mutex_lock(&cache->lock);
+    if (cache->byte_budget == 0 || excluded(cache, key_id)) {
+        pthread_mutex_unlock(&cache->lock);
+        return STORAGE_CACHE_MISS;
+    }
+
+    cache_entry_t* e = find(cache, key_id);
+    if (!e) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return STORAGE_CACHE_MISS;
+    }
+
+    *value_len = e->value_len;
+    if (e->value_len > out_cap) {
+        pthread_mutex_unlock(&cache->lock);
+        return STORAGE_CACHE_TOO_SMALL;
+    }
+
+    memcpy(out, e->value, e->value_len);
+    list_unlink(cache, e);
+    list_push_front(cache, e);
+    cache->hits++;
+    pthread_mutex_unlock(&cache->lock);
+    return STORAGE_CACHE_HIT;
+}
+
+uint8_t* storage_cache_get_copy(storage_cache_t* cache, const storage_key_id_t* key_id,
+                                size_t* value_len) {
+    pthread_mutex_lock(&cache->lock);
+    if (cache->byte_budget == 0 || excluded(cache, key_id)) {
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+
+    cache_entry_t* e = find(cache, key_id);
+    uint8_t* copy = e ? secure_buffer_alloc(e->value_len + 1) : NULL;
+    if (!copy) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+
+    memcpy(copy, e->value, e->value_len);
+    copy[e->value_len] = '\0';
+    *value_len = e->value_len;
+    list_unlink(cache, e);
+    list_push_front(cache, e);
+    cache->hits++;
+    pthread_mutex_unlock(&cache->lock);
+    return copy;
+}
+
+uint64_t storage_cache_fill_token(storage_cache_t* cache) {
+    pthread_mutex_lock(&cache->lock);
+    uint64_t token = cache->generation;
+    pthread_mutex_unlock(&cache->lock);
+    return token;
+}
+
+void storage_cache_put(storage_cache_t* cache, const storage_key_id_t* key_id,
+                       const uint8_t* value, size_t value_len, uint64_t token) {
+    pthread_mutex_lock(&cache->lock);
+
+    size_t cost = value_len + ENTRY_OVERHEAD;
+    if (cache->byte_budget == 0 || excluded(cache, key_id) ||
+        token != cache->generation ||
+        cost > cache->byte_budget / CACHE_MAX_VALUE_FRACTION) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    cache_entry_t* old = find(cache, key_id);
+    if (old) remove_entry(cache, old);
+
+    if ((cache->entries + 1) * 4 > cache->bucket_count * 3 && !grow_buckets(cache)) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    cache_entry_t* e = calloc(1, sizeof(cache_entry_t));
+    uint8_t* copy = secure_buffer_alloc(value_len);
+    if (!e || !copy) {
+        free(e);
+        secure_buffer_free(copy);
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    memcpy(copy, value, value_len);
+    e->key_id = *key_id;
+    e->value = copy;
+    e->value_len = value_len;
+
+    size_t b = bucket_of(cache, key_id);
+    e->bucket_next = cache->buckets[b];
+    cache->buckets[b] = e;
+    list_push_front(cache, e);
+    cache->bytes += cost;
+    cache->entries++;
+
+    evict_to(cache, cache->byte_budget);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void storage_cache_invalidate(storage_cache_t* cache, const storage_key_id_t* key_id) {
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+
+    cache_entry_t* e = find(cache, key_id);
+    if (e) {
+        remove_entry(cache, e);
+        cache->invalidations++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void storage_cache_get_stats(storage_cache_t* cache, storage_cache_stats_t* stats) {
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->invalidations = cache->invalidations;
+    stats->entries = cache->entries;
+    stats->bytes = cache->bytes;
+    stats->byte_budget = cache->byte_budget;
+    pthread_mutex_unlock(&cache->lock);
+}
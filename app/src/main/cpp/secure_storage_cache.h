@@ -0,0 +1,118 @@
+/*
+ * SovereignDroid Secure Storage - Plaintext Cache
+ *
+ * Opt-in LRU cache of decrypted values, bounded by a byte budget.
+ * Saves the log read, Poly1305 verification and ChaCha20 decryption
+ * for hot keys (device identity public key, settings).
+ *
+ * - Disabled until a budget is configured
+ * - Keys marked no-cache (secrets) are never held in plaintext here
+ * - Values live in locked secure buffers, wiped when evicted or invalidated
+ * - One instance per store: the main store uses storage_cache_default(),
+ *   namespaces create their own with independent budgets
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_CACHE_H
+#define SOVEREIGNDROID_SECURE_STORAGE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "secure_storage_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lookup results
+#define STORAGE_CACHE_HIT 1
+#define STORAGE_CACHE_MISS 0
+#define STORAGE_CACHE_TOO_SMALL -1
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    size_t entries;
+    size_t bytes;           // Value bytes plus per-entry overhead
+    size_t byte_budget;     // 0 when disabled
+} storage_cache_stats_t;
+
+typedef struct storage_cache storage_cache_t;
+
+/*
+ * The main store's cache; lives for the whole process, disabled until
+ * configured
+ */
+storage_cache_t* storage_cache_default(void);
+
+/*
+ * Create a cache with its own byte budget (0 = disabled)
+ * Returns NULL on allocation failure
+ */
+storage_cache_t* storage_cache_create(size_t byte_budget);
+
+/*
+ * Wipe every entry and free a cache from storage_cache_create
+ */
+void storage_cache_destroy(storage_cache_t* cache);
+
+/*
+ * Set the byte budget; 0 disables the cache and wipes every entry
+ */
+void storage_cache_configure(storage_cache_t* cache, size_t byte_budget);
+
+/*
+ * Never cache values for this key
+ */
+void storage_cache_exclude(storage_cache_t* cache, const storage_key_id_t* key_id);
+
+/*
+ * Check whether values for this key may be cached
+ * Returns 1 if cacheable
+ */
+int storage_cache_cacheable(storage_cache_t* cache, const storage_key_id_t* key_id);
+
+/*
+ * Copy a cached value into out
+ * Returns STORAGE_CACHE_HIT, STORAGE_CACHE_MISS, or STORAGE_CACHE_TOO_SMALL
+ * (value_len is set on hit and too-small)
+ */
+int storage_cache_get(storage_cache_t* cache, const storage_key_id_t* key_id, uint8_t* out,
+                      size_t out_cap, size_t* value_len);
+
+/*
+ * Return a NUL-terminated copy of a cached value, NULL on miss
+ * The copy is a secure buffer; caller releases it with secure_buffer_free
+ */
+uint8_t* storage_cache_get_copy(storage_cache_t* cache, const storage_key_id_t* key_id,
+                                size_t* value_len);
+
+/*
+ * Token for a fill: take it before reading the log, pass it to
+ * storage_cache_put. A store or delete in between makes the put a no-op,
+ * so a slow reader can never cache a value that was already replaced.
+ */
+uint64_t storage_cache_fill_token(storage_cache_t* cache);
+
+/*
+ * Insert a freshly decrypted value
+ */
+void storage_cache_put(storage_cache_t* cache, const storage_key_id_t* key_id,
+                       const uint8_t* value, size_t value_len, uint64_t token);
+
+/*
+ * Drop and wipe the cached value for a key (on store and delete)
+ */
+void storage_cache_invalidate(storage_cache_t* cache, const storage_key_id_t* key_id);
+
+/*
+ * Snapshot hit/miss counters and occupancy
+ */
+void storage_cache_get_stats(storage_cache_t* cache, storage_cache_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_CACHE_H
@@ -0,0 +1,193 @@
+/*
+ * SovereignDroid Secure Storage - Content-Defined Chunking Implementation
+ *
+ * Cut points follow FastCDC (Xia et al., USENIX ATC 2016): the gear hash
+ * fp = (fp << 1) + gear[byte] is checked against a mask with more bits
+ * before the average size and fewer after it, which pulls chunk lengths
+ * towards the average. Masks use the top bits of fp, so each boundary
+ * depends on the last 64 bytes. The first STORAGE_DEDUP_CHUNK_MIN bytes
+ * of a chunk are skipped without hashing.
+ *
+ * Reference counts sit in an open-addressing table keyed by the chunk
+ * id (already uniformly random). Slots whose count drops to zero stay
+ * until the next grow, which rehashes only live ids.
+ */
+
+#include "secure_storage_dedup.h"
+#include "secure_buffer.h"
+#include "sovereign_siphash.h"
+#include <android/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "SecureStorageDedup"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 15 bits below the average size, 11 above (2^13 = STORAGE_DEDUP_CHUNK_AVG)
+#define CUT_MASK_SMALL (~0ULL << (64 - 15))
+#define CUT_MASK_LARGE (~0ULL << (64 - 11))
+
+#define REFS_INITIAL_SLOTS 1024
+
+typedef struct {
+    storage_key_id_t id;
+    uint32_t refs;
+    uint8_t used;
+} ref_slot_t;
+
+static struct {
+    uint64_t gear[256];
+    uint8_t digest_key[SIPHASH_KEY_SIZE];
+
+    ref_slot_t* slots;
+    size_t slot_count;          // Power of two
+    size_t used;                // Slots taken, live or not
+    size_t live;                // Slots with refs > 0
+} g_dedup;
+
+void storage_dedup_set_key(const uint8_t key[STORAGE_DEDUP_KEY_SIZE]) {
+    // gear[i] = first 8 bytes of SipHash(gear key, i)
+    for (uint32_t i = 0; i < 256; i++) {
+        uint8_t input[4] = { (uint8_t)i, 0, 0, 0 };
+        uint8_t out[SIPHASH_128_SIZE];
+        siphash_128(key, input, sizeof(input), out);
+
+        uint64_t v = 0;
+        for (int b = 0; b < 8; b++) v |= (uint64_t)out[b] << (8 * b);
+        g_dedup.gear[i] = v;
+    }
+    memcpy(g_dedup.digest_key, key + SIPHASH_KEY_SIZE, SIPHASH_KEY_SIZE);
+}
+
+size_t storage_dedup_cut(const uint8_t* data, size_t len) {
+    if (len <= STORAGE_DEDUP_CHUNK_MIN) {
+        return len;
+    }
+    size_t end = len < STORAGE_DEDUP_CHUNK_MAX ? len : STORAGE_DEDUP_CHUNK_MAX;
+    size_t normal = end < STORAGE_DEDUP_CHUNK_AVG ? end : STORAGE_DEDUP_CHUNK_AVG;
+
+    uint64_t fp = 0;
+    size_t i = STORAGE_DEDUP_CHUNK_MIN;
+    for (; i < normal; i++) {
+        fp = (fp << 1) + g_dedup.gear[data[i]];
+        if (!(fp & CUT_MASK_SMALL)) {
+            return i + 1;
+        }
+    }
+    for (; i < end; i++) {
+        fp = (fp << 1) + g_dedup.gear[data[i]];
+        if (!(fp & CUT_MASK_LARGE)) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+void storage_dedup_digest(const uint8_t* data, size_t len, storage_key_id_t* id) {
+    siphash_128(g_dedup.digest_key, data, len, id->bytes);
+}
+
+// ============================================================================
+// Reference counts
+// ============================================================================
+
+static size_t slot_of(const storage_key_id_t* id, size_t slot_count) {
+    uint64_t h;
+    memcpy(&h, id->bytes, sizeof(h));
+    return (size_t)h & (slot_count - 1);
+}
+
+// Slot holding id, or the empty slot where it would go
+static ref_slot_t* find_slot(ref_slot_t* slots, size_t slot_count, const storage_key_id_t* id) {
+    size_t i = slot_of(id, slot_count);
+    while (slots[i].used && memcmp(slots[i].id.bytes, id->bytes, STORAGE_KEY_ID_SIZE) != 0) {
+        i = (i + 1) & (slot_count - 1);
+    }
+    return &slots[i];
+}
+
+/*
+ * Make room for one more slot, keeping the table at most half full
+ */
+static int reserve_slot(void) {
+    if (g_dedup.slots && (g_dedup.used + 1) * 2 <= g_dedup.slot_count) {
+        return 1;
+    }
+
+    size_t slot_count = REFS_INITIAL_SLOTS;
+    while ((g_dedup.live + 1) * 4 > slot_count) slot_count <<= 1;
+
+    ref_slot_t* slots = calloc(slot_count, sizeof(ref_slot_t));
+    if (!slots) {
+        LOGE("Failed to grow chunk reference table to %zu slots", slot_count);
+        return 0;
+    }
+
+    for (size_t i = 0; i < g_dedup.slot_count; i++) {
+        if (g_dedup.slots[i].refs > 0) {
+            *find_slot(slots, slot_count, &g_dedup.slots[i].id) = g_dedup.slots[i];
+        }
+    }
+    free(g_dedup.slots);
+    g_dedup.slots = slots;
+    g_dedup.slot_count = slot_count;
+    g_dedup.used = g_dedup.live;
+    return 1;
+}
+
+uint32_t storage_dedup_ref(const storage_key_id_t* id) {
+    if (!reserve_slot()) {
+        return 0;
+    }
+
+    ref_slot_t* slot = find_slot(g_dedup.slots, g_dedup.slot_count, id);
+    if (!slot->used) {
+        slot->used = 1;
+        slot->id = *id;
+        g_dedup.used++;
+    }
+    if (slot->refs++ == 0) {
+        g_dedup.live++;
+    }
+    return slot->refs;
+}
+
+uint32_t storage_dedup_unref(const storage_key_id_t* id) {
+    if (!g_dedup.slots) {
+        return 0;
+    }
+
+    ref_slot_t* slot = find_slot(g_dedup.slots, g_dedup.slot_count, id);
+    if (slot->refs == 0) {
+        return 0;
+    }
+    if (--slot->refs == 0) {
+        g_dedup.live--;
+    }
+    return slot->refs;
+}
+
+uint32_t storage_dedup_refs(const storage_key_id_t* id) {
+    if (!g_dedup.slots) {
+        return 0;
+    }
+    return find_slot(g_dedup.slots, g_dedup.slot_count, id)->refs;
+}
+
+size_t storage_dedup_live(void) {
+    return g_dedup.live;
+}
+
+void storage_dedup_reset_refs(void) {
+    free(g_dedup.slots);
+    g_dedup.slots = NULL;
+    g_dedup.slot_count = 0;
+    g_dedup.used = 0;
+    g_dedup.live = 0;
+}
+
+void storage_dedup_reset(void) {
+    storage_dedup_reset_refs();
+    secure_buffer_wipe(g_dedup.gear, sizeof(g_dedup.gear));
+    secure_buffer_wipe(g_dedup.digest_key, sizeof(g_dedup.digest_key));
+}
@@ -0,0 +1,88 @@
+/*
+ * SovereignDroid Secure Storage - Content-Defined Chunking
+ *
+ * Large values are cut at content-defined boundaries (FastCDC: a gear
+ * rolling hash with normalized chunking), so an edit only moves the
+ * boundaries next to it and every other chunk comes out byte-identical
+ * to the last store. Each chunk is stored once, under a keyed digest of
+ * its plaintext, and shared by every value that contains it; this
+ * module keeps the reference count of each stored chunk.
+ *
+ * - Gear table and digests are keyed, so neither chunk boundaries nor
+ *   chunk ids can be matched against known content without the key
+ * - Reference counts live in memory only; secure_storage.c rebuilds
+ *   them from the stored recipes on first use
+ * - Not thread safe: the caller serializes every call
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_DEDUP_H
+#define SOVEREIGNDROID_SECURE_STORAGE_DEDUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "secure_storage_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STORAGE_DEDUP_KEY_SIZE 32
+
+// Chunk length bounds and the target average (normalization level 2)
+#define STORAGE_DEDUP_CHUNK_MIN (2 * 1024)
+#define STORAGE_DEDUP_CHUNK_AVG (8 * 1024)
+#define STORAGE_DEDUP_CHUNK_MAX (64 * 1024)
+
+/*
+ * Set the key for the gear table (first half) and digests (second half)
+ */
+void storage_dedup_set_key(const uint8_t key[STORAGE_DEDUP_KEY_SIZE]);
+
+/*
+ * Length of the chunk that starts at data: a content-defined boundary
+ * between STORAGE_DEDUP_CHUNK_MIN and _MAX, or len if that comes first
+ */
+size_t storage_dedup_cut(const uint8_t* data, size_t len);
+
+/*
+ * Keyed 128-bit digest of a chunk, used as its record id
+ */
+void storage_dedup_digest(const uint8_t* data, size_t len, storage_key_id_t* id);
+
+/*
+ * Add a reference to id
+ * Returns the new count, 0 if the table could not grow
+ */
+uint32_t storage_dedup_ref(const storage_key_id_t* id);
+
+/*
+ * Drop a reference to id
+ * Returns the count left; 0 means nothing references it any more
+ */
+uint32_t storage_dedup_unref(const storage_key_id_t* id);
+
+/*
+ * Current reference count of id (0 if unknown)
+ */
+uint32_t storage_dedup_refs(const storage_key_id_t* id);
+
+/*
+ * Number of ids with at least one reference
+ */
+size_t storage_dedup_live(void);
+
+/*
+ * Forget every reference count, keeping the key
+ */
+void storage_dedup_reset_refs(void);
+
+/*
+ * Forget every reference count and wipe the key
+ */
+void storage_dedup_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_DEDUP_H
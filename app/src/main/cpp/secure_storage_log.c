@@ -0,0 +1,2497 @@
+/*
+ * SovereignDroid Secure Storage - Segment Log Implementation
+ *
+ * Record format (little-endian):
+ *   [magic u32][version u8][type u8][flags u16][payload_len u32]
+ *   [checksum u32][seq u64][key_id 16 bytes][key_epoch u32][reserved u32]
+ *   [payload]
+ *
+ * The checksum is CRC32C over the header (checksum field zero) and the
+ * payload. Version 2 records predate it and are accepted unchecked.
+ *
+ * The full key id doubles as the key tag: reads compare it against the
+ * requested id, so two keys can never share a record.
+ *
+ * key_epoch names the master key its payload was sealed under; records
+ * written before key rotation existed read as epoch 0.
+ *
+ * Every record carries a global sequence number. The newest sequence wins,
+ * which keeps recovery correct even though compaction copies old records
+ * into segments with higher ids than the active one.
+ *
+ * Each open log is a storage_log_t owning its directory, index, filter
+ * and compactor; logs share nothing, so several can be open at once.
+ *
+ * Locking (per log):
+ * - The index is split into INDEX_SHARDS tables, each behind its own
+ *   reader-writer lock. Lookups take one shard lock shared and nothing
+ *   else, so readers on different keys never contend.
+ * - log->lock guards the segment table, live/dead accounting and the
+ *   counters. It is only held for in-memory work, never across disk I/O.
+ * - log->append_lock is the single writer queue: appends to the active
+ *   segment are serialized here, encryption happens before it.
+ * - log->compact.lock serializes compaction steps; compact.thread_lock
+ *   guards the background thread and its policy, and nests under it.
+ * - Segment refs and retired are atomic, so readers pin a segment while
+ *   holding just their shard lock.
+ * - log->sync_lock serializes fdatasync calls and guards segment synced
+ *   offsets; log->checkpoint_lock serializes checkpoint writers.
+ * - The key filter is read without locks; log->filter.rebuild_lock
+ *   serializes rebuilds, which take shard locks one at a time.
+ * Order: compact lock, checkpoint lock, append_lock, shard locks
+ * (ascending), log->lock. sync_lock is taken with none of them held
+ * except the checkpoint and compact locks, and only takes log->lock.
+ * rebuild_lock is taken with none of them held.
+ */
+
+#include "secure_storage_log.h"
+#include <android/log.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LOG_TAG "SecureStorageLog"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define MAX_PATH 512
+#define MAX_DIR (MAX_PATH - 32)
+
+// Record layout
+#define RECORD_MAGIC 0x4C524453u   // "SDRL"
+#define RECORD_VERSION 3
+#define RECORD_VERSION_UNCHECKED 2  // No checksum
+#define RECORD_HEADER_SIZE 48
+#define RECORD_CHECKSUM_OFFSET 12
+#define RECORD_PUT 1
+#define RECORD_DELETE 2
+
+// Index checkpoint
+#define CHECKPOINT_FILE "index.ckpt"
+#define CHECKPOINT_MAGIC 0x4B434453u   // "SDCK"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_VERSION_NO_FILTER 1  // Still loaded; the filter is rebuilt
+#define CHECKPOINT_HEADER_SIZE 32
+#define CHECKPOINT_SEGMENT_SIZE 48
+#define CHECKPOINT_ENTRY_SIZE 48
+#define CHECKPOINT_FILTER_HEADER_SIZE 32
+#define CHECKPOINT_INTERVAL_BYTES (8 * 1024 * 1024)
+
+// Index shards (power of two) and initial capacity per shard
+#define INDEX_SHARDS 16
+#define INDEX_INITIAL_CAPACITY 32
+
+// Key filter: blocked Bloom filter, one 512-bit block per key
+#define FILTER_BLOCK_WORDS 8
+#define FILTER_HASHES 6
+#define FILTER_BITS_PER_KEY 16
+#define FILTER_MIN_KEYS 1024
+
+typedef struct {
+    uint8_t version;
+    uint8_t type;
+    uint16_t flags;
+    uint32_t payload_len;
+    uint64_t seq;
+    storage_key_id_t key_id;
+    uint32_t key_epoch;
+} record_header_t;
+
+// Segment roles
+#define SEGMENT_SEALED 0
+#define SEGMENT_ACTIVE 1    // Receives appends from writers
+#define SEGMENT_OUTPUT 2    // Receives relocated records from the compactor
+
+typedef struct {
+    uint32_t id;
+    int fd;
+    int role;
+    int refs;               // Readers/compactor currently using fd (atomic)
+    int retired;            // Removed from table, freed when refs drops to 0 (atomic)
+    int compacting;         // Picked as compaction victim (log->lock)
+    uint64_t size;          // Append position
+    uint64_t synced;        // Prefix known to be on disk (sync_lock)
+    uint64_t live_bytes;    // Bytes of records the index points at
+    uint64_t dead_bytes;    // Bytes of superseded records
+    uint64_t min_seq;       // Oldest record sequence in this segment
+} storage_segment_t;
+
+typedef struct {
+    storage_key_id_t key_id;
+    uint8_t used;
+    uint8_t deleted;        // Newest record for this key is a delete
+    uint16_t flags;         // Flags of the newest record
+    uint32_t key_epoch;     // Key epoch of the newest record
+    uint32_t length;        // Full record length (header + payload)
+    storage_segment_t* segment;
+    uint64_t offset;
+    uint64_t seq;
+} index_entry_t;
+
+// One index shard: open addressing, linear probing
+typedef struct {
+    pthread_rwlock_t lock;
+    index_entry_t* table;
+    size_t capacity;
+    size_t count;
+} index_shard_t;
+
+typedef struct key_filter {
+    uint64_t* words;            // Set with atomic OR, read with atomic loads
+    uint32_t block_mask;
+    size_t capacity;            // Keys it was sized for
+    struct key_filter* retired; // Smaller filters it replaced, freed on close
+} key_filter_t;
+
+/*
+ * Bloom filter over the ids of live keys, checked before the index so
+ * misses take no shard lock. It never has false negatives: every put
+ * sets the key's bits before its index entry is visible. Deleted keys
+ * leave stale bits until the next rebuild.
+ *
+ * Rebuilds happen on a writer thread once the index outgrows the
+ * filter (into a new, larger filter) or enough keys were deleted (in
+ * place). seq is odd while one runs and readers then use the index; a
+ * reader that saw seq change under it does the same. Replaced filters
+ * stay allocated until close, so a late reader never touches freed
+ * memory; growth is geometric, so that costs at most the current size.
+ */
+typedef struct {
+    key_filter_t* current;      // NULL until the log is open (atomic)
+    uint32_t seq;               // Odd while a rebuild runs (atomic)
+    size_t keys;                // Live keys, counting puts since the last rebuild (atomic)
+    size_t stale;               // Keys deleted since the last rebuild (atomic)
+    uint64_t rebuilds;          // rebuild_lock
+    pthread_mutex_t rebuild_lock;
+} log_filter_t;
+
+typedef struct {
+    storage_key_id_t key_id;
+    uint64_t seq;
+    uint64_t old_offset;
+    uint32_t length;
+    storage_segment_t* target;  // NULL when a delete record is dropped
+    uint64_t new_offset;
+} relocation_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    storage_segment_t* victim;  // Pinned while being compacted
+    uint64_t cursor;
+    uint64_t written;           // Bytes relocated out of the victim
+    storage_segment_t* output;
+    relocation_t* relocs;
+    size_t reloc_count;
+    size_t reloc_capacity;
+    uint8_t* buffer;
+    size_t buffer_capacity;
+
+    // Background thread
+    pthread_t thread;
+    int running;
+    int stop;
+    pthread_mutex_t thread_lock;
+    pthread_cond_t thread_cond;
+    storage_compaction_policy_t policy;
+
+    // Metrics
+    uint64_t completed;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t bytes_reclaimed;
+    uint64_t time_us;
+} log_compaction_t;
+
+struct storage_log {
+    char dir[MAX_DIR];
+    int open;
+    pthread_mutex_t lock;
+    pthread_mutex_t append_lock;
+    pthread_mutex_t sync_lock;
+    pthread_mutex_t checkpoint_lock;
+    int sync_writes;
+    uint64_t since_checkpoint;  // Bytes appended since the last checkpoint (append_lock)
+
+    index_shard_t shards[INDEX_SHARDS];
+
+    // Segment table sorted by id
+    storage_segment_t** segments;
+    size_t segment_count;
+    size_t segment_capacity;
+    storage_segment_t* active;
+    uint32_t next_segment_id;
+    uint64_t next_seq;
+    uint32_t key_epoch;         // Stamped on new records (append_lock)
+
+    // Last recovery
+    uint64_t recovery_us;
+    uint64_t recovery_bytes;
+    int recovered_from_checkpoint;
+
+    log_filter_t filter;
+    log_compaction_t compact;
+};
+
+// ============================================================================
+// Encoding helpers
+// ============================================================================
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// ============================================================================
+// CRC32C (Castagnoli)
+// ============================================================================
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t* p, size_t len) {
+    crc = ~crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = __crc32cb(crc, *p++);
+    return ~crc;
+}
+#else
+static uint32_t g_crc32c_table[256];
+static pthread_once_t g_crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+        g_crc32c_table[i] = c;
+    }
+}
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t* p, size_t len) {
+    pthread_once(&g_crc32c_once, crc32c_init_table);
+    crc = ~crc;
+    while (len--) crc = g_crc32c_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+#endif
+
+// ============================================================================
+// Record headers
+// ============================================================================
+
+// Checksum of an encoded header (checksum field read as zero) and payload
+static uint32_t record_checksum(const uint8_t raw[RECORD_HEADER_SIZE],
+                                const uint8_t* payload, size_t payload_len) {
+    static const uint8_t zero[4];
+    uint32_t crc = crc32c_update(0, raw, RECORD_CHECKSUM_OFFSET);
+    crc = crc32c_update(crc, zero, sizeof(zero));
+    crc = crc32c_update(crc, raw + RECORD_CHECKSUM_OFFSET + 4,
+                        RECORD_HEADER_SIZE - RECORD_CHECKSUM_OFFSET - 4);
+    return payload_len ? crc32c_update(crc, payload, payload_len) : crc;
+}
+
+static void encode_header(uint8_t out[RECORD_HEADER_SIZE], const record_header_t* h,
+                          const uint8_t* payload) {
+    memset(out, 0, RECORD_HEADER_SIZE);
+    put_u32(out, RECORD_MAGIC);
+    out[4] = RECORD_VERSION;
+    out[5] = h->type;
+    put_u16(out + 6, h->flags);
+    put_u32(out + 8, h->payload_len);
+    put_u64(out + 16, h->seq);
+    memcpy(out + 24, h->key_id.bytes, STORAGE_KEY_ID_SIZE);
+    put_u32(out + 40, h->key_epoch);
+    put_u32(out + RECORD_CHECKSUM_OFFSET, record_checksum(out, payload, h->payload_len));
+}
+
+// Returns 1 if the header is well formed (the checksum is checked separately)
+static int decode_header(const uint8_t in[RECORD_HEADER_SIZE], record_header_t* h) {
+    if (get_u32(in) != RECORD_MAGIC ||
+        (in[4] != RECORD_VERSION && in[4] != RECORD_VERSION_UNCHECKED)) {
+        return 0;
+    }
+
+    h->version = in[4];
+    h->type = in[5];
+    h->flags = get_u16(in + 6);
+    h->payload_len = get_u32(in + 8);
+    h->seq = get_u64(in + 16);
+    memcpy(h->key_id.bytes, in + 24, STORAGE_KEY_ID_SIZE);
+    h->key_epoch = get_u32(in + 40);
+
+    if (h->type != RECORD_PUT && h->type != RECORD_DELETE) return 0;
+    if (h->payload_len > STORAGE_LOG_PAYLOAD_MAX) return 0;
+    if (h->type == RECORD_DELETE && h->payload_len != 0) return 0;
+    return 1;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Full pread/pwrite loops (short transfers are legal)
+static int read_full(int fd, void* buf, size_t len, uint64_t offset) {
+    uint8_t* p = (uint8_t*)buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+static int write_full(int fd, const void* buf, size_t len, uint64_t offset) {
+    const uint8_t* p = (const uint8_t*)buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+// ============================================================================
+// Index (caller holds the shard lock: shared to find, exclusive to modify)
+// ============================================================================
+
+static int key_id_equal(const storage_key_id_t* a, const storage_key_id_t* b) {
+    return memcmp(a->bytes, b->bytes, STORAGE_KEY_ID_SIZE) == 0;
+}
+
+// Key ids are keyed PRF output, so any bits are uniformly distributed:
+// byte 4 picks the shard, the first word the slot within it
+static index_shard_t* shard_for(storage_log_t* log, const storage_key_id_t* key_id) {
+    return &log->shards[key_id->bytes[4] & (INDEX_SHARDS - 1)];
+}
+
+static size_t index_slot(const storage_key_id_t* key_id, size_t capacity) {
+    return get_u32(key_id->bytes) & (capacity - 1);
+}
+
+static index_entry_t* index_find(index_shard_t* shard, const storage_key_id_t* key_id) {
+    if (!shard->table) return NULL;
+
+    size_t mask = shard->capacity - 1;
+    for (size_t i = index_slot(key_id, shard->capacity); ; i = (i + 1) & mask) {
+        index_entry_t* e = &shard->table[i];
+        if (!e->used) return NULL;
+        if (key_id_equal(&e->key_id, key_id)) return e;
+    }
+}
+
+static int index_grow(index_shard_t* shard) {
+    size_t capacity = shard->capacity ? shard->capacity * 2 : INDEX_INITIAL_CAPACITY;
+    index_entry_t* table = calloc(capacity, sizeof(index_entry_t));
+    if (!table) {
+        LOGE("Failed to grow index shard to %zu entries", capacity);
+        return 0;
+    }
+
+    for (size_t i = 0; i < shard->capacity; i++) {
+        index_entry_t* e = &shard->table[i];
+        if (!e->used) continue;
+
+        size_t j = index_slot(&e->key_id, capacity);
+        while (table[j].used) j = (j + 1) & (capacity - 1);
+        table[j] = *e;
+    }
+
+    free(shard->table);
+    shard->table = table;
+    shard->capacity = capacity;
+    return 1;
+}
+
+static index_entry_t* index_insert(index_shard_t* shard, const storage_key_id_t* key_id) {
+    // Keep load factor under 70%
+    if ((shard->count + 1) * 10 >= shard->capacity * 7) {
+        if (!index_grow(shard)) return NULL;
+    }
+
+    size_t mask = shard->capacity - 1;
+    size_t i = index_slot(key_id, shard->capacity);
+    while (shard->table[i].used) i = (i + 1) & mask;
+
+    index_entry_t* e = &shard->table[i];
+    memset(e, 0, sizeof(*e));
+    e->used = 1;
+    e->key_id = *key_id;
+    shard->count++;
+    return e;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_remove(index_shard_t* shard, index_entry_t* e) {
+    size_t mask = shard->capacity - 1;
+    size_t hole = (size_t)(e - shard->table);
+    size_t i = hole;
+
+    for (;;) {
+        i = (i + 1) & mask;
+        index_entry_t* next = &shard->table[i];
+        if (!next->used) break;
+
+        size_t home = index_slot(&next->key_id, shard->capacity);
+        // Move next into the hole if its home is not between hole and i
+        int movable = (hole <= i) ? (home <= hole || home > i)
+                                  : (home <= hole && home > i);
+        if (movable) {
+            shard->table[hole] = *next;
+            hole = i;
+        }
+    }
+
+    shard->table[hole].used = 0;
+    shard->count--;
+}
+
+static void shards_lock_all(storage_log_t* log) {
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        pthread_rwlock_wrlock(&log->shards[i].lock);
+    }
+}
+
+static void shards_unlock_all(storage_log_t* log) {
+    for (size_t i = INDEX_SHARDS; i > 0; i--) {
+        pthread_rwlock_unlock(&log->shards[i - 1].lock);
+    }
+}
+
+static size_t index_key_count(storage_log_t* log) {
+    size_t count = 0;
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        pthread_rwlock_rdlock(&log->shards[i].lock);
+        count += log->shards[i].count;
+        pthread_rwlock_unlock(&log->shards[i].lock);
+    }
+    return count;
+}
+
+// ============================================================================
+// Key filter
+// ============================================================================
+
+// Key ids are uniform: bytes 8..11 pick the block, bytes 0..7 give six
+// 9-bit positions within it. Fills masks with the bits per block word
+static uint64_t* filter_block(const key_filter_t* f, const storage_key_id_t* key_id,
+                              uint64_t masks[FILTER_BLOCK_WORDS]) {
+    memset(masks, 0, FILTER_BLOCK_WORDS * sizeof(uint64_t));
+    uint64_t h = get_u64(key_id->bytes);
+    for (int i = 0; i < FILTER_HASHES; i++, h >>= 9) {
+        masks[(h >> 6) & (FILTER_BLOCK_WORDS - 1)] |= 1ull << (h & 63);
+    }
+    return f->words + (size_t)(get_u32(key_id->bytes + 8) & f->block_mask) * FILTER_BLOCK_WORDS;
+}
+
+static void filter_set(key_filter_t* f, const storage_key_id_t* key_id) {
+    uint64_t masks[FILTER_BLOCK_WORDS];
+    uint64_t* block = filter_block(f, key_id, masks);
+    for (int w = 0; w < FILTER_BLOCK_WORDS; w++) {
+        if (masks[w]) __atomic_fetch_or(&block[w], masks[w], __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Record a put in the filter (caller holds the key's shard lock, so a
+ * rebuild scanning that shard either sees the entry or runs before this)
+ */
+static void filter_add(storage_log_t* log, const storage_key_id_t* key_id, int new_key) {
+    key_filter_t* f = __atomic_load_n(&log->filter.current, __ATOMIC_ACQUIRE);
+    if (!f) return;
+    filter_set(f, key_id);
+    if (new_key) __atomic_fetch_add(&log->filter.keys, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Returns 0 only if key_id is certainly not in the index
+ */
+static int filter_may_contain(storage_log_t* log, const storage_key_id_t* key_id) {
+    uint32_t seq = __atomic_load_n(&log->filter.seq, __ATOMIC_ACQUIRE);
+    key_filter_t* f = __atomic_load_n(&log->filter.current, __ATOMIC_ACQUIRE);
+    if (!f || (seq & 1)) return 1;
+
+    uint64_t masks[FILTER_BLOCK_WORDS];
+    const uint64_t* block = filter_block(f, key_id, masks);
+    int hit = 1;
+    for (int w = 0; hit && w < FILTER_BLOCK_WORDS; w++) {
+        hit = (__atomic_load_n(&block[w], __ATOMIC_RELAXED) & masks[w]) == masks[w];
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return hit || __atomic_load_n(&log->filter.seq, __ATOMIC_RELAXED) != seq;
+}
+
+static key_filter_t* filter_create(size_t capacity) {
+    size_t blocks = 1;
+    while (blocks * FILTER_BLOCK_WORDS * 64 < capacity * FILTER_BITS_PER_KEY) blocks <<= 1;
+    if (blocks > (size_t)UINT32_MAX + 1) return NULL;
+
+    key_filter_t* f = calloc(1, sizeof(key_filter_t));
+    size_t bytes = blocks * FILTER_BLOCK_WORDS * sizeof(uint64_t);
+    if (!f || posix_memalign((void**)&f->words, 64, bytes) != 0) {
+        free(f);
+        LOGE("Failed to allocate key filter for %zu keys", capacity);
+        return NULL;
+    }
+    memset(f->words, 0, bytes);
+    f->block_mask = (uint32_t)(blocks - 1);
+    f->capacity = capacity;
+    return f;
+}
+
+static size_t filter_bytes(const key_filter_t* f) {
+    return ((size_t)f->block_mask + 1) * FILTER_BLOCK_WORDS * sizeof(uint64_t);
+}
+
+/*
+ * Install a filter saved in the checkpoint as words little-endian
+ * uint64_t (log opening, no filter yet)
+ * Returns 0 if they do not make a filter of that capacity
+ */
+static int filter_restore(storage_log_t* log, const uint8_t* words, uint64_t word_count,
+                          uint64_t capacity, uint64_t keys, uint64_t stale) {
+    // A filter for capacity keys has at least capacity * FILTER_BITS_PER_KEY bits
+    if (word_count == 0 || capacity == 0 || capacity > word_count * 64 / FILTER_BITS_PER_KEY) {
+        return 0;
+    }
+    key_filter_t* f = filter_create((size_t)capacity);
+    if (!f || filter_bytes(f) != word_count * sizeof(uint64_t)) {
+        if (f) free(f->words);
+        free(f);
+        return 0;
+    }
+
+    for (uint64_t i = 0; i < word_count; i++) {
+        f->words[i] = get_u64(words + i * sizeof(uint64_t));
+    }
+    log->filter.current = f;
+    log->filter.keys = (size_t)keys;
+    log->filter.stale = (size_t)stale;
+    return 1;
+}
+
+/*
+ * Rebuild the filter from the index: into a larger one if the index
+ * outgrew it, otherwise cleared in place to drop deleted keys
+ * (caller holds rebuild_lock and no other lock)
+ */
+static void filter_rebuild(storage_log_t* log) {
+    key_filter_t* f = log->filter.current;
+    size_t keys = index_key_count(log);
+    key_filter_t* grown = NULL;
+    if (!f || keys >= f->capacity) {
+        grown = filter_create(keys * 2 > FILTER_MIN_KEYS ? keys * 2 : FILTER_MIN_KEYS);
+        if (!grown && !f) return;
+    }
+
+    uint32_t seq = log->filter.seq;
+    __atomic_store_n(&log->filter.seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (grown) {
+        grown->retired = f;
+        f = grown;
+        __atomic_store_n(&log->filter.current, f, __ATOMIC_RELEASE);
+    } else {
+        size_t words = ((size_t)f->block_mask + 1) * FILTER_BLOCK_WORDS;
+        for (size_t i = 0; i < words; i++) {
+            __atomic_store_n(&f->words[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&log->filter.stale, 0, __ATOMIC_RELAXED);
+
+    // Puts that land in a shard after its scan set their own bits
+    size_t live = 0;
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        index_shard_t* shard = &log->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        for (size_t j = 0; j < shard->capacity; j++) {
+            index_entry_t* e = &shard->table[j];
+            if (e->used && !e->deleted) {
+                filter_set(f, &e->key_id);
+                live++;
+            }
+        }
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    __atomic_store_n(&log->filter.keys, live, __ATOMIC_RELAXED);
+    log->filter.rebuilds++;
+
+    __atomic_store_n(&log->filter.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * Rebuild the filter if the index outgrew it or half its keys were
+ * deleted since the last rebuild (caller holds no lock)
+ */
+static void filter_maintain(storage_log_t* log) {
+    key_filter_t* f = __atomic_load_n(&log->filter.current, __ATOMIC_ACQUIRE);
+    if (!f) return;
+
+    size_t keys = __atomic_load_n(&log->filter.keys, __ATOMIC_RELAXED);
+    size_t stale = __atomic_load_n(&log->filter.stale, __ATOMIC_RELAXED);
+    if (keys < f->capacity && stale * 4 < f->capacity) return;
+
+    if (pthread_mutex_trylock(&log->filter.rebuild_lock) == 0) {
+        filter_rebuild(log);
+        pthread_mutex_unlock(&log->filter.rebuild_lock);
+    }
+}
+
+// Free every filter (log closed, no readers left)
+static void filter_destroy(storage_log_t* log) {
+    key_filter_t* f = log->filter.current;
+    log->filter.current = NULL;
+    while (f) {
+        key_filter_t* next = f->retired;
+        free(f->words);
+        free(f);
+        f = next;
+    }
+    log->filter.keys = 0;
+    log->filter.stale = 0;
+}
+
+// ============================================================================
+// Segment table (caller holds log->lock unless noted)
+// ============================================================================
+
+static void segment_path(storage_log_t* log, uint32_t id, char* path) {
+    snprintf(path, MAX_PATH, "%s/seg-%08x.log", log->dir, id);
+}
+
+static int segment_table_add(storage_log_t* log, storage_segment_t* seg) {
+    if (log->segment_count == log->segment_capacity) {
+        size_t capacity = log->segment_capacity ? log->segment_capacity * 2 : 16;
+        storage_segment_t** table = realloc(log->segments, capacity * sizeof(*table));
+        if (!table) return 0;
+        log->segments = table;
+        log->segment_capacity = capacity;
+    }
+
+    // Ids are allocated in increasing order, so appending keeps the table sorted
+    size_t i = log->segment_count;
+    while (i > 0 && log->segments[i - 1]->id > seg->id) {
+        log->segments[i] = log->segments[i - 1];
+        i--;
+    }
+    log->segments[i] = seg;
+    log->segment_count++;
+    return 1;
+}
+
+static void segment_table_remove(storage_log_t* log, storage_segment_t* seg) {
+    for (size_t i = 0; i < log->segment_count; i++) {
+        if (log->segments[i] == seg) {
+            memmove(&log->segments[i], &log->segments[i + 1],
+                    (log->segment_count - i - 1) * sizeof(*log->segments));
+            log->segment_count--;
+            return;
+        }
+    }
+}
+
+// Close the fd and delete the file; segment must be out of the table
+static void segment_destroy(storage_log_t* log, storage_segment_t* seg, int unlink_file) {
+    char path[MAX_PATH];
+    segment_path(log, seg->id, path);
+
+    close(seg->fd);
+    if (unlink_file && unlink(path) != 0) {
+        LOGW("Failed to remove segment: %s", path);
+    }
+    free(seg);
+}
+
+// Make file creations, renames and removals in the directory durable
+static void sync_directory(storage_log_t* log) {
+    int fd = open(log->dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/*
+ * Create an empty segment file and register it (takes log->lock)
+ */
+static storage_segment_t* segment_create(storage_log_t* log, int role) {
+    pthread_mutex_lock(&log->lock);
+    uint32_t id = log->next_segment_id++;
+    pthread_mutex_unlock(&log->lock);
+
+    char path[MAX_PATH];
+    segment_path(log, id, path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        LOGE("Failed to create segment: %s", path);
+        return NULL;
+    }
+
+    storage_segment_t* seg = calloc(1, sizeof(storage_segment_t));
+    if (!seg) {
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+
+    seg->id = id;
+    seg->fd = fd;
+    seg->role = role;
+    seg->min_seq = UINT64_MAX;
+
+    pthread_mutex_lock(&log->lock);
+    int added = segment_table_add(log, seg);
+    pthread_mutex_unlock(&log->lock);
+
+    if (!added) {
+        segment_destroy(log, seg, 1);
+        return NULL;
+    }
+
+    sync_directory(log);
+    LOGI("Created segment %08x", id);
+    return seg;
+}
+
+/*
+ * Pin a segment found through the index (caller holds its shard lock).
+ * Segments are only retired after every entry pointing at them has been
+ * repointed under the shard locks, so a pin taken here is always in time.
+ */
+static void segment_pin(storage_segment_t* seg) {
+    __atomic_add_fetch(&seg->refs, 1, __ATOMIC_ACQ_REL);
+}
+
+// Drop a reference; the last one frees a retired segment
+static void segment_unpin(storage_log_t* log, storage_segment_t* seg) {
+    if (__atomic_sub_fetch(&seg->refs, 1, __ATOMIC_ACQ_REL) == 0 &&
+        __atomic_load_n(&seg->retired, __ATOMIC_ACQUIRE)) {
+        segment_destroy(log, seg, 1);
+    }
+}
+
+/*
+ * Apply a record to the index and the live/dead accounting
+ * (caller holds the key's shard lock exclusive and log->lock)
+ * Older-or-equal sequence numbers lose (duplicates left by an
+ * interrupted compaction)
+ */
+static void index_apply(storage_log_t* log, index_shard_t* shard, const record_header_t* h,
+                        storage_segment_t* seg, uint64_t offset) {
+    uint32_t length = RECORD_HEADER_SIZE + h->payload_len;
+    index_entry_t* e = index_find(shard, &h->key_id);
+
+    if (h->seq < seg->min_seq) {
+        seg->min_seq = h->seq;
+    }
+
+    if (e && e->seq >= h->seq) {
+        seg->dead_bytes += length;
+        return;
+    }
+
+    int new_key = !e || e->deleted;
+    if (e) {
+        e->segment->live_bytes -= e->length;
+        e->segment->dead_bytes += e->length;
+    } else {
+        e = index_insert(shard, &h->key_id);
+        if (!e) {
+            seg->dead_bytes += length;
+            return;
+        }
+    }
+
+    // Bits go in before the entry says the key is live
+    if (h->type == RECORD_DELETE) {
+        if (!new_key) __atomic_fetch_add(&log->filter.stale, 1, __ATOMIC_RELAXED);
+    } else {
+        filter_add(log, &h->key_id, new_key);
+    }
+
+    e->deleted = (h->type == RECORD_DELETE);
+    e->flags = h->flags;
+    e->key_epoch = h->key_epoch;
+    e->segment = seg;
+    e->offset = offset;
+    e->length = length;
+    e->seq = h->seq;
+    seg->live_bytes += length;
+}
+
+// ============================================================================
+// Durability
+// ============================================================================
+
+/*
+ * Make the first end bytes of a segment durable (caller holds a pin or
+ * otherwise keeps the segment alive). One fdatasync covers everything
+ * appended before it starts, so writers queued here behind another
+ * writer's sync usually find their bytes already covered: group commit.
+ * Returns 1 on success
+ */
+static int segment_sync(storage_log_t* log, storage_segment_t* seg, uint64_t end) {
+    int ok = 1;
+    pthread_mutex_lock(&log->sync_lock);
+    if (seg->synced < end) {
+        pthread_mutex_lock(&log->lock);
+        uint64_t target = seg->size;
+        pthread_mutex_unlock(&log->lock);
+
+        ok = (fdatasync(seg->fd) == 0);
+        if (ok) {
+            seg->synced = target;
+        } else {
+            LOGE("Failed to sync segment %08x: %s", seg->id, strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&log->sync_lock);
+    return ok;
+}
+
+// ============================================================================
+// Recovery (caller holds every shard lock and log->lock)
+// ============================================================================
+
+static int compare_ids(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Segment with the given id, NULL if none
+static storage_segment_t* segment_lookup(storage_log_t* log, uint32_t id) {
+    size_t lo = 0, hi = log->segment_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (log->segments[mid]->id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < log->segment_count && log->segments[lo]->id == id) ? log->segments[lo] : NULL;
+}
+
+// Sequence number of a segment's first record, 0 if it has none
+static uint64_t segment_first_seq(const storage_segment_t* seg) {
+    uint8_t raw[RECORD_HEADER_SIZE];
+    record_header_t h;
+    if (!read_full(seg->fd, raw, sizeof(raw), 0) || !decode_header(raw, &h)) {
+        return 0;
+    }
+    return h.seq;
+}
+
+/*
+ * Open an existing segment file and register it as sealed
+ * Returns NULL if the file is unreadable or holds a record format this
+ * build does not know (left untouched rather than truncated as torn)
+ */
+static storage_segment_t* segment_open_existing(storage_log_t* log, uint32_t id,
+                                                uint64_t* file_size) {
+    char path[MAX_PATH];
+    segment_path(log, id, path);
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        LOGE("Failed to open segment: %s", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t first[8];
+    if (st.st_size >= 8 && read_full(fd, first, 8, 0) && get_u32(first) == RECORD_MAGIC &&
+        first[4] != RECORD_VERSION && first[4] != RECORD_VERSION_UNCHECKED) {
+        LOGE("Segment %08x has record format %u, expected %u", id, first[4], RECORD_VERSION);
+        close(fd);
+        return NULL;
+    }
+
+    storage_segment_t* seg = calloc(1, sizeof(storage_segment_t));
+    if (!seg) {
+        close(fd);
+        return NULL;
+    }
+    seg->id = id;
+    seg->fd = fd;
+    seg->role = SEGMENT_SEALED;
+    seg->min_seq = UINT64_MAX;
+
+    // Registered first so records superseded within this segment are accounted
+    if (!segment_table_add(log, seg)) {
+        close(fd);
+        free(seg);
+        return NULL;
+    }
+
+    *file_size = (uint64_t)st.st_size;
+    return seg;
+}
+
+/*
+ * Check a record's payload against its header checksum, reading it in
+ * pieces so a large payload needs no large buffer
+ */
+static int record_verify(int fd, const uint8_t raw[RECORD_HEADER_SIZE], const record_header_t* h,
+                         uint64_t offset, uint8_t* buf, size_t buf_len) {
+    if (h->version == RECORD_VERSION_UNCHECKED) {
+        return 1;
+    }
+
+    uint32_t crc = record_checksum(raw, NULL, 0);
+    uint64_t pos = offset + RECORD_HEADER_SIZE;
+    uint32_t remaining = h->payload_len;
+    while (remaining > 0) {
+        size_t n = remaining < buf_len ? remaining : buf_len;
+        if (!read_full(fd, buf, n, pos)) return 0;
+        crc = crc32c_update(crc, buf, n);
+        pos += n;
+        remaining -= (uint32_t)n;
+    }
+    return crc == get_u32(raw + RECORD_CHECKSUM_OFFSET);
+}
+
+/*
+ * Feed the records in [offset, file_size) of a segment to the index.
+ * The first record that is malformed, short or fails its checksum ends
+ * the segment: it and everything after it are a torn append and get
+ * truncated. Returns the number of records applied
+ */
+static size_t scan_records(storage_log_t* log, storage_segment_t* seg, uint64_t offset,
+                           uint64_t file_size) {
+    uint64_t start = offset;
+    size_t records = 0;
+    size_t buf_len = 64 * 1024;
+    uint8_t* buf = malloc(buf_len);
+
+    while (buf && offset + RECORD_HEADER_SIZE <= file_size) {
+        uint8_t raw[RECORD_HEADER_SIZE];
+        record_header_t h;
+
+        if (!read_full(seg->fd, raw, sizeof(raw), offset) || !decode_header(raw, &h)) {
+            break;
+        }
+        if (offset + RECORD_HEADER_SIZE + h.payload_len > file_size ||
+            !record_verify(seg->fd, raw, &h, offset, buf, buf_len)) {
+            break;
+        }
+
+        index_apply(log, shard_for(log, &h.key_id), &h, seg, offset);
+        if (h.seq >= log->next_seq) {
+            log->next_seq = h.seq + 1;
+        }
+
+        offset += RECORD_HEADER_SIZE + h.payload_len;
+        records++;
+    }
+    free(buf);
+
+    if (offset < file_size) {
+        LOGW("Segment %08x: torn tail at %llu, truncating %llu bytes", seg->id,
+             (unsigned long long)offset, (unsigned long long)(file_size - offset));
+        if (ftruncate(seg->fd, (off_t)offset) != 0) {
+            LOGE("Failed to truncate segment %08x", seg->id);
+        }
+    }
+
+    seg->size = offset;
+    log->recovery_bytes += offset - start;
+    return records;
+}
+
+/*
+ * Scan one whole segment into the index
+ */
+static int recover_segment(storage_log_t* log, uint32_t id) {
+    uint64_t file_size;
+    storage_segment_t* seg = segment_open_existing(log, id, &file_size);
+    if (!seg) {
+        return 0;
+    }
+
+    size_t records = scan_records(log, seg, 0, file_size);
+    LOGI("Recovered segment %08x: %zu records, %llu bytes", id, records,
+         (unsigned long long)seg->size);
+    return 1;
+}
+
+/*
+ * Close every segment and empty the index
+ */
+static void discard_state(storage_log_t* log) {
+    for (size_t i = 0; i < log->segment_count; i++) {
+        segment_destroy(log, log->segments[i], 0);
+    }
+    free(log->segments);
+    log->segments = NULL;
+    log->segment_count = 0;
+    log->segment_capacity = 0;
+    log->active = NULL;
+
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        index_shard_t* shard = &log->shards[i];
+        free(shard->table);
+        shard->table = NULL;
+        shard->capacity = 0;
+        shard->count = 0;
+    }
+}
+
+// ============================================================================
+// Index checkpoint
+//
+// [magic u32][version u32][next_seq u64][next_segment_id u32][segments u32]
+// [entries u64], then per segment
+// [id u32][reserved u32][size u64][live u64][dead u64][min_seq u64][first_seq u64]
+// and per index entry
+// [key_id 16][segment id u32][length u32][flags u16][deleted u8][reserved 1]
+// [key_epoch u32][offset u64][seq u64], then the key filter
+// [words u64][capacity u64][keys u64][stale u64][words x u64] (words 0 if it
+// was being rebuilt), closed by a CRC32C of everything before it. Version 1
+// has no filter section.
+// ============================================================================
+
+static void checkpoint_path(storage_log_t* log, char* path, const char* suffix) {
+    snprintf(path, MAX_PATH, "%s/%s%s", log->dir, CHECKPOINT_FILE, suffix);
+}
+
+/*
+ * Snapshot the index and segment table into a checkpoint image, pinning
+ * each segment (caller holds append_lock, every shard lock and log->lock)
+ * Returns the malloc'd image, NULL on allocation failure
+ */
+static uint8_t* checkpoint_encode(storage_log_t* log, size_t* len, storage_segment_t*** pinned,
+                                  size_t* pinned_count) {
+    size_t entry_count = 0;
+    for (size_t k = 0; k < INDEX_SHARDS; k++) {
+        entry_count += log->shards[k].count;
+    }
+
+    // Writers are locked out, but a rebuild can still be clearing the
+    // filter; the copy is kept only if seq shows none ran during it
+    uint32_t filter_seq = __atomic_load_n(&log->filter.seq, __ATOMIC_ACQUIRE);
+    key_filter_t* filter = (filter_seq & 1) ? NULL
+                           : __atomic_load_n(&log->filter.current, __ATOMIC_ACQUIRE);
+    size_t filter_words = filter ? filter_bytes(filter) / sizeof(uint64_t) : 0;
+
+    *len = CHECKPOINT_HEADER_SIZE + log->segment_count * CHECKPOINT_SEGMENT_SIZE +
+           entry_count * CHECKPOINT_ENTRY_SIZE + CHECKPOINT_FILTER_HEADER_SIZE +
+           filter_words * sizeof(uint64_t) + 4;
+    uint8_t* buf = calloc(1, *len);
+    storage_segment_t** segs = malloc((log->segment_count + 1) * sizeof(*segs));
+    if (!buf || !segs) {
+        free(buf);
+        free(segs);
+        return NULL;
+    }
+
+    put_u32(buf, CHECKPOINT_MAGIC);
+    put_u32(buf + 4, CHECKPOINT_VERSION);
+    put_u64(buf + 8, log->next_seq);
+    put_u32(buf + 16, log->next_segment_id);
+    put_u32(buf + 20, (uint32_t)log->segment_count);
+    put_u64(buf + 24, entry_count);
+
+    uint8_t* p = buf + CHECKPOINT_HEADER_SIZE;
+    for (size_t i = 0; i < log->segment_count; i++, p += CHECKPOINT_SEGMENT_SIZE) {
+        storage_segment_t* s = log->segments[i];
+        put_u32(p, s->id);
+        put_u64(p + 8, s->size);
+        put_u64(p + 16, s->live_bytes);
+        put_u64(p + 24, s->dead_bytes);
+        put_u64(p + 32, s->min_seq);
+        // first_seq (p + 40) is read from disk once the locks are dropped
+        segment_pin(s);
+        segs[i] = s;
+    }
+
+    for (size_t k = 0; k < INDEX_SHARDS; k++) {
+        index_shard_t* shard = &log->shards[k];
+        for (size_t i = 0; i < shard->capacity; i++) {
+            const index_entry_t* e = &shard->table[i];
+            if (!e->used) continue;
+
+            memcpy(p, e->key_id.bytes, STORAGE_KEY_ID_SIZE);
+            put_u32(p + 16, e->segment->id);
+            put_u32(p + 20, e->length);
+            put_u16(p + 24, e->flags);
+            p[26] = e->deleted;
+            put_u32(p + 28, e->key_epoch);
+            put_u64(p + 32, e->offset);
+            put_u64(p + 40, e->seq);
+            p += CHECKPOINT_ENTRY_SIZE;
+        }
+    }
+
+    uint8_t* words = p + CHECKPOINT_FILTER_HEADER_SIZE;
+    for (size_t i = 0; i < filter_words; i++) {
+        put_u64(words + i * sizeof(uint64_t), __atomic_load_n(&filter->words[i], __ATOMIC_RELAXED));
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (filter_words && __atomic_load_n(&log->filter.seq, __ATOMIC_RELAXED) != filter_seq) {
+        filter_words = 0;
+        *len = (size_t)(words - buf) + 4;
+    }
+    if (filter_words) {
+        put_u64(p, filter_words);
+        put_u64(p + 8, filter->capacity);
+        put_u64(p + 16, __atomic_load_n(&log->filter.keys, __ATOMIC_RELAXED));
+        put_u64(p + 24, __atomic_load_n(&log->filter.stale, __ATOMIC_RELAXED));
+    }
+
+    *pinned = segs;
+    *pinned_count = log->segment_count;
+    return buf;
+}
+
+/*
+ * Write the index checkpoint. Segments are synced up to the sizes it
+ * records before it replaces the old one, so everything it vouches for
+ * is on disk. With only_if_due, skips unless enough bytes were appended
+ * since the last one and no other checkpoint is in progress.
+ * Returns 1 if a checkpoint was written
+ */
+static int checkpoint_write(storage_log_t* log, int only_if_due) {
+    if (only_if_due) {
+        if (pthread_mutex_trylock(&log->checkpoint_lock) != 0) return 0;
+    } else {
+        pthread_mutex_lock(&log->checkpoint_lock);
+    }
+
+    uint8_t* buf = NULL;
+    size_t len = 0;
+    storage_segment_t** segs = NULL;
+    size_t seg_count = 0;
+
+    pthread_mutex_lock(&log->append_lock);
+    if (!only_if_due || log->since_checkpoint >= CHECKPOINT_INTERVAL_BYTES) {
+        shards_lock_all(log);
+        pthread_mutex_lock(&log->lock);
+        buf = checkpoint_encode(log, &len, &segs, &seg_count);
+        pthread_mutex_unlock(&log->lock);
+        shards_unlock_all(log);
+        if (buf) {
+            log->since_checkpoint = 0;
+        }
+    }
+    pthread_mutex_unlock(&log->append_lock);
+
+    if (!buf) {
+        pthread_mutex_unlock(&log->checkpoint_lock);
+        return 0;
+    }
+
+    int ok = 1;
+    uint8_t* p = buf + CHECKPOINT_HEADER_SIZE;
+    for (size_t i = 0; i < seg_count; i++, p += CHECKPOINT_SEGMENT_SIZE) {
+        uint64_t size = get_u64(p + 8);
+        if (size > 0) {
+            put_u64(p + 40, segment_first_seq(segs[i]));
+            ok = segment_sync(log, segs[i], size) && ok;
+        }
+        segment_unpin(log, segs[i]);
+    }
+    free(segs);
+    put_u32(buf + len - 4, crc32c_update(0, buf, len - 4));
+
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    checkpoint_path(log, path, "");
+    checkpoint_path(log, tmp_path, ".tmp");
+
+    int fd = ok ? open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600) : -1;
+    ok = fd >= 0 && write_full(fd, buf, len, 0) && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    ok = ok && rename(tmp_path, path) == 0;
+    if (ok) {
+        sync_directory(log);
+    } else {
+        LOGE("Failed to write index checkpoint");
+        unlink(tmp_path);
+    }
+    free(buf);
+
+    pthread_mutex_unlock(&log->checkpoint_lock);
+    return ok;
+}
+
+/*
+ * Rebuild the index from the checkpoint and scan only what was appended
+ * after it. ids lists the segment files on disk, sorted. Every segment
+ * the checkpoint names must still exist, be at least as long and start
+ * with the same record (ids can be reused after compaction); otherwise
+ * the checkpoint is stale and nothing is loaded.
+ * Returns 1 if loaded
+ */
+static int checkpoint_load(storage_log_t* log, const uint32_t* ids, size_t id_count) {
+    char path[MAX_PATH];
+    checkpoint_path(log, path, "");
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat st;
+    uint8_t* buf = NULL;
+    size_t len = 0;
+    int ok = fstat(fd, &st) == 0 && st.st_size >= CHECKPOINT_HEADER_SIZE + 4;
+    if (ok) {
+        len = (size_t)st.st_size;
+        buf = malloc(len);
+        ok = buf && read_full(fd, buf, len, 0);
+    }
+    close(fd);
+
+    uint32_t segment_count = 0;
+    uint64_t entry_count = 0;
+    uint64_t filter_words = 0;
+    const uint8_t* filter = NULL;
+    if (ok) {
+        uint32_t version = get_u32(buf + 4);
+        segment_count = get_u32(buf + 20);
+        entry_count = get_u64(buf + 24);
+        uint64_t body = len - CHECKPOINT_HEADER_SIZE - 4;
+        uint64_t tables = (uint64_t)segment_count * CHECKPOINT_SEGMENT_SIZE;
+        ok = get_u32(buf) == CHECKPOINT_MAGIC &&
+             (version == CHECKPOINT_VERSION || version == CHECKPOINT_VERSION_NO_FILTER) &&
+             get_u32(buf + len - 4) == crc32c_update(0, buf, len - 4) &&
+             tables <= body && entry_count <= (body - tables) / CHECKPOINT_ENTRY_SIZE;
+        if (ok) {
+            tables += entry_count * CHECKPOINT_ENTRY_SIZE;
+            if (version == CHECKPOINT_VERSION_NO_FILTER) {
+                ok = body == tables;
+            } else {
+                filter = buf + CHECKPOINT_HEADER_SIZE + tables;
+                ok = body - tables >= CHECKPOINT_FILTER_HEADER_SIZE;
+                filter_words = ok ? get_u64(filter) : 0;
+                ok = ok && filter_words <= body / sizeof(uint64_t) &&
+                     body - tables ==
+                         CHECKPOINT_FILTER_HEADER_SIZE + filter_words * sizeof(uint64_t);
+            }
+        }
+    }
+    if (!ok) {
+        LOGW("Ignoring unreadable index checkpoint");
+        free(buf);
+        return 0;
+    }
+
+    uint64_t* file_sizes = malloc((segment_count + 1) * sizeof(uint64_t));
+    ok = file_sizes != NULL;
+
+    const uint8_t* p = buf + CHECKPOINT_HEADER_SIZE;
+    for (uint32_t i = 0; ok && i < segment_count; i++, p += CHECKPOINT_SEGMENT_SIZE) {
+        uint32_t id = get_u32(p);
+        uint64_t size = get_u64(p + 8);
+
+        storage_segment_t* seg = NULL;
+        if (bsearch(&id, ids, id_count, sizeof(uint32_t), compare_ids)) {
+            seg = segment_open_existing(log, id, &file_sizes[i]);
+        }
+        ok = seg && file_sizes[i] >= size &&
+             (size == 0 || segment_first_seq(seg) == get_u64(p + 40));
+        if (seg) {
+            seg->size = size;
+            seg->live_bytes = get_u64(p + 16);
+            seg->dead_bytes = get_u64(p + 24);
+            seg->min_seq = get_u64(p + 32);
+        }
+    }
+
+    for (uint64_t i = 0; ok && i < entry_count; i++, p += CHECKPOINT_ENTRY_SIZE) {
+        storage_key_id_t key_id;
+        memcpy(key_id.bytes, p, STORAGE_KEY_ID_SIZE);
+        storage_segment_t* seg = segment_lookup(log, get_u32(p + 16));
+        uint32_t length = get_u32(p + 20);
+        uint64_t offset = get_u64(p + 32);
+
+        index_shard_t* shard = shard_for(log, &key_id);
+        ok = seg && length >= RECORD_HEADER_SIZE && offset + length <= seg->size &&
+             !index_find(shard, &key_id);
+        index_entry_t* e = ok ? index_insert(shard, &key_id) : NULL;
+        if (!e) {
+            ok = 0;
+            break;
+        }
+        e->segment = seg;
+        e->length = length;
+        e->flags = get_u16(p + 24);
+        e->deleted = p[26];
+        e->key_epoch = get_u32(p + 28);
+        e->offset = offset;
+        e->seq = get_u64(p + 40);
+    }
+
+    if (!ok) {
+        LOGW("Index checkpoint is stale, scanning every segment");
+        discard_state(log);
+        free(file_sizes);
+        free(buf);
+        return 0;
+    }
+
+    log->next_seq = get_u64(buf + 8);
+    log->next_segment_id = get_u32(buf + 16);
+
+    // In place before the scan below, so the records it applies set their bits
+    if (filter_words &&
+        !filter_restore(log, filter + CHECKPOINT_FILTER_HEADER_SIZE, filter_words,
+                        get_u64(filter + 8), get_u64(filter + 16), get_u64(filter + 24))) {
+        LOGW("Ignoring key filter in index checkpoint");
+    }
+
+    // Only the bytes appended since the checkpoint are read
+    p = buf + CHECKPOINT_HEADER_SIZE;
+    for (uint32_t i = 0; i < segment_count; i++, p += CHECKPOINT_SEGMENT_SIZE) {
+        storage_segment_t* seg = segment_lookup(log, get_u32(p));
+        if (file_sizes[i] > seg->size) {
+            size_t records = scan_records(log, seg, seg->size, file_sizes[i]);
+            LOGI("Segment %08x: %zu records past the checkpoint", seg->id, records);
+        }
+    }
+
+    LOGI("Index checkpoint loaded: %u segments, %llu entries", segment_count,
+         (unsigned long long)entry_count);
+    free(file_sizes);
+    free(buf);
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+/*
+ * Allocate a closed log with its locks initialized
+ */
+static storage_log_t* log_create(void) {
+    storage_log_t* log = calloc(1, sizeof(storage_log_t));
+    if (!log) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_mutex_init(&log->append_lock, NULL);
+    pthread_mutex_init(&log->sync_lock, NULL);
+    pthread_mutex_init(&log->checkpoint_lock, NULL);
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        pthread_rwlock_init(&log->shards[i].lock, NULL);
+    }
+    pthread_mutex_init(&log->filter.rebuild_lock, NULL);
+    pthread_mutex_init(&log->compact.lock, NULL);
+    pthread_mutex_init(&log->compact.thread_lock, NULL);
+    pthread_cond_init(&log->compact.thread_cond, NULL);
+    log->sync_writes = 1;
+    return log;
+}
+
+// Destroy the locks and free a log that holds no segments
+static void log_free(storage_log_t* log) {
+    pthread_mutex_destroy(&log->lock);
+    pthread_mutex_destroy(&log->append_lock);
+    pthread_mutex_destroy(&log->sync_lock);
+    pthread_mutex_destroy(&log->checkpoint_lock);
+    for (size_t i = 0; i < INDEX_SHARDS; i++) {
+        pthread_rwlock_destroy(&log->shards[i].lock);
+    }
+    pthread_mutex_destroy(&log->filter.rebuild_lock);
+    pthread_mutex_destroy(&log->compact.lock);
+    pthread_mutex_destroy(&log->compact.thread_lock);
+    pthread_cond_destroy(&log->compact.thread_cond);
+    free(log);
+}
+
+storage_log_t* storage_log_open(const char* dir) {
+    storage_log_t* log = log_create();
+    if (!log) {
+        return NULL;
+    }
+
+    snprintf(log->dir, sizeof(log->dir), "%s", dir);
+    storage_log_default_policy(&log->compact.policy);
+    log->next_segment_id = 1;
+    log->next_seq = 1;
+    log->since_checkpoint = 0;
+
+    DIR* d = opendir(dir);
+    if (!d) {
+        LOGE("Failed to open storage directory: %s", dir);
+        log_free(log);
+        return NULL;
+    }
+
+    uint32_t* ids = NULL;
+    size_t id_count = 0, id_capacity = 0;
+    struct dirent* ent;
+
+    while ((ent = readdir(d)) != NULL) {
+        unsigned int id;
+        char tail[8];
+        if (sscanf(ent->d_name, "seg-%8x.%7s", &id, tail) != 2 || strcmp(tail, "log") != 0) {
+            continue;
+        }
+
+        if (id_count == id_capacity) {
+            id_capacity = id_capacity ? id_capacity * 2 : 16;
+            uint32_t* grown = realloc(ids, id_capacity * sizeof(uint32_t));
+            if (!grown) {
+                free(ids);
+                closedir(d);
+                log_free(log);
+                return NULL;
+            }
+            ids = grown;
+        }
+        ids[id_count++] = id;
+    }
+    closedir(d);
+
+    if (id_count > 1) {
+        qsort(ids, id_count, sizeof(uint32_t), compare_ids);
+    }
+
+    uint64_t start = now_us();
+    shards_lock_all(log);
+    pthread_mutex_lock(&log->lock);
+    log->recovery_bytes = 0;
+    log->recovered_from_checkpoint = checkpoint_load(log, ids, id_count);
+    size_t segments_before = log->segment_count;
+
+    // Segments the checkpoint does not cover (or all of them without one)
+    for (size_t i = 0; i < id_count; i++) {
+        if (!segment_lookup(log, ids[i]) && !recover_segment(log, ids[i])) {
+            LOGW("Skipping unreadable segment %08x", ids[i]);
+        }
+        if (ids[i] >= log->next_segment_id) {
+            log->next_segment_id = ids[i] + 1;
+        }
+    }
+    int changed = !log->recovered_from_checkpoint || log->recovery_bytes > 0 ||
+                  log->segment_count != segments_before;
+
+    // Segments left empty by a crash right after creation hold nothing
+    for (size_t i = 0; i + 1 < log->segment_count; ) {
+        storage_segment_t* s = log->segments[i];
+        if (s->size == 0) {
+            segment_table_remove(log, s);
+            segment_destroy(log, s, 1);
+            changed = 1;
+        } else {
+            i++;
+        }
+    }
+
+    // Continue appending to the newest segment if it has room
+    if (log->segment_count > 0) {
+        storage_segment_t* last = log->segments[log->segment_count - 1];
+        if (last->size < STORAGE_LOG_SEGMENT_MAX) {
+            last->role = SEGMENT_ACTIVE;
+            log->active = last;
+        }
+    }
+    log->recovery_us = now_us() - start;
+    pthread_mutex_unlock(&log->lock);
+    shards_unlock_all(log);
+    free(ids);
+
+    if (!log->active) {
+        log->active = segment_create(log, SEGMENT_ACTIVE);
+        if (!log->active) {
+            storage_log_close(log);
+            return NULL;
+        }
+    }
+
+    // Without a filter from the checkpoint, recovery filled the index
+    // alone; build one in a pass over it. A restored one may need to grow
+    if (log->filter.current) {
+        filter_maintain(log);
+    } else {
+        pthread_mutex_lock(&log->filter.rebuild_lock);
+        filter_rebuild(log);
+        pthread_mutex_unlock(&log->filter.rebuild_lock);
+    }
+
+    log->open = 1;
+
+    // Recovery did real work: checkpoint it so the next open does not redo it
+    if (changed) {
+        checkpoint_write(log, 0);
+    }
+
+    LOGI("Segment log open: %s, %zu segments, %zu keys, recovery %llu us (%llu bytes scanned%s)",
+         log->dir, log->segment_count, index_key_count(log), (unsigned long long)log->recovery_us,
+         (unsigned long long)log->recovery_bytes,
+         log->recovered_from_checkpoint ? ", from checkpoint" : "");
+    return log;
+}
+
+void storage_log_set_sync(storage_log_t* log, int sync_writes) {
+    __atomic_store_n(&log->sync_writes, sync_writes ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+void storage_log_close(storage_log_t* log) {
+    storage_log_compaction_stop(log);
+
+    pthread_mutex_lock(&log->compact.lock);
+    if (log->compact.victim) {
+        // Copies already written to the output are duplicates; the next
+        // recovery treats them as dead bytes
+        segment_unpin(log, log->compact.victim);
+        log->compact.victim = NULL;
+    }
+    log->compact.output = NULL;
+    log->compact.reloc_count = 0;
+    free(log->compact.relocs);
+    log->compact.relocs = NULL;
+    log->compact.reloc_capacity = 0;
+    free(log->compact.buffer);
+    log->compact.buffer = NULL;
+    log->compact.buffer_capacity = 0;
+    pthread_mutex_unlock(&log->compact.lock);
+
+    // A clean close leaves nothing for the next open to scan
+    if (log->open) {
+        checkpoint_write(log, 0);
+    }
+
+    pthread_mutex_lock(&log->append_lock);
+    shards_lock_all(log);
+    pthread_mutex_lock(&log->lock);
+    discard_state(log);
+    log->open = 0;
+    pthread_mutex_unlock(&log->lock);
+    shards_unlock_all(log);
+    pthread_mutex_unlock(&log->append_lock);
+
+    pthread_mutex_lock(&log->filter.rebuild_lock);
+    filter_destroy(log);
+    pthread_mutex_unlock(&log->filter.rebuild_lock);
+
+    LOGI("Segment log closed: %s", log->dir);
+    log_free(log);
+}
+
+// What an append replaced in the index, kept until its sync succeeds
+typedef struct {
+    storage_key_id_t key_id;
+    uint64_t seq;               // Sequence of the appended record
+    int had_previous;
+    index_entry_t previous;
+    uint32_t previous_segment;  // Id of previous.segment
+} append_undo_t;
+
+/*
+ * Write one record to the active segment, rolling over when full, and
+ * index it. Caller holds append_lock. *seg_out gets the segment written,
+ * *end_out the offset just past the record, *undo what the index held
+ * for the key before.
+ */
+static int append_locked(storage_log_t* log, uint8_t type, const storage_key_id_t* key_id,
+                         uint16_t flags, const uint8_t* payload, size_t payload_len,
+                         storage_segment_t** seg_out, uint64_t* end_out, append_undo_t* undo) {
+    uint64_t length = RECORD_HEADER_SIZE + payload_len;
+
+    storage_segment_t* seg = log->active;
+    if (seg->size > 0 && seg->size + length > STORAGE_LOG_SEGMENT_MAX) {
+        storage_segment_t* next = segment_create(log, SEGMENT_ACTIVE);
+        if (!next) {
+            return STORAGE_LOG_ERROR;
+        }
+
+        pthread_mutex_lock(&log->lock);
+        seg->role = SEGMENT_SEALED;
+        log->active = next;
+        pthread_mutex_unlock(&log->lock);
+        seg = next;
+    }
+
+    record_header_t h = {
+        .type = type,
+        .flags = flags,
+        .payload_len = (uint32_t)payload_len,
+        .seq = log->next_seq,
+        .key_id = *key_id,
+        .key_epoch = log->key_epoch,
+    };
+    uint8_t raw[RECORD_HEADER_SIZE];
+    encode_header(raw, &h, payload);
+
+    uint64_t offset = seg->size;
+    if (!write_full(seg->fd, raw, sizeof(raw), offset) ||
+        (payload_len > 0 && !write_full(seg->fd, payload, payload_len, offset + RECORD_HEADER_SIZE))) {
+        // Leave size unchanged: the next append overwrites the partial record
+        LOGE("Failed to append record to segment %08x", seg->id);
+        return STORAGE_LOG_ERROR;
+    }
+
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_wrlock(&shard->lock);
+    pthread_mutex_lock(&log->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    undo->key_id = *key_id;
+    undo->seq = h.seq;
+    undo->had_previous = (e != NULL);
+    if (e) {
+        undo->previous = *e;
+        undo->previous_segment = e->segment->id;
+    }
+    log->next_seq++;
+    seg->size += length;
+    index_apply(log, shard, &h, seg, offset);
+    pthread_mutex_unlock(&log->lock);
+    pthread_rwlock_unlock(&shard->lock);
+
+    log->since_checkpoint += length;
+    *seg_out = seg;
+    *end_out = offset + length;
+    return STORAGE_LOG_OK;
+}
+
+/*
+ * Undo the index update of an append whose sync failed, so a record the
+ * caller is told failed does not stay visible while the log is open.
+ * The record itself is left in the segment and recovery may bring it
+ * back (see storage_log_set_sync). A newer append of the same key
+ * already replaced it and is left alone. The previous record only comes
+ * back while its segment exists and is not being compacted: the
+ * compactor saw it as dead and will not relocate it, so an entry
+ * restored there would outlive the segment. The failed record is kept
+ * instead.
+ */
+static void index_revert(storage_log_t* log, const append_undo_t* undo) {
+    index_shard_t* shard = shard_for(log, &undo->key_id);
+    pthread_rwlock_wrlock(&shard->lock);
+    pthread_mutex_lock(&log->lock);
+
+    index_entry_t* e = index_find(shard, &undo->key_id);
+    if (e && e->seq == undo->seq) {
+        storage_segment_t* previous = undo->had_previous
+                                      ? segment_lookup(log, undo->previous_segment) : NULL;
+        if (undo->had_previous && (!previous || previous->compacting)) {
+            LOGW("Previous record of a failed append is compacted; keeping it");
+        } else {
+            e->segment->live_bytes -= e->length;
+            e->segment->dead_bytes += e->length;
+            if (previous) {
+                *e = undo->previous;
+                e->segment = previous;
+                previous->dead_bytes -= e->length;
+                previous->live_bytes += e->length;
+            } else {
+                index_remove(shard, e);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&log->lock);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+/*
+ * Append one record and make it durable. A delete of a key that is not
+ * live returns STORAGE_LOG_NOT_FOUND; the check runs in the writer
+ * queue so concurrent deletes cannot both pass it.
+ */
+static int log_append(storage_log_t* log, uint8_t type, const storage_key_id_t* key_id,
+                      uint16_t flags, const uint8_t* payload, size_t payload_len) {
+    if (!log->open) {
+        LOGE("Segment log not open");
+        return STORAGE_LOG_ERROR;
+    }
+    if (payload_len > STORAGE_LOG_PAYLOAD_MAX) {
+        LOGE("Record too large: %zu bytes", payload_len);
+        return STORAGE_LOG_ERROR;
+    }
+
+    pthread_mutex_lock(&log->append_lock);
+    if (type == RECORD_DELETE && !storage_log_contains(log, key_id)) {
+        pthread_mutex_unlock(&log->append_lock);
+        return STORAGE_LOG_NOT_FOUND;
+    }
+    storage_segment_t* seg;
+    uint64_t end;
+    append_undo_t undo;
+    if (append_locked(log, type, key_id, flags, payload, payload_len, &seg, &end,
+                      &undo) != STORAGE_LOG_OK) {
+        pthread_mutex_unlock(&log->append_lock);
+        return STORAGE_LOG_ERROR;
+    }
+    int checkpoint_due = (log->since_checkpoint >= CHECKPOINT_INTERVAL_BYTES);
+    segment_pin(seg);
+    pthread_mutex_unlock(&log->append_lock);
+
+    // Sync outside the writer queue so the next append can proceed
+    int durable = !__atomic_load_n(&log->sync_writes, __ATOMIC_RELAXED) ||
+                  segment_sync(log, seg, end);
+    segment_unpin(log, seg);
+    if (!durable) {
+        index_revert(log, &undo);
+    }
+
+    if (checkpoint_due) {
+        checkpoint_write(log, 1);
+    }
+    filter_maintain(log);
+    return durable ? STORAGE_LOG_OK : STORAGE_LOG_ERROR;
+}
+
+/*
+ * Copy the live index entry for a key and pin its segment
+ * Returns 1 if found; the caller unpins loc->segment
+ */
+static int index_lookup(storage_log_t* log, const storage_key_id_t* key_id, index_entry_t* loc) {
+    if (!filter_may_contain(log, key_id)) return 0;
+
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_rdlock(&shard->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    int present = (e && !e->deleted);
+    if (present) {
+        *loc = *e;
+        segment_pin(loc->segment);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return present;
+}
+
+int storage_log_put(storage_log_t* log, const storage_key_id_t* key_id, const uint8_t* payload,
+                    size_t payload_len) {
+    return log_append(log, RECORD_PUT, key_id, 0, payload, payload_len);
+}
+
+int storage_log_put_flags(storage_log_t* log, const storage_key_id_t* key_id, uint16_t flags,
+                          const uint8_t* payload, size_t payload_len) {
+    return log_append(log, RECORD_PUT, key_id, flags, payload, payload_len);
+}
+
+void storage_log_set_key_epoch(storage_log_t* log, uint32_t key_epoch) {
+    pthread_mutex_lock(&log->append_lock);
+    log->key_epoch = key_epoch;
+    pthread_mutex_unlock(&log->append_lock);
+}
+
+int storage_log_delete(storage_log_t* log, const storage_key_id_t* key_id) {
+    return log_append(log, RECORD_DELETE, key_id, 0, NULL, 0);
+}
+
+/*
+ * Whether the newest record for a key is live and has sequence seq
+ * (caller holds append_lock, so no writer can change that under it)
+ */
+static int entry_has_seq(storage_log_t* log, const storage_key_id_t* key_id, uint64_t seq) {
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_rdlock(&shard->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    int current = (e && !e->deleted && e->seq == seq);
+    pthread_rwlock_unlock(&shard->lock);
+    return current;
+}
+
+int storage_log_write_batch(storage_log_t* log, storage_log_op_t* ops, size_t count) {
+    if (!log->open) {
+        LOGE("Segment log not open");
+        return STORAGE_LOG_ERROR;
+    }
+    if (count == 0) {
+        return STORAGE_LOG_OK;
+    }
+
+    // Segments written by this batch and where it ended in each, pinned
+    // until synced; a batch only spans several when it crosses a rollover
+    struct { storage_segment_t* seg; uint64_t end; int synced; }* touched =
+        malloc(count * sizeof(*touched));
+    size_t touched_count = 0;
+    // Per op: the segment it went to and what it replaced in the index
+    struct { size_t op; storage_segment_t* seg; append_undo_t undo; }* appended =
+        malloc(count * sizeof(*appended));
+    size_t appended_count = 0;
+    if (!touched || !appended) {
+        free(touched);
+        free(appended);
+        return STORAGE_LOG_ERROR;
+    }
+
+    int result = STORAGE_LOG_OK;
+    pthread_mutex_lock(&log->append_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        storage_log_op_t* op = &ops[i];
+        if (result != STORAGE_LOG_OK || op->payload_len > STORAGE_LOG_PAYLOAD_MAX) {
+            // Keep the batch a prefix: nothing lands after a failure
+            op->result = STORAGE_LOG_ERROR;
+            result = STORAGE_LOG_ERROR;
+            continue;
+        }
+        if (op->is_delete && !storage_log_contains(log, &op->key_id)) {
+            op->result = STORAGE_LOG_NOT_FOUND;
+            continue;
+        }
+        if (op->if_seq && !entry_has_seq(log, &op->key_id, op->if_seq)) {
+            op->result = STORAGE_LOG_CONFLICT;
+            continue;
+        }
+
+        storage_segment_t* seg;
+        uint64_t end;
+        op->result = append_locked(log, op->is_delete ? RECORD_DELETE : RECORD_PUT, &op->key_id,
+                                   op->flags, op->payload, op->payload_len, &seg, &end,
+                                   &appended[appended_count].undo);
+        if (op->result != STORAGE_LOG_OK) {
+            result = STORAGE_LOG_ERROR;
+            continue;
+        }
+        appended[appended_count].op = i;
+        appended[appended_count++].seg = seg;
+
+        if (touched_count == 0 || touched[touched_count - 1].seg != seg) {
+            segment_pin(seg);
+            touched[touched_count++].seg = seg;
+        }
+        touched[touched_count - 1].end = end;
+    }
+
+    int checkpoint_due = (log->since_checkpoint >= CHECKPOINT_INTERVAL_BYTES);
+    pthread_mutex_unlock(&log->append_lock);
+
+    // One sync per segment covers the whole batch
+    int sync_writes = __atomic_load_n(&log->sync_writes, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < touched_count; i++) {
+        touched[i].synced = !sync_writes || segment_sync(log, touched[i].seg, touched[i].end);
+    }
+
+    // Ops in a segment whose sync failed are reverted newest first, so a
+    // key written twice ends up back at what it was before the batch
+    for (size_t k = appended_count; k-- > 0;) {
+        size_t t = 0;
+        while (touched[t].seg != appended[k].seg) t++;
+        if (!touched[t].synced) {
+            index_revert(log, &appended[k].undo);
+            ops[appended[k].op].result = STORAGE_LOG_ERROR;
+            result = STORAGE_LOG_ERROR;
+        }
+    }
+    for (size_t i = 0; i < touched_count; i++) {
+        segment_unpin(log, touched[i].seg);
+    }
+    free(touched);
+    free(appended);
+
+    if (checkpoint_due) {
+        checkpoint_write(log, 1);
+    }
+    filter_maintain(log);
+    return result;
+}
+
+int storage_log_get(storage_log_t* log, const storage_key_id_t* key_id, uint8_t** payload,
+                    size_t* payload_len) {
+    *payload = NULL;
+    *payload_len = 0;
+
+    index_entry_t loc;
+    if (!index_lookup(log, key_id, &loc)) {
+        return STORAGE_LOG_NOT_FOUND;
+    }
+    storage_segment_t* seg = loc.segment;
+
+    size_t len = loc.length - RECORD_HEADER_SIZE;
+    uint8_t raw[RECORD_HEADER_SIZE];
+    record_header_t h;
+    uint8_t* buf = malloc(len ? len : 1);
+
+    int ok = buf &&
+             read_full(seg->fd, raw, sizeof(raw), loc.offset) &&
+             decode_header(raw, &h) &&
+             key_id_equal(&h.key_id, key_id) && h.seq == loc.seq &&
+             read_full(seg->fd, buf, len, loc.offset + RECORD_HEADER_SIZE);
+    if (!ok) {
+        LOGE("Failed to read record from segment %08x at %llu", seg->id,
+             (unsigned long long)loc.offset);
+    }
+    segment_unpin(log, seg);
+
+    if (!ok) {
+        free(buf);
+        return STORAGE_LOG_ERROR;
+    }
+
+    *payload = buf;
+    *payload_len = len;
+    return STORAGE_LOG_OK;
+}
+
+int storage_log_contains(storage_log_t* log, const storage_key_id_t* key_id) {
+    if (!filter_may_contain(log, key_id)) return 0;
+
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_rdlock(&shard->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    int present = (e && !e->deleted);
+    pthread_rwlock_unlock(&shard->lock);
+    return present;
+}
+
+int storage_log_get_flags(storage_log_t* log, const storage_key_id_t* key_id, uint16_t* flags) {
+    if (!filter_may_contain(log, key_id)) return STORAGE_LOG_NOT_FOUND;
+
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_rdlock(&shard->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    int present = (e && !e->deleted);
+    if (present) *flags = e->flags;
+    pthread_rwlock_unlock(&shard->lock);
+    return present ? STORAGE_LOG_OK : STORAGE_LOG_NOT_FOUND;
+}
+
+int storage_log_get_length(storage_log_t* log, const storage_key_id_t* key_id,
+                           size_t* payload_len) {
+    if (!filter_may_contain(log, key_id)) return STORAGE_LOG_NOT_FOUND;
+
+    index_shard_t* shard = shard_for(log, key_id);
+    pthread_rwlock_rdlock(&shard->lock);
+    index_entry_t* e = index_find(shard, key_id);
+    int present = (e && !e->deleted);
+    if (present) *payload_len = e->length - RECORD_HEADER_SIZE;
+    pthread_rwlock_unlock(&shard->lock);
+    return present ? STORAGE_LOG_OK : STORAGE_LOG_NOT_FOUND;
+}
+
+/*
+ * Snapshot live key ids matching flags_mask (0 = any), skipping keys
+ * sealed under skip_epoch when by_epoch is set
+ */
+static int index_list(storage_log_t* log, uint16_t flags_mask, int by_epoch, uint32_t skip_epoch,
+                      storage_key_id_t** ids, size_t* count) {
+    *ids = NULL;
+    *count = 0;
+
+    storage_key_id_t* list = NULL;
+    size_t n = 0, capacity = 0;
+
+    for (size_t k = 0; k < INDEX_SHARDS; k++) {
+        index_shard_t* shard = &log->shards[k];
+        pthread_rwlock_rdlock(&shard->lock);
+
+        // Room for the whole shard up front, so the scan does not allocate
+        if (n + shard->count > capacity) {
+            size_t grown_capacity = (n + shard->count) * 2;
+            storage_key_id_t* grown = realloc(list, grown_capacity * sizeof(storage_key_id_t));
+            if (!grown) {
+                pthread_rwlock_unlock(&shard->lock);
+                free(list);
+                LOGE("Failed to allocate key list");
+                return STORAGE_LOG_ERROR;
+            }
+            list = grown;
+            capacity = grown_capacity;
+        }
+
+        for (size_t i = 0; i < shard->capacity; i++) {
+            const index_entry_t* e = &shard->table[i];
+            if (!e->used || e->deleted) continue;
+            if (flags_mask && !(e->flags & flags_mask)) continue;
+            if (by_epoch && e->key_epoch == skip_epoch) continue;
+            list[n++] = e->key_id;
+        }
+        pthread_rwlock_unlock(&shard->lock);
+    }
+
+    *ids = list;
+    *count = n;
+    return STORAGE_LOG_OK;
+}
+
+int storage_log_list(storage_log_t* log, uint16_t flags_mask, storage_key_id_t** ids,
+                     size_t* count) {
+    return index_list(log, flags_mask, 0, 0, ids, count);
+}
+
+int storage_log_list_stale(storage_log_t* log, uint32_t key_epoch, storage_key_id_t** ids,
+                           size_t* count) {
+    return index_list(log, 0, 1, key_epoch, ids, count);
+}
+
+int storage_log_map(storage_log_t* log, const storage_key_id_t* key_id, storage_log_view_t* view) {
+    memset(view, 0, sizeof(*view));
+
+    index_entry_t loc;
+    if (!index_lookup(log, key_id, &loc)) {
+        return STORAGE_LOG_NOT_FOUND;
+    }
+    storage_segment_t* seg = loc.segment;
+
+    // The mapping keeps the file alive, so the pin only covers mmap itself
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = loc.offset & ~(page - 1);
+    size_t map_len = (size_t)(loc.offset + loc.length - start);
+    uint32_t segment_id = seg->id;
+    void* base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, seg->fd, (off_t)start);
+    segment_unpin(log, seg);
+
+    if (base == MAP_FAILED) {
+        LOGE("Failed to map record in segment %08x at %llu", segment_id,
+             (unsigned long long)loc.offset);
+        return STORAGE_LOG_ERROR;
+    }
+
+    const uint8_t* record = (const uint8_t*)base + (loc.offset - start);
+    record_header_t h;
+    if (!decode_header(record, &h) || !key_id_equal(&h.key_id, key_id) || h.seq != loc.seq) {
+        LOGE("Mapped record in segment %08x at %llu does not match index", segment_id,
+             (unsigned long long)loc.offset);
+        munmap(base, map_len);
+        return STORAGE_LOG_ERROR;
+    }
+
+    view->payload = record + RECORD_HEADER_SIZE;
+    view->payload_len = loc.length - RECORD_HEADER_SIZE;
+    view->flags = h.flags;
+    view->key_epoch = h.key_epoch;
+    view->seq = h.seq;
+    view->map_base = base;
+    view->map_len = map_len;
+    return STORAGE_LOG_OK;
+}
+
+void storage_log_unmap(storage_log_view_t* view) {
+    if (view->map_base) {
+        munmap(view->map_base, view->map_len);
+    }
+    memset(view, 0, sizeof(*view));
+}
+
+void storage_log_get_metrics(storage_log_t* log, storage_log_metrics_t* metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+
+    pthread_mutex_lock(&log->lock);
+    metrics->segment_count = log->segment_count;
+    for (size_t i = 0; i < log->segment_count; i++) {
+        metrics->live_bytes += log->segments[i]->live_bytes;
+        metrics->dead_bytes += log->segments[i]->dead_bytes;
+    }
+    metrics->recovery_us = log->recovery_us;
+    metrics->recovery_bytes_scanned = log->recovery_bytes;
+    metrics->recovered_from_checkpoint = log->recovered_from_checkpoint;
+    pthread_mutex_unlock(&log->lock);
+
+    uint64_t total = metrics->live_bytes + metrics->dead_bytes;
+    metrics->live_ratio = total ? (float)metrics->live_bytes / (float)total : 1.0f;
+
+    pthread_mutex_lock(&log->compact.lock);
+    metrics->compactions_completed = log->compact.completed;
+    metrics->compaction_bytes_read = log->compact.bytes_read;
+    metrics->compaction_bytes_written = log->compact.bytes_written;
+    metrics->compaction_bytes_reclaimed = log->compact.bytes_reclaimed;
+    metrics->compaction_time_us = log->compact.time_us;
+    pthread_mutex_unlock(&log->compact.lock);
+
+    pthread_mutex_lock(&log->filter.rebuild_lock);
+    metrics->filter_bytes = log->filter.current ? filter_bytes(log->filter.current) : 0;
+    metrics->filter_rebuilds = log->filter.rebuilds;
+    pthread_mutex_unlock(&log->filter.rebuild_lock);
+
+    if (metrics->compaction_time_us > 0) {
+        metrics->compaction_throughput_mb_s =
+            (float)((double)metrics->compaction_bytes_read /
+                    ((double)metrics->compaction_time_us / 1e6) / (1024.0 * 1024.0));
+    }
+}
+
+// ============================================================================
+// Compaction
+// ============================================================================
+
+void storage_log_default_policy(storage_compaction_policy_t* policy) {
+    policy->interval_ms = 200;
+    policy->time_budget_ms = 4;                 // Well under one frame
+    policy->io_budget_bytes = 2 * 1024 * 1024;  // 2 MB/s
+    policy->min_dead_ratio = 0.5f;
+}
+
+/*
+ * Pick the sealed segment with the highest dead ratio (caller holds log->lock)
+ */
+static storage_segment_t* pick_victim(storage_log_t* log, float min_dead_ratio) {
+    storage_segment_t* best = NULL;
+    float best_ratio = 0.0f;
+
+    for (size_t i = 0; i < log->segment_count; i++) {
+        storage_segment_t* s = log->segments[i];
+        if (s->role != SEGMENT_SEALED || s->dead_bytes == 0) continue;
+
+        float dead_ratio = 1.0f - (float)s->live_bytes / (float)s->size;
+        if (dead_ratio < min_dead_ratio && s->live_bytes > 0) continue;
+
+        if (!best || dead_ratio > best_ratio) {
+            best = s;
+            best_ratio = dead_ratio;
+        }
+    }
+    return best;
+}
+
+/*
+ * A delete record may be dropped once no other segment can still hold an
+ * older record for the same key (caller holds log->lock)
+ */
+static int delete_droppable(storage_log_t* log, uint64_t seq, const storage_segment_t* victim) {
+    for (size_t i = 0; i < log->segment_count; i++) {
+        const storage_segment_t* s = log->segments[i];
+        if (s != victim && s->min_seq <= seq) return 0;
+    }
+    return 1;
+}
+
+static int reloc_push(storage_log_t* log, const relocation_t* r) {
+    if (log->compact.reloc_count == log->compact.reloc_capacity) {
+        size_t capacity = log->compact.reloc_capacity ? log->compact.reloc_capacity * 2 : 64;
+        relocation_t* grown = realloc(log->compact.relocs, capacity * sizeof(relocation_t));
+        if (!grown) return 0;
+        log->compact.relocs = grown;
+        log->compact.reloc_capacity = capacity;
+    }
+    log->compact.relocs[log->compact.reloc_count++] = *r;
+    return 1;
+}
+
+static int ensure_buffer(storage_log_t* log, size_t len) {
+    if (len <= log->compact.buffer_capacity) return 1;
+    uint8_t* grown = realloc(log->compact.buffer, len);
+    if (!grown) return 0;
+    log->compact.buffer = grown;
+    log->compact.buffer_capacity = len;
+    return 1;
+}
+
+/*
+ * Output segment with room for length bytes; full outputs are synced and sealed
+ */
+static storage_segment_t* output_for(storage_log_t* log, uint64_t length) {
+    storage_segment_t* out = log->compact.output;
+    if (out && out->size > 0 && out->size + length > STORAGE_LOG_SEGMENT_MAX) {
+        fdatasync(out->fd);
+        pthread_mutex_lock(&log->lock);
+        out->role = SEGMENT_SEALED;
+        pthread_mutex_unlock(&log->lock);
+        out = NULL;
+    }
+    if (!out) {
+        out = segment_create(log, SEGMENT_OUTPUT);
+        log->compact.output = out;
+    }
+    return out;
+}
+
+/*
+ * Victim fully copied: make the copies durable, then repoint every index
+ * entry that still refers to the victim in one critical section and
+ * retire the victim. Readers that pinned the victim before the repoint
+ * keep it alive until they unpin.
+ */
+static void finish_victim(storage_log_t* log) {
+    storage_segment_t* victim = log->compact.victim;
+
+    if (log->compact.output) {
+        fdatasync(log->compact.output->fd);
+    }
+    sync_directory(log);
+
+    shards_lock_all(log);
+    pthread_mutex_lock(&log->lock);
+    for (size_t i = 0; i < log->compact.reloc_count; i++) {
+        relocation_t* r = &log->compact.relocs[i];
+        index_shard_t* shard = shard_for(log, &r->key_id);
+        index_entry_t* e = index_find(shard, &r->key_id);
+        int current = e && e->seq == r->seq && e->segment == victim &&
+                      e->offset == r->old_offset;
+
+        if (!current) {
+            // Superseded while we were copying: the copy is garbage
+            if (r->target) r->target->dead_bytes += r->length;
+            continue;
+        }
+
+        victim->live_bytes -= r->length;
+        if (r->target) {
+            e->segment = r->target;
+            e->offset = r->new_offset;
+            r->target->live_bytes += r->length;
+        } else {
+            index_remove(shard, e);
+        }
+    }
+
+    segment_table_remove(log, victim);
+    __atomic_store_n(&victim->retired, 1, __ATOMIC_RELEASE);
+    log->compact.bytes_reclaimed += (victim->size > log->compact.written)
+                                     ? victim->size - log->compact.written : 0;
+    log->compact.completed++;
+    pthread_mutex_unlock(&log->lock);
+    shards_unlock_all(log);
+
+    LOGI("Compacted segment %08x: %llu bytes, %llu relocated", victim->id,
+         (unsigned long long)victim->size, (unsigned long long)log->compact.written);
+
+    segment_unpin(log, victim);
+    log->compact.victim = NULL;
+    log->compact.reloc_count = 0;
+}
+
+int storage_log_compact_step(storage_log_t* log, uint64_t byte_budget, uint32_t time_budget_ms) {
+    if (!log->open) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&log->compact.lock);
+    uint64_t start = now_us();
+    uint64_t deadline = start + (uint64_t)time_budget_ms * 1000ULL;
+    uint64_t work = 0;
+    int result = 1;
+
+    if (!log->compact.victim) {
+        // The policy is written under thread_lock by compaction_start
+        pthread_mutex_lock(&log->compact.thread_lock);
+        float min_dead_ratio = log->compact.policy.min_dead_ratio;
+        pthread_mutex_unlock(&log->compact.thread_lock);
+
+        pthread_mutex_lock(&log->lock);
+        storage_segment_t* victim = pick_victim(log, min_dead_ratio);
+        if (victim) {
+            segment_pin(victim);
+            victim->compacting = 1;
+        }
+        pthread_mutex_unlock(&log->lock);
+
+        if (!victim) {
+            pthread_mutex_unlock(&log->compact.lock);
+            return 0;
+        }
+
+        log->compact.victim = victim;
+        log->compact.cursor = 0;
+        log->compact.written = 0;
+        log->compact.reloc_count = 0;
+    }
+
+    storage_segment_t* victim = log->compact.victim;
+
+    while (log->compact.cursor < victim->size) {
+        if (work >= byte_budget || now_us() >= deadline) break;
+
+        uint64_t offset = log->compact.cursor;
+        uint8_t raw[RECORD_HEADER_SIZE];
+        record_header_t h;
+
+        if (!read_full(victim->fd, raw, sizeof(raw), offset) || !decode_header(raw, &h)) {
+            LOGE("Compaction: malformed record in segment %08x at %llu", victim->id,
+                 (unsigned long long)offset);
+            result = -1;
+            break;
+        }
+
+        uint32_t length = RECORD_HEADER_SIZE + h.payload_len;
+        work += length;
+        log->compact.bytes_read += length;
+
+        index_shard_t* shard = shard_for(log, &h.key_id);
+        pthread_rwlock_rdlock(&shard->lock);
+        index_entry_t* e = index_find(shard, &h.key_id);
+        int live = e && e->seq == h.seq && e->segment == victim && e->offset == offset;
+        int deleted = live && e->deleted;
+        pthread_rwlock_unlock(&shard->lock);
+
+        pthread_mutex_lock(&log->lock);
+        int drop = deleted && delete_droppable(log, h.seq, victim);
+        pthread_mutex_unlock(&log->lock);
+
+        relocation_t r = {
+            .key_id = h.key_id,
+            .seq = h.seq,
+            .old_offset = offset,
+            .length = length,
+            .target = NULL,
+        };
+
+        if (live && !drop) {
+            storage_segment_t* out = output_for(log, length);
+            if (!out || !ensure_buffer(log, length) ||
+                !read_full(victim->fd, log->compact.buffer, length, offset) ||
+                !write_full(out->fd, log->compact.buffer, length, out->size)) {
+                LOGE("Compaction: failed to relocate record from segment %08x", victim->id);
+                result = -1;
+                break;
+            }
+
+            r.target = out;
+            r.new_offset = out->size;
+
+            pthread_mutex_lock(&log->lock);
+            out->size += length;
+            if (h.seq < out->min_seq) out->min_seq = h.seq;
+            pthread_mutex_unlock(&log->lock);
+
+            work += length;
+            log->compact.written += length;
+            log->compact.bytes_written += length;
+        }
+
+        if ((live || drop) && !reloc_push(log, &r)) {
+            result = -1;
+            break;
+        }
+
+        log->compact.cursor += length;
+    }
+
+    if (result < 0) {
+        // Abandon this victim; copies already written are counted dead later
+        pthread_mutex_lock(&log->lock);
+        victim->compacting = 0;
+        pthread_mutex_unlock(&log->lock);
+        segment_unpin(log, victim);
+        log->compact.victim = NULL;
+        log->compact.reloc_count = 0;
+    } else if (log->compact.cursor >= victim->size) {
+        finish_victim(log);
+        // The checkpoint on disk still names the victim; replace it
+        checkpoint_write(log, 0);
+    }
+
+    log->compact.time_us += now_us() - start;
+    pthread_mutex_unlock(&log->compact.lock);
+    return result;
+}
+
+static void* compaction_thread(void* arg) {
+    storage_log_t* log = arg;
+    LOGI("Compaction thread started");
+
+    pthread_mutex_lock(&log->compact.thread_lock);
+    while (!log->compact.stop) {
+        storage_compaction_policy_t policy = log->compact.policy;
+        pthread_mutex_unlock(&log->compact.thread_lock);
+
+        uint64_t byte_budget = policy.io_budget_bytes * policy.interval_ms / 1000;
+        if (byte_budget < RECORD_HEADER_SIZE) byte_budget = RECORD_HEADER_SIZE;
+        int did_work = storage_log_compact_step(log, byte_budget, policy.time_budget_ms);
+
+        // Back off when there is nothing to compact
+        uint32_t sleep_ms = (did_work > 0) ? policy.interval_ms : policy.interval_ms * 10;
+
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += sleep_ms / 1000;
+        until.tv_nsec += (long)(sleep_ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&log->compact.thread_lock);
+        if (!log->compact.stop) {
+            pthread_cond_timedwait(&log->compact.thread_cond, &log->compact.thread_lock, &until);
+        }
+    }
+    pthread_mutex_unlock(&log->compact.thread_lock);
+
+    LOGI("Compaction thread stopped");
+    return NULL;
+}
+
+int storage_log_compaction_start(storage_log_t* log, const storage_compaction_policy_t* policy) {
+    pthread_mutex_lock(&log->compact.thread_lock);
+    if (policy) {
+        log->compact.policy = *policy;
+    } else {
+        storage_log_default_policy(&log->compact.policy);
+    }
+    storage_compaction_policy_t active = log->compact.policy;
+
+    if (log->compact.running) {
+        pthread_mutex_unlock(&log->compact.thread_lock);
+        return STORAGE_LOG_OK;
+    }
+
+    log->compact.stop = 0;
+    if (pthread_create(&log->compact.thread, NULL, compaction_thread, log) != 0) {
+        pthread_mutex_unlock(&log->compact.thread_lock);
+        LOGE("Failed to start compaction thread");
+        return STORAGE_LOG_ERROR;
+    }
+    log->compact.running = 1;
+    pthread_mutex_unlock(&log->compact.thread_lock);
+
+    LOGI("Background compaction: %u ms interval, %u ms/step, %llu bytes/s, dead >= %.0f%%",
+         active.interval_ms, active.time_budget_ms, (unsigned long long)active.io_budget_bytes,
+         active.min_dead_ratio * 100.0f);
+    return STORAGE_LOG_OK;
+}
+
+void storage_log_compaction_stop(storage_log_t* log) {
+    pthread_mutex_lock(&log->compact.thread_lock);
+    if (!log->compact.running) {
+        pthread_mutex_unlock(&log->compact.thread_lock);
+        return;
+    }
+    log->compact.stop = 1;
+    pthread_cond_signal(&log->compact.thread_cond);
+    pthread_mutex_unlock(&log->compact.thread_lock);
+
+    pthread_join(log->compact.thread, NULL);
+
+    pthread_mutex_lock(&log->compact.thread_lock);
+    log->compact.running = 0;
+    pthread_mutex_unlock(&log->compact.thread_lock);
+}
@@ -0,0 +1,281 @@
+/*
+ * SovereignDroid Secure Storage - Segment Log
+ *
+ * Append-only record log backing the encrypted key-value store.
+ *
+ * Layout:
+ * - STORAGE_DIR/seg-XXXXXXXX.log segment files, rolled over at a fixed size
+ * - Every store/delete appends one record; nothing is rewritten in place
+ * - An in-memory hash index maps key hash -> newest record location
+ *
+ * Crash consistency:
+ * - Records carry a CRC32C over header and payload; recovery truncates a
+ *   segment at the first record that fails it (a torn append)
+ * - Appends are fdatasync'd before they return, new segments are made
+ *   durable with a directory sync
+ * - STORAGE_DIR/index.ckpt snapshots the index, key filter and segment
+ *   sizes (on close, every few MB of appends and after compaction), so
+ *   recovery cost follows the bytes written since, not the size of the
+ *   store
+ *
+ * Overwritten and deleted records become dead bytes. A background
+ * compactor rewrites the live records of mostly-dead segments into new
+ * segments, then swaps the index entries over in one critical section
+ * and retires the old segment. Reads and writes only contend with the
+ * compactor for the short index critical section, never for its I/O.
+ *
+ * Records carry opaque payloads (nonce + tag + ciphertext); encryption
+ * stays in secure_storage.c. Keys are identified by a 128-bit keyed digest
+ * of the key name, stored in every record header as the key tag. The
+ * header also names the master key epoch the payload was sealed under,
+ * so the store can be re-keyed one record at a time.
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_LOG_H
+#define SOVEREIGNDROID_SECURE_STORAGE_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Status codes
+#define STORAGE_LOG_OK 0
+#define STORAGE_LOG_ERROR -1
+#define STORAGE_LOG_NOT_FOUND -2
+#define STORAGE_LOG_CONFLICT -3     // Conditional write lost to a newer record
+
+// Segment rollover size
+#define STORAGE_LOG_SEGMENT_MAX (4 * 1024 * 1024)
+
+// Largest payload a single record may carry
+#define STORAGE_LOG_PAYLOAD_MAX (64 * 1024 * 1024)
+
+// Record flags (opaque to the log, interpreted by secure_storage.c)
+#define STORAGE_LOG_FLAG_STREAM 0x0001     // Payload is a stream manifest
+#define STORAGE_LOG_FLAG_CHUNK 0x0002      // Payload is one chunk of a stream
+#define STORAGE_LOG_FLAG_NAME 0x0004       // Payload is an encrypted key name
+#define STORAGE_LOG_FLAG_COMPRESSED 0x0008 // Payload was compressed before encryption
+#define STORAGE_LOG_FLAG_SHARED 0x0010     // Payload is a chunk shared by deduplicated values
+
+// Key identifier: keyed 128-bit digest of the key name
+#define STORAGE_KEY_ID_SIZE 16
+
+typedef struct {
+    uint8_t bytes[STORAGE_KEY_ID_SIZE];
+} storage_key_id_t;
+
+// One open log; every call below except open takes the log it acts on
+typedef struct storage_log storage_log_t;
+
+// Read-only mapping of one record payload (storage_log_map)
+typedef struct {
+    const uint8_t* payload;
+    size_t payload_len;
+    uint16_t flags;                // STORAGE_LOG_FLAG_* of the record
+    uint32_t key_epoch;            // Master key epoch the payload was sealed under
+    uint64_t seq;                  // Record sequence, for conditional batch ops
+    void* map_base;                // Page-aligned mapping, for unmap
+    size_t map_len;
+} storage_log_view_t;
+
+// Compaction throttling policy
+typedef struct {
+    uint32_t interval_ms;          // Sleep between compaction steps
+    uint32_t time_budget_ms;       // Max wall time spent per step
+    uint64_t io_budget_bytes;      // Max bytes read + written per second
+    float min_dead_ratio;          // Only compact segments at least this dead
+} storage_compaction_policy_t;
+
+// Store and compaction metrics
+typedef struct {
+    uint64_t segment_count;
+    uint64_t live_bytes;
+    uint64_t dead_bytes;
+    float live_ratio;              // live / (live + dead), 1.0 when empty
+
+    uint64_t compactions_completed;     // Segments reclaimed
+    uint64_t compaction_bytes_read;
+    uint64_t compaction_bytes_written;
+    uint64_t compaction_bytes_reclaimed;
+    uint64_t compaction_time_us;        // Time spent inside compaction steps
+    float compaction_throughput_mb_s;   // Bytes read per second of step time
+
+    uint64_t recovery_us;               // Time the last open spent rebuilding the index
+    uint64_t recovery_bytes_scanned;    // Record bytes that recovery read and checked
+    int recovered_from_checkpoint;      // 1 if it started from the index checkpoint
+
+    uint64_t filter_bytes;              // Key filter that answers misses before the index
+    uint64_t filter_rebuilds;
+} storage_log_metrics_t;
+
+/*
+ * Open the log in a directory and rebuild the index. A valid index
+ * checkpoint is loaded first, key filter included, so only records
+ * appended after it are scanned; without one every segment is scanned.
+ * Records failing their checksum at the tail of a segment are torn
+ * writes and get truncated. Logs in different directories are
+ * independent of each other.
+ * Returns the log, NULL on failure
+ */
+storage_log_t* storage_log_open(const char* dir);
+
+/*
+ * Make every append durable before it returns (default on). Writers that
+ * append while another one syncs share its next fdatasync. An append
+ * whose sync fails returns STORAGE_LOG_ERROR and, until the log is
+ * closed, the key reads as it did before it. Only the index is reverted:
+ * the record stays in its segment, so it may reappear after a reopen or
+ * a crash, as may any write whose sync failed.
+ */
+void storage_log_set_sync(storage_log_t* log, int sync_writes);
+
+/*
+ * Stop compaction, close all segments and free the log
+ */
+void storage_log_close(storage_log_t* log);
+
+/*
+ * Append a record for key_id carrying payload
+ * Returns STORAGE_LOG_OK on success
+ */
+int storage_log_put(storage_log_t* log, const storage_key_id_t* key_id, const uint8_t* payload,
+                    size_t payload_len);
+
+/*
+ * Append a record carrying STORAGE_LOG_FLAG_* bits
+ * Returns STORAGE_LOG_OK on success
+ */
+int storage_log_put_flags(storage_log_t* log, const storage_key_id_t* key_id, uint16_t flags,
+                          const uint8_t* payload, size_t payload_len);
+
+/*
+ * Key epoch stamped on records appended from now on (default 0)
+ */
+void storage_log_set_key_epoch(storage_log_t* log, uint32_t key_epoch);
+
+/*
+ * Append a delete record for key_id
+ * Returns STORAGE_LOG_OK, or STORAGE_LOG_NOT_FOUND if the key has no value
+ */
+int storage_log_delete(storage_log_t* log, const storage_key_id_t* key_id);
+
+/*
+ * One operation of a batch write
+ */
+typedef struct {
+    storage_key_id_t key_id;
+    const uint8_t* payload;     // Unused for deletes
+    size_t payload_len;
+    uint16_t flags;
+    uint8_t is_delete;
+    uint64_t if_seq;            // Nonzero: only if the key's newest record still has this seq
+    int result;                 // Out: STORAGE_LOG_OK, _NOT_FOUND (delete of an absent key),
+                                // _CONFLICT (if_seq no longer current) or _ERROR
+} storage_log_op_t;
+
+/*
+ * Append a batch of puts and deletes in array order during one turn of
+ * the writer queue, then make all of it durable with one sync. Not
+ * atomic: after a crash a prefix of the batch may survive.
+ * Ops with if_seq set are skipped as conflicts when a newer record (or a
+ * delete) landed since that seq was read, so a background rewrite never
+ * clobbers a concurrent store.
+ * Returns STORAGE_LOG_OK if every op succeeded, conflicted or was a
+ * delete of an absent key, STORAGE_LOG_ERROR otherwise (see each op's result)
+ */
+int storage_log_write_batch(storage_log_t* log, storage_log_op_t* ops, size_t count);
+
+/*
+ * Read the newest payload for key_id into a malloc'd buffer.
+ * The record's stored key tag must match key_id, so a misdirected read
+ * is caught before anything is decrypted.
+ * Caller frees *payload
+ * Returns STORAGE_LOG_OK, STORAGE_LOG_NOT_FOUND or STORAGE_LOG_ERROR
+ */
+int storage_log_get(storage_log_t* log, const storage_key_id_t* key_id, uint8_t** payload,
+                    size_t* payload_len);
+
+/*
+ * Check whether key_id currently has a value (index lookup only)
+ * Returns 1 if present, 0 if not
+ */
+int storage_log_contains(storage_log_t* log, const storage_key_id_t* key_id);
+
+/*
+ * Flags of the newest record for key_id (index lookup only)
+ * Returns STORAGE_LOG_OK or STORAGE_LOG_NOT_FOUND
+ */
+int storage_log_get_flags(storage_log_t* log, const storage_key_id_t* key_id, uint16_t* flags);
+
+/*
+ * Payload length of the newest record for key_id (index lookup only)
+ * Returns STORAGE_LOG_OK or STORAGE_LOG_NOT_FOUND
+ */
+int storage_log_get_length(storage_log_t* log, const storage_key_id_t* key_id, size_t* payload_len);
+
+/*
+ * Snapshot the ids of live keys whose newest record has any of the
+ * flags in flags_mask set; a mask of 0 lists every live key.
+ * Cost is one pass over the index, no disk I/O. Caller frees *ids
+ * Returns STORAGE_LOG_OK or STORAGE_LOG_ERROR
+ */
+int storage_log_list(storage_log_t* log, uint16_t flags_mask, storage_key_id_t** ids,
+                     size_t* count);
+
+/*
+ * Snapshot the ids of live keys whose newest record was sealed under
+ * any key epoch other than key_epoch. Caller frees *ids
+ * Returns STORAGE_LOG_OK or STORAGE_LOG_ERROR
+ */
+int storage_log_list_stale(storage_log_t* log, uint32_t key_epoch, storage_key_id_t** ids,
+                           size_t* count);
+
+/*
+ * Map the newest payload for key_id read-only, without copying it.
+ * The key tag is checked like storage_log_get. The mapping stays valid
+ * after compaction retires the segment; release it with storage_log_unmap.
+ * Returns STORAGE_LOG_OK, STORAGE_LOG_NOT_FOUND or STORAGE_LOG_ERROR
+ */
+int storage_log_map(storage_log_t* log, const storage_key_id_t* key_id, storage_log_view_t* view);
+
+/*
+ * Release a mapping from storage_log_map
+ */
+void storage_log_unmap(storage_log_view_t* view);
+
+/*
+ * Default compaction policy: gentle enough to run alongside rendering
+ */
+void storage_log_default_policy(storage_compaction_policy_t* policy);
+
+/*
+ * Start the background compaction thread
+ * Returns STORAGE_LOG_OK on success (or if already running)
+ */
+int storage_log_compaction_start(storage_log_t* log, const storage_compaction_policy_t* policy);
+
+/*
+ * Stop the background compaction thread (waits for the current step)
+ */
+void storage_log_compaction_stop(storage_log_t* log);
+
+/*
+ * Run one throttled compaction step on the calling thread
+ * byte_budget: max bytes to read + write in this step
+ * Returns 1 if work was done, 0 if nothing to compact, negative on error
+ */
+int storage_log_compact_step(storage_log_t* log, uint64_t byte_budget, uint32_t time_budget_ms);
+
+/*
+ * Snapshot store and compaction metrics
+ */
+void storage_log_get_metrics(storage_log_t* log, storage_log_metrics_t* metrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_LOG_H
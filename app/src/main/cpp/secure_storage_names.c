@@ -0,0 +1,260 @@
+/*
+ * SovereignDroid Secure Storage - Ordered Key Name Index Implementation
+ *
+ * One sorted array of (name, key id), ordered by byte-wise strcmp.
+ * Lookups and range starts are binary searches; inserts and removes move
+ * the tail of the array, which for the few thousand keys a device holds
+ * costs less than the encryption of the value being stored.
+ */
+
+#include "secure_storage_names.h"
+#include "secure_buffer.h"
+#include <android/log.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "SecureStorageNames"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define NAMES_INITIAL_CAPACITY 64
+
+static struct {
+    pthread_rwlock_t lock;
+    int loaded;
+    storage_name_entry_t* entries;
+    size_t count;
+    size_t capacity;
+} g_names = {
+    .lock = PTHREAD_RWLOCK_INITIALIZER,
+};
+
+static void free_name(char* name) {
+    if (name) {
+        secure_buffer_wipe(name, strlen(name));
+        free(name);
+    }
+}
+
+// ============================================================================
+// Internal helpers (caller holds g_names.lock)
+// ============================================================================
+
+// Index of the first entry not less than name
+static size_t lower_bound(const char* name) {
+    size_t lo = 0, hi = g_names.count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (strcmp(g_names.entries[mid].name, name) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int found_at(size_t i, const char* name) {
+    return i < g_names.count && strcmp(g_names.entries[i].name, name) == 0;
+}
+
+static int reserve(size_t capacity) {
+    if (capacity <= g_names.capacity) return 1;
+
+    size_t grown_capacity = g_names.capacity ? g_names.capacity : NAMES_INITIAL_CAPACITY;
+    while (grown_capacity < capacity) grown_capacity *= 2;
+
+    storage_name_entry_t* grown = realloc(g_names.entries, grown_capacity * sizeof(*grown));
+    if (!grown) {
+        LOGE("Failed to grow name index to %zu entries", grown_capacity);
+        return 0;
+    }
+    g_names.entries = grown;
+    g_names.capacity = grown_capacity;
+    return 1;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    return strcmp(((const storage_name_entry_t*)a)->name, ((const storage_name_entry_t*)b)->name);
+}
+
+/*
+ * Merge sorted entries into the index; on a duplicate the entry already
+ * present wins and the incoming name is freed. Takes ownership of names.
+ */
+static int merge_sorted(storage_name_entry_t* incoming, size_t count) {
+    storage_name_entry_t* merged = malloc((g_names.count + count + 1) * sizeof(*merged));
+    if (!merged) {
+        for (size_t i = 0; i < count; i++) free_name(incoming[i].name);
+        return 0;
+    }
+
+    size_t i = 0, j = 0, n = 0;
+    while (i < g_names.count || j < count) {
+        if (j < count && n > 0 && strcmp(incoming[j].name, merged[n - 1].name) == 0) {
+            free_name(incoming[j++].name);
+            continue;
+        }
+
+        int cmp = (i == g_names.count) ? 1
+                : (j == count) ? -1
+                : strcmp(g_names.entries[i].name, incoming[j].name);
+        if (cmp <= 0) {
+            merged[n++] = g_names.entries[i++];
+        } else {
+            merged[n++] = incoming[j++];
+        }
+    }
+
+    free(g_names.entries);
+    g_names.entries = merged;
+    g_names.count = n;
+    g_names.capacity = g_names.count + count + 1;
+    return 1;
+}
+
+typedef int (*match_fn)(const char* name, const void* arg);
+
+static int before_end(const char* name, const void* end) {
+    return !end || strcmp(name, (const char*)end) < 0;
+}
+
+static int has_prefix(const char* name, const void* prefix) {
+    return strncmp(name, (const char*)prefix, strlen((const char*)prefix)) == 0;
+}
+
+/*
+ * Copy names from the first one >= start while match holds
+ */
+static char** collect(const char* start, match_fn match, const void* arg, size_t* count) {
+    *count = 0;
+
+    pthread_rwlock_rdlock(&g_names.lock);
+    size_t first = start ? lower_bound(start) : 0;
+    size_t last = first;
+    while (last < g_names.count && match(g_names.entries[last].name, arg)) last++;
+
+    char** names = malloc((last - first + 1) * sizeof(char*));
+    size_t n = 0;
+    for (size_t i = first; names && i < last; i++) {
+        names[n] = strdup(g_names.entries[i].name);
+        if (!names[n]) {
+            storage_names_free_list(names, n);
+            names = NULL;
+            break;
+        }
+        n++;
+    }
+    pthread_rwlock_unlock(&g_names.lock);
+
+    if (names) {
+        *count = n;
+    }
+    return names;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int storage_names_ensure_loaded(storage_names_source_t source) {
+    pthread_rwlock_rdlock(&g_names.lock);
+    int loaded = g_names.loaded;
+    pthread_rwlock_unlock(&g_names.lock);
+    if (loaded) {
+        return 1;
+    }
+
+    pthread_rwlock_wrlock(&g_names.lock);
+    if (!g_names.loaded) {
+        storage_name_entry_t* entries = NULL;
+        size_t count = 0;
+
+        if (source(&entries, &count)) {
+            if (count > 1) {
+                qsort(entries, count, sizeof(*entries), compare_entries);
+            }
+            g_names.loaded = merge_sorted(entries, count);
+            LOGI("Name index loaded: %zu keys", g_names.count);
+        }
+        free(entries);
+    }
+    loaded = g_names.loaded;
+    pthread_rwlock_unlock(&g_names.lock);
+    return loaded;
+}
+
+int storage_names_insert(const char* name, const storage_key_id_t* key_id) {
+    // Stores of existing keys only need the shared lock
+    pthread_rwlock_rdlock(&g_names.lock);
+    int present = found_at(lower_bound(name), name);
+    pthread_rwlock_unlock(&g_names.lock);
+    if (present) {
+        return 1;
+    }
+
+    char* copy = strdup(name);
+    if (!copy) {
+        return 0;
+    }
+
+    pthread_rwlock_wrlock(&g_names.lock);
+    size_t i = lower_bound(name);
+    if (found_at(i, name)) {
+        pthread_rwlock_unlock(&g_names.lock);
+        free_name(copy);
+        return 1;
+    }
+    if (!reserve(g_names.count + 1)) {
+        pthread_rwlock_unlock(&g_names.lock);
+        free_name(copy);
+        return 0;
+    }
+
+    memmove(&g_names.entries[i + 1], &g_names.entries[i],
+            (g_names.count - i) * sizeof(storage_name_entry_t));
+    g_names.entries[i].name = copy;
+    g_names.entries[i].key_id = *key_id;
+    g_names.count++;
+    pthread_rwlock_unlock(&g_names.lock);
+    return 1;
+}
+
+void storage_names_remove(const char* name) {
+    pthread_rwlock_wrlock(&g_names.lock);
+    size_t i = lower_bound(name);
+    if (found_at(i, name)) {
+        free_name(g_names.entries[i].name);
+        memmove(&g_names.entries[i], &g_names.entries[i + 1],
+                (g_names.count - i - 1) * sizeof(storage_name_entry_t));
+        g_names.count--;
+    }
+    pthread_rwlock_unlock(&g_names.lock);
+}
+
+char** storage_names_range(const char* start, const char* end, size_t* count) {
+    return collect(start, before_end, end, count);
+}
+
+char** storage_names_prefix(const char* prefix, size_t* count) {
+    return collect(prefix, has_prefix, prefix, count);
+}
+
+void storage_names_free_list(char** names, size_t count) {
+    if (!names) return;
+    for (size_t i = 0; i < count; i++) {
+        free_name(names[i]);
+    }
+    free(names);
+}
+
+void storage_names_reset(void) {
+    pthread_rwlock_wrlock(&g_names.lock);
+    for (size_t i = 0; i < g_names.count; i++) {
+        free_name(g_names.entries[i].name);
+    }
+    free(g_names.entries);
+    g_names.entries = NULL;
+    g_names.count = 0;
+    g_names.capacity = 0;
+    g_names.loaded = 0;
+    pthread_rwlock_unlock(&g_names.lock);
+}
@@ -0,0 +1,82 @@
+/*
+ * SovereignDroid Secure Storage - Ordered Key Name Index
+ *
+ * Key ids are keyed hashes, so the segment log alone cannot enumerate
+ * keys. Every value also gets a small name record (the key name sealed
+ * with the master key, flag STORAGE_LOG_FLAG_NAME). This module keeps
+ * those names in one sorted run in memory for prefix and range scans.
+ *
+ * - Filled lazily: the first scan decrypts the name records once
+ * - Stores and deletes keep it current afterwards
+ * - Names are wiped when the index is reset
+ */
+
+#ifndef SOVEREIGNDROID_SECURE_STORAGE_NAMES_H
+#define SOVEREIGNDROID_SECURE_STORAGE_NAMES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "secure_storage_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char* name;                 // malloc'd, NUL-terminated
+    storage_key_id_t key_id;
+} storage_name_entry_t;
+
+/*
+ * Produces every name currently in the log (malloc'd array of entries)
+ * Returns 1 on success
+ */
+typedef int (*storage_names_source_t)(storage_name_entry_t** entries, size_t* count);
+
+/*
+ * Fill the index from source if this is the first use since a reset.
+ * source runs under the index's write lock, so inserts and removes made
+ * while it reads the log are applied after it, never lost.
+ * Returns 1 if the index is loaded
+ */
+int storage_names_ensure_loaded(storage_names_source_t source);
+
+/*
+ * Add a name (no-op if present). Allowed before the index is loaded.
+ * Returns 1 on success
+ */
+int storage_names_insert(const char* name, const storage_key_id_t* key_id);
+
+/*
+ * Remove a name (no-op if absent)
+ */
+void storage_names_remove(const char* name);
+
+/*
+ * Copy the names in [start, end) in order; NULL bounds are open.
+ * Returns a malloc'd array of malloc'd strings, NULL on allocation failure
+ * (count 0 with a non-NULL result means no match). Free with
+ * storage_names_free_list.
+ */
+char** storage_names_range(const char* start, const char* end, size_t* count);
+
+/*
+ * Copy the names starting with prefix, in order (see storage_names_range)
+ */
+char** storage_names_prefix(const char* prefix, size_t* count);
+
+/*
+ * Wipe and free a list from storage_names_range / storage_names_prefix
+ */
+void storage_names_free_list(char** names, size_t count);
+
+/*
+ * Wipe every name and mark the index unloaded (shutdown, clear)
+ */
+void storage_names_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SECURE_STORAGE_NAMES_H
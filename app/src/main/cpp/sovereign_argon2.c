@@ -0,0 +1,459 @@
+/*
+ * SovereignDroid Argon2id Implementation
+ * Based on RFC 9106
+ *
+ * Memory is lanes x lane_length blocks of 1 KiB, each lane split into
+ * four slices. Within a slice every lane only references blocks that are
+ * already final, so the lanes of one slice are filled concurrently and
+ * the threads meet at each slice boundary.
+ */
+
+#include "sovereign_argon2.h"
+#include "sovereign_blake2b.h"
+#include "secure_buffer.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ARGON2_VERSION 0x13
+#define ARGON2_TYPE_ID 2
+#define ARGON2_SYNC_POINTS 4
+#define ARGON2_BLOCK_SIZE 1024
+#define ARGON2_QWORDS 128
+#define ARGON2_PREHASH_SIZE 64
+
+// Calibration: lanes used, first probe size, passes to start from
+#define CALIBRATE_LANES_MAX 4
+#define CALIBRATE_PROBE_KIB (8 * 1024)
+#define CALIBRATE_T_COST 3
+
+typedef struct {
+    uint64_t v[ARGON2_QWORDS];
+} block_t;
+
+typedef struct {
+    block_t* memory;
+    uint32_t passes;
+    uint32_t lanes;
+    uint32_t lane_length;
+    uint32_t segment_length;
+    uint32_t memory_blocks;
+} instance_t;
+
+typedef struct {
+    const instance_t* instance;
+    uint32_t pass;
+    uint32_t slice;
+    uint32_t first_lane;
+    uint32_t lane_step;
+} fill_job_t;
+
+static void store32_le(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void load_block(block_t* b, const uint8_t bytes[ARGON2_BLOCK_SIZE]) {
+    for (int i = 0; i < ARGON2_QWORDS; i++) {
+        uint64_t v = 0;
+        for (int j = 0; j < 8; j++) {
+            v |= (uint64_t)bytes[i * 8 + j] << (8 * j);
+        }
+        b->v[i] = v;
+    }
+}
+
+static void store_block(uint8_t bytes[ARGON2_BLOCK_SIZE], const block_t* b) {
+    for (int i = 0; i < ARGON2_QWORDS; i++) {
+        for (int j = 0; j < 8; j++) {
+            bytes[i * 8 + j] = (uint8_t)(b->v[i] >> (8 * j));
+        }
+    }
+}
+
+/*
+ * H' (variable-length hash): BLAKE2b chained in 32-byte steps
+ */
+static void hash_long(uint8_t* out, size_t out_len, const uint8_t* in, size_t in_len) {
+    uint8_t len_le[4];
+    store32_le(len_le, (uint32_t)out_len);
+
+    blake2b_ctx ctx;
+    if (out_len <= BLAKE2B_OUT_MAX) {
+        blake2b_init(&ctx, out_len);
+        blake2b_update(&ctx, len_le, sizeof(len_le));
+        blake2b_update(&ctx, in, in_len);
+        blake2b_final(&ctx, out);
+        return;
+    }
+
+    uint8_t v[BLAKE2B_OUT_MAX];
+    blake2b_init(&ctx, BLAKE2B_OUT_MAX);
+    blake2b_update(&ctx, len_le, sizeof(len_le));
+    blake2b_update(&ctx, in, in_len);
+    blake2b_final(&ctx, v);
+    memcpy(out, v, 32);
+    out += 32;
+    out_len -= 32;
+
+    while (out_len > BLAKE2B_OUT_MAX) {
+        blake2b(v, BLAKE2B_OUT_MAX, v, BLAKE2B_OUT_MAX);
+        memcpy(out, v, 32);
+        out += 32;
+        out_len -= 32;
+    }
+    blake2b(out, out_len, v, BLAKE2B_OUT_MAX);
+    secure_buffer_wipe(v, sizeof(v));
+}
+
+// ============================================================================
+// Compression function G
+// ============================================================================
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+// BlaMka: a + b + 2 * lo32(a) * lo32(b)
+static inline uint64_t blamka(uint64_t a, uint64_t b) {
+    return a + b + 2 * (uint64_t)(uint32_t)a * (uint32_t)b;
+}
+
+#define GB(a, b, c, d) do {                                 \
+        a = blamka(a, b); d = ROTR64(d ^ a, 32);            \
+        c = blamka(c, d); b = ROTR64(b ^ c, 24);            \
+        a = blamka(a, b); d = ROTR64(d ^ a, 16);            \
+        c = blamka(c, d); b = ROTR64(b ^ c, 63);            \
+    } while (0)
+
+#define ROUND(v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15) do { \
+        GB(v0, v4, v8,  v12); GB(v1, v5, v9,  v13);         \
+        GB(v2, v6, v10, v14); GB(v3, v7, v11, v15);         \
+        GB(v0, v5, v10, v15); GB(v1, v6, v11, v12);         \
+        GB(v2, v7, v8,  v13); GB(v3, v4, v9,  v14);         \
+    } while (0)
+
+/*
+ * next = G(prev, ref), XORed into the old next when with_xor
+ * (passes after the first). ref and next may be the same block
+ */
+static void fill_block(const block_t* prev, const block_t* ref, block_t* next, int with_xor) {
+    block_t r, tmp;
+    int i;
+
+    for (i = 0; i < ARGON2_QWORDS; i++) {
+        r.v[i] = ref->v[i] ^ prev->v[i];
+    }
+    tmp = r;
+    if (with_xor) {
+        for (i = 0; i < ARGON2_QWORDS; i++) {
+            tmp.v[i] ^= next->v[i];
+        }
+    }
+
+    // Rows of 16 words, then columns of pairs
+    uint64_t* v = r.v;
+    for (i = 0; i < 8; i++) {
+        uint64_t* w = v + 16 * i;
+        ROUND(w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7],
+              w[8], w[9], w[10], w[11], w[12], w[13], w[14], w[15]);
+    }
+    for (i = 0; i < 8; i++) {
+        uint64_t* w = v + 2 * i;
+        ROUND(w[0], w[1], w[16], w[17], w[32], w[33], w[48], w[49],
+              w[64], w[65], w[80], w[81], w[96], w[97], w[112], w[113]);
+    }
+
+    for (i = 0; i < ARGON2_QWORDS; i++) {
+        next->v[i] = tmp.v[i] ^ r.v[i];
+    }
+}
+
+// ============================================================================
+// Memory filling
+// ============================================================================
+
+// Data-independent addresses: the next 128 of them from the input block
+static void next_addresses(block_t* address, block_t* input, const block_t* zero) {
+    input->v[6]++;
+    fill_block(zero, input, address, 0);
+    fill_block(zero, address, address, 0);
+}
+
+/*
+ * Column of the reference block within its lane (RFC 9106, 3.4.1.2)
+ */
+static uint32_t index_alpha(const instance_t* in, uint32_t pass, uint32_t slice,
+                            uint32_t index, uint32_t rand, int same_lane) {
+    uint32_t area;
+    if (pass == 0) {
+        if (slice == 0) {
+            area = index - 1;
+        } else if (same_lane) {
+            area = slice * in->segment_length + index - 1;
+        } else {
+            area = slice * in->segment_length - (index == 0 ? 1 : 0);
+        }
+    } else if (same_lane) {
+        area = in->lane_length - in->segment_length + index - 1;
+    } else {
+        area = in->lane_length - in->segment_length - (index == 0 ? 1 : 0);
+    }
+
+    uint64_t rel = rand;
+    rel = (rel * rel) >> 32;
+    rel = area - 1 - (((uint64_t)area * rel) >> 32);
+
+    uint32_t start = 0;
+    if (pass != 0 && slice != ARGON2_SYNC_POINTS - 1) {
+        start = (slice + 1) * in->segment_length;
+    }
+    return (uint32_t)((start + rel) % in->lane_length);
+}
+
+static void fill_segment(const instance_t* in, uint32_t pass, uint32_t lane, uint32_t slice) {
+    // Argon2id: data-independent addressing for the first half of pass 0
+    int independent = pass == 0 && slice < ARGON2_SYNC_POINTS / 2;
+    uint32_t start = (pass == 0 && slice == 0) ? 2 : 0;
+
+    block_t address, input, zero;
+    if (independent) {
+        memset(&zero, 0, sizeof(zero));
+        memset(&input, 0, sizeof(input));
+        input.v[0] = pass;
+        input.v[1] = lane;
+        input.v[2] = slice;
+        input.v[3] = in->memory_blocks;
+        input.v[4] = in->passes;
+        input.v[5] = ARGON2_TYPE_ID;
+        if (start != 0) {
+            next_addresses(&address, &input, &zero);
+        }
+    }
+
+    uint32_t offset = lane * in->lane_length + slice * in->segment_length + start;
+    uint32_t prev = (offset % in->lane_length == 0) ? offset + in->lane_length - 1 : offset - 1;
+
+    for (uint32_t i = start; i < in->segment_length; i++, offset++, prev++) {
+        if (offset % in->lane_length == 1) {
+            prev = offset - 1;
+        }
+
+        uint64_t rand;
+        if (independent) {
+            if (i % ARGON2_QWORDS == 0) {
+                next_addresses(&address, &input, &zero);
+            }
+            rand = address.v[i % ARGON2_QWORDS];
+        } else {
+            rand = in->memory[prev].v[0];
+        }
+
+        uint32_t ref_lane = (pass == 0 && slice == 0) ? lane : (uint32_t)((rand >> 32) % in->lanes);
+        uint32_t ref_index = index_alpha(in, pass, slice, i, (uint32_t)rand, ref_lane == lane);
+        const block_t* ref = &in->memory[(size_t)in->lane_length * ref_lane + ref_index];
+        fill_block(&in->memory[prev], ref, &in->memory[offset], pass != 0);
+    }
+}
+
+static void* fill_lanes(void* arg) {
+    const fill_job_t* job = arg;
+    for (uint32_t lane = job->first_lane; lane < job->instance->lanes; lane += job->lane_step) {
+        fill_segment(job->instance, job->pass, lane, job->slice);
+    }
+    return NULL;
+}
+
+static uint32_t online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+}
+
+static void fill_memory(const instance_t* in) {
+    uint32_t threads = online_cpus();
+    if (threads > in->lanes) {
+        threads = in->lanes;
+    }
+
+    fill_job_t jobs[ARGON2_LANES_MAX];
+    pthread_t tids[ARGON2_LANES_MAX];
+    int started[ARGON2_LANES_MAX];
+
+    for (uint32_t pass = 0; pass < in->passes; pass++) {
+        for (uint32_t slice = 0; slice < ARGON2_SYNC_POINTS; slice++) {
+            for (uint32_t t = 0; t < threads; t++) {
+                jobs[t] = (fill_job_t){ in, pass, slice, t, threads };
+            }
+            // Thread 0 is the caller; a thread that fails to start runs inline
+            for (uint32_t t = 1; t < threads; t++) {
+                started[t] = pthread_create(&tids[t], NULL, fill_lanes, &jobs[t]) == 0;
+                if (!started[t]) {
+                    fill_lanes(&jobs[t]);
+                }
+            }
+            fill_lanes(&jobs[0]);
+            for (uint32_t t = 1; t < threads; t++) {
+                if (started[t]) {
+                    pthread_join(tids[t], NULL);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Argon2id with the optional secret K and associated data X of RFC 9106
+ */
+static int argon2id_full(const argon2_params_t* params,
+                         const uint8_t* pwd, size_t pwd_len,
+                         const uint8_t* salt, size_t salt_len,
+                         const uint8_t* secret, size_t secret_len,
+                         const uint8_t* ad, size_t ad_len,
+                         uint8_t* out, size_t out_len) {
+    uint32_t lanes = params->lanes;
+    if (lanes < 1 || lanes > ARGON2_LANES_MAX || params->t_cost < 1 ||
+        params->m_cost_kib < 8 * lanes || salt_len < ARGON2_SALT_MIN || out_len < 4 ||
+        pwd_len > UINT32_MAX || salt_len > UINT32_MAX || secret_len > UINT32_MAX ||
+        ad_len > UINT32_MAX || out_len > UINT32_MAX) {
+        return 0;
+    }
+
+    instance_t in;
+    in.passes = params->t_cost;
+    in.lanes = lanes;
+    in.segment_length = params->m_cost_kib / (lanes * ARGON2_SYNC_POINTS);
+    in.lane_length = in.segment_length * ARGON2_SYNC_POINTS;
+    in.memory_blocks = in.lane_length * lanes;
+    in.memory = malloc((size_t)in.memory_blocks * sizeof(block_t));
+    if (!in.memory) {
+        return 0;
+    }
+
+    // H0 over every parameter and input
+    uint8_t h0[ARGON2_PREHASH_SIZE + 8];
+    uint8_t word[4];
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, ARGON2_PREHASH_SIZE);
+    const uint32_t header[6] = { lanes, (uint32_t)out_len, params->m_cost_kib, params->t_cost,
+                                 ARGON2_VERSION, ARGON2_TYPE_ID };
+    for (int i = 0; i < 6; i++) {
+        store32_le(word, header[i]);
+        blake2b_update(&ctx, word, 4);
+    }
+    const uint8_t* fields[4] = { pwd, salt, secret, ad };
+    const size_t lens[4] = { pwd_len, salt_len, secret_len, ad_len };
+    for (int i = 0; i < 4; i++) {
+        store32_le(word, (uint32_t)lens[i]);
+        blake2b_update(&ctx, word, 4);
+        if (lens[i]) {
+            blake2b_update(&ctx, fields[i], lens[i]);
+        }
+    }
+    blake2b_final(&ctx, h0);
+    secure_buffer_wipe(&ctx, sizeof(ctx));
+
+    // First two blocks of each lane: H'(H0 || column || lane)
+    uint8_t bytes[ARGON2_BLOCK_SIZE];
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        store32_le(h0 + ARGON2_PREHASH_SIZE + 4, lane);
+        for (uint32_t col = 0; col < 2; col++) {
+            store32_le(h0 + ARGON2_PREHASH_SIZE, col);
+            hash_long(bytes, ARGON2_BLOCK_SIZE, h0, sizeof(h0));
+            load_block(&in.memory[(size_t)lane * in.lane_length + col], bytes);
+        }
+    }
+    secure_buffer_wipe(h0, sizeof(h0));
+
+    fill_memory(&in);
+
+    // Tag: H' of the XOR of every lane's last block
+    block_t final = in.memory[in.lane_length - 1];
+    for (uint32_t lane = 1; lane < lanes; lane++) {
+        const block_t* last = &in.memory[(size_t)lane * in.lane_length + in.lane_length - 1];
+        for (int i = 0; i < ARGON2_QWORDS; i++) {
+            final.v[i] ^= last->v[i];
+        }
+    }
+    store_block(bytes, &final);
+    hash_long(out, out_len, bytes, sizeof(bytes));
+
+    secure_buffer_wipe(bytes, sizeof(bytes));
+    secure_buffer_wipe(&final, sizeof(final));
+    secure_buffer_wipe(in.memory, (size_t)in.memory_blocks * sizeof(block_t));
+    free(in.memory);
+    return 1;
+}
+
+int argon2id(const argon2_params_t* params,
+             const uint8_t* pwd, size_t pwd_len,
+             const uint8_t* salt, size_t salt_len,
+             uint8_t* out, size_t out_len) {
+    return argon2id_full(params, pwd, pwd_len, salt, salt_len, NULL, 0, NULL, 0, out, out_len);
+}
+
+// ============================================================================
+// Calibration
+// ============================================================================
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Time one derivation with params, in microseconds (0 on failure)
+static uint64_t time_params(const argon2_params_t* params) {
+    static const uint8_t salt[16] = "calibrate.salt..";
+    uint8_t out[32];
+
+    uint64_t start = now_us();
+    if (!argon2id(params, (const uint8_t*)"calibrate", 9, salt, sizeof(salt), out, sizeof(out))) {
+        return 0;
+    }
+    uint64_t elapsed = now_us() - start;
+    return elapsed ? elapsed : 1;
+}
+
+uint32_t argon2id_calibrate(uint32_t target_ms, uint32_t max_m_kib, argon2_params_t* params) {
+    uint32_t lanes = online_cpus();
+    if (lanes > CALIBRATE_LANES_MAX) {
+        lanes = CALIBRATE_LANES_MAX;
+    }
+    if (max_m_kib < 8 * lanes) {
+        max_m_kib = 8 * lanes;
+    }
+    uint64_t target_us = (uint64_t)(target_ms ? target_ms : 1) * 1000;
+
+    // Probe a small size, then scale memory linearly towards the target
+    params->lanes = lanes;
+    params->t_cost = CALIBRATE_T_COST;
+    params->m_cost_kib = CALIBRATE_PROBE_KIB < max_m_kib ? CALIBRATE_PROBE_KIB : max_m_kib;
+    uint64_t elapsed = time_params(params);
+    if (!elapsed) {
+        return 0;
+    }
+
+    if (elapsed < target_us && params->m_cost_kib < max_m_kib) {
+        uint64_t m = (uint64_t)params->m_cost_kib * target_us / elapsed;
+        params->m_cost_kib = m < max_m_kib ? (uint32_t)m : max_m_kib;
+        elapsed = time_params(params);
+        if (!elapsed) {
+            return 0;
+        }
+    }
+
+    // Memory capped (or the probe alone was too slow): adjust the passes
+    uint64_t t = (params->t_cost * target_us + elapsed / 2) / elapsed;
+    if (t < 1) {
+        t = 1;
+    }
+    if (t > params->t_cost || elapsed > target_us + target_us / 2) {
+        params->t_cost = (uint32_t)t;
+        elapsed = time_params(params);
+        if (!elapsed) {
+            return 0;
+        }
+    }
+    return (uint32_t)((elapsed + 500) / 1000);
+}
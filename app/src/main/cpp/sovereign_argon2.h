@@ -0,0 +1,46 @@
+/*
+ * SovereignDroid Argon2id Implementation
+ *
+ * Based on RFC 9106 (Argon2 version 0x13, type id)
+ * Implemented from specification for sovereignty
+ *
+ * Memory-hard password hashing: secure storage derives the key that
+ * wraps the master key file from a passphrase with it. Lanes are filled
+ * in parallel, one thread per lane up to the number of online CPUs, so
+ * a multi-lane setting costs wall time roughly in proportion to
+ * memory / cores rather than memory.
+ */
+
+#ifndef SOVEREIGN_ARGON2_H
+#define SOVEREIGN_ARGON2_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARGON2_SALT_MIN 8
+#define ARGON2_LANES_MAX 16
+
+typedef struct {
+    uint32_t t_cost;            // Passes over memory (>= 1)
+    uint32_t m_cost_kib;        // Memory in KiB (>= 8 * lanes)
+    uint32_t lanes;             // Degree of parallelism (1..ARGON2_LANES_MAX)
+} argon2_params_t;
+
+/*
+ * Argon2id tag of pwd under salt (at least ARGON2_SALT_MIN bytes) into
+ * out_len bytes (>= 4)
+ * Returns 1 on success, 0 on bad parameters or allocation failure
+ */
+int argon2id(const argon2_params_t* params,
+             const uint8_t* pwd, size_t pwd_len,
+             const uint8_t* salt, size_t salt_len,
+             uint8_t* out, size_t out_len);
+
+/*
+ * Pick parameters that take about target_ms on this device: one lane per
+ * online CPU (up to 4), memory grown up to max_m_kib first, then passes.
+ * Returns the measured time of the chosen parameters in ms, 0 on failure
+ */
+uint32_t argon2id_calibrate(uint32_t target_ms, uint32_t max_m_kib, argon2_params_t* params);
+
+#endif // SOVEREIGN_ARGON2_H
@@ -0,0 +1,133 @@
+/*
+ * SovereignDroid BLAKE2b Implementation
+ * Based on RFC 7693
+ */
+
+#include "sovereign_blake2b.h"
+#include <string.h>
+
+// Same initialization vector as SHA-512
+static const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+// Message word schedule; rounds 10 and 11 reuse rows 0 and 1
+static const uint8_t SIGMA[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+#define G(a, b, c, d, x, y) do {                    \
+        a = a + b + (x); d = ROTR64(d ^ a, 32);     \
+        c = c + d;       b = ROTR64(b ^ c, 24);     \
+        a = a + b + (y); d = ROTR64(d ^ a, 16);     \
+        c = c + d;       b = ROTR64(b ^ c, 63);     \
+    } while (0)
+
+static uint64_t load64_le(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v |= (uint64_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+static void compress(blake2b_ctx* ctx, const uint8_t block[128], int last) {
+    uint64_t m[16], v[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        m[i] = load64_le(block + i * 8);
+    }
+    for (i = 0; i < 8; i++) {
+        v[i] = ctx->h[i];
+        v[i + 8] = IV[i];
+    }
+    v[12] ^= ctx->t[0];
+    v[13] ^= ctx->t[1];
+    if (last) {
+        v[14] = ~v[14];
+    }
+
+    for (i = 0; i < 12; i++) {
+        const uint8_t* s = SIGMA[i];
+        G(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]]);
+        G(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]]);
+        G(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]]);
+        G(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]]);
+        G(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]]);
+        G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        G(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]]);
+        G(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (i = 0; i < 8; i++) {
+        ctx->h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+static void add_count(blake2b_ctx* ctx, size_t len) {
+    ctx->t[0] += len;
+    if (ctx->t[0] < len) {
+        ctx->t[1]++;
+    }
+}
+
+void blake2b_init(blake2b_ctx* ctx, size_t out_len) {
+    memcpy(ctx->h, IV, sizeof(IV));
+    // Parameter block: digest length, no key, fanout 1, depth 1
+    ctx->h[0] ^= 0x01010000ULL ^ (uint64_t)out_len;
+    ctx->t[0] = 0;
+    ctx->t[1] = 0;
+    ctx->buffered = 0;
+    ctx->out_len = out_len;
+}
+
+void blake2b_update(blake2b_ctx* ctx, const uint8_t* data, size_t len) {
+    // The last block is compressed in final, so keep a full one buffered
+    while (len > 0) {
+        if (ctx->buffered == 128) {
+            add_count(ctx, 128);
+            compress(ctx, ctx->buffer, 0);
+            ctx->buffered = 0;
+        }
+        size_t take = 128 - ctx->buffered;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(ctx->buffer + ctx->buffered, data, take);
+        ctx->buffered += take;
+        data += take;
+        len -= take;
+    }
+}
+
+void blake2b_final(blake2b_ctx* ctx, uint8_t* out) {
+    add_count(ctx, ctx->buffered);
+    memset(ctx->buffer + ctx->buffered, 0, 128 - ctx->buffered);
+    compress(ctx, ctx->buffer, 1);
+
+    for (size_t i = 0; i < ctx->out_len; i++) {
+        out[i] = (uint8_t)(ctx->h[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+void blake2b(uint8_t* out, size_t out_len, const uint8_t* data, size_t len) {
+    blake2b_ctx ctx;
+    blake2b_init(&ctx, out_len);
+    blake2b_update(&ctx, data, len);
+    blake2b_final(&ctx, out);
+}
@@ -0,0 +1,48 @@
+/*
+ * SovereignDroid BLAKE2b Implementation
+ *
+ * Based on RFC 7693 (unkeyed, sequential mode)
+ * Implemented from specification for sovereignty
+ *
+ * BLAKE2b is the hash inside Argon2 (sovereign_argon2.c)
+ */
+
+#ifndef SOVEREIGN_BLAKE2B_H
+#define SOVEREIGN_BLAKE2B_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLAKE2B_OUT_MAX 64
+
+// BLAKE2b context
+typedef struct {
+    uint64_t h[8];          // Chained state
+    uint64_t t[2];          // Byte count (128-bit)
+    uint8_t buffer[128];    // Input buffer
+    size_t buffered;
+    size_t out_len;
+} blake2b_ctx;
+
+/*
+ * Initialize for an out_len-byte digest (1..64)
+ */
+void blake2b_init(blake2b_ctx* ctx, size_t out_len);
+
+/*
+ * Update BLAKE2b with data
+ * Can be called multiple times
+ */
+void blake2b_update(blake2b_ctx* ctx, const uint8_t* data, size_t len);
+
+/*
+ * Finalize and write ctx->out_len bytes
+ */
+void blake2b_final(blake2b_ctx* ctx, uint8_t* out);
+
+/*
+ * Convenience function: hash data in one call
+ */
+void blake2b(uint8_t* out, size_t out_len, const uint8_t* data, size_t len);
+
+#endif // SOVEREIGN_BLAKE2B_H
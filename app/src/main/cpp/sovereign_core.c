@@ -15,6 +15,7 @@
 
 #include "sovereign_core.h"
 #include <android/log.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define LOG_TAG "SovereignCore"
@@ -33,7 +34,7 @@
  * - Logging works
  * - JNI bridge is functional
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_NativeCore_getBootstrapMessage(JNIEnv* env, jobject thiz) {
     LOGI("Native core bootstrap initiated");
     LOGI("JNI interface functional");
@@ -57,7 +58,7 @@ Java_com_sovereigndroid_core_NativeCore_getBootstrapMessage(JNIEnv* env, jobject
  * Returns the version number of the native core
  * Useful for debugging and version tracking
  */
-JNIEXPORT jint JNICALL
+SOVEREIGN_JNI_EXPORT jint JNICALL
 Java_com_sovereigndroid_core_NativeCore_getNativeVersion(JNIEnv* env, jobject thiz) {
     LOGI("Native version query: %d", NATIVE_CORE_VERSION);
     return NATIVE_CORE_VERSION;
@@ -70,33 +71,34 @@ Java_com_sovereigndroid_core_NativeCore_getNativeVersion(JNIEnv* env, jobject th
  */
 
 #include "device_identity.h"
+#include "sovereign_ed25519.h"
 
 // Initialize device identity subsystem
-JNIEXPORT jint JNICALL
+SOVEREIGN_JNI_EXPORT jint JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_initialize(JNIEnv* env, jobject thiz) {
     return device_identity_init();
 }
 
 // Check if identity exists
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_hasIdentity(JNIEnv* env, jobject thiz) {
     return (jboolean)device_identity_exists();
 }
 
 // Generate new identity
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_generateIdentity(JNIEnv* env, jobject thiz) {
     return (jboolean)(device_identity_generate() == IDENTITY_OK);
 }
 
 // Load existing identity
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_loadIdentity(JNIEnv* env, jobject thiz) {
     return (jboolean)(device_identity_load() == IDENTITY_OK);
 }
 
 // Get public key
-JNIEXPORT jbyteArray JNICALL
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_getPublicKey(JNIEnv* env, jobject thiz) {
     uint8_t public_key[32];
     
@@ -112,7 +114,7 @@ Java_com_sovereigndroid_core_DeviceIdentity_getPublicKey(JNIEnv* env, jobject th
 }
 
 // Get fingerprint
-JNIEXPORT jbyteArray JNICALL
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_getFingerprint(JNIEnv* env, jobject thiz) {
     uint8_t fingerprint[32];
     
@@ -128,7 +130,7 @@ Java_com_sovereigndroid_core_DeviceIdentity_getFingerprint(JNIEnv* env, jobject
 }
 
 // Sign data
-JNIEXPORT jbyteArray JNICALL
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_signData(JNIEnv* env, jobject thiz, jbyteArray data) {
     if (data == NULL) return NULL;
     
@@ -152,7 +154,7 @@ Java_com_sovereigndroid_core_DeviceIdentity_signData(JNIEnv* env, jobject thiz,
 }
 
 // Verify signature
-JNIEXPORT jboolean JNICALL
+SOVEREIGN_JNI_EXPORT jboolean JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_verifySignature(JNIEnv* env, jobject thiz,
                                                             jbyteArray data, jbyteArray signature) {
     if (data == NULL || signature == NULL) return JNI_FALSE;
@@ -180,7 +182,7 @@ Java_com_sovereigndroid_core_DeviceIdentity_verifySignature(JNIEnv* env, jobject
 }
 
 // Create attestation
-JNIEXPORT jbyteArray JNICALL
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
 Java_com_sovereigndroid_core_DeviceIdentity_createAttestation(JNIEnv* env, jobject thiz) {
     uint8_t attestation[128];
     
@@ -193,3 +195,210 @@ Java_com_sovereigndroid_core_DeviceIdentity_createAttestation(JNIEnv* env, jobje
     (*env)->SetByteArrayRegion(env, result, 0, length, (jbyte*)attestation);
     return result;
 }
+
+/*
+ * Batched signing: messages are packed into one array, little-endian:
+ * [count u32] then per message [length u32][bytes]
+ */
+
+/*
+ * Split a packed message array into pointers
+ * into data. Returns the message count, or -1 if malformed; the caller
+ * frees *messages and *lens
+ */
+static long unpack_messages(const uint8_t* data, size_t data_len,
+                            const uint8_t*** messages, size_t** lens) {
+    if (data_len < 4) return -1;
+    
+    uint32_t count = (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                     ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    if (count > (data_len - 4) / 4) return -1;
+    
+    *messages = malloc((count ? count : 1) * sizeof(**messages));
+    *lens = malloc((count ? count : 1) * sizeof(**lens));
+    if (!*messages || !*lens) {
+        free(*messages);
+        free(*lens);
+        return -1;
+    }
+    
+    size_t pos = 4;
+    uint32_t parsed = 0;
+    while (parsed < count && data_len - pos >= 4) {
+        size_t len = (size_t)data[pos] | ((size_t)data[pos + 1] << 8) |
+                     ((size_t)data[pos + 2] << 16) | ((size_t)data[pos + 3] << 24);
+        pos += 4;
+        if (len > data_len - pos) break;
+        (*messages)[parsed] = data + pos;
+        (*lens)[parsed] = len;
+        pos += len;
+        parsed++;
+    }
+    
+    // Short or trailing bytes mean the count and the contents disagree
+    if (parsed != count || pos != data_len) {
+        free(*messages);
+        free(*lens);
+        return -1;
+    }
+    return (long)count;
+}
+
+/*
+ * Copy a byte[] into a new native buffer (at least one byte), so batch
+ * work runs outside any critical section; the caller frees it
+ */
+static uint8_t* copy_byte_array(JNIEnv* env, jbyteArray array, jsize* len) {
+    *len = (*env)->GetArrayLength(env, array);
+    uint8_t* data = malloc(*len ? (size_t)*len : 1);
+    if (data && *len > 0) {
+        (*env)->GetByteArrayRegion(env, array, 0, *len, (jbyte*)data);
+    }
+    return data;
+}
+
+/*
+ * Sign every message in a packed array; returns count * 64 signature bytes
+ */
+SOVEREIGN_JNI_EXPORT jbyteArray JNICALL
+Java_com_sovereigndroid_core_DeviceIdentity_signMany(JNIEnv* env, jobject thiz, jbyteArray messages) {
+    if (!messages) return NULL;
+    jsize data_len;
+    uint8_t* data = copy_byte_array(env, messages, &data_len);
+    if (!data) return NULL;
+    
+    const uint8_t** ptrs;
+    size_t* lens;
+    long count = unpack_messages(data, (size_t)data_len, &ptrs, &lens);
+    uint8_t* signatures = (count > 0 && count <= INT32_MAX / ED25519_SIGNATURE_SIZE)
+                          ? malloc((size_t)count * ED25519_SIGNATURE_SIZE) : NULL;
+    int result = (count == 0) ? IDENTITY_OK : IDENTITY_ERROR;
+    if (signatures) {
+        result = device_identity_sign_many(ptrs, lens, (size_t)count, signatures);
+    }
+    free(data);
+    if (count >= 0) {
+        free(ptrs);
+        free(lens);
+    }
+    
+    jbyteArray out = NULL;
+    if (result == IDENTITY_OK) {
+        jsize out_len = (jsize)(count * ED25519_SIGNATURE_SIZE);
+        out = (*env)->NewByteArray(env, out_len);
+        if (out && out_len > 0) {
+            (*env)->SetByteArrayRegion(env, out, 0, out_len, (const jbyte*)signatures);
+        }
+    } else if (count < 0) {
+        LOGE("Malformed message batch");
+    }
+    free(signatures);
+    return out;
+}
+
+/*
+ * Verify a packed message array against count * 64 signature bytes
+ * Returns NULL while signature verification is unavailable
+ */
+SOVEREIGN_JNI_EXPORT jbooleanArray JNICALL
+Java_com_sovereigndroid_core_DeviceIdentity_verifyMany(JNIEnv* env, jobject thiz,
+                                                     jbyteArray messages, jbyteArray signatures) {
+    if (!messages || !signatures) return NULL;
+    jsize data_len;
+    jsize sig_len;
+    uint8_t* data = copy_byte_array(env, messages, &data_len);
+    uint8_t* sigs = data ? copy_byte_array(env, signatures, &sig_len) : NULL;
+    if (!sigs) {
+        free(data);
+        return NULL;
+    }
+    
+    const uint8_t** ptrs;
+    size_t* lens;
+    long count = unpack_messages(data, (size_t)data_len, &ptrs, &lens);
+    uint8_t* results = NULL;
+    int valid = IDENTITY_ERROR;
+    if (count >= 0 && (size_t)sig_len == (size_t)count * ED25519_SIGNATURE_SIZE) {
+        results = malloc(count ? (size_t)count : 1);
+        if (results) {
+            valid = device_identity_verify_many(ptrs, lens, (size_t)count, sigs, results);
+        }
+    } else {
+        LOGE("Malformed verification batch");
+    }
+    free(sigs);
+    free(data);
+    if (count >= 0) {
+        free(ptrs);
+        free(lens);
+    }
+    
+    jbooleanArray out = NULL;
+    if (valid >= 0) {
+        out = (*env)->NewBooleanArray(env, (jsize)count);
+        if (out && count > 0) {
+            // jboolean is one byte holding 0 or 1, the same layout as results
+            (*env)->SetBooleanArrayRegion(env, out, 0, (jsize)count, (const jboolean*)results);
+        }
+    }
+    free(results);
+    return out;
+}
+
+/*
+ * ==================================================================
+ * Native registration
+ * ==================================================================
+ */
+
+static const JNINativeMethod g_native_core_methods[] = {
+    { "getBootstrapMessage", "()Ljava/lang/String;",
+      (void*)Java_com_sovereigndroid_core_NativeCore_getBootstrapMessage },
+    { "getNativeVersion", "()I", (void*)Java_com_sovereigndroid_core_NativeCore_getNativeVersion },
+};
+
+static const JNINativeMethod g_device_identity_methods[] = {
+    { "initialize", "()I", (void*)Java_com_sovereigndroid_core_DeviceIdentity_initialize },
+    { "hasIdentity", "()Z", (void*)Java_com_sovereigndroid_core_DeviceIdentity_hasIdentity },
+    { "generateIdentity", "()Z", (void*)Java_com_sovereigndroid_core_DeviceIdentity_generateIdentity },
+    { "loadIdentity", "()Z", (void*)Java_com_sovereigndroid_core_DeviceIdentity_loadIdentity },
+    { "getPublicKey", "()[B", (void*)Java_com_sovereigndroid_core_DeviceIdentity_getPublicKey },
+    { "getFingerprint", "()[B", (void*)Java_com_sovereigndroid_core_DeviceIdentity_getFingerprint },
+    { "signData", "([B)[B", (void*)Java_com_sovereigndroid_core_DeviceIdentity_signData },
+    { "verifySignature", "([B[B)Z", (void*)Java_com_sovereigndroid_core_DeviceIdentity_verifySignature },
+    { "createAttestation", "()[B", (void*)Java_com_sovereigndroid_core_DeviceIdentity_createAttestation },
+    { "signMany", "([B)[B", (void*)Java_com_sovereigndroid_core_DeviceIdentity_signMany },
+    { "verifyMany", "([B[B)[Z", (void*)Java_com_sovereigndroid_core_DeviceIdentity_verifyMany },
+};
+
+int sovereign_core_register_natives(JNIEnv* env) {
+    int core = sovereign_jni_register(env, SOVEREIGN_JNI_CLASS("NativeCore"), g_native_core_methods,
+                                      SOVEREIGN_JNI_COUNT(g_native_core_methods));
+    int identity = sovereign_jni_register(env, SOVEREIGN_JNI_CLASS("DeviceIdentity"),
+                                          g_device_identity_methods,
+                                          SOVEREIGN_JNI_COUNT(g_device_identity_methods));
+    return (core > 0 ? core : 0) + (identity > 0 ? identity : 0);
+}
+
+/*
+ * Library load hook (System.loadLibrary)
+ * Binds every native through the tables above so the VM never has to
+ * resolve Java_... names, and lets each module cache its class refs and
+ * method IDs on the loading thread, whose class loader can see the app.
+ * A class the app does not ship is skipped rather than failing the load.
+ */
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+    JNIEnv* env = NULL;
+    if ((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_6) != JNI_OK) {
+        LOGE("JNI_OnLoad: JNI 1.6 not available");
+        return JNI_ERR;
+    }
+
+    int registered = sovereign_core_register_natives(env);
+    registered += device_capabilities_register_natives(env);
+    registered += secure_storage_register_natives(env);
+    registered += secure_storage_async_register_natives(env);
+
+    LOGI("JNI_OnLoad: %d native methods registered", registered);
+    return JNI_VERSION_1_6;
+}
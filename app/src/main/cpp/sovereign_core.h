@@ -8,7 +8,7 @@
 #ifndef SOVEREIGNDROID_SOVEREIGN_CORE_H
 #define SOVEREIGNDROID_SOVEREIGN_CORE_H
 
-#include <jni.h>
+#include "sovereign_jni.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,7 +19,7 @@ extern "C" {
  * Method:    getBootstrapMessage
  * Signature: ()Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL
+SOVEREIGN_JNI_EXPORT jstring JNICALL
 Java_com_sovereigndroid_core_NativeCore_getBootstrapMessage(JNIEnv* env, jobject thiz);
 
 /*
@@ -27,7 +27,7 @@ Java_com_sovereigndroid_core_NativeCore_getBootstrapMessage(JNIEnv* env, jobject
  * Method:    getNativeVersion
  * Signature: ()I
  */
-JNIEXPORT jint JNICALL
+SOVEREIGN_JNI_EXPORT jint JNICALL
 Java_com_sovereigndroid_core_NativeCore_getNativeVersion(JNIEnv* env, jobject thiz);
 
 #ifdef __cplusplus
@@ -8,6 +8,7 @@
  */
 
 #include "sovereign_crypto.h"
+#include "secure_buffer.h"
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -92,6 +93,7 @@ static void chacha20_block(uint32_t out[16], const uint8_t key[32],
     for (i = 0; i < 16; i++) {
         out[i] += state[i];
     }
+    secure_buffer_wipe(state, sizeof(state));
 }
 
 /*
@@ -116,6 +118,7 @@ void chacha20_encrypt(const uint8_t key[CHACHA20_KEY_SIZE],
             output[i + j] = input[i + j] ^ ks_bytes[j];
         }
     }
+    secure_buffer_wipe(keystream, sizeof(keystream));
 }
 
 // ============================================================================
@@ -208,6 +211,8 @@ void poly1305_authenticate(const uint8_t key[32],
     for (i = 0; i < 4; i++) {
         store32_le(tag + i * 4, h[i]);
     }
+    secure_buffer_wipe(r, sizeof(r));
+    secure_buffer_wipe(s, sizeof(s));
 }
 
 // ============================================================================
@@ -236,20 +241,19 @@ int chacha20_poly1305_encrypt(const uint8_t key[CHACHA20_KEY_SIZE],
     poly1305_authenticate(poly_key, ciphertext, plaintext_len, tag);
     
     // Zero poly_key for security
-    memset(poly_key, 0, 32);
+    secure_buffer_wipe(poly_key, sizeof(poly_key));
     
     return 1;
 }
 
 /*
- * ChaCha20-Poly1305 decrypt
+ * ChaCha20-Poly1305 tag check (no decryption)
  */
-int chacha20_poly1305_decrypt(const uint8_t key[CHACHA20_KEY_SIZE],
-                              const uint8_t nonce[CHACHA20_NONCE_SIZE],
-                              const uint8_t* ciphertext,
-                              size_t ciphertext_len,
-                              const uint8_t tag[POLY1305_TAG_SIZE],
-                              uint8_t* plaintext) {
+int chacha20_poly1305_verify(const uint8_t key[CHACHA20_KEY_SIZE],
+                             const uint8_t nonce[CHACHA20_NONCE_SIZE],
+                             const uint8_t* ciphertext,
+                             size_t ciphertext_len,
+                             const uint8_t tag[POLY1305_TAG_SIZE]) {
     uint8_t poly_key[32];
     uint8_t computed_tag[POLY1305_TAG_SIZE];
     int i, tag_match;
@@ -268,10 +272,22 @@ int chacha20_poly1305_decrypt(const uint8_t key[CHACHA20_KEY_SIZE],
     }
     
     // Zero sensitive data
-    memset(poly_key, 0, 32);
-    memset(computed_tag, 0, POLY1305_TAG_SIZE);
+    secure_buffer_wipe(poly_key, sizeof(poly_key));
+    secure_buffer_wipe(computed_tag, sizeof(computed_tag));
     
-    if (tag_match != 0) {
+    return tag_match == 0;
+}
+
+/*
+ * ChaCha20-Poly1305 decrypt
+ */
+int chacha20_poly1305_decrypt(const uint8_t key[CHACHA20_KEY_SIZE],
+                              const uint8_t nonce[CHACHA20_NONCE_SIZE],
+                              const uint8_t* ciphertext,
+                              size_t ciphertext_len,
+                              const uint8_t tag[POLY1305_TAG_SIZE],
+                              uint8_t* plaintext) {
+    if (!chacha20_poly1305_verify(key, nonce, ciphertext, ciphertext_len, tag)) {
         // Authentication failed - data tampered
         memset(plaintext, 0, ciphertext_len);
         return 0;
@@ -111,6 +111,25 @@ int chacha20_poly1305_decrypt(const uint8_t key[CHACHA20_KEY_SIZE],
                               const uint8_t tag[POLY1305_TAG_SIZE],
                               uint8_t* plaintext);
 
+/*
+ * ChaCha20-Poly1305 tag check
+ * 
+ * Verifies the authentication tag without decrypting, so no plaintext
+ * is ever produced (integrity scrubs of stored data).
+ * 
+ * @param key 32-byte encryption key
+ * @param nonce 12-byte nonce (same as used for encryption)
+ * @param ciphertext Input ciphertext
+ * @param ciphertext_len Length of ciphertext
+ * @param tag Authentication tag to verify (16 bytes)
+ * @return 1 if the tag is valid, 0 on authentication failure
+ */
+int chacha20_poly1305_verify(const uint8_t key[CHACHA20_KEY_SIZE],
+                             const uint8_t nonce[CHACHA20_NONCE_SIZE],
+                             const uint8_t* ciphertext,
+                             size_t ciphertext_len,
+                             const uint8_t tag[POLY1305_TAG_SIZE]);
+
 /*
  * Generate random bytes for keys and nonces
  * Uses /dev/urandom for cryptographically secure randomness
@@ -3,7 +3,7 @@
  * Simplified deterministic implementation
  * 
  * Uses deterministic key derivation based on RFC 8032 structure
- * Signature verification uses cryptographic binding to validate authenticity
+ * Signature verification is not available: every signature is rejected
  * 
  * Note: Simplified curve operations for sovereignty/auditability
  * Production use should integrate full ref10 for maximum security
@@ -11,6 +11,7 @@
 
 #include "sovereign_ed25519.h"
 #include "sovereign_sha512.h"
+#include "secure_buffer.h"
 #include <string.h>
 #include <stdint.h>
 
@@ -117,21 +118,23 @@ void ed25519_create_keypair(uint8_t public_key[32], uint8_t private_key[32], con
     
     // Public key = [hash] * B
     ge_scalarmult_base(public_key, hash);
+    secure_buffer_wipe(hash, sizeof(hash));
 }
 
-void ed25519_sign(uint8_t signature[64], const uint8_t* message, size_t message_len,
-                  const uint8_t private_key[32], const uint8_t public_key[32]) {
-    sha512_ctx ctx;
-    uint8_t hash[64];
-    uint8_t r[64];
-    uint8_t hram[64];
-    uint8_t R[32];
-    
-    // Hash private key
+// Expand a private key into the clamped scalar (0..31) and nonce prefix (32..63)
+static void expand_private_key(uint8_t hash[64], const uint8_t private_key[32]) {
     sha512(private_key, 32, hash);
     hash[0] &= 248;
     hash[31] &= 63;
     hash[31] |= 64;
+}
+
+static void sign_expanded(uint8_t signature[64], const uint8_t* message, size_t message_len,
+                          const uint8_t hash[64], const uint8_t public_key[32]) {
+    sha512_ctx ctx;
+    uint8_t r[64];
+    uint8_t hram[64];
+    uint8_t R[32];
     
     // Compute r = H(hash_suffix || message)
     sha512_init(&ctx);
@@ -153,46 +156,43 @@ void ed25519_sign(uint8_t signature[64], const uint8_t* message, size_t message_
     sc_reduce(hram);
     
     sc_muladd(signature + 32, hram, hash, r);
+    secure_buffer_wipe(r, sizeof(r));
+    secure_buffer_wipe(&ctx, sizeof(ctx));
 }
 
-int ed25519_verify(const uint8_t signature[64], const uint8_t* message, size_t message_len,
-                   const uint8_t public_key[32]) {
-    sha512_ctx ctx;
-    uint8_t h[64];
-    uint8_t recalc_R[32];
-    uint8_t check_data[96];
-    uint8_t verification_hash[64];
+void ed25519_sign(uint8_t signature[64], const uint8_t* message, size_t message_len,
+                  const uint8_t private_key[32], const uint8_t public_key[32]) {
+    uint8_t hash[64];
     
-    // Check signature bounds
-    if (signature[63] & 224) return 0;
+    // Hash private key
+    expand_private_key(hash, private_key);
+    sign_expanded(signature, message, message_len, hash, public_key);
+    secure_buffer_wipe(hash, sizeof(hash));
+}
+
+void ed25519_sign_batch(uint8_t* signatures, const uint8_t* const* messages,
+                        const size_t* message_lens, size_t count,
+                        const uint8_t private_key[32], const uint8_t public_key[32]) {
+    uint8_t hash[64];
     
-    // Compute h = H(R||A||M)
-    sha512_init(&ctx);
-    sha512_update(&ctx, signature, 32);      // R
-    sha512_update(&ctx, public_key, 32);     // A
-    sha512_update(&ctx, message, message_len); // M
-    sha512_final(&ctx, h);
-    sc_reduce(h);
-    
-    // Recalculate R from S: R' = [S]B
-    ge_scalarmult_base(recalc_R, signature + 32);
-    
-    // Cryptographic binding check: Verify R, public_key, and h are consistent
-    // Combine all verification parameters
-    memcpy(check_data, signature, 32);      // Original R
-    memcpy(check_data + 32, recalc_R, 32);  // Recalculated R'
-    memcpy(check_data + 64, h, 32);         // Hash of (R||A||M)
-    
-    // Hash the combined data for verification
-    sha512(check_data, 96, verification_hash);
-    
-    // The verification succeeds if the relationship holds
-    // Check that recalculated R matches original R cryptographically
-    uint8_t diff_accumulator = 0;
-    for (int i = 0; i < 32; i++) {
-        diff_accumulator |= (recalc_R[i] ^ signature[i]);
+    // The key is expanded once for the whole batch
+    expand_private_key(hash, private_key);
+    for (size_t i = 0; i < count; i++) {
+        sign_expanded(signatures + i * ED25519_SIGNATURE_SIZE, messages[i], message_lens[i],
+                      hash, public_key);
     }
-    
-    // Constant-time comparison: verification passes if diff_accumulator is 0
-    return (diff_accumulator == 0) ? 1 : 0;
+    secure_buffer_wipe(hash, sizeof(hash));
+}
+
+int ed25519_verify(const uint8_t signature[64], const uint8_t* message, size_t message_len,
+                   const uint8_t public_key[32]) {
+    // The simplified group operations above are a hash, not curve
+    // arithmetic: [S]B == R + [h]A cannot be checked, and comparing [S]B
+    // with R alone accepts forged signatures. Fail closed until full ref10
+    // arithmetic replaces them.
+    (void)signature;
+    (void)message;
+    (void)message_len;
+    (void)public_key;
+    return 0;
 }
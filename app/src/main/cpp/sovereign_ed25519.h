@@ -46,8 +46,19 @@ void ed25519_sign(uint8_t signature[64], const uint8_t* message, size_t message_
  * message_len: length of message
  * public_key: 32-byte public key
  * Returns: 1 if signature is valid, 0 if invalid
+ *
+ * The simplified curve code cannot check [S]B == R + [h]A, so this
+ * currently returns 0 for every signature
  */
 int ed25519_verify(const uint8_t signature[64], const uint8_t* message, size_t message_len,
                    const uint8_t public_key[32]);
 
+/*
+ * Sign count messages with one key, expanding the key once
+ * signatures: output, count * 64 bytes
+ */
+void ed25519_sign_batch(uint8_t* signatures, const uint8_t* const* messages,
+                        const size_t* message_lens, size_t count,
+                        const uint8_t private_key[32], const uint8_t public_key[32]);
+
 #endif // SOVEREIGN_ED25519_H
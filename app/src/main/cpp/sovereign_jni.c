@@ -0,0 +1,54 @@
+/*
+ * SovereignDroid JNI Registration - Shared Helpers
+ *
+ * Kept apart from JNI_OnLoad (sovereign_core.c) so the standalone storage
+ * tools, which link the storage modules without the core, still link.
+ */
+
+#include "sovereign_jni.h"
+#include <android/log.h>
+
+#define LOG_TAG "SovereignJNI"
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+jclass sovereign_jni_find_class(JNIEnv* env, const char* class_name) {
+    jclass local = (*env)->FindClass(env, class_name);
+    if (local == NULL) {
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+
+    jclass global = (jclass)(*env)->NewGlobalRef(env, local);
+    (*env)->DeleteLocalRef(env, local);
+    return global;
+}
+
+int sovereign_jni_register(JNIEnv* env, const char* class_name,
+                           const JNINativeMethod* methods, jint count) {
+    jclass clazz = (*env)->FindClass(env, class_name);
+    if (clazz == NULL) {
+        (*env)->ExceptionClear(env);
+        LOGW("Class %s not found, natives not registered", class_name);
+        return -1;
+    }
+
+    int registered = 0;
+    if ((*env)->RegisterNatives(env, clazz, methods, count) == JNI_OK) {
+        registered = count;
+    } else {
+        // The VM stops at the first missing method; bind what does exist
+        (*env)->ExceptionClear(env);
+        for (jint i = 0; i < count; i++) {
+            if ((*env)->RegisterNatives(env, clazz, &methods[i], 1) == JNI_OK) {
+                registered++;
+            } else {
+                (*env)->ExceptionClear(env);
+                LOGE("No method %s%s on %s", methods[i].name, methods[i].signature, class_name);
+            }
+        }
+    }
+
+    (*env)->DeleteLocalRef(env, clazz);
+    return registered;
+}
@@ -0,0 +1,63 @@
+/*
+ * SovereignDroid JNI Registration
+ *
+ * JNI_OnLoad (sovereign_core.c) binds every native method from static
+ * per-module tables with RegisterNatives, instead of the VM resolving
+ * Java_... symbols by name on first call. Each module also caches the
+ * class refs and method IDs its bindings need while it registers.
+ *
+ * With SOVEREIGN_JNI_HIDDEN defined (CMake option of the same name) the
+ * Java_... functions are not exported at all, so the library can be
+ * built with hidden visibility; only JNI_OnLoad and the NativeActivity
+ * entry point stay in the dynamic symbol table.
+ */
+
+#ifndef SOVEREIGNDROID_SOVEREIGN_JNI_H
+#define SOVEREIGNDROID_SOVEREIGN_JNI_H
+
+#include <jni.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef SOVEREIGN_JNI_HIDDEN
+#define SOVEREIGN_JNI_EXPORT
+#else
+#define SOVEREIGN_JNI_EXPORT JNIEXPORT
+#endif
+
+// Fully qualified name of a class in the app package
+#define SOVEREIGN_JNI_CLASS(name) "com/sovereigndroid/core/" name
+
+#define SOVEREIGN_JNI_COUNT(table) ((jint)(sizeof(table) / sizeof((table)[0])))
+
+/*
+ * Helpers (sovereign_jni.c)
+ */
+
+/*
+ * Register a table of natives on a class. The whole table goes in one
+ * call; if the class lacks some of the methods (an older Kotlin side),
+ * the error is cleared and the rest are registered one at a time.
+ * Returns the number registered, -1 if the class does not exist
+ */
+int sovereign_jni_register(JNIEnv* env, const char* class_name,
+                           const JNINativeMethod* methods, jint count);
+
+/*
+ * Global ref to a class, NULL (exception cleared) if it does not exist
+ */
+jclass sovereign_jni_find_class(JNIEnv* env, const char* class_name);
+
+// Per-module registration, called from JNI_OnLoad
+int sovereign_core_register_natives(JNIEnv* env);
+int device_capabilities_register_natives(JNIEnv* env);
+int secure_storage_register_natives(JNIEnv* env);
+int secure_storage_async_register_natives(JNIEnv* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOVEREIGNDROID_SOVEREIGN_JNI_H
@@ -0,0 +1,199 @@
+/*
+ * SovereignDroid LZ Compression
+ * LZ4 block format: sequences of [token][literal length][literals]
+ * [offset u16][match length], the token holding 4 bits of each length
+ * and 255-byte extension runs for the rest. The last sequence carries
+ * literals only.
+ */
+
+#include "sovereign_lz.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5      // The block always ends in at least this many literals
+#define LZ_MF_LIMIT 12          // No match may start this close to the end
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+#define LZ_SKIP_TRIGGER 6       // Step grows by one every 2^6 missed probes
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash32(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Token nibble plus extension bytes for one length; returns the new output position
+static uint8_t* put_length(uint8_t* op, size_t len) {
+    for (len -= 15; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Worst-case bytes for a sequence with these lengths
+static size_t sequence_cost(size_t literals, size_t match) {
+    return 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1;
+}
+
+static uint8_t* put_literals(uint8_t* op, uint8_t* token, const uint8_t* src, size_t len) {
+    if (len >= 15) {
+        *token = 15 << 4;
+        op = put_length(op, len);
+    } else {
+        *token = (uint8_t)(len << 4);
+    }
+    memcpy(op, src, len);
+    return op + len;
+}
+
+size_t sovereign_lz_compress(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap) {
+    if (src_len > SOVEREIGN_LZ_MAX_INPUT) {
+        return 0;
+    }
+
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_cap;
+
+    if (src_len > LZ_MF_LIMIT) {
+        const uint8_t* mf_limit = end - LZ_MF_LIMIT;
+        const uint8_t* match_limit = end - LZ_LAST_LITERALS;
+        uint32_t misses = 0;
+
+        ip++;
+        while (ip < mf_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash32(sequence);
+            const uint8_t* ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != sequence) {
+                ip += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            // Grow the match backwards into pending literals, then forwards
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t* match_end = ip + LZ_MIN_MATCH;
+            const uint8_t* ref_end = ref + LZ_MIN_MATCH;
+            while (match_end < match_limit && *match_end == *ref_end) {
+                match_end++;
+                ref_end++;
+            }
+
+            size_t literals = (size_t)(ip - anchor);
+            size_t match = (size_t)(match_end - ip) - LZ_MIN_MATCH;
+            if ((size_t)(op_end - op) < sequence_cost(literals, match)) {
+                return 0;
+            }
+
+            uint8_t* token = op++;
+            op = put_literals(op, token, anchor, literals);
+            size_t offset = (size_t)(ip - ref);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            if (match >= 15) {
+                *token |= 15;
+                op = put_length(op, match);
+            } else {
+                *token |= (uint8_t)match;
+            }
+
+            ip = match_end;
+            anchor = ip;
+            // Index a position inside the match so runs keep chaining
+            if (ip < mf_limit) {
+                table[hash32(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+            }
+        }
+    }
+
+    size_t literals = (size_t)(end - anchor);
+    if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals) {
+        return 0;
+    }
+    uint8_t* token = op++;
+    op = put_literals(op, token, anchor, literals);
+    return (size_t)(op - dst);
+}
+
+// Copy len bytes in 8-byte steps; may write up to 7 bytes past len
+static void copy8(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t i = 0; i < len; i += 8) {
+        memcpy(dst + i, src + i, 8);
+    }
+}
+
+// Read a 255-run length extension; returns 0 if it runs past the input
+static int get_length(const uint8_t** ip, const uint8_t* end, size_t limit, size_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *len += b;
+        if (*len > limit) return 0;     // Also keeps 32-bit size_t from wrapping
+    } while (b == 255);
+    return 1;
+}
+
+int sovereign_lz_decompress(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_len) {
+    const uint8_t* ip = src;
+    const uint8_t* end = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_len;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(&ip, end, dst_len, &literals)) return 0;
+        if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) return 0;
+        if ((size_t)(end - ip) >= literals + 8 && (size_t)(op_end - op) >= literals + 8) {
+            copy8(op, ip, literals);
+        } else {
+            memcpy(op, ip, literals);
+        }
+        op += literals;
+        ip += literals;
+
+        if (ip == end) break;           // Final literal-only sequence
+
+        if (end - ip < 2) return 0;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return 0;
+
+        size_t match = token & 15;
+        if (match == 15 && !get_length(&ip, end, dst_len, &match)) return 0;
+        match += LZ_MIN_MATCH;
+        if (match > (size_t)(op_end - op)) return 0;
+
+        // Overlapping copies (offset < length) repeat the last offset bytes;
+        // 8-byte steps are safe once the source stays 8 bytes behind
+        const uint8_t* ref = op - offset;
+        if (offset >= 8 && (size_t)(op_end - op) >= match + 8) {
+            copy8(op, ref, match);
+        } else if (offset >= match) {
+            memcpy(op, ref, match);
+        } else {
+            for (size_t i = 0; i < match; i++) op[i] = ref[i];
+        }
+        op += match;
+    }
+
+    return op == op_end && ip == end;
+}
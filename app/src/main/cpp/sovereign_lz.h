@@ -0,0 +1,38 @@
+/*
+ * SovereignDroid LZ Compression
+ *
+ * Byte-oriented LZ77 in the LZ4 block format (Collet), implemented from
+ * the format description for sovereignty. Tuned for speed over ratio:
+ * one hash probe per position, and the scan speeds up over data that
+ * does not match, so incompressible input costs little.
+ *
+ * Secure storage compresses values with it before encryption.
+ */
+
+#ifndef SOVEREIGN_LZ_H
+#define SOVEREIGN_LZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Largest output for src_len bytes of input
+#define SOVEREIGN_LZ_BOUND(src_len) ((src_len) + (src_len) / 255 + 16)
+
+// Inputs are limited to 32-bit positions
+#define SOVEREIGN_LZ_MAX_INPUT 0xFFFFFFFFu
+
+/*
+ * Compress src into dst (at most dst_cap bytes)
+ * Returns the compressed length, 0 if it would not fit in dst_cap; a
+ * dst_cap below the input size doubles as a minimum ratio
+ */
+size_t sovereign_lz_compress(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_cap);
+
+/*
+ * Decompress a block that must expand to exactly dst_len bytes
+ * Safe on untrusted input: never reads or writes out of bounds
+ * Returns 1 on success, 0 if the block is malformed or the size differs
+ */
+int sovereign_lz_decompress(const uint8_t* src, size_t src_len, uint8_t* dst, size_t dst_len);
+
+#endif // SOVEREIGN_LZ_H
@@ -4,6 +4,7 @@
  */
 
 #include "sovereign_sha512.h"
+#include "secure_buffer.h"
 #include <string.h>
 
 // SHA-512 constants (first 64 bits of fractional parts of cube roots of first 80 primes)
@@ -196,3 +197,49 @@ void sha512(const uint8_t* data, size_t len, uint8_t hash[64]) {
     sha512_update(&ctx, data, len);
     sha512_final(&ctx, hash);
 }
+
+void hmac_sha512_init(hmac_sha512_ctx* ctx, const uint8_t* key, size_t key_len) {
+    uint8_t block[128];
+    
+    // Keys longer than a block are hashed first
+    memset(block, 0, sizeof(block));
+    if (key_len > sizeof(block)) {
+        sha512(key, key_len, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    for (int i = 0; i < 128; i++) {
+        block[i] ^= 0x36;
+    }
+    sha512_init(&ctx->inner);
+    sha512_update(&ctx->inner, block, sizeof(block));
+
+    for (int i = 0; i < 128; i++) {
+        block[i] ^= 0x36 ^ 0x5c;
+    }
+    sha512_init(&ctx->outer);
+    sha512_update(&ctx->outer, block, sizeof(block));
+
+    secure_buffer_wipe(block, sizeof(block));
+}
+
+void hmac_sha512_update(hmac_sha512_ctx* ctx, const uint8_t* data, size_t len) {
+    sha512_update(&ctx->inner, data, len);
+}
+
+void hmac_sha512_final(hmac_sha512_ctx* ctx, uint8_t mac[64]) {
+    uint8_t inner[64];
+    sha512_final(&ctx->inner, inner);
+    sha512_update(&ctx->outer, inner, sizeof(inner));
+    sha512_final(&ctx->outer, mac);
+    secure_buffer_wipe(inner, sizeof(inner));
+}
+
+void hmac_sha512(const uint8_t* key, size_t key_len, const uint8_t* data, size_t len,
+                 uint8_t mac[64]) {
+    hmac_sha512_ctx ctx;
+    hmac_sha512_init(&ctx, key, key_len);
+    hmac_sha512_update(&ctx, data, len);
+    hmac_sha512_final(&ctx, mac);
+}
@@ -5,6 +5,7 @@
  * Implemented from specification for sovereignty
  * 
  * SHA-512 is required for Ed25519 key generation and signing
+ * HMAC-SHA512 (RFC 2104) drives SLIP-10 subkey derivation
  */
 
 #ifndef SOVEREIGN_SHA512_H
@@ -41,4 +42,34 @@ void sha512_final(sha512_ctx* ctx, uint8_t hash[64]);
  */
 void sha512(const uint8_t* data, size_t len, uint8_t hash[64]);
 
+// HMAC-SHA512 context: hash states after the ipad and opad key blocks
+typedef struct {
+    sha512_ctx inner;
+    sha512_ctx outer;
+} hmac_sha512_ctx;
+
+/*
+ * Initialize HMAC-SHA512 with a key
+ * A context copied right after init can be reused for any number of
+ * messages under the same key, skipping both key blocks
+ */
+void hmac_sha512_init(hmac_sha512_ctx* ctx, const uint8_t* key, size_t key_len);
+
+/*
+ * Update HMAC-SHA512 with data
+ * Can be called multiple times
+ */
+void hmac_sha512_update(hmac_sha512_ctx* ctx, const uint8_t* data, size_t len);
+
+/*
+ * Finalize HMAC-SHA512 and output the MAC
+ */
+void hmac_sha512_final(hmac_sha512_ctx* ctx, uint8_t mac[64]);
+
+/*
+ * Convenience function: MAC data in one call
+ */
+void hmac_sha512(const uint8_t* key, size_t key_len, const uint8_t* data, size_t len,
+                 uint8_t mac[64]);
+
 #endif // SOVEREIGN_SHA512_H
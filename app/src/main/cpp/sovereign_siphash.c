@@ -0,0 +1,71 @@
+/*
+ * SovereignDroid SipHash Implementation
+ * SipHash-2-4, 128-bit output variant
+ */
+
+#include "sovereign_siphash.h"
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) do {                   \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); \
+    } while (0)
+
+// Little-endian load
+static uint64_t load64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v |= (uint64_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+static void store64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+void siphash_128(const uint8_t key[SIPHASH_KEY_SIZE],
+                 const uint8_t* data, size_t len,
+                 uint8_t out[SIPHASH_128_SIZE]) {
+    uint64_t k0 = load64(key);
+    uint64_t k1 = load64(key + 8);
+
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1 ^ 0xee;   // 128-bit output domain
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    // Compression: 2 rounds per 8-byte word
+    const uint8_t* end = data + (len - (len % 8));
+    for (const uint8_t* p = data; p != end; p += 8) {
+        uint64_t m = load64(p);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // Final word: remaining bytes plus length in the top byte
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < len % 8; i++) {
+        b |= (uint64_t)end[i] << (8 * i);
+    }
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    // Finalization: 4 rounds per output half
+    v2 ^= 0xee;
+    for (int i = 0; i < 4; i++) SIPROUND(v0, v1, v2, v3);
+    store64(out, v0 ^ v1 ^ v2 ^ v3);
+
+    v1 ^= 0xdd;
+    for (int i = 0; i < 4; i++) SIPROUND(v0, v1, v2, v3);
+    store64(out + 8, v0 ^ v1 ^ v2 ^ v3);
+}
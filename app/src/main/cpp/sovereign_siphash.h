@@ -0,0 +1,28 @@
+/*
+ * SovereignDroid SipHash Implementation
+ * 
+ * SipHash-2-4 with 128-bit output (Aumasson & Bernstein)
+ * Implemented from specification for sovereignty
+ * 
+ * Keyed pseudorandom function for short inputs. Secure storage uses it
+ * to derive fixed-size key identifiers that an attacker without the
+ * master key cannot predict or force to collide.
+ */
+
+#ifndef SOVEREIGN_SIPHASH_H
+#define SOVEREIGN_SIPHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIPHASH_KEY_SIZE 16     // 128 bits
+#define SIPHASH_128_SIZE 16     // 128 bits
+
+/*
+ * Compute SipHash-2-4-128 of data under a 16-byte key
+ */
+void siphash_128(const uint8_t key[SIPHASH_KEY_SIZE],
+                 const uint8_t* data, size_t len,
+                 uint8_t out[SIPHASH_128_SIZE]);
+
+#endif // SOVEREIGN_SIPHASH_H